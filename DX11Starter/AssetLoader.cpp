@@ -0,0 +1,283 @@
+#include "AssetLoader.h"
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include "TextureData.h"
+
+// Asset names are only for messages and Find, and every path
+// here is plain ASCII
+static std::string NarrowName(const std::wstring& name)
+{
+	std::string narrow(name.size(), '?');
+	for (size_t i = 0; i < name.size(); i++)
+	{
+		if (name[i] < 128)
+			narrow[i] = (char)name[i];
+	}
+	return narrow;
+}
+
+AssetLoader::AssetLoader(JobSystem* jobs, ID3D11Device* device, ID3D11DeviceContext* context)
+{
+	this->jobs = jobs;
+	this->device = device;
+	this->context = context;
+	started = false;
+	finishedCount = 0;
+	failedCount = 0;
+	loadedCount = 0;
+}
+
+AssetLoader::~AssetLoader()
+{
+	// Loads still running would write into assets we no longer own
+	jobs->Wait(&pending);
+}
+
+int AssetLoader::Add(std::string name, LoadFunction load, FinishFunction finish)
+{
+	// Workers index into the list, so it can't grow once they're running
+	if (started)
+	{
+		printf("Asset %s was added after loading started\n", name.c_str());
+		return -1;
+	}
+
+	Asset asset;
+	asset.Name = name;
+	asset.Load = load;
+	asset.Finish = finish;
+	asset.Done = nullptr;
+	asset.DependencyCount = 0;
+	asset.Remaining = 0;
+	asset.Failed = false;
+	assets.push_back(asset);
+	return (int)assets.size() - 1;
+}
+
+void AssetLoader::AddDependency(int dependency, int asset)
+{
+	if (started || dependency < 0 || asset < 0) return;
+	assets[dependency].Dependents.push_back(asset);
+	assets[asset].DependencyCount++;
+}
+
+void AssetLoader::AddDependencies(int asset, const std::vector<int>& dependencies)
+{
+	for (int dependency : dependencies)
+		AddDependency(dependency, asset);
+}
+
+int AssetLoader::AddTexture(std::wstring path, ID3D11ShaderResourceView** srv, FinishFunction done)
+{
+	*srv = nullptr;
+	std::string name = NarrowName(path);
+	std::shared_ptr<TextureData> data = std::make_shared<TextureData>();
+	int asset = Add(name,
+		[path, data]() {
+			return LoadTextureData(path, *data);
+		},
+		[this, name, data, srv]() {
+			if (!CreateTextureFromData(device, context, *data, srv))
+				printf("Failed to create texture %s\n", name.c_str());
+
+			// The pixels are on the GPU now
+			*data = TextureData();
+		});
+	if (asset >= 0) assets[asset].Done = done;
+	return asset;
+}
+
+int AssetLoader::AddMesh(std::string path, Mesh** mesh, MeshVertexFormat format, FinishFunction done)
+{
+	Mesh* target = new Mesh(format);
+	*mesh = target;
+	JobSystem* meshJobs = jobs;
+	int asset = Add(path,
+		[path, target, meshJobs]() {
+			return target->Load(path.c_str(), meshJobs);
+		},
+		[this, target]() {
+			target->CreateBuffers(device);
+		});
+	if (asset < 0)
+	{
+		// Nothing will ever load it
+		delete target;
+		*mesh = nullptr;
+		return -1;
+	}
+	assets[asset].Done = done;
+	return asset;
+}
+
+int AssetLoader::AddShader(std::wstring file, ISimpleShader* shader)
+{
+	return Add(NarrowName(file),
+		[file, shader]() {
+			std::wstring debugPath = L"x64/Debug/" + file;
+			return shader->ReadShaderFile(debugPath.c_str()) || shader->ReadShaderFile(file.c_str());
+		},
+		[shader]() {
+			shader->CreateShaderObjects();
+		});
+}
+
+int AssetLoader::Find(const std::string& name)
+{
+	for (size_t i = 0; i < assets.size(); i++)
+	{
+		if (assets[i].Name == name) return (int)i;
+	}
+	return -1;
+}
+
+// --------------------------------------------------------
+// Kahn's algorithm, as in JobGraph - anything that never
+// becomes ready is waiting on itself
+// --------------------------------------------------------
+bool AssetLoader::HasCycle()
+{
+	std::vector<int> incoming(assets.size());
+	std::vector<int> ready;
+	for (size_t i = 0; i < assets.size(); i++)
+	{
+		incoming[i] = assets[i].DependencyCount;
+		if (incoming[i] == 0) ready.push_back((int)i);
+	}
+
+	size_t visited = 0;
+	while (!ready.empty())
+	{
+		int asset = ready.back();
+		ready.pop_back();
+		visited++;
+		for (int dependent : assets[asset].Dependents)
+		{
+			if (--incoming[dependent] == 0)
+				ready.push_back(dependent);
+		}
+	}
+	return visited != assets.size();
+}
+
+bool AssetLoader::Start()
+{
+	if (started) return true;
+	if (HasCycle())
+	{
+		printf("Asset dependencies form a cycle!\n");
+		return false;
+	}
+	started = true;
+
+	for (size_t i = 0; i < assets.size(); i++)
+		assets[i].Remaining = assets[i].DependencyCount;
+
+	for (size_t i = 0; i < assets.size(); i++)
+	{
+		if (assets[i].DependencyCount == 0)
+			Queue((int)i);
+	}
+	return true;
+}
+
+// --------------------------------------------------------
+// Sends an asset's load to a worker.  Assets without one go
+// straight to the finish queue.
+// --------------------------------------------------------
+void AssetLoader::Queue(int asset)
+{
+	if (!assets[asset].Load)
+	{
+		OnLoaded(asset, true);
+		return;
+	}
+
+	jobs->Run([this, asset]() {
+		OnLoaded(asset, assets[asset].Load());
+	}, &pending);
+}
+
+void AssetLoader::OnLoaded(int asset, bool succeeded)
+{
+	std::lock_guard<std::mutex> lock(loadedMutex);
+	assets[asset].Failed = !succeeded;
+	loaded.push_back(asset);
+	loadedCount++;
+}
+
+// --------------------------------------------------------
+// Creates an asset's GPU resources and queues whatever was
+// only waiting for it
+// --------------------------------------------------------
+void AssetLoader::FinishAsset(int asset)
+{
+	// Failed assets still release their dependents, which just
+	// see a null resource - the same as loading them one after
+	// another always did
+	Asset& current = assets[asset];
+	if (current.Failed)
+	{
+		printf("Couldn't load %s\n", current.Name.c_str());
+		failedCount++;
+	}
+	else if (current.Finish)
+	{
+		current.Finish();
+	}
+	if (current.Done)
+		current.Done();
+	finishedCount++;
+
+	for (int dependent : current.Dependents)
+	{
+		if (--assets[dependent].Remaining == 0)
+			Queue(dependent);
+	}
+}
+
+bool AssetLoader::Update(float budgetSeconds)
+{
+	typedef std::chrono::steady_clock Clock;
+	Clock::time_point start = Clock::now();
+
+	while (finishedCount < assets.size())
+	{
+		int asset = -1;
+		{
+			std::lock_guard<std::mutex> lock(loadedMutex);
+			if (!loaded.empty())
+			{
+				asset = loaded.front();
+				loaded.pop_front();
+			}
+		}
+
+		if (asset >= 0)
+		{
+			FinishAsset(asset);
+		}
+		else if (!jobs->TryRunJob())
+		{
+			// Nothing to finish and nothing left to help with -
+			// the rest is already running on the workers
+			break;
+		}
+
+		std::chrono::duration<float> elapsed = Clock::now() - start;
+		if (elapsed.count() >= budgetSeconds) break;
+	}
+	return IsDone();
+}
+
+float AssetLoader::GetProgress()
+{
+	if (assets.empty()) return 1.0f;
+	return (loadedCount.load() + finishedCount) / (2.0f * assets.size());
+}
+
+bool AssetLoader::IsDone()
+{
+	return started && finishedCount == assets.size();
+}
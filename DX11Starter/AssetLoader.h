@@ -0,0 +1,110 @@
+#pragma once
+#include <d3d11.h>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "JobSystem.h"
+#include "Mesh.h"
+#include "SimpleShader.h"
+
+// --------------------------------------------------------
+// Loads assets across the job system.  Each asset has up to
+// two steps:
+//
+// Load   - File I/O, decoding and processing.  Runs on a
+//          worker, so it mustn't touch the device context.
+// Finish - Creates the GPU resources from what Load produced.
+//          Runs on the thread that calls Update.
+//
+// Assets only start loading once everything they depend on
+// has finished, so a material can wait for its texture and
+// shaders and an entity for its mesh and material, while
+// everything independent loads side by side.
+// --------------------------------------------------------
+class AssetLoader
+{
+public:
+	typedef std::function<bool()> LoadFunction;
+	typedef std::function<void()> FinishFunction;
+
+	AssetLoader(JobSystem* jobs, ID3D11Device* device, ID3D11DeviceContext* context);
+	~AssetLoader();
+
+	// Either step may be null.  Returns a handle for AddDependency.
+	int Add(std::string name, LoadFunction load, FinishFunction finish);
+
+	// "asset" won't start loading until "dependency" has finished
+	void AddDependency(int dependency, int asset);
+	void AddDependencies(int asset, const std::vector<int>& dependencies);
+
+	// WIC images are decoded on a worker, DDS files read there;
+	// the texture (with mips) is created when it finishes
+	//
+	// done - Optional, runs on the owning thread once the asset
+	//        is finished with, whether or not it loaded
+	int AddTexture(std::wstring path, ID3D11ShaderResourceView** srv, FinishFunction done = nullptr);
+
+	// The mesh exists right away, but is empty until it finishes.
+	// Null (and -1 returned) if loading has already started.
+	int AddMesh(std::string path, Mesh** mesh, MeshVertexFormat format = MeshVertexFormat::Float,
+		FinishFunction done = nullptr);
+
+	// Reads and reflects the shader on a worker, trying the
+	// Visual Studio output directory first (see Game::LoadShaders)
+	int AddShader(std::wstring file, ISimpleShader* shader);
+
+	// Handle of the asset with this name, or -1
+	int Find(const std::string& name);
+
+	// Queues everything with no dependencies.  Returns false
+	// without starting anything if the dependencies form a cycle.
+	bool Start();
+
+	// Finishes loaded assets until the time budget runs out (the
+	// first one always finishes), helping with the loads when
+	// nothing is ready.  Returns true once all are done.
+	bool Update(float budgetSeconds);
+
+	// 0 to 1 - loading and finishing each count for half an asset
+	float GetProgress();
+	bool IsDone();
+	unsigned int GetFailedCount() { return failedCount; }
+
+private:
+	struct Asset
+	{
+		std::string Name;
+		LoadFunction Load;
+		FinishFunction Finish;
+		FinishFunction Done;	// After Finish, or instead if the load failed
+		std::vector<int> Dependents;
+		int DependencyCount;
+		int Remaining;
+		bool Failed;
+	};
+
+	JobSystem* jobs;
+	ID3D11Device* device;
+	ID3D11DeviceContext* context;
+
+	std::vector<Asset> assets;
+	bool started;
+	unsigned int finishedCount;
+	unsigned int failedCount;
+
+	// Filled by the workers, emptied by Update
+	std::mutex loadedMutex;
+	std::deque<int> loaded;
+	std::atomic<unsigned int> loadedCount;
+
+	// Every queued load, so the destructor can wait them out
+	JobCounter pending;
+
+	bool HasCycle();
+	void Queue(int asset);
+	void OnLoaded(int asset, bool succeeded);
+	void FinishAsset(int asset);
+};
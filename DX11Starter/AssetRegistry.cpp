@@ -0,0 +1,394 @@
+#include "AssetRegistry.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <vector>
+#include "TextureData.h"
+
+// --------------------------------------------------------
+// One registered asset.  Handles point straight at these, so
+// they live in their own allocations and never move.
+// --------------------------------------------------------
+struct AssetHandle::Entry
+{
+	AssetRegistry* Registry;
+	std::string Key;
+	AssetClass Class;
+	ID3D11ShaderResourceView* Texture;
+	Mesh* MeshAsset;
+	size_t Bytes;				// Measured once the load finishes
+	int RefCount;
+	unsigned long long LastUsed;
+	AssetLoader* Loader;		// The one LoadHandle belongs to
+	int LoadHandle;
+	bool Loading;
+};
+
+static const char* ClassNames[] = { "Textures", "Meshes" };
+
+AssetClassStats::AssetClassStats()
+{
+	Count = 0;
+	Referenced = 0;
+	Bytes = 0;
+	ReferencedBytes = 0;
+	Budget = 0;
+	Loads = 0;
+	Hits = 0;
+	Evictions = 0;
+}
+
+// --------------------------------------------------------
+// Handles
+// --------------------------------------------------------
+AssetHandle::AssetHandle()
+{
+	entry = nullptr;
+}
+
+AssetHandle::AssetHandle(Entry* entry)
+{
+	this->entry = entry;
+	if (entry)
+	{
+		entry->RefCount++;
+		entry->Registry->Touch(entry);
+	}
+}
+
+AssetHandle::AssetHandle(const AssetHandle& other)
+	: AssetHandle(other.entry)
+{
+}
+
+AssetHandle& AssetHandle::operator=(const AssetHandle& other)
+{
+	// The other handle keeps its asset referenced, so releasing
+	// ours first can't evict it
+	if (other.entry != entry)
+	{
+		Release();
+		entry = other.entry;
+		if (entry)
+		{
+			entry->RefCount++;
+			entry->Registry->Touch(entry);
+		}
+	}
+	return *this;
+}
+
+AssetHandle::~AssetHandle()
+{
+	Release();
+}
+
+// --------------------------------------------------------
+// Drops this reference.  The asset itself stays cached until
+// its class needs the room.
+// --------------------------------------------------------
+void AssetHandle::Release()
+{
+	if (!entry) return;
+
+	Entry* released = entry;
+	entry = nullptr;
+	released->RefCount--;
+	released->Registry->Touch(released);
+	if (released->RefCount == 0)
+		released->Registry->TrimClass(released->Class);
+}
+
+ID3D11ShaderResourceView* AssetHandle::GetTexture() const
+{
+	if (!entry) return nullptr;
+	return entry->Texture;
+}
+
+Mesh* AssetHandle::GetMesh() const
+{
+	if (!entry) return nullptr;
+	return entry->MeshAsset;
+}
+
+int AssetHandle::GetLoadHandle(const AssetLoader& loader) const
+{
+	// Handles are indices into one loader's list - in any other
+	// they'd name an unrelated asset
+	if (!entry || !entry->Loading || entry->Loader != &loader) return -1;
+	return entry->LoadHandle;
+}
+
+// --------------------------------------------------------
+// Registry
+// --------------------------------------------------------
+AssetRegistry::AssetRegistry()
+{
+	// Generous - this is about catching leaks and runaway
+	// caches rather than squeezing into a small card
+	budgets[(int)AssetClass::Texture] = 256 * 1024 * 1024;
+	budgets[(int)AssetClass::Mesh] = 64 * 1024 * 1024;
+	for (int i = 0; i < (int)AssetClass::Count; i++)
+	{
+		loads[i] = 0;
+		hits[i] = 0;
+		evictions[i] = 0;
+	}
+	useClock = 0;
+}
+
+AssetRegistry::~AssetRegistry()
+{
+	for (auto& pair : entries)
+	{
+		if (pair.second->RefCount > 0)
+			printf("Asset %s is still referenced\n", pair.first.c_str());
+		Destroy(*pair.second);
+	}
+}
+
+std::string AssetRegistry::CanonicalizePath(const std::string& path)
+{
+	// Windows paths aren't case sensitive, and take either slash
+	std::string lower = path;
+	for (char& c : lower)
+	{
+		if (c == '\\') c = '/';
+		else c = (char)tolower((unsigned char)c);
+	}
+
+	std::vector<std::string> parts;
+	size_t start = 0;
+	while (start <= lower.size())
+	{
+		size_t end = lower.find('/', start);
+		if (end == std::string::npos) end = lower.size();
+		std::string part = lower.substr(start, end - start);
+		start = end + 1;
+
+		if (part.empty() || part == ".") continue;
+		if (part == ".." && !parts.empty() && parts.back() != "..")
+			parts.pop_back();
+		else
+			parts.push_back(part);
+	}
+
+	std::string canonical;
+	for (size_t i = 0; i < parts.size(); i++)
+	{
+		if (i > 0) canonical += '/';
+		canonical += parts[i];
+	}
+	return canonical;
+}
+
+AssetHandle::Entry* AssetRegistry::Find(const std::string& key)
+{
+	auto found = entries.find(key);
+	return found == entries.end() ? nullptr : found->second.get();
+}
+
+AssetHandle::Entry* AssetRegistry::Insert(const std::string& key, AssetClass assetClass, AssetLoader& loader)
+{
+	std::unique_ptr<AssetHandle::Entry> entry(new AssetHandle::Entry());
+	entry->Registry = this;
+	entry->Key = key;
+	entry->Class = assetClass;
+	entry->Texture = nullptr;
+	entry->MeshAsset = nullptr;
+	entry->Bytes = 0;
+	entry->RefCount = 0;
+	entry->LastUsed = 0;
+	entry->Loader = &loader;
+	entry->LoadHandle = -1;
+	entry->Loading = true;
+
+	AssetHandle::Entry* inserted = entry.get();
+	entries[key] = std::move(entry);
+	loads[(int)assetClass]++;
+	return inserted;
+}
+
+// --------------------------------------------------------
+// Takes back an Insert whose load couldn't be queued - left
+// in, it would stay Loading, and unevictable, forever
+// --------------------------------------------------------
+void AssetRegistry::Remove(AssetHandle::Entry* entry)
+{
+	loads[(int)entry->Class]--;
+	std::string key = entry->Key;
+	Destroy(*entry);
+	entries.erase(key);
+}
+
+void AssetRegistry::Touch(AssetHandle::Entry* entry)
+{
+	entry->LastUsed = ++useClock;
+}
+
+AssetHandle AssetRegistry::LoadTexture(AssetLoader& loader, const std::wstring& path)
+{
+	// Every texture path here is plain ASCII
+	std::string narrow(path.size(), '?');
+	for (size_t i = 0; i < path.size(); i++)
+	{
+		if (path[i] < 128) narrow[i] = (char)path[i];
+	}
+
+	std::string key = "texture:" + CanonicalizePath(narrow);
+	AssetHandle::Entry* entry = Find(key);
+	if (entry)
+	{
+		hits[(int)AssetClass::Texture]++;
+		return AssetHandle(entry);
+	}
+
+	entry = Insert(key, AssetClass::Texture, loader);
+	entry->LoadHandle = loader.AddTexture(path, &entry->Texture, [this, entry]() {
+		entry->Loading = false;
+		entry->Bytes = GetTextureMemorySize(entry->Texture);
+		TrimClass(AssetClass::Texture);
+	});
+	if (entry->LoadHandle < 0)
+	{
+		Remove(entry);
+		return AssetHandle();
+	}
+	return AssetHandle(entry);
+}
+
+AssetHandle AssetRegistry::LoadMesh(AssetLoader& loader, const std::string& path, MeshVertexFormat format)
+{
+	// The vertex format changes what ends up on the GPU
+	const char* formatName = format == MeshVertexFormat::Quantized ? "quantized" : "float";
+	std::string key = "mesh:" + CanonicalizePath(path) + "|" + formatName;
+	AssetHandle::Entry* entry = Find(key);
+	if (entry)
+	{
+		hits[(int)AssetClass::Mesh]++;
+		return AssetHandle(entry);
+	}
+
+	entry = Insert(key, AssetClass::Mesh, loader);
+	entry->LoadHandle = loader.AddMesh(path, &entry->MeshAsset, format, [this, entry]() {
+		entry->Loading = false;
+		entry->Bytes = entry->MeshAsset->GetMemorySize();
+		TrimClass(AssetClass::Mesh);
+	});
+	if (entry->LoadHandle < 0)
+	{
+		Remove(entry);
+		return AssetHandle();
+	}
+	return AssetHandle(entry);
+}
+
+void AssetRegistry::SetBudget(AssetClass assetClass, size_t bytes)
+{
+	budgets[(int)assetClass] = bytes;
+	TrimClass(assetClass);
+}
+
+void AssetRegistry::Trim()
+{
+	for (int i = 0; i < (int)AssetClass::Count; i++)
+		TrimClass((AssetClass)i);
+}
+
+// --------------------------------------------------------
+// Evicts the least recently used unreferenced assets until
+// the class fits its budget, or nothing more can go
+// --------------------------------------------------------
+void AssetRegistry::TrimClass(AssetClass assetClass)
+{
+	size_t total = 0;
+	std::vector<AssetHandle::Entry*> candidates;
+	for (auto& pair : entries)
+	{
+		AssetHandle::Entry* entry = pair.second.get();
+		if (entry->Class != assetClass) continue;
+		total += entry->Bytes;
+		if (entry->RefCount == 0 && !entry->Loading)
+			candidates.push_back(entry);
+	}
+
+	size_t budget = budgets[(int)assetClass];
+	if (total <= budget) return;
+
+	std::sort(candidates.begin(), candidates.end(),
+		[](const AssetHandle::Entry* a, const AssetHandle::Entry* b) { return a->LastUsed < b->LastUsed; });
+
+	for (AssetHandle::Entry* entry : candidates)
+	{
+		if (total <= budget) break;
+		total -= entry->Bytes;
+		evictions[(int)assetClass]++;
+
+		// The key is part of the entry - take a copy before it goes
+		std::string key = entry->Key;
+		Destroy(*entry);
+		entries.erase(key);
+	}
+}
+
+void AssetRegistry::EvictUnreferenced()
+{
+	std::vector<std::string> unreferenced;
+	for (auto& pair : entries)
+	{
+		if (pair.second->RefCount == 0 && !pair.second->Loading)
+			unreferenced.push_back(pair.first);
+	}
+
+	for (const std::string& key : unreferenced)
+	{
+		AssetHandle::Entry* entry = Find(key);
+		evictions[(int)entry->Class]++;
+		Destroy(*entry);
+		entries.erase(key);
+	}
+}
+
+AssetClassStats AssetRegistry::GetStats(AssetClass assetClass)
+{
+	AssetClassStats stats;
+	stats.Budget = budgets[(int)assetClass];
+	stats.Loads = loads[(int)assetClass];
+	stats.Hits = hits[(int)assetClass];
+	stats.Evictions = evictions[(int)assetClass];
+
+	for (auto& pair : entries)
+	{
+		const AssetHandle::Entry& entry = *pair.second;
+		if (entry.Class != assetClass) continue;
+
+		stats.Count++;
+		stats.Bytes += entry.Bytes;
+		if (entry.RefCount > 0)
+		{
+			stats.Referenced++;
+			stats.ReferencedBytes += entry.Bytes;
+		}
+	}
+	return stats;
+}
+
+void AssetRegistry::PrintStats()
+{
+	for (int i = 0; i < (int)AssetClass::Count; i++)
+	{
+		AssetClassStats stats = GetStats((AssetClass)i);
+		printf("%s: %u loaded (%u referenced), %.2f / %.2f MB, budget %.0f MB, %u loads, %u shared, %u evicted\n",
+			ClassNames[i], stats.Count, stats.Referenced,
+			stats.ReferencedBytes / (1024.0 * 1024.0), stats.Bytes / (1024.0 * 1024.0),
+			stats.Budget / (1024.0 * 1024.0), stats.Loads, stats.Hits, stats.Evictions);
+	}
+}
+
+void AssetRegistry::Destroy(AssetHandle::Entry& entry)
+{
+	if (entry.Texture) entry.Texture->Release();
+	entry.Texture = nullptr;
+	delete entry.MeshAsset;
+	entry.MeshAsset = nullptr;
+}
@@ -0,0 +1,131 @@
+#pragma once
+#include <d3d11.h>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include "AssetLoader.h"
+#include "Mesh.h"
+
+class AssetRegistry;
+
+// --------------------------------------------------------
+// Kinds of asset the registry tracks, each with its own budget
+// --------------------------------------------------------
+enum class AssetClass
+{
+	Texture,
+	Mesh,
+	Count
+};
+
+// --------------------------------------------------------
+// Memory accounting for one asset class.  Bytes are what the
+// GPU copies take - vertex / index buffers, or textures with
+// their mips.
+// --------------------------------------------------------
+struct AssetClassStats
+{
+	AssetClassStats();
+
+	unsigned int Count;			// Loaded, referenced or not
+	unsigned int Referenced;	// Held by at least one handle
+	size_t Bytes;
+	size_t ReferencedBytes;
+	size_t Budget;
+	unsigned int Loads;			// Actually read from disk
+	unsigned int Hits;			// Handed out an existing copy
+	unsigned int Evictions;
+};
+
+// --------------------------------------------------------
+// A counted reference to a registry asset.  Copies share the
+// reference; the asset stays loaded while any handle to it
+// exists.  Only use handles on the thread that owns the
+// registry.
+// --------------------------------------------------------
+class AssetHandle
+{
+public:
+	AssetHandle();
+	AssetHandle(const AssetHandle& other);
+	AssetHandle& operator=(const AssetHandle& other);
+	~AssetHandle();
+
+	void Release();
+	bool IsValid() const { return entry != nullptr; }
+
+	// Null if it's another class of asset.  Like the loader's,
+	// textures are null and meshes empty until the load finishes.
+	ID3D11ShaderResourceView* GetTexture() const;
+	Mesh* GetMesh() const;
+
+	// Handle to depend on in the loader that's loading it, or -1
+	// once it's loaded or if a different loader asks
+	int GetLoadHandle(const AssetLoader& loader) const;
+
+private:
+	friend class AssetRegistry;
+	struct Entry;
+	explicit AssetHandle(Entry* entry);
+
+	Entry* entry;
+};
+
+// --------------------------------------------------------
+// Owns every texture and mesh loaded from disk, keyed by the
+// canonical path plus whatever import settings change the
+// result, so asking for the same file twice shares one copy.
+//
+// Assets nobody holds a handle to stay cached until their
+// class goes over budget, then the least recently used go
+// first.  Assets still loading are never evicted.
+// --------------------------------------------------------
+class AssetRegistry
+{
+public:
+	AssetRegistry();
+	~AssetRegistry();
+
+	// Queue the load on the loader, or share the copy already
+	// registered under the same key.  The handle is invalid if
+	// the loader has already started and the asset is new.
+	AssetHandle LoadTexture(AssetLoader& loader, const std::wstring& path);
+	AssetHandle LoadMesh(AssetLoader& loader, const std::string& path,
+		MeshVertexFormat format = MeshVertexFormat::Float);
+
+	// Bytes each class may keep, counting referenced assets.
+	// Only unreferenced ones can be evicted to get back under.
+	void SetBudget(AssetClass assetClass, size_t bytes);
+
+	// Evicts unreferenced assets from classes over budget
+	void Trim();
+
+	// Evicts every unreferenced asset, e.g. between songs
+	void EvictUnreferenced();
+
+	AssetClassStats GetStats(AssetClass assetClass);
+	void PrintStats();
+
+	// Lower case with forward slashes, "." and ".." resolved
+	static std::string CanonicalizePath(const std::string& path);
+
+private:
+	friend class AssetHandle;
+
+	std::unordered_map<std::string, std::unique_ptr<AssetHandle::Entry>> entries;
+	size_t budgets[(int)AssetClass::Count];
+	unsigned int loads[(int)AssetClass::Count];
+	unsigned int hits[(int)AssetClass::Count];
+	unsigned int evictions[(int)AssetClass::Count];
+
+	// Bumped whenever an asset is handed out or let go, for LRU
+	unsigned long long useClock;
+
+	AssetHandle::Entry* Find(const std::string& key);
+	AssetHandle::Entry* Insert(const std::string& key, AssetClass assetClass, AssetLoader& loader);
+	void Remove(AssetHandle::Entry* entry);
+	void Touch(AssetHandle::Entry* entry);
+	void TrimClass(AssetClass assetClass);
+	static void Destroy(AssetHandle::Entry& entry);
+};
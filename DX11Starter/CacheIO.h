@@ -0,0 +1,75 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------
+// Little helpers for writing fixed-size, little-endian values
+// so cache files don't depend on the compiler's struct layout
+// --------------------------------------------------------
+inline void WriteU32(std::vector<unsigned char>& out, uint32_t value)
+{
+	for (int i = 0; i < 4; i++)
+		out.push_back((unsigned char)(value >> (i * 8)));
+}
+
+inline void WriteU64(std::vector<unsigned char>& out, uint64_t value)
+{
+	for (int i = 0; i < 8; i++)
+		out.push_back((unsigned char)(value >> (i * 8)));
+}
+
+inline void WriteString(std::vector<unsigned char>& out, const std::string& str)
+{
+	WriteU32(out, (uint32_t)str.size());
+	out.insert(out.end(), str.begin(), str.end());
+}
+
+// --------------------------------------------------------
+// Bounds-checked reader over a byte buffer.  Any read past
+// the end flips "ok" and returns zeroes from then on.
+// --------------------------------------------------------
+struct CacheReader
+{
+	const unsigned char* bytes;
+	size_t size;
+	size_t pos;
+	bool ok;
+
+	uint32_t U32()
+	{
+		if (!ok || size - pos < 4) { ok = false; return 0; }
+		uint32_t value = 0;
+		for (int i = 0; i < 4; i++)
+			value |= (uint32_t)bytes[pos++] << (i * 8);
+		return value;
+	}
+
+	uint64_t U64()
+	{
+		if (!ok || size - pos < 8) { ok = false; return 0; }
+		uint64_t value = 0;
+		for (int i = 0; i < 8; i++)
+			value |= (uint64_t)bytes[pos++] << (i * 8);
+		return value;
+	}
+
+	std::string String()
+	{
+		uint32_t length = U32();
+		if (!ok || size - pos < length) { ok = false; return std::string(); }
+		std::string str((const char*)bytes + pos, length);
+		pos += length;
+		return str;
+	}
+
+	// Reads an element count, rejecting anything that couldn't
+	// possibly fit in the remaining bytes (guards against garbage)
+	uint32_t Count(size_t minElementSize)
+	{
+		uint32_t count = U32();
+		if (ok && (size - pos) / minElementSize < count) ok = false;
+		return ok ? count : 0;
+	}
+};
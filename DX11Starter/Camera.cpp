@@ -7,8 +7,10 @@ Camera::Camera(unsigned int width, unsigned int height)
 	XMMATRIX identity = XMMatrixIdentity();
 	_position = XMFLOAT3(0, 0, -5);
 	truePosition = _position;
+	_previousPosition = _position;
 	_xRot = 0;
 	_yRot = 0;
+	_viewPosition = XMFLOAT3(0, 0, 0);
 	XMStoreFloat4x4(&_viewMatrix, identity);
 	XMMATRIX P = XMMatrixPerspectiveFovLH(
 		0.25f * 3.1415926535f,		// Field of View Angle
@@ -37,6 +39,37 @@ XMFLOAT4X4 Camera::GetProjectionMatrix()
 	return _projectionMatrix;
 }
 
+float Camera::GetPixelsPerUnit(unsigned int screenHeight)
+{
+	// _22 is the projection's vertical scale, 1 / tan(fov / 2)
+	return _projectionMatrix._22 * screenHeight * 0.5f;
+}
+
+XMFLOAT3 Camera::GetViewPosition()
+{
+	return _viewPosition;
+}
+
+// --------------------------------------------------------
+// Gribb / Hartmann - the planes are sums and differences of
+// the view projection matrix's columns.  Both matrices are
+// stored transposed, so its columns are the rows of P * V.
+// --------------------------------------------------------
+void Camera::GetFrustumPlanes(XMFLOAT4 planes[6])
+{
+	XMFLOAT4X4 m;
+	XMStoreFloat4x4(&m, XMMatrixMultiply(XMLoadFloat4x4(&_projectionMatrix), XMLoadFloat4x4(&_viewMatrix)));
+	XMVECTOR x = XMVectorSet(m._11, m._12, m._13, m._14);
+	XMVECTOR y = XMVectorSet(m._21, m._22, m._23, m._24);
+	XMVECTOR z = XMVectorSet(m._31, m._32, m._33, m._34);
+	XMVECTOR w = XMVectorSet(m._41, m._42, m._43, m._44);
+
+	// D3D clip space depth runs 0 to w, so near is just z
+	XMVECTOR unnormalized[6] = { w + x, w - x, w + y, w - y, z, w - z };
+	for (int i = 0; i < 6; i++)
+		XMStoreFloat4(&planes[i], XMPlaneNormalize(unnormalized[i]));
+}
+
 void Camera::Shake(float duration, float frequency, float magnitude) {
 	shakeTimer = duration;
 	shakeFreq = frequency;
@@ -46,7 +79,6 @@ void Camera::Shake(float duration, float frequency, float magnitude) {
 void Camera::Update(float deltaTime)
 {
 	XMFLOAT3 xAxis = XMFLOAT3(1, 0, 0);
-	XMFLOAT3 yAxis = XMFLOAT3(0, 1, 0);
 	XMFLOAT3 forward = XMFLOAT3(0, 0, 1);
 	XMVECTOR rotation = XMQuaternionRotationRollPitchYaw(_xRot, _yRot, 0);
 	XMVECTOR direction = XMVector3Rotate(XMLoadFloat3(&forward), rotation);
@@ -90,7 +122,34 @@ void Camera::Update(float deltaTime)
 		}
 	}
 
-	XMMATRIX lookAt = XMMatrixLookToLH(XMLoadFloat3(&_position), direction, XMLoadFloat3(&yAxis));
+	UpdateViewMatrix(_position);
+}
+
+void Camera::SaveState()
+{
+	_previousPosition = _position;
+}
+
+// --------------------------------------------------------
+// Rebuilds the view matrix part way between the previous and
+// current simulation step (0 = previous, 1 = current)
+// --------------------------------------------------------
+void Camera::Interpolate(float alpha)
+{
+	XMFLOAT3 position;
+	XMStoreFloat3(&position, XMVectorLerp(XMLoadFloat3(&_previousPosition), XMLoadFloat3(&_position), alpha));
+	UpdateViewMatrix(position);
+}
+
+void Camera::UpdateViewMatrix(XMFLOAT3 position)
+{
+	XMFLOAT3 yAxis = XMFLOAT3(0, 1, 0);
+	XMFLOAT3 forward = XMFLOAT3(0, 0, 1);
+	XMVECTOR rotation = XMQuaternionRotationRollPitchYaw(_xRot, _yRot, 0);
+	XMVECTOR direction = XMVector3Rotate(XMLoadFloat3(&forward), rotation);
+
+	_viewPosition = position;
+	XMMATRIX lookAt = XMMatrixLookToLH(XMLoadFloat3(&position), direction, XMLoadFloat3(&yAxis));
 	XMStoreFloat4x4(&_viewMatrix, XMMatrixTranspose(lookAt));
 }
 
@@ -10,14 +10,32 @@ public:
 	XMFLOAT3 GetPosition();
 	XMFLOAT4X4 GetViewMatrix();
 	XMFLOAT4X4 GetProjectionMatrix();
+
+	// Screen pixels one world unit covers at a distance of one
+	// unit - divide by distance for anything further away
+	float GetPixelsPerUnit(unsigned int screenHeight);
+
+	// Where the view matrix was built from - the interpolated,
+	// shaken position rather than GetPosition()
+	XMFLOAT3 GetViewPosition();
+
+	// World space planes of the view frustum, normalized and
+	// facing inwards: left, right, bottom, top, near, far
+	void GetFrustumPlanes(XMFLOAT4 planes[6]);
 	void Update(float);
 	void Look(long, long);
 	void OnResize(unsigned int, unsigned int);
 	void Shake(float duration, float frequency, float magnitude);
+
+	// Fixed timestep support - SaveState() before each simulation
+	// step, Interpolate() before drawing
+	void SaveState();
+	void Interpolate(float alpha);
 private:
 	XMFLOAT4X4 _viewMatrix;
 	XMFLOAT4X4 _projectionMatrix;
 	XMFLOAT3 _position;
+	XMFLOAT3 _viewPosition;
 	XMFLOAT3 _direction;
 	float _xRot;
 	float _yRot;
@@ -26,6 +44,9 @@ private:
 	float shakeMagnitude;
 	float shakeFreq;
 	XMFLOAT3 truePosition;
+	XMFLOAT3 _previousPosition;
+
+	void UpdateViewMatrix(XMFLOAT3 position);
 
 	bool _userControlled=false;
 };
@@ -0,0 +1,36 @@
+#include "CommandList.h"
+#include "Hash.h"
+
+NullCommandBackend::NullCommandBackend()
+{
+	Reset();
+}
+
+void NullCommandBackend::Reset()
+{
+	materialBinds = 0;
+	geometryBinds = 0;
+	drawCount = 0;
+	checksum = HashBytes(nullptr, 0);
+}
+
+void NullCommandBackend::BindMaterial(const void* material)
+{
+	materialBinds++;
+	checksum = HashBytes(&material, sizeof(material), checksum);
+}
+
+void NullCommandBackend::BindGeometry(const void* vertexBuffer, const void* indexBuffer, unsigned int stride, unsigned int indexSize)
+{
+	geometryBinds++;
+	const void* buffers[2] = { vertexBuffer, indexBuffer };
+	unsigned int sizes[2] = { stride, indexSize };
+	checksum = HashBytes(buffers, sizeof(buffers), checksum);
+	checksum = HashBytes(sizes, sizeof(sizes), checksum);
+}
+
+void NullCommandBackend::Draw(const DrawPacket& packet)
+{
+	drawCount++;
+	checksum = HashBytes(&packet, sizeof(DrawPacket), checksum);
+}
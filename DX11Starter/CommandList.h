@@ -0,0 +1,80 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+// --------------------------------------------------------
+// Everything needed to issue one indexed draw.  Pointers are
+// opaque so recording never touches the graphics API - on
+// D3D11 they're a Material* and two ID3D11Buffer*s.
+// --------------------------------------------------------
+struct DrawPacket
+{
+	const void* Material;
+	const void* VertexBuffer;
+	const void* IndexBuffer;
+	const void* Quantization;	// The mesh's VertexQuantization, null for float vertices
+	unsigned int StartIndex;
+	unsigned int IndexCount;
+	unsigned int IndexSize;		// Bytes per index, 2 or 4
+	unsigned int VertexStride;
+	float World[16];		// Already transposed for the shader
+};
+
+// --------------------------------------------------------
+// Receives draws as they're replayed.  Bind calls only happen
+// when the state actually changes from the previous draw.
+// --------------------------------------------------------
+class CommandBackend
+{
+public:
+	virtual ~CommandBackend() {}
+	virtual void BindMaterial(const void* material) = 0;
+	virtual void BindGeometry(const void* vertexBuffer, const void* indexBuffer, unsigned int stride, unsigned int indexSize) = 0;
+	virtual void Draw(const DrawPacket& packet) = 0;
+};
+
+// --------------------------------------------------------
+// A list of draws recorded by one thread
+// --------------------------------------------------------
+class CommandList
+{
+public:
+	void Reset() { packets.clear(); }
+	void Record(const DrawPacket& packet) { packets.push_back(packet); }
+
+	size_t GetPacketCount() const { return packets.size(); }
+	const std::vector<DrawPacket>& GetPackets() const { return packets; }
+
+private:
+	std::vector<DrawPacket> packets;
+};
+
+// --------------------------------------------------------
+// Backend that just counts and hashes what it's given.  Lets
+// the recording path run (and be stress tested) with no GPU.
+// --------------------------------------------------------
+class NullCommandBackend : public CommandBackend
+{
+public:
+	NullCommandBackend();
+
+	void Reset();
+	void BindMaterial(const void* material);
+	void BindGeometry(const void* vertexBuffer, const void* indexBuffer, unsigned int stride, unsigned int indexSize);
+	void Draw(const DrawPacket& packet);
+
+	unsigned int GetMaterialBinds() const { return materialBinds; }
+	unsigned int GetGeometryBinds() const { return geometryBinds; }
+	unsigned int GetDrawCount() const { return drawCount; }
+
+	// Order-dependent hash of every bind and draw - two replays
+	// that produce the same checksum issued the same calls in
+	// the same order
+	unsigned long long GetChecksum() const { return checksum; }
+
+private:
+	unsigned int materialBinds;
+	unsigned int geometryBinds;
+	unsigned int drawCount;
+	unsigned long long checksum;
+};
@@ -0,0 +1,91 @@
+#include "CommandRecorder.h"
+
+CommandRecorder::CommandRecorder()
+{
+	listCount = 0;
+}
+
+CommandRecorder::~CommandRecorder()
+{
+}
+
+void CommandRecorder::Record(JobSystem* jobs, unsigned int itemCount, unsigned int minItemsPerList, RecordFunction record)
+{
+	if (minItemsPerList == 0) minItemsPerList = 1;
+
+	// One list per thread at most, and only as many as the
+	// item count justifies
+	unsigned int maxLists = jobs ? jobs->GetThreadCount() : 1;
+	listCount = itemCount / minItemsPerList;
+	if (listCount > maxLists) listCount = maxLists;
+	if (listCount == 0) listCount = 1;
+
+	// Lists are kept between frames so their memory is reused
+	if (lists.size() < listCount)
+		lists.resize(listCount);
+	for (unsigned int i = 0; i < listCount; i++)
+		lists[i].Reset();
+
+	unsigned int chunkCount = listCount;
+	auto recordChunk = [&](unsigned int chunk) {
+		unsigned int begin = (unsigned int)((unsigned long long)itemCount * chunk / chunkCount);
+		unsigned int end = (unsigned int)((unsigned long long)itemCount * (chunk + 1) / chunkCount);
+		record(begin, end, lists[chunk]);
+	};
+
+	if (jobs && listCount > 1)
+	{
+		jobs->ParallelFor(listCount, 1, [&](unsigned int begin, unsigned int end) {
+			for (unsigned int chunk = begin; chunk < end; chunk++)
+				recordChunk(chunk);
+		});
+	}
+	else
+		recordChunk(0);
+}
+
+void CommandRecorder::Replay(CommandBackend& backend)
+{
+	const void* material = nullptr;
+	const void* vertexBuffer = nullptr;
+	const void* indexBuffer = nullptr;
+	unsigned int stride = 0;
+	unsigned int indexSize = 0;
+	bool first = true;
+
+	for (unsigned int i = 0; i < listCount; i++)
+	{
+		for (const DrawPacket& packet : lists[i].GetPackets())
+		{
+			if (first || packet.Material != material)
+			{
+				material = packet.Material;
+				backend.BindMaterial(material);
+			}
+
+			if (first ||
+				packet.VertexBuffer != vertexBuffer ||
+				packet.IndexBuffer != indexBuffer ||
+				packet.VertexStride != stride ||
+				packet.IndexSize != indexSize)
+			{
+				vertexBuffer = packet.VertexBuffer;
+				indexBuffer = packet.IndexBuffer;
+				stride = packet.VertexStride;
+				indexSize = packet.IndexSize;
+				backend.BindGeometry(vertexBuffer, indexBuffer, stride, indexSize);
+			}
+
+			backend.Draw(packet);
+			first = false;
+		}
+	}
+}
+
+unsigned int CommandRecorder::GetPacketCount()
+{
+	unsigned int count = 0;
+	for (unsigned int i = 0; i < listCount; i++)
+		count += (unsigned int)lists[i].GetPacketCount();
+	return count;
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include "CommandList.h"
+#include "JobSystem.h"
+#include <functional>
+
+// --------------------------------------------------------
+// Records a draw list in parallel and plays it back in order.
+//
+// The items are split into contiguous chunks, one per command
+// list, and each chunk is recorded on whichever thread of the
+// job system picks it up.  Replay walks the lists in chunk order, so the draws
+// come out exactly as a serial walk would have issued them.
+// --------------------------------------------------------
+class CommandRecorder
+{
+public:
+	// Records draws for items [begin, end) into the given list
+	typedef std::function<void(unsigned int begin, unsigned int end, CommandList& list)> RecordFunction;
+
+	CommandRecorder();
+	~CommandRecorder();
+
+	// jobs            - Job system to record on (null records on this thread)
+	// itemCount       - Number of items in the draw list
+	// minItemsPerList - Below this many items per chunk, fewer lists are used
+	// record          - Called once per chunk
+	void Record(JobSystem* jobs, unsigned int itemCount, unsigned int minItemsPerList, RecordFunction record);
+
+	// Sends every recorded draw to the backend, skipping binds
+	// that wouldn't change anything
+	void Replay(CommandBackend& backend);
+
+	unsigned int GetListCount() { return listCount; }
+	unsigned int GetPacketCount();
+
+private:
+	std::vector<CommandList> lists;
+	unsigned int listCount;
+};
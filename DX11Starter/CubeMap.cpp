@@ -4,20 +4,20 @@
 
 CubeMap::CubeMap()
 {
-	
+	skyboxSRV = nullptr;
 }
 
 
 CubeMap::~CubeMap()
 {
 
-	skyboxSRV->Release();
+	if (skyboxSRV) skyboxSRV->Release();
 	delete skyboxVS;
 	delete skyboxPS;
 }
 
 void CubeMap::DrawSkybox(ID3D11DeviceContext* context, Camera* camera, ID3D11SamplerState* sampler) {
-	UINT stride = sizeof(Vertex);
+	UINT stride = cube->GetVertexStride();
 	UINT offset = 0;
 	//*/
 	//render sky, must occur after all solid objects
@@ -26,7 +26,7 @@ void CubeMap::DrawSkybox(ID3D11DeviceContext* context, Camera* camera, ID3D11Sam
 
 
 	context->IASetVertexBuffers(0, 1, &skyboxVB, &stride, &offset);
-	context->IASetIndexBuffer(skyboxIB, DXGI_FORMAT_R32_UINT, 0);
+	context->IASetIndexBuffer(skyboxIB, cube->GetIndexFormat(), 0);
 
 	skyboxVS->SetMatrix4x4("view", camera->GetViewMatrix());
 	skyboxVS->SetMatrix4x4("projection", camera->GetProjectionMatrix());
@@ -57,7 +57,10 @@ void CubeMap::SetMesh(Mesh* m) {
 ID3D11ShaderResourceView* CubeMap::GetResourceView() {
 	return skyboxSRV;
 }
+// Keeps its own reference - the view may be shared
 void CubeMap::SetResourceView(ID3D11ShaderResourceView* srv) {
+	if (srv) srv->AddRef();
+	if (skyboxSRV) skyboxSRV->Release();
 	skyboxSRV = srv;
 }
 ID3D11RasterizerState* CubeMap::GetRasterizerState() {
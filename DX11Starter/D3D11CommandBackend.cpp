@@ -0,0 +1,100 @@
+#include "D3D11CommandBackend.h"
+#include "Material.h"
+#include "VertexQuantize.h"
+
+// --------------------------------------------------------
+// Shared by both backends
+// --------------------------------------------------------
+static void SetGeometry(ID3D11DeviceContext* context, const void* vertexBuffer, const void* indexBuffer, unsigned int stride, unsigned int indexSize)
+{
+	ID3D11Buffer* vb = (ID3D11Buffer*)vertexBuffer;
+	UINT offset = 0;
+	context->IASetVertexBuffers(0, 1, &vb, &stride, &offset);
+	context->IASetIndexBuffer((ID3D11Buffer*)indexBuffer, indexSize == 2 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT, 0);
+}
+
+D3D11SceneBackend::D3D11SceneBackend(ID3D11DeviceContext* context)
+{
+	this->context = context;
+	vertexShader = 0;
+	Skybox = 0;
+}
+
+void D3D11SceneBackend::BindMaterial(const void* material)
+{
+	Material* mat = (Material*)material;
+
+	vertexShader = mat->GetVertexShader();
+	vertexShader->SetMatrix4x4("view", View);
+	vertexShader->SetMatrix4x4("projection", Projection);
+
+	SimplePixelShader* ps = mat->GetPixelShader();
+	ps->SetData("light", &Light, sizeof(DirectionalLight));
+	ps->SetData("light2", &Light2, sizeof(DirectionalLight));
+	ps->SetData("CameraPosition", &CameraPosition, sizeof(DirectX::XMFLOAT3));
+	float reflective = mat->GetReflectivity();
+	ps->SetData("reflectivity", &reflective, sizeof(float));
+	ps->SetData("ParticleColor", &ParticleColor, sizeof(DirectX::XMFLOAT4));
+	ps->SetShaderResourceView("diffuseTexture", mat->GetTexture());
+
+	if (reflective > 0.0f) {
+		ps->SetShaderResourceView("Skybox", Skybox);
+	}
+	ps->SetSamplerState("basicSampler", mat->GetSamplerState());
+
+	ps->CopyAllBufferData();
+	vertexShader->SetShader();
+	ps->SetShader();
+}
+
+void D3D11SceneBackend::BindGeometry(const void* vertexBuffer, const void* indexBuffer, unsigned int stride, unsigned int indexSize)
+{
+	SetGeometry(context, vertexBuffer, indexBuffer, stride, indexSize);
+}
+
+void D3D11SceneBackend::Draw(const DrawPacket& packet)
+{
+	// Only the world matrix (and for quantized meshes, the
+	// dequantization) changes between draws of one material
+	vertexShader->SetMatrix4x4("world", packet.World);
+	if (packet.Quantization)
+		vertexShader->SetData("quantization", packet.Quantization, sizeof(VertexQuantization));
+	vertexShader->CopyAllBufferData();
+	context->DrawIndexed(packet.IndexCount, packet.StartIndex, 0);
+}
+
+D3D11DepthBackend::D3D11DepthBackend(ID3D11DeviceContext* context, SimpleVertexShader* depthShader, SimpleVertexShader* quantizedDepthShader)
+{
+	this->context = context;
+	this->depthShader = depthShader;
+	this->quantizedDepthShader = quantizedDepthShader;
+	activeShader = depthShader;
+}
+
+void D3D11DepthBackend::BindMaterial(const void* material)
+{
+	// Depth only - materials don't matter
+}
+
+void D3D11DepthBackend::BindGeometry(const void* vertexBuffer, const void* indexBuffer, unsigned int stride, unsigned int indexSize)
+{
+	SetGeometry(context, vertexBuffer, indexBuffer, stride, indexSize);
+}
+
+void D3D11DepthBackend::Draw(const DrawPacket& packet)
+{
+	// Quantized meshes need the shader with the matching input layout
+	SimpleVertexShader* shader = packet.Quantization ? quantizedDepthShader : depthShader;
+	if (shader == nullptr) return;
+	if (shader != activeShader)
+	{
+		activeShader = shader;
+		shader->SetShader();
+	}
+
+	shader->SetMatrix4x4("world", packet.World);
+	if (packet.Quantization)
+		shader->SetData("quantization", packet.Quantization, sizeof(VertexQuantization));
+	shader->CopyAllBufferData();
+	context->DrawIndexed(packet.IndexCount, packet.StartIndex, 0);
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <d3d11.h>
+#include <DirectXMath.h>
+#include "CommandList.h"
+#include "Lights.h"
+#include "SimpleShader.h"
+
+// --------------------------------------------------------
+// Replays entity draws through the immediate context with
+// each material's own shaders - the same work
+// Entity::PrepareMaterial does, minus the redundant binds.
+//
+// The per-frame values below must be filled in before Replay.
+// --------------------------------------------------------
+class D3D11SceneBackend : public CommandBackend
+{
+public:
+	D3D11SceneBackend(ID3D11DeviceContext* context);
+
+	void BindMaterial(const void* material);
+	void BindGeometry(const void* vertexBuffer, const void* indexBuffer, unsigned int stride, unsigned int indexSize);
+	void Draw(const DrawPacket& packet);
+
+	// Per-frame values
+	DirectX::XMFLOAT4X4 View;
+	DirectX::XMFLOAT4X4 Projection;
+	DirectionalLight Light;
+	DirectionalLight Light2;
+	DirectX::XMFLOAT3 CameraPosition;
+	DirectX::XMFLOAT4 ParticleColor;
+	ID3D11ShaderResourceView* Skybox;
+
+private:
+	ID3D11DeviceContext* context;
+	SimpleVertexShader* vertexShader;
+};
+
+// --------------------------------------------------------
+// Replays entity draws with a depth-only vertex shader, or its
+// quantized twin for meshes stored as QuantizedVertex.  The
+// caller sets up both shaders' view and projection, binds the
+// plain one and the depth target; this only feeds them world
+// matrices.
+// --------------------------------------------------------
+class D3D11DepthBackend : public CommandBackend
+{
+public:
+	D3D11DepthBackend(ID3D11DeviceContext* context, SimpleVertexShader* depthShader, SimpleVertexShader* quantizedDepthShader = nullptr);
+
+	void BindMaterial(const void* material);
+	void BindGeometry(const void* vertexBuffer, const void* indexBuffer, unsigned int stride, unsigned int indexSize);
+	void Draw(const DrawPacket& packet);
+
+private:
+	ID3D11DeviceContext* context;
+	SimpleVertexShader* depthShader;
+	SimpleVertexShader* quantizedDepthShader;
+	SimpleVertexShader* activeShader;
+};
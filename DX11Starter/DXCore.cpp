@@ -51,6 +51,12 @@ DXCore::DXCore(
 	// Initialize fields
 	fpsFrameCount = 0;
 	fpsTimeElapsed = 0.0f;
+
+	fixedTimeStep = 1.0f / 120.0f;
+	maxStepsPerFrame = 8;
+	interpolationAlpha = 1.0f;
+	accumulator = 0.0;
+	simulationTime = 0.0;
 	
 	device = 0;
 	context = 0;
@@ -380,7 +386,7 @@ WPARAM DXCore::Run()
 				UpdateTitleBarStats();
 
 			// The game loop
-			Update(deltaTime, totalTime);
+			StepSimulation();
 			Draw(deltaTime, totalTime);
 		}
 	}
@@ -424,6 +430,33 @@ void DXCore::UpdateTimer()
 	previousTime = currentTime;
 }
 
+// --------------------------------------------------------
+// Feeds the frame's real time into the simulation in fixed
+// steps.  Leftover time (less than one step) carries over to
+// the next frame.  After a long hitch only maxStepsPerFrame
+// steps run and the rest is dropped, so a slow frame can't
+// snowball into an even slower one.
+// --------------------------------------------------------
+void DXCore::StepSimulation()
+{
+	accumulator += deltaTime;
+
+	int steps = 0;
+	while (accumulator >= fixedTimeStep && steps < maxStepsPerFrame)
+	{
+		simulationTime += fixedTimeStep;
+		Update(fixedTimeStep, (float)simulationTime);
+		accumulator -= fixedTimeStep;
+		steps++;
+	}
+
+	// Fell too far behind - give up on the backlog
+	if (accumulator >= fixedTimeStep)
+		accumulator = 0.0;
+
+	interpolationAlpha = (float)(accumulator / fixedTimeStep);
+}
+
 
 // --------------------------------------------------------
 // Updates the window's title bar with several stats once
@@ -69,6 +69,14 @@ protected:
 	ID3D11RenderTargetView* backBufferRTV;
 	ID3D11DepthStencilView* depthStencilView;
 
+	// Fixed-rate simulation - Update() is always called with
+	// fixedTimeStep, as many times as real time calls for (up to
+	// maxStepsPerFrame), and Draw() gets how far the real time is
+	// between the last two simulation steps
+	float fixedTimeStep;
+	int maxStepsPerFrame;
+	float interpolationAlpha;
+
 	// Helper function for allocating a console window
 	void CreateConsoleWindow(int bufferLines, int bufferColumns, int windowLines, int windowColumns);
 
@@ -81,11 +89,17 @@ private:
 	__int64 currentTime;
 	__int64 previousTime;
 
+	// Simulation time waiting to be stepped, and the total time
+	// the simulation has actually covered
+	double accumulator;
+	double simulationTime;
+
 	// FPS calculation
 	int fpsFrameCount;
 	float fpsTimeElapsed;
 	
 	void UpdateTimer();			// Updates the timer for this frame
+	void StepSimulation();		// Runs however many fixed updates are due
 	void UpdateTitleBarStats();	// Puts debug info in the title bar
 };
 
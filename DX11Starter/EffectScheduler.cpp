@@ -0,0 +1,91 @@
+#include "EffectScheduler.h"
+#include <algorithm>
+
+EffectScheduler::EffectScheduler()
+{
+	cursor = 0;
+	lastTime = 0;
+}
+
+// --------------------------------------------------------
+// One downbeat per measure, one event per tempo change, and
+// stream start/end wherever the note density crosses the
+// threshold.  Measures are four beats.
+// --------------------------------------------------------
+void EffectScheduler::Build(SMParser& chart, float streamDensity)
+{
+	events.clear();
+	cursor = 0;
+	lastTime = 0;
+
+	size_t tempo = 0;
+	bool inStream = false;
+	int measureCount = chart.GetMeasureCount();
+	for (int m = 0; m < measureCount; m++)
+	{
+		double beat = m * 4.0;
+		while (tempo + 1 < chart.BpmChanges.size() && chart.BpmChanges[tempo + 1].Beat <= beat)
+			tempo++;
+
+		vector<int>* measure = chart.GetMeasure(m);
+		int notes = 0;
+		for (int note : *measure)
+			if (note > -1) notes++;
+
+		EffectEvent event;
+		event.Time = chart.BeatToSeconds(beat);
+		event.Measure = m;
+		event.Bpm = chart.BpmChanges.empty() ? (float)chart.BPMS : chart.BpmChanges[tempo].Bpm;
+		event.Density = notes / 4.0f;
+
+		event.Type = EffectEventType::Downbeat;
+		events.push_back(event);
+
+		bool dense = event.Density >= streamDensity;
+		if (dense != inStream)
+		{
+			event.Type = dense ? EffectEventType::StreamStart : EffectEventType::StreamEnd;
+			events.push_back(event);
+			inStream = dense;
+		}
+	}
+
+	// Tempo changes (the first one is just the starting tempo)
+	for (size_t i = 1; i < chart.BpmChanges.size(); i++)
+	{
+		EffectEvent event;
+		event.Time = chart.BeatToSeconds(chart.BpmChanges[i].Beat);
+		event.Type = EffectEventType::TempoChange;
+		event.Measure = (int)(chart.BpmChanges[i].Beat / 4);
+		event.Bpm = chart.BpmChanges[i].Bpm;
+		event.Density = 0;
+		events.push_back(event);
+	}
+
+	// Stable, so events at the same time keep the order above
+	std::stable_sort(events.begin(), events.end(), [](const EffectEvent& a, const EffectEvent& b) {
+		return a.Time < b.Time;
+	});
+}
+
+void EffectScheduler::Dispatch(double songTime, const EventHandler& handler)
+{
+	if (songTime < lastTime)
+		Seek(songTime);
+	lastTime = songTime;
+
+	while (cursor < events.size() && events[cursor].Time <= songTime)
+	{
+		handler(events[cursor]);
+		cursor++;
+	}
+}
+
+void EffectScheduler::Seek(double songTime)
+{
+	// First event that hasn't happened yet
+	cursor = std::upper_bound(events.begin(), events.end(), songTime, [](double time, const EffectEvent& event) {
+		return time < event.Time;
+	}) - events.begin();
+	lastTime = songTime;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <functional>
+#include <vector>
+#include "SMParser.h"
+
+// --------------------------------------------------------
+// Things in the chart that visual effects can react to
+// --------------------------------------------------------
+enum class EffectEventType
+{
+	Downbeat,		// First beat of a measure
+	TempoChange,	// A BPM change takes effect
+	StreamStart,	// First measure of a dense run of notes
+	StreamEnd		// First measure after it
+};
+
+struct EffectEvent
+{
+	double Time;		// Song time, seconds
+	EffectEventType Type;
+	int Measure;
+	float Bpm;			// Tempo in effect at this point
+	float Density;		// Notes per beat in this measure
+};
+
+// --------------------------------------------------------
+// Effect timeline worked out once from the chart's beat grid.
+//
+// Events sit in one array sorted by time with a cursor at the
+// next one due, so each frame only looks at what it actually
+// fires.  Going backwards in time (the song restarting) finds
+// the new position with a binary search.
+// --------------------------------------------------------
+class EffectScheduler
+{
+public:
+	typedef std::function<void(const EffectEvent&)> EventHandler;
+
+	EffectScheduler();
+
+	// streamDensity - notes per beat a measure needs to count as a stream
+	void Build(SMParser& chart, float streamDensity = 2.0f);
+
+	// Fires every event that came due since the last call, in order
+	void Dispatch(double songTime, const EventHandler& handler);
+
+	// Skips to a song time without firing anything
+	void Seek(double songTime);
+
+	unsigned int GetEventCount() const { return (unsigned int)events.size(); }
+	const EffectEvent& GetEvent(unsigned int index) const { return events[index]; }
+	unsigned int GetNextEventIndex() const { return (unsigned int)cursor; }
+
+private:
+	std::vector<EffectEvent> events;
+	size_t cursor;
+	double lastTime;
+};
@@ -1,4 +1,12 @@
 #include "Entity.h"
+#include "MeshSimplify.h"
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+// Culled triangles a draw may span to save starting another -
+// see CullMeshlets
+static const unsigned int MeshletMergeGap = 8;
 
 
 
@@ -12,6 +20,7 @@ Entity::Entity(Mesh* mesh, Material* material)
 	_pos = XMFLOAT3(0, 0, 0);
 	_rot = XMFLOAT3(0, 0, 0);
 	_scale = XMFLOAT3(1, 1, 1);
+	SaveState();
 }
 
 
@@ -101,6 +110,8 @@ void Entity::PrepareMaterial(XMFLOAT4X4 view, XMFLOAT4X4 projection, Directional
 	vs->SetMatrix4x4("view", view);
 	vs->SetMatrix4x4("projection", projection);
 	vs->SetMatrix4x4("world", _worldMatrix);
+	if (_mesh->GetQuantization())
+		vs->SetData("quantization", _mesh->GetQuantization(), sizeof(VertexQuantization));
 	vs->CopyAllBufferData();
 	SimplePixelShader* ps = _material->GetPixelShader();
 	ps->SetData("light", &light, sizeof(DirectionalLight));
@@ -139,8 +150,135 @@ void Entity::PrepareTerrainMaterial(XMFLOAT4X4 view, XMFLOAT4X4 projection, floa
 	ps->SetShader();
 }
 
+// --------------------------------------------------------
+// Captures this entity's draw without touching the context,
+// so it's safe to call from a worker thread
+// --------------------------------------------------------
+void Entity::RecordDraw(CommandList& list, float alpha, const LodView* view) {
+	const std::vector<MeshLod>& lods = _mesh->GetLods();
+	unsigned int lod = view ? SelectLod(*view) : 0;
+
+	DrawPacket packet;
+	packet.Material = _material;
+	packet.VertexBuffer = _mesh->GetVertexBuffer();
+	packet.IndexBuffer = _mesh->GetIndexBuffer();
+	packet.Quantization = _mesh->GetQuantization();
+	packet.StartIndex = lods.empty() ? 0 : lods[lod].IndexStart;
+	packet.IndexCount = lods.empty() ? 0 : lods[lod].IndexCount;
+	packet.IndexSize = _mesh->GetIndexSize();
+	packet.VertexStride = _mesh->GetVertexStride();
+	XMFLOAT4X4 world = GetInterpolatedWorldMatrix(alpha);
+	memcpy(packet.World, &world, sizeof(packet.World));
+
+	// Meshlets only split up LOD 0 - the coarser levels are
+	// already cheap and drawn from further away
+	if (!view || !view->CullMeshlets || lod != 0 || _mesh->GetMeshlets().empty()) {
+		list.Record(packet);
+		return;
+	}
+
+	// Each recording thread keeps its own list between entities
+	static thread_local std::vector<MeshletRange> ranges;
+	MeshletView meshletView = GetMeshletView(*view, world);
+	CullMeshlets(_mesh->GetMeshlets(), _mesh->GetMeshletBounds(), meshletView, MeshletMergeGap, ranges);
+	for (const MeshletRange& range : ranges) {
+		packet.StartIndex = range.IndexStart;
+		packet.IndexCount = range.IndexCount;
+		list.Record(packet);
+	}
+}
+
+// --------------------------------------------------------
+// The view moved into the mesh's own space, where its
+// meshlet bounds are.  world is stored transposed, as the
+// shaders want it.
+// --------------------------------------------------------
+MeshletView Entity::GetMeshletView(const LodView& view, const XMFLOAT4X4& world) {
+	XMMATRIX transposed = XMLoadFloat4x4(&world);
+	XMMATRIX inverse = XMMatrixInverse(nullptr, XMMatrixTranspose(transposed));
+
+	MeshletView meshletView;
+	XMFLOAT3 camera;
+	XMStoreFloat3(&camera, XMVector3Transform(XMLoadFloat3(&view.CameraPosition), inverse));
+	meshletView.CameraPosition[0] = camera.x;
+	meshletView.CameraPosition[1] = camera.y;
+	meshletView.CameraPosition[2] = camera.z;
+
+	// A world plane p holds model points x where x * W . p >= 0,
+	// which is the plane p * W^T - the stored matrix as it is
+	for (int i = 0; i < 6; i++) {
+		XMVECTOR plane = XMPlaneNormalize(XMPlaneTransform(XMLoadFloat4(&view.FrustumPlanes[i]), transposed));
+		XMStoreFloat4((XMFLOAT4*)meshletView.Planes[i], plane);
+	}
+	return meshletView;
+}
+
+// --------------------------------------------------------
+// Coarsest LOD of the mesh whose error stays under
+// view.MaxPixelError pixels on screen.  Distance is taken to
+// the near side of the bounding sphere, so big meshes don't
+// drop detail while the camera is right next to them.
+// --------------------------------------------------------
+unsigned int Entity::SelectLod(const LodView& view) {
+	const std::vector<MeshLod>& lods = _mesh->GetLods();
+	if (lods.size() < 2) return 0;
+
+	const MeshBounds& bounds = _mesh->GetBounds();
+	XMVECTOR boundsMin = XMVectorSet(bounds.Min[0], bounds.Min[1], bounds.Min[2], 0.0f);
+	XMVECTOR boundsMax = XMVectorSet(bounds.Max[0], bounds.Max[1], bounds.Max[2], 0.0f);
+	XMMATRIX world = XMMatrixTranspose(XMLoadFloat4x4(&_worldMatrix));
+	XMVECTOR center = XMVector3Transform((boundsMin + boundsMax) * 0.5f, world);
+
+	float scale = fmaxf(fabsf(_scale.x), fmaxf(fabsf(_scale.y), fabsf(_scale.z)));
+	float radius = XMVectorGetX(XMVector3Length(boundsMax - boundsMin)) * 0.5f * scale;
+	float distance = XMVectorGetX(XMVector3Length(center - XMLoadFloat3(&view.CameraPosition))) - radius;
+	if (distance <= 0.0f) return 0;
+
+	return SelectMeshLod(lods, view.PixelsPerUnit * scale / distance, view.MaxPixelError);
+}
+
+void Entity::SaveState() {
+	_prevPos = _pos;
+	_prevRot = _rot;
+	_prevScale = _scale;
+	_teleported = false;
+}
+
+// --------------------------------------------------------
+// World matrix part way between the previous and current
+// simulation step (0 = previous, 1 = current).  Entities that
+// were just activated jump straight to where they are now
+// rather than sliding in from wherever they were recycled.
+// --------------------------------------------------------
+XMFLOAT4X4 Entity::GetInterpolatedWorldMatrix(float alpha) {
+	if (_teleported || alpha >= 1.0f) return _worldMatrix;
+
+	XMVECTOR prevRot = XMLoadFloat3(&_prevRot);
+	XMVECTOR rot = XMLoadFloat3(&_rot);
+	XMVECTOR prevPos = XMLoadFloat3(&_prevPos);
+	XMVECTOR pos = XMLoadFloat3(&_pos);
+	XMVECTOR prevScale = XMLoadFloat3(&_prevScale);
+	XMVECTOR scl = XMLoadFloat3(&_scale);
+
+	// Nothing moved this step
+	if (XMVector3Equal(prevPos, pos) && XMVector3Equal(prevRot, rot) && XMVector3Equal(prevScale, scl))
+		return _worldMatrix;
+
+	XMMATRIX trans = XMMatrixTranslationFromVector(XMVectorLerp(prevPos, pos, alpha));
+	XMMATRIX rotation = XMMatrixRotationQuaternion(XMQuaternionSlerp(
+		XMQuaternionRotationRollPitchYawFromVector(prevRot),
+		XMQuaternionRotationRollPitchYawFromVector(rot),
+		alpha));
+	XMMATRIX scale = XMMatrixScalingFromVector(XMVectorLerp(prevScale, scl, alpha));
+
+	XMFLOAT4X4 world;
+	XMStoreFloat4x4(&world, XMMatrixTranspose(scale * rotation * trans));
+	return world;
+}
+
 void Entity::Activate() {
 	active = true;
+	_teleported = true;
 }
 
 void Entity::Deactivate() {
@@ -4,11 +4,26 @@
 #include "Lights.h"
 #include "CubeMap.h"
 #include "Camera.h"
+#include "CommandList.h"
 #include "ParticleManager.h";
 #include <DirectXMath.h>
 
 using namespace DirectX;
 
+// --------------------------------------------------------
+// What picking an LOD and culling meshlets need to know about
+// the view, gathered once per frame - see Entity::SelectLod
+// and Entity::RecordDraw
+// --------------------------------------------------------
+struct LodView
+{
+	XMFLOAT3 CameraPosition;	// Camera::GetViewPosition
+	float PixelsPerUnit;		// Camera::GetPixelsPerUnit
+	float MaxPixelError;		// How far on screen an LOD may stray
+	XMFLOAT4 FrustumPlanes[6];	// Camera::GetFrustumPlanes
+	bool CullMeshlets;
+};
+
 class Entity
 {
 public:
@@ -30,6 +45,12 @@ public:
 	bool IsActive();
 	void PrepareMaterial(XMFLOAT4X4, XMFLOAT4X4, DirectionalLight, DirectionalLight, XMFLOAT3);
 	void PrepareTerrainMaterial(XMFLOAT4X4 view, XMFLOAT4X4 projection, float * frequencies, unsigned int length, DirectionalLight light, DirectionalLight light2);
+	unsigned int SelectLod(const LodView& view);
+	void RecordDraw(CommandList& list, float alpha, const LodView* view = nullptr);
+
+	// Fixed timestep support - SaveState() before each simulation step
+	void SaveState();
+	XMFLOAT4X4 GetInterpolatedWorldMatrix(float alpha);
 
 	static CubeMap* activeSkybox;
 private:
@@ -40,6 +61,14 @@ private:
 	XMFLOAT3 _pos;
 	XMFLOAT3 _rot;
 	XMFLOAT3 _scale;
+
+	// Transform as of the previous simulation step
+	XMFLOAT3 _prevPos;
+	XMFLOAT3 _prevRot;
+	XMFLOAT3 _prevScale;
+	bool _teleported;
+
 	void UpdateWorldMatrix();
+	static MeshletView GetMeshletView(const LodView& view, const XMFLOAT4X4& world);
 };
 
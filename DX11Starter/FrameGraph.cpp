@@ -0,0 +1,360 @@
+#include "FrameGraph.h"
+#include <algorithm>
+
+FrameGraph::FrameGraph()
+{
+}
+
+FrameGraph::~FrameGraph()
+{
+}
+
+void FrameGraph::Clear()
+{
+	passes.clear();
+	resources.clear();
+	passOrder.clear();
+	physicalDescs.clear();
+}
+
+// --------------------------------------------------------
+// Declares a transient texture - one that only lives for part
+// of the frame and is therefore a candidate for aliasing
+// --------------------------------------------------------
+int FrameGraph::CreateTexture(std::string name, const FrameGraphTextureDesc& desc)
+{
+	Resource res = {};
+	res.Name = name;
+	res.Desc = desc;
+	res.Imported = false;
+	res.Physical = -1;
+	resources.push_back(res);
+	return (int)resources.size() - 1;
+}
+
+// --------------------------------------------------------
+// Declares a texture owned by someone else (the back buffer,
+// the swap chain's depth buffer).  Never aliased.
+// --------------------------------------------------------
+int FrameGraph::ImportTexture(std::string name)
+{
+	Resource res = {};
+	res.Name = name;
+	res.Imported = true;
+	res.Physical = -1;
+	resources.push_back(res);
+	return (int)resources.size() - 1;
+}
+
+void FrameGraph::MarkOutput(int resource)
+{
+	resources[resource].Output = true;
+}
+
+int FrameGraph::AddPass(std::string name, std::function<void()> execute)
+{
+	Pass pass;
+	pass.Name = name;
+	pass.Execute = execute;
+	pass.Culled = false;
+	passes.push_back(pass);
+	return (int)passes.size() - 1;
+}
+
+void FrameGraph::Read(int pass, int resource)
+{
+	ResourceAccess access = { resource, FrameGraphState::ShaderRead };
+	passes[pass].Reads.push_back(access);
+}
+
+void FrameGraph::Write(int pass, int resource, FrameGraphState state)
+{
+	ResourceAccess access = { resource, state };
+	passes[pass].Writes.push_back(access);
+}
+
+// --------------------------------------------------------
+// Builds the execution order, culls, aliases and records
+// barriers.  Returns false if the passes depend on each other
+// in a cycle (nothing is valid in that case).
+// --------------------------------------------------------
+bool FrameGraph::Compile()
+{
+	passOrder.clear();
+	physicalDescs.clear();
+	for (Pass& pass : passes)
+	{
+		pass.Culled = false;
+		pass.Barriers.clear();
+	}
+	for (Resource& res : resources)
+	{
+		res.Physical = -1;
+		res.FirstUse = -1;
+		res.LastUse = -1;
+	}
+
+	if (!SortPasses())
+	{
+		passOrder.clear();
+		return false;
+	}
+
+	CullPasses();
+	AssignPhysicalTextures();
+	BuildBarriers();
+	return true;
+}
+
+// --------------------------------------------------------
+// Topological sort.  Declaration order says which version of
+// a resource each pass means: a read sees the most recent
+// write declared before it, so
+//  - a reader follows the last earlier writer (read after write)
+//  - the next writer follows every reader of the previous
+//    version (write after read)
+//  - writers of the same resource keep their declaration order
+// A pass that reads and writes the same resource reads the
+// previous version.  Ties go to whichever pass was declared
+// first, so a graph that's already in a sensible order comes
+// out unchanged.
+// --------------------------------------------------------
+bool FrameGraph::SortPasses()
+{
+	size_t passCount = passes.size();
+	std::vector<std::vector<int>> edges(passCount);
+	std::vector<int> incoming(passCount, 0);
+
+	// Per resource, as of the pass being looked at: who wrote the
+	// current version, and who has read it since
+	std::vector<int> lastWriter(resources.size(), -1);
+	std::vector<std::vector<int>> readers(resources.size());
+
+	auto addEdge = [&](int from, int to) {
+		if (from == to) return;
+		edges[from].push_back(to);
+		incoming[to]++;
+	};
+
+	for (size_t p = 0; p < passCount; p++)
+	{
+		for (const ResourceAccess& access : passes[p].Reads)
+		{
+			if (lastWriter[access.Resource] >= 0)
+				addEdge(lastWriter[access.Resource], (int)p);
+			readers[access.Resource].push_back((int)p);
+		}
+
+		for (const ResourceAccess& access : passes[p].Writes)
+		{
+			if (lastWriter[access.Resource] >= 0)
+				addEdge(lastWriter[access.Resource], (int)p);
+			for (int reader : readers[access.Resource])
+				addEdge(reader, (int)p);
+
+			lastWriter[access.Resource] = (int)p;
+			readers[access.Resource].clear();
+		}
+	}
+
+	// Kahn's algorithm, always taking the lowest ready index
+	std::vector<bool> done(passCount, false);
+	for (size_t n = 0; n < passCount; n++)
+	{
+		int next = -1;
+		for (size_t p = 0; p < passCount; p++)
+		{
+			if (!done[p] && incoming[p] == 0) { next = (int)p; break; }
+		}
+		if (next < 0) return false; // Cycle
+
+		done[next] = true;
+		passOrder.push_back(next);
+		for (int dependent : edges[next])
+			incoming[dependent]--;
+	}
+	return true;
+}
+
+// --------------------------------------------------------
+// Walks backwards from the outputs.  A pass survives if it
+// writes something a surviving pass (or an output) needs.
+// --------------------------------------------------------
+void FrameGraph::CullPasses()
+{
+	std::vector<bool> needed(resources.size(), false);
+	for (size_t r = 0; r < resources.size(); r++)
+		needed[r] = resources[r].Output;
+
+	for (int i = (int)passOrder.size() - 1; i >= 0; i--)
+	{
+		Pass& pass = passes[passOrder[i]];
+
+		bool alive = false;
+		for (const ResourceAccess& access : pass.Writes)
+			alive = alive || needed[access.Resource];
+
+		pass.Culled = !alive;
+		if (!alive) continue;
+
+		// Everything this pass reads is needed too.  Writes load
+		// what's already there (depth testing, blending), so a write
+		// never makes the earlier version dead - which is why needed
+		// is only ever set here, never cleared, and earlier writers
+		// of a needed resource stay alive.
+		for (const ResourceAccess& access : pass.Reads)
+			needed[access.Resource] = true;
+	}
+
+	// Drop culled passes from the order
+	std::vector<int> liveOrder;
+	for (int p : passOrder)
+		if (!passes[p].Culled)
+			liveOrder.push_back(p);
+	passOrder = liveOrder;
+}
+
+// --------------------------------------------------------
+// Finds each transient texture's lifetime in the live order,
+// then greedily packs them into physical slots.  A slot can
+// be reused once its last user has finished, as long as the
+// descriptions match exactly.
+// --------------------------------------------------------
+void FrameGraph::AssignPhysicalTextures()
+{
+	for (size_t i = 0; i < passOrder.size(); i++)
+	{
+		const Pass& pass = passes[passOrder[i]];
+		for (int list = 0; list < 2; list++)
+		{
+			const std::vector<ResourceAccess>& accesses = list == 0 ? pass.Reads : pass.Writes;
+			for (const ResourceAccess& access : accesses)
+			{
+				Resource& res = resources[access.Resource];
+				if (res.FirstUse < 0) res.FirstUse = (int)i;
+				res.LastUse = (int)i;
+			}
+		}
+	}
+
+	// Transient resources that are actually used, by first use
+	std::vector<int> transients;
+	for (size_t r = 0; r < resources.size(); r++)
+		if (!resources[r].Imported && resources[r].FirstUse >= 0)
+			transients.push_back((int)r);
+	std::stable_sort(transients.begin(), transients.end(), [this](int a, int b) {
+		return resources[a].FirstUse < resources[b].FirstUse;
+	});
+
+	std::vector<int> slotLastUse;
+	for (int r : transients)
+	{
+		Resource& res = resources[r];
+
+		int slot = -1;
+		for (size_t s = 0; s < physicalDescs.size(); s++)
+		{
+			if (slotLastUse[s] < res.FirstUse && physicalDescs[s] == res.Desc)
+			{
+				slot = (int)s;
+				break;
+			}
+		}
+
+		if (slot < 0)
+		{
+			physicalDescs.push_back(res.Desc);
+			slotLastUse.push_back(-1);
+			slot = (int)physicalDescs.size() - 1;
+		}
+
+		res.Physical = slot;
+		slotLastUse[slot] = res.LastUse;
+	}
+}
+
+// --------------------------------------------------------
+// Simulates resource states through the frame and records a
+// barrier wherever a pass needs a different state.  When a
+// transient texture takes over an aliased slot its old
+// contents are meaningless, so it starts out Undefined.
+// --------------------------------------------------------
+void FrameGraph::BuildBarriers()
+{
+	// Imported textures are tracked per resource, transient ones per slot
+	std::vector<FrameGraphState> importedStates(resources.size(), FrameGraphState::Undefined);
+	std::vector<FrameGraphState> slotStates(physicalDescs.size(), FrameGraphState::Undefined);
+
+	for (size_t i = 0; i < passOrder.size(); i++)
+	{
+		Pass& pass = passes[passOrder[i]];
+		for (int list = 0; list < 2; list++)
+		{
+			const std::vector<ResourceAccess>& accesses = list == 0 ? pass.Reads : pass.Writes;
+			for (const ResourceAccess& access : accesses)
+			{
+				Resource& res = resources[access.Resource];
+				FrameGraphState& state = res.Imported ?
+					importedStates[access.Resource] :
+					slotStates[res.Physical];
+
+				if (!res.Imported && res.FirstUse == (int)i)
+					state = FrameGraphState::Undefined;
+
+				if (state != access.State)
+				{
+					FrameGraphBarrier barrier = { access.Resource, state, access.State };
+					pass.Barriers.push_back(barrier);
+					state = access.State;
+				}
+			}
+		}
+	}
+}
+
+void FrameGraph::Execute(std::function<void(const FrameGraphBarrier&)> barrierHandler)
+{
+	for (int p : passOrder)
+	{
+		Pass& pass = passes[p];
+		if (barrierHandler)
+		{
+			for (const FrameGraphBarrier& barrier : pass.Barriers)
+				barrierHandler(barrier);
+		}
+		if (pass.Execute)
+			pass.Execute();
+	}
+}
+
+bool FrameGraph::IsPassCulled(int pass)
+{
+	return passes[pass].Culled;
+}
+
+const std::vector<FrameGraphBarrier>& FrameGraph::GetBarriers(int pass)
+{
+	return passes[pass].Barriers;
+}
+
+// --------------------------------------------------------
+// Returns the physical slot backing a transient texture,
+// or -1 for imported or unused textures
+// --------------------------------------------------------
+int FrameGraph::GetPhysicalTexture(int resource)
+{
+	return resources[resource].Physical;
+}
+
+// --------------------------------------------------------
+// Number of transient textures that are actually used - compare
+// with GetPhysicalTextureCount() to see what aliasing saved
+// --------------------------------------------------------
+unsigned int FrameGraph::GetTransientTextureCount()
+{
+	unsigned int count = 0;
+	for (const Resource& res : resources)
+		if (!res.Imported && res.FirstUse >= 0)
+			count++;
+	return count;
+}
@@ -0,0 +1,140 @@
+#pragma once
+#include <functional>
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------
+// How a pass touches a resource, and the state the resource
+// has to be in for that pass
+// --------------------------------------------------------
+enum class FrameGraphState
+{
+	Undefined,		// Contents don't matter (start of frame / freshly aliased)
+	RenderTarget,	// Bound as a render target view
+	DepthWrite,		// Bound as a depth stencil view
+	ShaderRead		// Bound as a shader resource view
+};
+
+// --------------------------------------------------------
+// Description of a transient texture.  Two transient textures
+// may share memory only when their descriptions match.
+// --------------------------------------------------------
+struct FrameGraphTextureDesc
+{
+	unsigned int Width;
+	unsigned int Height;
+	unsigned int Format;	// DXGI_FORMAT of the views
+	bool IsDepth;			// Needs a depth stencil view instead of a render target view
+
+	bool operator==(const FrameGraphTextureDesc& other) const
+	{
+		return Width == other.Width && Height == other.Height &&
+			Format == other.Format && IsDepth == other.IsDepth;
+	}
+};
+
+// --------------------------------------------------------
+// A state change the graph wants done before a pass runs
+// --------------------------------------------------------
+struct FrameGraphBarrier
+{
+	int Resource;
+	FrameGraphState Before;
+	FrameGraphState After;
+};
+
+// --------------------------------------------------------
+// A small frame graph.  Passes declare the resources they read
+// and write; Compile() then
+//  - orders the passes so every read follows the writes it needs
+//  - culls passes whose results never reach an output
+//  - works out which transient textures can share memory
+//    (no overlap in lifetime and identical descriptions)
+//  - records the state changes each pass needs
+//
+// The graph only deals in integer handles and has no idea
+// what an actual texture is, so it's entirely CPU side.  The
+// owner creates one real texture per physical slot and maps
+// resource handles onto them with GetPhysicalTexture().
+// --------------------------------------------------------
+class FrameGraph
+{
+public:
+	FrameGraph();
+	~FrameGraph();
+
+	// Forget every pass and resource
+	void Clear();
+
+	// Resource declaration - returns a handle
+	int CreateTexture(std::string name, const FrameGraphTextureDesc& desc);
+	int ImportTexture(std::string name);
+
+	// Outputs (like the back buffer) keep the passes that write them alive
+	void MarkOutput(int resource);
+
+	// Pass declaration - returns a handle.  A read sees the latest
+	// write to that resource declared before it, so declare passes
+	// in the order you'd run them by hand.
+	int AddPass(std::string name, std::function<void()> execute);
+	void Read(int pass, int resource);
+	void Write(int pass, int resource, FrameGraphState state = FrameGraphState::RenderTarget);
+
+	// Sorts, culls and aliases - returns false on a dependency cycle
+	bool Compile();
+
+	// Runs every live pass in order, calling the barrier handler
+	// (if any) before each pass with the transitions it needs
+	void Execute(std::function<void(const FrameGraphBarrier&)> barrierHandler);
+
+	// Results of Compile()
+	const std::vector<int>& GetPassOrder() { return passOrder; }
+	bool IsPassCulled(int pass);
+	const std::vector<FrameGraphBarrier>& GetBarriers(int pass);
+	int GetPhysicalTexture(int resource);
+	unsigned int GetPhysicalTextureCount() { return (unsigned int)physicalDescs.size(); }
+	const FrameGraphTextureDesc& GetPhysicalDesc(unsigned int slot) { return physicalDescs[slot]; }
+	unsigned int GetTransientTextureCount();
+
+	// Names for debugging output
+	const std::string& GetPassName(int pass) { return passes[pass].Name; }
+	const std::string& GetResourceName(int resource) { return resources[resource].Name; }
+
+private:
+	struct ResourceAccess
+	{
+		int Resource;
+		FrameGraphState State;
+	};
+
+	struct Pass
+	{
+		std::string Name;
+		std::function<void()> Execute;
+		std::vector<ResourceAccess> Reads;
+		std::vector<ResourceAccess> Writes;
+		std::vector<FrameGraphBarrier> Barriers;
+		bool Culled;
+	};
+
+	struct Resource
+	{
+		std::string Name;
+		FrameGraphTextureDesc Desc;
+		bool Imported;
+		bool Output;
+		int Physical;		// Physical slot (transient only), -1 otherwise
+		int FirstUse;		// Position in passOrder
+		int LastUse;
+	};
+
+	std::vector<Pass> passes;
+	std::vector<Resource> resources;
+	std::vector<int> passOrder;
+	std::vector<FrameGraphTextureDesc> physicalDescs;
+
+	bool SortPasses();
+	void CullPasses();
+	void AssignPhysicalTextures();
+	void BuildBarriers();
+};
@@ -9,6 +9,9 @@
 // For the DirectX Math library
 using namespace DirectX;
 
+// Units per second the nodes travel down the rails (see Rail)
+static const double TrackSpeed = 20.0;
+
 // --------------------------------------------------------
 // Constructor
 //
@@ -32,6 +35,15 @@ Game::Game(HINSTANCE hInstance)
 	materials = std::vector<Material*>();
 	vertexShader = 0;
 	pixelShader = 0;
+	quantizedVS = 0;
+	quantizedDepthVS = 0;
+	jobSystem = new JobSystem();
+	assets = nullptr;
+	registry = nullptr;
+	terrain = nullptr;
+	terrainMaterial = nullptr;
+	trackDistance = 0.0;
+	previousTrackDistance = 0.0;
 	camera = new Camera(width, height);
 	skybox = new CubeMap();
 	Entity::activeSkybox = skybox;
@@ -96,12 +108,26 @@ Game::~Game()
 
 	delete vertexShader;
 	delete pixelShader;
-	delete simpleEmitter;
+	delete quantizedVS;
+	delete quantizedDepthVS;
+	ParticleManager::GetInstance().ReleaseEmitters();
+	particleBlendState->Release();
+	particleAlphaBlendState->Release();
+	particleDepthState->Release();
 
 	delete skybox;
 
-	ppsrv->Release();
-	ppRenderTargetView->Release();
+	// Waits for any chunk still building, so before the job system goes
+	delete terrain;
+
+	ReleaseFrameGraphTextures();
+
+	// Handles have to go before the registry they point into
+	sceneAssets.clear();
+	delete assets;
+	if (registry) registry->PrintStats();
+	delete registry;
+	delete jobSystem;
 	delete ppVS;
 	delete ppPS;
 
@@ -126,6 +152,10 @@ void Game::Init()
 	// Helper methods for loading shaders, creating some basic
 	// geometry to draw and some simple camera matrices.
 	//  - You'll be expanding and/or replacing these later
+	//  - Shaders, textures and meshes load across the job system,
+	//    see FinishLoading()
+	assets = new AssetLoader(jobSystem, device, context);
+	registry = new AssetRegistry();
 	LoadShaders();
 	CreateMatrices();
 	CreateBasicGeometry();
@@ -151,6 +181,12 @@ void Game::Init()
 	blendDesc.RenderTarget[0].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
 	device->CreateBlendState(&blendDesc, &particleBlendState);
 
+	// Regular alpha blending for the depth sorted sky - order matters
+	// here, so that emitter draws back to front
+	blendDesc.RenderTarget[0].DestBlend = D3D11_BLEND_INV_SRC_ALPHA;
+	blendDesc.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_INV_SRC_ALPHA;
+	device->CreateBlendState(&blendDesc, &particleAlphaBlendState);
+
 	// Depth state
 	D3D11_DEPTH_STENCIL_DESC depthDesc = {};
 	depthDesc.DepthEnable = true;
@@ -158,20 +194,34 @@ void Game::Init()
 	depthDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
 	device->CreateDepthStencilState(&depthDesc, &particleDepthState);
 
-	// create the particle emitters
-	simpleEmitter = new Emitter(device, particleVS, particlePS, particleGS, particleTexture, sampler, particleBlendState, particleDepthState);
-	ParticleManager::GetInstance().AttachEmitter(simpleEmitter);
+	// create the particle emitters - both draw from the manager's budget
+	ParticleManager& particles = ParticleManager::GetInstance();
+
+	// hit sparks matter most, so they can take budget from the sky
+	EmitterSettings noteSettings;
+	noteSettings.Capacity = 8192;
+	noteSettings.Overflow = ParticleOverflow::Priority;
+	noteSettings.Priority = 1;
+	noteSettings.LodWeight = 0.5f; // hit feedback only thins out so far
+	particles.AttachEmitter(ParticleEffect::NoteHit, new Emitter(device, particleVS, particlePS, particleGS,
+		particleTexture, sampler, particleBlendState, particleDepthState, particles.GetBudget(), noteSettings));
+
+	// the sky just recycles its oldest drops when it runs out.  Its big
+	// overlapping quads are alpha blended, so they're drawn sorted.
+	EmitterSettings skySettings;
+	skySettings.Capacity = 2048;
+	skySettings.Overflow = ParticleOverflow::DropOldest;
+	skySettings.Priority = 0;
+	skySettings.SortByDepth = true;
+	skySettings.LodWeight = 1;
+	particles.AttachEmitter(ParticleEffect::Sky, new Emitter(device, particleVS, particlePS, particleGS,
+		particleTexture, sampler, particleAlphaBlendState, particleDepthState, particles.GetBudget(), skySettings));
 
 	// Tell the input assembler stage of the pipeline what kind of
 	// geometric primitives (points, lines or triangles) we want to draw.  
 	// Essentially: "What kind of shape should the GPU draw with our data?"
 	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
-	ID3D11ShaderResourceView* skySRV = (skybox->GetResourceView());
-	HRESULT hr = CreateDDSTextureFromFile(device, L"Assets/Textures/EmptySpace.dds", 0, &skySRV);
-	skybox->SetResourceView(skySRV);
-
-	//printf(hr);
 	//CreateWICTextureFromFile(device, L"Assets/Textures/skybox.dds", 0, &skyboxSRV);
 
 	// Create a sampler state for texture sampling
@@ -194,44 +244,6 @@ void Game::Init()
 	device->CreateRasterizerState(&rsDesc, &rs);
 	skybox->SetRasterizerState(rs);
 
-	// post process effects
-	D3D11_TEXTURE2D_DESC textureDesc = {};
-	textureDesc.Width = width;
-	textureDesc.Height = height;
-	textureDesc.ArraySize = 1;
-	textureDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
-	textureDesc.CPUAccessFlags = 0;
-	textureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-	textureDesc.MipLevels = 1;
-	textureDesc.MiscFlags = 0;
-	textureDesc.SampleDesc.Count = 1;
-	textureDesc.SampleDesc.Quality = 0;
-	textureDesc.Usage = D3D11_USAGE_DEFAULT;
-
-	// set up render target
-	ID3D11Texture2D* ppTexture;
-	device->CreateTexture2D(&textureDesc, 0, &ppTexture);
-
-	// Create the Render Target View
-	D3D11_RENDER_TARGET_VIEW_DESC rtvDesc = {};
-	rtvDesc.Format = textureDesc.Format;
-	rtvDesc.Texture2D.MipSlice = 0;
-	rtvDesc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
-
-	device->CreateRenderTargetView(ppTexture, &rtvDesc, &ppRenderTargetView);
-
-	// Create the Shader Resource View
-	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-	srvDesc.Format = textureDesc.Format;
-	srvDesc.Texture2D.MipLevels = 1;
-	srvDesc.Texture2D.MostDetailedMip = 0;
-	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-
-	device->CreateShaderResourceView(ppTexture, &srvDesc, &ppsrv);
-
-	// We don't need the texture reference itself no mo'
-	ppTexture->Release();
-
 	D3D11_DEPTH_STENCIL_DESC dsDesc = {};
 	dsDesc.DepthEnable = true;
 	dsDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ALL;
@@ -240,48 +252,6 @@ void Game::Init()
 	device->CreateDepthStencilState(&dsDesc, &dss);
 	skybox->SetStencilState(dss);
 
-	ID3D11Texture2D* dofTexture;
-	device->CreateTexture2D(&textureDesc, 0, &dofTexture);
-	ID3D11Texture2D* dofBlurTexture;
-	device->CreateTexture2D(&textureDesc, 0, &dofBlurTexture);
-
-	device->CreateRenderTargetView(dofTexture, &rtvDesc, &dofRTV);
-	device->CreateRenderTargetView(dofBlurTexture, &rtvDesc, &dofBlurRTV);
-
-	device->CreateShaderResourceView(dofTexture, &srvDesc, &dofSRV);
-	device->CreateShaderResourceView(dofBlurTexture, &srvDesc, &dofBlurSRV);
-	dofTexture->Release();
-	dofBlurTexture->Release();
-
-	D3D11_TEXTURE2D_DESC depthTexDesc = {};
-	depthTexDesc.Width = width;
-	depthTexDesc.Height = height;
-	depthTexDesc.ArraySize = 1;
-	depthTexDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE;
-	depthTexDesc.CPUAccessFlags = 0;
-	depthTexDesc.Format = DXGI_FORMAT_R32_TYPELESS;
-	depthTexDesc.MipLevels = 1;
-	depthTexDesc.SampleDesc.Count = 1;
-	depthTexDesc.SampleDesc.Quality = 0;
-	depthTexDesc.Usage = D3D11_USAGE_DEFAULT;
-	ID3D11Texture2D* depthBuffer;
-	device->CreateTexture2D(&depthTexDesc, 0, &depthBuffer);
-
-	D3D11_DEPTH_STENCIL_VIEW_DESC dofDepthDesc = {};
-	dofDepthDesc.Format = DXGI_FORMAT_D32_FLOAT;
-	dofDepthDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
-	dofDepthDesc.Texture2D.MipSlice = 0;
-	device->CreateDepthStencilView(depthBuffer, &dofDepthDesc, &depthDSV);
-
-	D3D11_SHADER_RESOURCE_VIEW_DESC depthSrvDesc = {};
-	depthSrvDesc.Format = DXGI_FORMAT_R32_FLOAT;
-	depthSrvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-	depthSrvDesc.Texture2D.MipLevels = 1;
-	depthSrvDesc.Texture2D.MostDetailedMip = 0;
-	device->CreateShaderResourceView(depthBuffer, &depthSrvDesc, &depthSRV);
-
-	depthBuffer->Release();
-
 	D3D11_RASTERIZER_DESC depthRastDesc = {};
 	depthRastDesc.FillMode = D3D11_FILL_SOLID;
 	depthRastDesc.CullMode = D3D11_CULL_BACK;
@@ -293,13 +263,16 @@ void Game::Init()
 
 	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
-	// Effects
-	/*ppRenderTarget = new ID3D11Texture2D();
-	renderTargetView;
-	ppsrv;
-	*/
+	// Post process targets and the passes that use them
+	BuildFrameGraph();
+
+	BuildUpdateGraph();
+
 	// load song beatmap, print success
 	cout << "songs loaded: " << parser.OpenFile("Assets/Beatmaps/song.sm");
+
+	// sky effects follow the beatmap's measures and tempo changes
+	ParticleManager::GetInstance().LoadChart(&parser);
 }
 
 // --------------------------------------------------------
@@ -307,70 +280,67 @@ void Game::Init()
 // my SimpleShader wrapper for DirectX shader manipulation.
 // - SimpleShader provides helpful methods for sending
 //   data to individual variables on the GPU
+// - They're only queued here - see FinishLoading()
 // --------------------------------------------------------
 void Game::LoadShaders()
 {
 	vertexShader = new SimpleVertexShader(device, context);
-	if (!vertexShader->LoadShaderFile(L"x64/Debug/VertexShader.cso"))
-		vertexShader->LoadShaderFile(L"VertexShader.cso");
+	assets->AddShader(L"VertexShader.cso", vertexShader);
 
 	pixelShader = new SimplePixelShader(device, context);
-	if (!pixelShader->LoadShaderFile(L"x64/Debug/PixelShader.cso"))
-		pixelShader->LoadShaderFile(L"PixelShader.cso");
+	assets->AddShader(L"PixelShader.cso", pixelShader);
 
 	// Load particle shaders
 	particleVS = new SimpleVertexShader(device, context);
-	if (!particleVS->LoadShaderFile(L"x64/Debug/ParticleVS.cso"))
-		particleVS->LoadShaderFile(L"ParticleVS.cso");
+	assets->AddShader(L"ParticleVS.cso", particleVS);
 
 	particlePS = new SimplePixelShader(device, context);
-	if (!particlePS->LoadShaderFile(L"x64/Debug/ParticlePS.cso"))
-		particlePS->LoadShaderFile(L"ParticlePS.cso");
+	assets->AddShader(L"ParticlePS.cso", particlePS);
 
 	particleGS = new SimpleGeometryShader(device, context);
-	if (!particleGS->LoadShaderFile(L"x64/Debug/ParticleGS.cso"))
-		particleGS->LoadShaderFile(L"ParticleGS.cso");
-	particleGS->SetFloat("pixelWidth", 1.0f / width);
-	particleGS->SetFloat("pixelHeight", 1.0f / height);
+	int particleGSAsset = assets->AddShader(L"ParticleGS.cso", particleGS);
+
+	// Its variables only exist once it's been created
+	int particleGSConstants = assets->Add("Particle GS constants", nullptr, [this]() {
+		particleGS->SetFloat("pixelWidth", 1.0f / width);
+		particleGS->SetFloat("pixelHeight", 1.0f / height);
+	});
+	assets->AddDependency(particleGSAsset, particleGSConstants);
 
 	terrainVS = new SimpleVertexShader(device, context);
-	if (!terrainVS->LoadShaderFile(L"x64/Debug/TerrainVS.cso"))
-		terrainVS->LoadShaderFile(L"x64/Debug/TerrainVS.cso");
+	assets->AddShader(L"TerrainVS.cso", terrainVS);
 	terrainPS = new SimplePixelShader(device, context);
-	if (!terrainPS->LoadShaderFile(L"x64/Debug/ScrollingTexturePS.cso"))
-		terrainPS->LoadShaderFile(L"ScrollingTexturePS.cso");
+	assets->AddShader(L"ScrollingTexturePS.cso", terrainPS);
 
 	SimpleVertexShader* skyboxVS = new SimpleVertexShader(device, context);
-	if (!skyboxVS->LoadShaderFile(L"x64/Debug/SkyboxVS.cso"))
-		skyboxVS->LoadShaderFile(L"SkyboxVS.cso");
+	assets->AddShader(L"SkyboxVS.cso", skyboxVS);
 	SimplePixelShader* skyboxPS = new SimplePixelShader(device, context);
-	if (!skyboxPS->LoadShaderFile(L"x64/Debug/SkyboxPS.cso")) 
-		skyboxPS->LoadShaderFile(L"SkyboxPS.cso");
+	assets->AddShader(L"SkyboxPS.cso", skyboxPS);
 	skybox->SetSVS(skyboxVS);
 	skybox->SetSPS(skyboxPS);
 
 	ppVS = new SimpleVertexShader(device, context);
-	if (!ppVS->LoadShaderFile(L"x64/Debug/PPVS.cso"))
-		ppVS->LoadShaderFile(L"PPVS.cso");
+	assets->AddShader(L"PPVS.cso", ppVS);
 	ppPS = new SimplePixelShader(device, context);
-	if (!ppPS->LoadShaderFile(L"x64/Debug/PPPS.cso"))
-		ppPS->LoadShaderFile(L"PPPS.cso");
+	assets->AddShader(L"PPPS.cso", ppPS);
 
 	depthVS = new SimpleVertexShader(device, context);
-	if (!depthVS->LoadShaderFile(L"x64/Debug/DepthVS.cso"))
-		depthVS->LoadShaderFile(L"DepthVS.cso");
+	assets->AddShader(L"DepthVS.cso", depthVS);
+
+	quantizedVS = new SimpleVertexShader(device, context);
+	assets->AddShader(L"QuantizedVS.cso", quantizedVS);
+
+	quantizedDepthVS = new SimpleVertexShader(device, context);
+	assets->AddShader(L"QuantizedDepthVS.cso", quantizedDepthVS);
 	dofVS = new SimpleVertexShader(device, context);
-	if (!dofVS->LoadShaderFile(L"x64/Debug/DepthOfFieldVS.cso"))
-		dofVS->LoadShaderFile(L"DepthOfFieldVS.cso");
+	assets->AddShader(L"DepthOfFieldVS.cso", dofVS);
 	dofPS = new SimplePixelShader(device, context);
-	if (!dofPS->LoadShaderFile(L"x64/Debug/DepthOfFieldPS.cso"))
-		dofPS->LoadShaderFile(L"DepthOfFieldPS.cso");
+	assets->AddShader(L"DepthOfFieldPS.cso", dofPS);
 	dofBlurPS = new SimplePixelShader(device, context);
-	if (!dofBlurPS->LoadShaderFile(L"x64/Debug/DepthOfFieldBlurPS.cso"))
-		dofBlurPS->LoadShaderFile(L"DepthOfFieldBlurPS.cso");
+	assets->AddShader(L"DepthOfFieldBlurPS.cso", dofBlurPS);
 
-	// You'll notice that the code above attempts to load each
-	// compiled shader file (.cso) from two different relative paths.
+	// AddShader attempts to load each compiled shader
+	// file (.cso) from two different relative paths.
 
 	// This is because the "working directory" (where relative paths begin)
 	// will be different during the following two scenarios:
@@ -383,6 +353,44 @@ void Game::LoadShaders()
 
 
 
+// --------------------------------------------------------
+// Runs everything queued on the asset loader.  Workers read,
+// decode and process the files while this thread creates the
+// GPU resources as they come in, drawing a loading screen
+// between batches.
+// --------------------------------------------------------
+void Game::FinishLoading()
+{
+	if (!assets->Start())
+		return;
+
+	// A frame's worth of finishing at a time keeps the screen alive
+	while (!assets->Update(1.0f / 60.0f))
+		DrawLoadingScreen(assets->GetProgress());
+
+	if (assets->GetFailedCount() > 0)
+		printf("%u assets failed to load\n", assets->GetFailedCount());
+	registry->PrintStats();
+}
+
+// --------------------------------------------------------
+// Fades the window in from black as loading progresses, with
+// the percentage in the title bar.  The frame loop hasn't
+// started yet, so this presents on its own.
+// --------------------------------------------------------
+void Game::DrawLoadingScreen(float progress)
+{
+	const float color[4] = { 0.1f * progress, 0.1f * progress, 0.2f * progress, 0.0f };
+	context->OMSetRenderTargets(1, &backBufferRTV, 0);
+	context->ClearRenderTargetView(backBufferRTV, color);
+
+	std::string title = titleBarText + "    Loading " + std::to_string((int)(progress * 100.0f)) + "%";
+	SetWindowText(hWnd, title.c_str());
+
+	// Wait for vsync so the workers aren't fighting a spinning thread
+	swapChain->Present(1, 0);
+}
+
 // --------------------------------------------------------
 // Initializes the matrices necessary to represent our geometry's 
 // transformations and our 3D camera
@@ -444,68 +452,89 @@ void Game::CreateBasicGeometry()
 
 	device->CreateSamplerState(&desc, &sampler);
 
-	ID3D11ShaderResourceView* metalTex;
-	ID3D11ShaderResourceView* woodTex;
-	ID3D11ShaderResourceView* terrainTex;
-	ID3D11ShaderResourceView* carTex;
-
-	CreateWICTextureFromFile(device, context, L"Assets/Textures/wheel2.bmp", 0, &carTex);
-	CreateWICTextureFromFile(device, context, L"Assets/Textures/metal.jpg", 0, &metalTex);
-	CreateWICTextureFromFile(device, context, L"Assets/Textures/wood.jpg", 0, &woodTex);
-	CreateWICTextureFromFile(device, context, L"Assets/Textures/SimpleParticle.jpg", 0, &particleTexture);
-	CreateWICTextureFromFile(device, context, L"Assets/Textures/sand-texture.jpg", 0, &terrainTex);
-
-	Mesh* cone = new Mesh("Assets/Models/cone.obj", device);
-	meshes.push_back(cone);
-	Mesh* cube = new Mesh("Assets/Models/cube.obj", device);
-	meshes.push_back(cube);
-	Mesh* cylinder = new Mesh("Assets/Models/cylinder.obj", device);
-	meshes.push_back(cylinder);
-	Mesh* helix = new Mesh("Assets/Models/helix.obj", device);
-	meshes.push_back(helix);
-	Mesh* sphere = new Mesh("Assets/Models/sphere.obj", device);
-	meshes.push_back(sphere);
-	Mesh* torus = new Mesh("Assets/Models/torus.obj", device);
-	meshes.push_back(torus);
-	Mesh* car = new Mesh("Assets/Models/Porsche_911_GT2.obj", device);
-	meshes.push_back(car);
-
-	skybox->SetMesh(cube);
+	// Files come from the registry, which shares them between
+	// everything that asks and releases them when they go
+	AssetHandle carTex = registry->LoadTexture(*assets, L"Assets/Textures/wheel2.bmp");
+	AssetHandle metalTex = registry->LoadTexture(*assets, L"Assets/Textures/metal.jpg");
+	AssetHandle woodTex = registry->LoadTexture(*assets, L"Assets/Textures/wood.jpg");
+	AssetHandle particleTex = registry->LoadTexture(*assets, L"Assets/Textures/SimpleParticle.jpg");
+	AssetHandle terrainTex = registry->LoadTexture(*assets, L"Assets/Textures/sand-texture.jpg");
+	AssetHandle skyTex = registry->LoadTexture(*assets, L"Assets/Textures/EmptySpace.dds");
+
+	// The meshes exist right away but stay empty until they've loaded
+	AssetHandle cone = registry->LoadMesh(*assets, "Assets/Models/cone.obj");
+	AssetHandle cube = registry->LoadMesh(*assets, "Assets/Models/cube.obj");
+	AssetHandle cylinder = registry->LoadMesh(*assets, "Assets/Models/cylinder.obj");
+	AssetHandle helix = registry->LoadMesh(*assets, "Assets/Models/helix.obj");
+	AssetHandle sphere = registry->LoadMesh(*assets, "Assets/Models/sphere.obj");
+	AssetHandle torus = registry->LoadMesh(*assets, "Assets/Models/torus.obj");
+	// The car is by far the biggest mesh, so it's stored at half size
+	AssetHandle car = registry->LoadMesh(*assets, "Assets/Models/Porsche_911_GT2.obj", MeshVertexFormat::Quantized);
+
+	// Held for as long as the game runs
+	sceneAssets = { carTex, metalTex, woodTex, particleTex, terrainTex, skyTex,
+		cone, cube, cylinder, helix, sphere, torus, car };
+
+	skybox->SetMesh(cube.GetMesh());
   
-	Mesh* terrainMesh = new Mesh(8, 8, device);
-	meshes.push_back(terrainMesh);
+	// Materials wait for their texture and shaders...
+	Material* defMaterial = nullptr;
+	int defMaterialAsset = assets->Add("Default material", nullptr, [&]() {
+		defMaterial = new Material(vertexShader, pixelShader, carTex.GetTexture(), sampler);
+	});
+	assets->AddDependencies(defMaterialAsset,
+		{ carTex.GetLoadHandle(*assets), assets->Find("VertexShader.cso"), assets->Find("PixelShader.cso") });
+
+	Material* playerMaterial = nullptr;
+	int playerMaterialAsset = assets->Add("Player material", nullptr, [&]() {
+		playerMaterial = new Material(quantizedVS, pixelShader, carTex.GetTexture(), sampler);
+		playerMaterial->SetReflective(0.2f);
+	});
+	assets->AddDependencies(playerMaterialAsset,
+		{ carTex.GetLoadHandle(*assets), assets->Find("QuantizedVS.cso"), assets->Find("PixelShader.cso") });
+
+	Material* woodMaterial = nullptr;
+	int woodMaterialAsset = assets->Add("Wood material", nullptr, [&]() {
+		woodMaterial = new Material(vertexShader, pixelShader, woodTex.GetTexture(), sampler);
+	});
+	assets->AddDependencies(woodMaterialAsset,
+		{ woodTex.GetLoadHandle(*assets), assets->Find("VertexShader.cso"), assets->Find("PixelShader.cso") });
+
+	Material* dynMaterial = nullptr;
+	int dynMaterialAsset = assets->Add("Terrain material", nullptr, [&]() {
+		dynMaterial = new Material(terrainVS, terrainPS, terrainTex.GetTexture(), sampler);
+	});
+	assets->AddDependencies(dynMaterialAsset,
+		{ terrainTex.GetLoadHandle(*assets), assets->Find("TerrainVS.cso"), assets->Find("ScrollingTexturePS.cso") });
 
+	//testCube1 = new Entity(sphere, dynMaterial);
+	//testCube2 = new Entity(sphere, dynMaterial);
+	//testCube1->SetPosition({ -1.0f, 1.0f, 1.0f });
+	//testCube2->SetPosition({ 1.0f,1.0f,1.0f });
+
+	// ...and entities for their mesh and material
+	Entity* playerEnt = nullptr;
+	int playerAsset = assets->Add("Player", nullptr, [&]() {
+		playerEnt = new Entity(car.GetMesh(), playerMaterial);
+		playerEnt->Activate();
+	});
+	assets->AddDependencies(playerAsset, { car.GetLoadHandle(*assets), playerMaterialAsset });
 
-	Material* defMaterial = new Material(vertexShader, pixelShader, carTex, sampler);
+	FinishLoading();
+
+	particleTexture = particleTex.GetTexture();
+	skybox->SetResourceView(skyTex.GetTexture());
 	materials.push_back(defMaterial);
-	Material* playerMaterial = new Material(vertexShader, pixelShader, carTex, sampler);
-	playerMaterial->SetReflective(0.2f);
 	materials.push_back(playerMaterial);
-	Material* woodMaterial = new Material(vertexShader, pixelShader, woodTex, sampler);
 	materials.push_back(woodMaterial);
-	Material* dynMaterial = new Material(terrainVS, terrainPS, terrainTex, sampler);
 	materials.push_back(dynMaterial);
 
-	//testCube1 = new Entity(sphere, dynMaterial);
-	//testCube2 = new Entity(sphere, dynMaterial);
-	//testCube1->SetPosition({ -1.0f, 1.0f, 1.0f });
-	//testCube2->SetPosition({ 1.0f,1.0f,1.0f });
-
-	terrainL = new Entity(terrainMesh, dynMaterial);
-	terrainL->SetPosition({ -17.4f, -2.0f, 0.0f });
-	terrainL->SetRotation({ 0.0f, 0.0f, 0.0f });
-	terrainL->SetScale({ 5.0f, 5.0f, 25.0f });
-	terrainL->Activate();
-	
-	terrainR = new Entity(terrainMesh, dynMaterial);
-	terrainR->SetRotation({ 0.0f, 3.14f, 0.0f });
-	terrainR->SetPosition({ +17.4f, -2.0f, 0.0f });
-	terrainR->SetScale({ 5.0f, 5.0f, 25.0f });
-	terrainR->Activate();
+	// The terrain builds on the job system while the game runs,
+	// but the first stretch is waited for so it's there at once
+	terrainMaterial = dynMaterial;
+	terrain = new Terrain(device, jobSystem);
+	terrain->Update(context, trackDistance, camera->GetPosition().z, true);
 
-	Entity* playerEnt = new Entity(car, playerMaterial);
-  
-	playerEnt->Activate();
 	//RailSet* rs = new RailSet(cube,defMaterial,&entities);
 
 	std::vector<XMFLOAT3> railPositions;
@@ -516,7 +545,7 @@ void Game::CreateBasicGeometry()
 	player = new Player(playerEnt, railPositions);
 	entities.push_back(playerEnt);
   
-	nodeManager = new MusicNodeManager(player, railPositions, cube, woodMaterial,&entities,&parser, camera);
+	nodeManager = new MusicNodeManager(player, railPositions, cube.GetMesh(), woodMaterial,&entities,&parser, camera);
 	///*
 	for (int j = 1; j < 7; j++) {
 		//Entity* nodeEnt = new Entity(cube, woodMaterial);
@@ -534,6 +563,217 @@ void Game::CreateBasicGeometry()
 }
 
 
+// --------------------------------------------------------
+// Declares the render passes for a frame and the textures they
+// read and write, then lets the frame graph order them and work
+// out which intermediate targets can share memory.  Called from
+// Init and again whenever the window size changes.
+// --------------------------------------------------------
+void Game::BuildFrameGraph()
+{
+	ReleaseFrameGraphTextures();
+	frameGraph.Clear();
+
+	FrameGraphTextureDesc colorDesc = { width, height, DXGI_FORMAT_R8G8B8A8_UNORM, false };
+	FrameGraphTextureDesc depthDesc = { width, height, DXGI_FORMAT_R32_FLOAT, true };
+
+	fgBackBuffer = frameGraph.ImportTexture("BackBuffer");
+	fgBackBufferDepth = frameGraph.ImportTexture("BackBufferDepth");
+	frameGraph.MarkOutput(fgBackBuffer);
+
+	fgDepth = frameGraph.CreateTexture("DepthOfFieldDepth", depthDesc);
+	fgSceneColor = frameGraph.CreateTexture("SceneColor", colorDesc);
+	fgDofBlur = frameGraph.CreateTexture("DepthOfFieldBlur", colorDesc);
+	fgDofOutput = frameGraph.CreateTexture("DepthOfFieldOutput", colorDesc);
+
+	int depthPass = frameGraph.AddPass("DepthPrepass", [this]() {
+		RenderDepthBuffer(frameFreqs, frameDeltaTime, frameTotalTime);
+	});
+	frameGraph.Write(depthPass, fgDepth, FrameGraphState::DepthWrite);
+
+	int scenePass = frameGraph.AddPass("Scene", [this]() {
+		DrawScene(frameFreqs, frameDeltaTime, frameTotalTime);
+	});
+	frameGraph.Write(scenePass, fgSceneColor);
+	frameGraph.Write(scenePass, fgBackBufferDepth, FrameGraphState::DepthWrite);
+
+	int blurPass = frameGraph.AddPass("DepthOfFieldBlur", [this]() { DrawDepthOfFieldBlur(); });
+	frameGraph.Read(blurPass, fgSceneColor);
+	frameGraph.Write(blurPass, fgDofBlur);
+
+	int compositePass = frameGraph.AddPass("DepthOfFieldComposite", [this]() { DrawDepthOfFieldComposite(); });
+	frameGraph.Read(compositePass, fgSceneColor);
+	frameGraph.Read(compositePass, fgDofBlur);
+	frameGraph.Read(compositePass, fgDepth);
+	frameGraph.Write(compositePass, fgDofOutput);
+
+	int bloomPass = frameGraph.AddPass("Bloom", [this]() { DrawBloom(); });
+	frameGraph.Read(bloomPass, fgDofOutput);
+	frameGraph.Write(bloomPass, fgBackBuffer);
+
+	if (!frameGraph.Compile())
+	{
+		printf("Frame graph has a dependency cycle!\n");
+		return;
+	}
+
+	// One real texture per physical slot
+	unsigned int slotCount = frameGraph.GetPhysicalTextureCount();
+	graphRTVs.assign(slotCount, nullptr);
+	graphSRVs.assign(slotCount, nullptr);
+	graphDSVs.assign(slotCount, nullptr);
+	for (unsigned int slot = 0; slot < slotCount; slot++)
+	{
+		const FrameGraphTextureDesc& desc = frameGraph.GetPhysicalDesc(slot);
+
+		D3D11_TEXTURE2D_DESC textureDesc = {};
+		textureDesc.Width = desc.Width;
+		textureDesc.Height = desc.Height;
+		textureDesc.ArraySize = 1;
+		textureDesc.MipLevels = 1;
+		textureDesc.SampleDesc.Count = 1;
+		textureDesc.SampleDesc.Quality = 0;
+		textureDesc.Usage = D3D11_USAGE_DEFAULT;
+
+		// Depth needs a typeless texture so it can be both a DSV and an SRV
+		if (desc.IsDepth)
+		{
+			textureDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+			textureDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE;
+		}
+		else
+		{
+			textureDesc.Format = (DXGI_FORMAT)desc.Format;
+			textureDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+		}
+
+		ID3D11Texture2D* texture;
+		device->CreateTexture2D(&textureDesc, 0, &texture);
+
+		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.Format = (DXGI_FORMAT)desc.Format;
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+		srvDesc.Texture2D.MipLevels = 1;
+		srvDesc.Texture2D.MostDetailedMip = 0;
+		device->CreateShaderResourceView(texture, &srvDesc, &graphSRVs[slot]);
+
+		if (desc.IsDepth)
+		{
+			D3D11_DEPTH_STENCIL_VIEW_DESC dsvDesc = {};
+			dsvDesc.Format = DXGI_FORMAT_D32_FLOAT;
+			dsvDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
+			dsvDesc.Texture2D.MipSlice = 0;
+			device->CreateDepthStencilView(texture, &dsvDesc, &graphDSVs[slot]);
+		}
+		else
+		{
+			D3D11_RENDER_TARGET_VIEW_DESC rtvDesc = {};
+			rtvDesc.Format = textureDesc.Format;
+			rtvDesc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
+			rtvDesc.Texture2D.MipSlice = 0;
+			device->CreateRenderTargetView(texture, &rtvDesc, &graphRTVs[slot]);
+		}
+
+		// The views keep the texture alive
+		texture->Release();
+	}
+
+	printf("Frame graph: %u passes, %u transient textures in %u allocations\n",
+		(unsigned int)frameGraph.GetPassOrder().size(),
+		frameGraph.GetTransientTextureCount(),
+		slotCount);
+
+	frameGraphBuilt = true;
+}
+
+void Game::ReleaseFrameGraphTextures()
+{
+	for (auto rtv : graphRTVs) if (rtv) rtv->Release();
+	for (auto srv : graphSRVs) if (srv) srv->Release();
+	for (auto dsv : graphDSVs) if (dsv) dsv->Release();
+	graphRTVs.clear();
+	graphSRVs.clear();
+	graphDSVs.clear();
+}
+
+// --------------------------------------------------------
+// D3D11 tracks hazards itself, but it silently refuses to bind a
+// texture as a target while it's still bound as a shader input.
+// So anything becoming writable first gets the SRV slots cleared.
+// --------------------------------------------------------
+void Game::OnFrameGraphBarrier(const FrameGraphBarrier& barrier)
+{
+	bool wasWritable =
+		barrier.Before == FrameGraphState::RenderTarget ||
+		barrier.Before == FrameGraphState::DepthWrite;
+	bool nowWritable =
+		barrier.After == FrameGraphState::RenderTarget ||
+		barrier.After == FrameGraphState::DepthWrite;
+
+	if (nowWritable && !wasWritable)
+	{
+		ID3D11ShaderResourceView* none[D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT] = {};
+		context->PSSetShaderResources(0, D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT, none);
+	}
+}
+
+// --------------------------------------------------------
+// Views for a frame graph resource.  Imported and unused
+// resources have no physical slot, so anything without a view
+// of that kind comes back null.
+// --------------------------------------------------------
+ID3D11RenderTargetView* Game::GetGraphRTV(int resource)
+{
+	if (resource == fgBackBuffer) return backBufferRTV;
+	int slot = frameGraph.GetPhysicalTexture(resource);
+	return slot < 0 ? nullptr : graphRTVs[slot];
+}
+
+ID3D11ShaderResourceView* Game::GetGraphSRV(int resource)
+{
+	int slot = frameGraph.GetPhysicalTexture(resource);
+	return slot < 0 ? nullptr : graphSRVs[slot];
+}
+
+ID3D11DepthStencilView* Game::GetGraphDSV(int resource)
+{
+	if (resource == fgBackBufferDepth) return depthStencilView;
+	int slot = frameGraph.GetPhysicalTexture(resource);
+	return slot < 0 ? nullptr : graphDSVs[slot];
+}
+
+// --------------------------------------------------------
+// Splits the entity list across the job system.  Each thread
+// records its chunk into its own command list; nothing touches
+// the context until the passes replay the lists in order.
+// --------------------------------------------------------
+void Game::RecordEntityDraws()
+{
+	// Recording one entity is cheap, so small lists stay on one thread
+	const unsigned int minEntitiesPerList = 64;
+
+	// Far away entities draw a simplified mesh, as long as it
+	// stays within a pixel of the real one
+	LodView lodView;
+	lodView.CameraPosition = camera->GetViewPosition();
+	lodView.PixelsPerUnit = camera->GetPixelsPerUnit(height);
+	lodView.MaxPixelError = 1.0f;
+
+	// Up close, parts of a mesh that are off screen or facing
+	// away are skipped a meshlet at a time
+	camera->GetFrustumPlanes(lodView.FrustumPlanes);
+	lodView.CullMeshlets = true;
+
+	entityCommands.Record(jobSystem, (unsigned int)entities.size(), minEntitiesPerList,
+		[this, lodView](unsigned int begin, unsigned int end, CommandList& list) {
+		for (unsigned int i = begin; i < end; i++) {
+			if (entities[i]->IsActive())
+				entities[i]->RecordDraw(list, interpolationAlpha, &lodView);
+		}
+	});
+}
+
+
 // --------------------------------------------------------
 // Handle resizing DirectX "stuff" to match the new window size.
 // For instance, updating our projection matrix's aspect ratio.
@@ -545,6 +785,10 @@ void Game::OnResize()
 
 	camera->OnResize(width, height);
 
+	// Post process targets are sized to the window
+	if (frameGraphBuilt)
+		BuildFrameGraph();
+
 	//// Update our projection matrix since the window size changed
 	//XMMATRIX P = XMMatrixPerspectiveFovLH(
 	//	0.25f * 3.1415926535f,	// Field of View Angle
@@ -559,10 +803,16 @@ void Game::OnResize()
 // --------------------------------------------------------
 void Game::Update(float deltaTime, float totalTime)
 {
+	// Remember where everything was before this step, for interpolation
+	camera->SaveState();
+	for (auto entity : entities)
+		entity->SaveState();
+
+	// The ground scrolls at the speed the nodes come down the rails
+	previousTrackDistance = trackDistance;
+	trackDistance += deltaTime * TrackSpeed;
+
 	system->update();
-	camera->Update(deltaTime);
-	simpleEmitter->Update(deltaTime);
-	ParticleManager::GetInstance().Update(deltaTime);
 	// Quit if the escape key is pressed
 	if (GetAsyncKeyState(VK_ESCAPE))
 		Quit();
@@ -588,9 +838,48 @@ void Game::Update(float deltaTime, float totalTime)
 	float cosTime = abs(cosf(totalTime));
 
 
-	player->Update(deltaTime);
-	nodeManager->Update(deltaTime);
+	// Chart-timed effects need to know where the song is
+	unsigned int songMs = 0;
+	songChannel->getPosition(&songMs, FMOD_TIMEUNIT_MS);
+	ParticleManager::GetInstance().SetSongTime(songMs / 1000.0, !songNotStarted);
 
+	// Camera, particles, player and music nodes - see BuildUpdateGraph()
+	updateDeltaTime = deltaTime;
+	updateGraph.Execute(*jobSystem);
+}
+
+// --------------------------------------------------------
+// Lays out the per-frame subsystem updates as a job graph.
+//  - Camera, particle aging and the player don't touch each
+//    other, so they run side by side
+//  - ParticleManager spawns into the emitters, so it waits for
+//    aging to finish (they share one particle budget, so the
+//    emitters are aged in a single job)
+//  - MusicNodeManager shakes the camera, checks the player's
+//    rail and fires hit bursts, so it goes last
+// --------------------------------------------------------
+void Game::BuildUpdateGraph()
+{
+	int cameraJob = updateGraph.AddJob("Camera", [this]() {
+		camera->Update(updateDeltaTime);
+	});
+	int emitterJob = updateGraph.AddJob("Emitters", [this]() {
+		ParticleManager::GetInstance().UpdateEmitters(updateDeltaTime);
+	});
+	int particlesJob = updateGraph.AddJob("ParticleManager", [this]() {
+		ParticleManager::GetInstance().Update(updateDeltaTime);
+	});
+	int playerJob = updateGraph.AddJob("Player", [this]() {
+		player->Update(updateDeltaTime);
+	});
+	int nodesJob = updateGraph.AddJob("MusicNodeManager", [this]() {
+		nodeManager->Update(updateDeltaTime);
+	});
+
+	updateGraph.AddDependency(emitterJob, particlesJob);
+	updateGraph.AddDependency(cameraJob, nodesJob);
+	updateGraph.AddDependency(particlesJob, nodesJob);
+	updateGraph.AddDependency(playerJob, nodesJob);
 }
 
 // --------------------------------------------------------
@@ -598,8 +887,7 @@ void Game::Update(float deltaTime, float totalTime)
 // --------------------------------------------------------
 void Game::Draw(float deltaTime, float totalTime)
 {
-	float freqs[64];
-	memset(freqs, 0, sizeof(float) * 64);
+	memset(frameFreqs, 0, sizeof(float) * 64);
 
 	bool songNotStarted;
 	songChannel->getPaused(&songNotStarted);
@@ -608,95 +896,122 @@ void Game::Draw(float deltaTime, float totalTime)
 		dsp->getParameterData(FMOD_DSP_FFT_SPECTRUMDATA, (void**)&fft, 0, 0, 0);
 		for (int i = 0; i < 64; i++) {
 			if (fft->spectrum[0] == nullptr) break;
-			freqs[i] = fft->spectrum[0][i];
+			frameFreqs[i] = fft->spectrum[0][i];
 		}
 	}
+	frameDeltaTime = deltaTime;
+	frameTotalTime = totalTime;
+
+	// Particle LOD follows how long frames are actually taking
+	ParticleManager::GetInstance().ObserveFrameTime(deltaTime);
+
+	// Draw between the last two simulation steps
+	camera->Interpolate(interpolationAlpha);
+	double distance = previousTrackDistance + (trackDistance - previousTrackDistance) * interpolationAlpha;
+	terrain->Update(context, distance, camera->GetViewPosition().z);
+	RecordEntityDraws();
+
+	// New particles go up once, however many passes draw them
+	ParticleManager::GetInstance().UploadEmitters(context);
+	ParticleManager::GetInstance().SortEmitters(context, camera, jobSystem);
 
-	RenderDepthBuffer(freqs, deltaTime, totalTime);
+	// Depth prepass, scene, depth of field and bloom - see BuildFrameGraph()
+	frameGraph.Execute([this](const FrameGraphBarrier& barrier) {
+		OnFrameGraphBarrier(barrier);
+	});
+
+	// Present the back buffer to the user
+	//  - Puts the final frame we're drawing into the window so the user can see it
+	//  - Do this exactly ONCE PER FRAME (always at the very end of the frame)
+	swapChain->Present(0, 0);
+}
 
+// --------------------------------------------------------
+// Main scene pass - opaque geometry, terrain, sky and particles
+// --------------------------------------------------------
+void Game::DrawScene(float* freqs, float deltaTime, float totalTime)
+{
 	// Background color (Cornflower Blue in this case) for clearing
 	const float color[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
 
+	ID3D11RenderTargetView* sceneRTV = GetGraphRTV(fgSceneColor);
+	ID3D11DepthStencilView* sceneDSV = GetGraphDSV(fgBackBufferDepth);
+
 	// Clear the render target and depth buffer (erases what's on the screen)
 	//  - Do this ONCE PER FRAME
 	//  - At the beginning of Draw (before drawing *anything*)
-	context->ClearRenderTargetView(backBufferRTV, color);
 	context->ClearDepthStencilView(
-		depthStencilView,
+		sceneDSV,
 		D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL,
 		1.0f,
 		0);
 
-	context->OMSetRenderTargets(1, &dofRTV, depthStencilView);
-	context->ClearRenderTargetView(dofRTV, color);
+	context->OMSetRenderTargets(1, &sceneRTV, sceneDSV);
+	context->ClearRenderTargetView(sceneRTV, color);
 	
-	const UINT stride = sizeof(Vertex);
-	const UINT offset = 0;
-
-	for (auto entity : entities) {
-		if (!entity->IsActive()) continue;
-		Mesh* mesh = entity->GetMesh();
-		UINT stride = sizeof(Vertex);
-		UINT offset = 0;
-		ID3D11Buffer* vb = mesh->GetVertexBuffer();
-		context->IASetVertexBuffers(0, 1, &vb, &stride, &offset);
-		context->IASetIndexBuffer(mesh->GetIndexBuffer(), DXGI_FORMAT_R32_UINT, 0);
-		entity->PrepareMaterial(camera->GetViewMatrix(), camera->GetProjectionMatrix(), dirLight, dirLight2, camera->GetPosition());
-		context->DrawIndexed(mesh->GetIndexCount(), 0, 0);
-	}
+	D3D11SceneBackend sceneBackend(context);
+	sceneBackend.View = camera->GetViewMatrix();
+	sceneBackend.Projection = camera->GetProjectionMatrix();
+	sceneBackend.Light = dirLight;
+	sceneBackend.Light2 = dirLight2;
+	sceneBackend.CameraPosition = camera->GetPosition();
+	sceneBackend.ParticleColor = ParticleManager::GetInstance().GetCyclingColor();
+	sceneBackend.Skybox = skybox->GetResourceView();
+	entityCommands.Replay(sceneBackend);
+
+	// The chunks themselves move now, so the texture stays put
 	terrainPS->SetFloat("time", totalTime);
-	terrainR->SetRotation({ 0.0f, 3.14f, 0.0f });
-	terrainR->SetPosition({ +17.4f, -2.0f, 0.0f });
-	terrainR->SetScale({ 5.0f, 5.0f, 25.0f });
-	terrainL->SetPosition({ -17.4f, -2.0f, 0.0f });
-	terrainL->SetRotation({ 0.0f, 0.0f, 0.0f });
-	terrainL->SetScale({ 5.0f, 5.0f, 25.0f });
-	Mesh* mesh = terrainL->GetMesh();
-	ID3D11Buffer* vb = mesh->GetVertexBuffer();
-	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
-	context->IASetVertexBuffers(0, 1, &vb, &stride, &offset);
-	context->IASetIndexBuffer(mesh->GetIndexBuffer(), DXGI_FORMAT_R32_UINT, 0);
-	terrainL->PrepareTerrainMaterial(camera->GetViewMatrix(), camera->GetProjectionMatrix(), freqs, 64, dirLight, dirLight2);
-	terrainPS->SetFloat("speed", -0.15f);
-	context->DrawIndexed(mesh->GetIndexCount(), 0, 0);
-	terrainR->PrepareTerrainMaterial(camera->GetViewMatrix(), camera->GetProjectionMatrix(), freqs, 64, dirLight, dirLight2);
-	terrainPS->SetFloat("speed", 0.15f);
-	context->DrawIndexed(mesh->GetIndexCount(), 0, 0);
-	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-
+	terrainPS->SetFloat("speed", 0.0f);
+	terrain->Draw(context, terrainMaterial, camera->GetViewMatrix(), camera->GetProjectionMatrix(),
+		freqs, 64, dirLight, dirLight2);
 
 	skybox->DrawSkybox(context, camera, sampler);
 
 	// Draw particles
-	simpleEmitter->Draw(context, camera, deltaTime, totalTime);
+	ParticleManager::GetInstance().DrawEmitters(context, camera, deltaTime, totalTime);
+}
 
-	// Turn off vertex and index buffers
-	context->OMSetRenderTargets(1, &dofBlurRTV, 0);
+// --------------------------------------------------------
+// Blurs the scene color for the depth of field composite
+// --------------------------------------------------------
+void Game::DrawDepthOfFieldBlur()
+{
+	const UINT stride = sizeof(Vertex);
+	const UINT offset = 0;
+
+	ID3D11RenderTargetView* blurRTV = GetGraphRTV(fgDofBlur);
+	context->OMSetRenderTargets(1, &blurRTV, 0);
 	dofVS->SetShader();
 	
 	dofBlurPS->SetShader();
-	dofBlurPS->SetShaderResourceView("Pixels", dofSRV);
+	dofBlurPS->SetShaderResourceView("Pixels", GetGraphSRV(fgSceneColor));
 	dofBlurPS->SetSamplerState("Sampler", sampler);
 	dofBlurPS->SetFloat("pixelWidth", 1.0f / width);
 	dofBlurPS->SetFloat("pixelHeight", 1.0f / height);
 	dofBlurPS->SetInt("blurAmount", 3);
 	dofBlurPS->CopyAllBufferData();
 
+	// Turn off vertex and index buffers
 	ID3D11Buffer* nothing = 0;
 	context->IASetVertexBuffers(0, 1, &nothing, &stride, &offset);
 	context->IASetIndexBuffer(0, DXGI_FORMAT_R32_UINT, 0);
 
 	// Draw the post process (3 verts = 1 triangle to fill the screen)
 	context->Draw(3, 0);
-	
-	dofBlurPS->SetShaderResourceView("Pixels", 0);
+}
 
-	context->OMSetRenderTargets(1, &ppRenderTargetView, 0);
+// --------------------------------------------------------
+// Mixes sharp and blurred scene color based on depth
+// --------------------------------------------------------
+void Game::DrawDepthOfFieldComposite()
+{
+	ID3D11RenderTargetView* outputRTV = GetGraphRTV(fgDofOutput);
+	context->OMSetRenderTargets(1, &outputRTV, 0);
 	
 	dofPS->SetShader();
-	dofPS->SetShaderResourceView("Unblurred", dofSRV);
-	dofPS->SetShaderResourceView("Blurred", dofBlurSRV);
-	dofPS->SetShaderResourceView("DepthBuffer", depthSRV);
+	dofPS->SetShaderResourceView("Unblurred", GetGraphSRV(fgSceneColor));
+	dofPS->SetShaderResourceView("Blurred", GetGraphSRV(fgDofBlur));
+	dofPS->SetShaderResourceView("DepthBuffer", GetGraphSRV(fgDepth));
 	dofPS->SetSamplerState("Sampler", sampler);
 	dofPS->SetFloat("Distance", 1.75f);
 	dofPS->SetFloat("Range", 2.0f);
@@ -705,16 +1020,26 @@ void Game::Draw(float deltaTime, float totalTime)
 	dofPS->CopyAllBufferData();
 
 	context->Draw(3, 0);
+}
+
+// --------------------------------------------------------
+// Bloom post process, drawn straight to the back buffer
+// --------------------------------------------------------
+void Game::DrawBloom()
+{
+	const float color[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
 
 	// draw output of bloom post process to screen ====================
-	context->OMSetRenderTargets(1, &backBufferRTV, depthStencilView);
+	ID3D11RenderTargetView* outputRTV = GetGraphRTV(fgBackBuffer);
+	context->ClearRenderTargetView(outputRTV, color);
+	context->OMSetRenderTargets(1, &outputRTV, depthStencilView);
 
 	// Turn on VS (no args)
 	ppVS->SetShader();
 
 	// Turn on PS
 	ppPS->SetShader();
-	ppPS->SetShaderResourceView("Pixels", ppsrv);
+	ppPS->SetShaderResourceView("Pixels", GetGraphSRV(fgDofOutput));
 	ppPS->SetSamplerState("Sampler", sampler);
 	ppPS->SetFloat("pixelWidth", 1.0f / width);
 	ppPS->SetFloat("pixelHeight", 1.0f / height);
@@ -722,17 +1047,10 @@ void Game::Draw(float deltaTime, float totalTime)
 	ppPS->CopyAllBufferData();
 
 	context->Draw(3, 0);
-
-	// Unbind the post process SRV
-	ppPS->SetShaderResourceView("Pixels", 0);
-
-	// Present the back buffer to the user
-	//  - Puts the final frame we're drawing into the window so the user can see it
-	//  - Do this exactly ONCE PER FRAME (always at the very end of the frame)
-	swapChain->Present(0, 0);
 }
 
 void Game::RenderDepthBuffer(float* freqs, float deltaTime, float totalTime) {
+	ID3D11DepthStencilView* depthDSV = GetGraphDSV(fgDepth);
 	context->OMSetRenderTargets(0, 0, depthDSV);
 	context->ClearDepthStencilView(depthDSV, D3D11_CLEAR_DEPTH, 1.0f, 0);
 	context->RSSetState(depthRS);
@@ -740,34 +1058,18 @@ void Game::RenderDepthBuffer(float* freqs, float deltaTime, float totalTime) {
 	depthVS->SetShader();
 	depthVS->SetMatrix4x4("view", camera->GetViewMatrix());
 	depthVS->SetMatrix4x4("projection", camera->GetProjectionMatrix());
+	quantizedDepthVS->SetMatrix4x4("view", camera->GetViewMatrix());
+	quantizedDepthVS->SetMatrix4x4("projection", camera->GetProjectionMatrix());
 
 	context->PSSetShader(0, 0, 0);
 
-	UINT stride = sizeof(Vertex);
-	UINT offset = 0;
+	D3D11DepthBackend depthBackend(context, depthVS, quantizedDepthVS);
+	entityCommands.Replay(depthBackend);
 
-	for (auto entity : entities) {
-		if (!entity->IsActive()) continue;
-		Mesh* mesh = entity->GetMesh();
-		ID3D11Buffer* vb = mesh->GetVertexBuffer();
-		context->IASetVertexBuffers(0, 1, &vb, &stride, &offset);
-		context->IASetIndexBuffer(mesh->GetIndexBuffer(), DXGI_FORMAT_R32_UINT, 0);
-		entity->PrepareMaterial(camera->GetViewMatrix(), camera->GetProjectionMatrix(), dirLight, dirLight2,camera->GetPosition());
-		context->DrawIndexed(mesh->GetIndexCount(), 0, 0);
-	}
-
-	Mesh* mesh = terrainL->GetMesh();
-	ID3D11Buffer* vb = mesh->GetVertexBuffer();
-	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
-	context->IASetVertexBuffers(0, 1, &vb, &stride, &offset);
-	context->IASetIndexBuffer(mesh->GetIndexBuffer(), DXGI_FORMAT_R32_UINT, 0);
-	terrainL->PrepareTerrainMaterial(camera->GetViewMatrix(), camera->GetProjectionMatrix(), freqs, 64, dirLight, dirLight2);
-	context->DrawIndexed(mesh->GetIndexCount(), 0, 0);
-	terrainR->PrepareTerrainMaterial(camera->GetViewMatrix(), camera->GetProjectionMatrix(), freqs, 64, dirLight, dirLight2);
-	context->DrawIndexed(mesh->GetIndexCount(), 0, 0);
-	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	terrain->Draw(context, terrainMaterial, camera->GetViewMatrix(), camera->GetProjectionMatrix(),
+		freqs, 64, dirLight, dirLight2);
 
-	simpleEmitter->Draw(context, camera, deltaTime, totalTime);
+	ParticleManager::GetInstance().DrawEmitters(context, camera, deltaTime, totalTime);
 
 	context->OMSetRenderTargets(1, &backBufferRTV, depthStencilView);
 	context->RSSetState(0);
@@ -18,6 +18,13 @@
 #include "MusicNodeManager.h"
 #include "CubeMap.h"
 #include "ParticleEmitter.h"
+#include "FrameGraph.h"
+#include "CommandRecorder.h"
+#include "JobGraph.h"
+#include "AssetLoader.h"
+#include "AssetRegistry.h"
+#include "D3D11CommandBackend.h"
+#include "Terrain.h"
 
 class Game
 	: public DXCore
@@ -34,6 +41,10 @@ public:
 	void Update(float deltaTime, float totalTime);
 	void Draw(float deltaTime, float totalTime);
 	void RenderDepthBuffer(float* freqs, float deltaTime, float totalTime);
+	void DrawScene(float* freqs, float deltaTime, float totalTime);
+	void DrawDepthOfFieldBlur();
+	void DrawDepthOfFieldComposite();
+	void DrawBloom();
 
 	// Overridden mouse input helper methods
 	void OnMouseDown(WPARAM buttonState, int x, int y);
@@ -47,25 +58,37 @@ private:
 	void LoadShaders();
 	void CreateMatrices();
 	void CreateBasicGeometry();
-
-	// Meshes!
+	void FinishLoading();
+	void DrawLoadingScreen(float progress);
+
+	// Frame graph setup - rebuilt whenever the window size changes
+	void BuildFrameGraph();
+	void ReleaseFrameGraphTextures();
+	void OnFrameGraphBarrier(const FrameGraphBarrier& barrier);
+	ID3D11RenderTargetView* GetGraphRTV(int resource);
+	ID3D11ShaderResourceView* GetGraphSRV(int resource);
+	ID3D11DepthStencilView* GetGraphDSV(int resource);
+
+	// Meshes built in code - the registry owns the ones from files
 	std::vector<Mesh*> meshes;
 	std::vector<Entity*> entities;
 	std::vector<Material*> materials;
-	Entity* terrainL;
-	Entity* terrainR;
+
+	// Ground either side of the track, and how far it has scrolled
+	Terrain* terrain;
+	Material* terrainMaterial;
+	double trackDistance;
+	double previousTrackDistance;
 
 	// Wrappers for DirectX shaders to provide simplified functionality
 	SimpleVertexShader* vertexShader;
 	SimplePixelShader* pixelShader;
 	ID3D11SamplerState* sampler;
 
-	ID3D11RenderTargetView* dofRTV;
-	ID3D11ShaderResourceView* dofSRV;
-	ID3D11RenderTargetView* dofBlurRTV;
-	ID3D11ShaderResourceView* dofBlurSRV;
-	ID3D11DepthStencilView* depthDSV;
-	ID3D11ShaderResourceView* depthSRV;
+	// For meshes with MeshVertexFormat::Quantized
+	SimpleVertexShader* quantizedVS;
+	SimpleVertexShader* quantizedDepthVS;
+
 	ID3D11RasterizerState* depthRS;
 	SimpleVertexShader* depthVS;
 	SimpleVertexShader* dofVS;
@@ -109,17 +132,55 @@ private:
 	SMParser parser = SMParser();
 	// ----
 
+	// Frame graph and the textures backing its physical slots
+	FrameGraph frameGraph;
+	bool frameGraphBuilt = false;
+	std::vector<ID3D11RenderTargetView*> graphRTVs;
+	std::vector<ID3D11ShaderResourceView*> graphSRVs;
+	std::vector<ID3D11DepthStencilView*> graphDSVs;
+
+	// Frame graph resource handles
+	int fgBackBuffer;
+	int fgBackBufferDepth;
+	int fgDepth;
+	int fgSceneColor;
+	int fgDofBlur;
+	int fgDofOutput;
+
+	// Per-frame data the passes need
+	float frameFreqs[64];
+	float frameDeltaTime;
+	float frameTotalTime;
+
+	// Worker threads for the per-frame update and draw recording
+	JobSystem* jobSystem;
+
+	// Startup assets - loaded on the job system, finished here
+	AssetLoader* assets;
+
+	// Owns every texture and mesh loaded from a file
+	AssetRegistry* registry;
+	std::vector<AssetHandle> sceneAssets;
+
+	// Subsystem updates and what has to finish before each one starts
+	JobGraph updateGraph;
+	float updateDeltaTime;
+	void BuildUpdateGraph();
+
+	// Entity draws, recorded across the job system once per frame
+	// and replayed by both the depth prepass and the scene pass
+	CommandRecorder entityCommands;
+	void RecordEntityDraws();
+
 	// Effects
-	ID3D11RenderTargetView* ppRenderTargetView;
-	ID3D11ShaderResourceView* ppsrv;
 	SimpleVertexShader* ppVS;
 	SimplePixelShader* ppPS;
 
 	// Particle stuff
 	ID3D11ShaderResourceView* particleTexture;
-	ID3D11BlendState* particleBlendState;
+	ID3D11BlendState* particleBlendState;		// Additive
+	ID3D11BlendState* particleAlphaBlendState;	// For sorted emitters
 	ID3D11DepthStencilState* particleDepthState;
-	Emitter* simpleEmitter;
 	SimpleVertexShader* particleVS;
 	SimplePixelShader* particlePS;
 	SimpleGeometryShader* particleGS;
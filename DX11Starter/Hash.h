@@ -0,0 +1,24 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// --------------------------------------------------------
+// 64-bit FNV-1a hash over a block of bytes.  Used to key
+// on-disk caches by the content of the file they came from,
+// so a rebuilt asset never matches a stale cache entry.
+//
+// data - Pointer to the bytes to hash
+// size - Number of bytes
+// seed - Previous hash value when hashing in pieces
+// --------------------------------------------------------
+inline uint64_t HashBytes(const void* data, size_t size, uint64_t seed = 14695981039346656037ULL)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	uint64_t hash = seed;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
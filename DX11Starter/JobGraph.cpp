@@ -0,0 +1,102 @@
+#include "JobGraph.h"
+#include <cstdio>
+
+JobGraph::JobGraph()
+{
+	validated = false;
+}
+
+JobGraph::~JobGraph()
+{
+}
+
+int JobGraph::AddJob(std::string name, JobSystem::JobFunction job)
+{
+	Node node;
+	node.Name = name;
+	node.Job = job;
+	node.DependencyCount = 0;
+	nodes.push_back(node);
+	validated = false;
+	return (int)nodes.size() - 1;
+}
+
+void JobGraph::AddDependency(int before, int after)
+{
+	nodes[before].Dependents.push_back(after);
+	nodes[after].DependencyCount++;
+	validated = false;
+}
+
+// --------------------------------------------------------
+// Kahn's algorithm - if some nodes never become ready, they
+// depend on each other in a loop
+// --------------------------------------------------------
+bool JobGraph::HasCycle()
+{
+	std::vector<int> incoming(nodes.size());
+	std::vector<int> ready;
+	for (size_t i = 0; i < nodes.size(); i++)
+	{
+		incoming[i] = nodes[i].DependencyCount;
+		if (incoming[i] == 0) ready.push_back((int)i);
+	}
+
+	size_t visited = 0;
+	while (!ready.empty())
+	{
+		int node = ready.back();
+		ready.pop_back();
+		visited++;
+		for (int dependent : nodes[node].Dependents)
+		{
+			if (--incoming[dependent] == 0)
+				ready.push_back(dependent);
+		}
+	}
+	return visited != nodes.size();
+}
+
+bool JobGraph::Execute(JobSystem& jobs)
+{
+	if (!validated)
+	{
+		if (HasCycle())
+		{
+			printf("Job graph has a dependency cycle!\n");
+			return false;
+		}
+		remaining.reset(new std::atomic<int>[nodes.size()]);
+		validated = true;
+	}
+
+	for (size_t i = 0; i < nodes.size(); i++)
+		remaining[i] = nodes[i].DependencyCount;
+
+	JobCounter counter;
+	for (size_t i = 0; i < nodes.size(); i++)
+	{
+		if (nodes[i].DependencyCount == 0)
+			Submit(jobs, (int)i, &counter);
+	}
+
+	jobs.Wait(&counter);
+	return true;
+}
+
+// --------------------------------------------------------
+// Queues a node.  When it finishes it releases its dependents;
+// they're queued (raising the counter) before this job's own
+// count is dropped, so the counter can't hit zero early.
+// --------------------------------------------------------
+void JobGraph::Submit(JobSystem& jobs, int node, JobCounter* counter)
+{
+	jobs.Run([this, &jobs, node, counter]() {
+		nodes[node].Job();
+		for (int dependent : nodes[node].Dependents)
+		{
+			if (--remaining[dependent] == 0)
+				Submit(jobs, dependent, counter);
+		}
+	}, counter);
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include "JobSystem.h"
+#include <string>
+
+// --------------------------------------------------------
+// A set of jobs with "runs after" edges between them.  Built
+// once, then executed as often as needed - each job is queued
+// the moment the last job it depends on finishes, so anything
+// independent runs side by side.
+// --------------------------------------------------------
+class JobGraph
+{
+public:
+	JobGraph();
+	~JobGraph();
+
+	// Returns a handle for AddDependency
+	int AddJob(std::string name, JobSystem::JobFunction job);
+
+	// "after" won't start until "before" has finished
+	void AddDependency(int before, int after);
+
+	// Runs every job and returns once they're all done.  Returns
+	// false without running anything if the edges form a cycle.
+	bool Execute(JobSystem& jobs);
+
+	const std::string& GetJobName(int job) { return nodes[job].Name; }
+
+private:
+	struct Node
+	{
+		std::string Name;
+		JobSystem::JobFunction Job;
+		std::vector<int> Dependents;
+		int DependencyCount;
+	};
+
+	std::vector<Node> nodes;
+	std::unique_ptr<std::atomic<int>[]> remaining;
+	bool validated;
+
+	bool HasCycle();
+	void Submit(JobSystem& jobs, int node, JobCounter* counter);
+};
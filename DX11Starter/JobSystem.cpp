@@ -0,0 +1,185 @@
+#include "JobSystem.h"
+
+// Which JobSystem (if any) owns the current thread, and its queue
+static thread_local JobSystem* currentSystem = nullptr;
+static thread_local unsigned int currentQueue = 0;
+
+JobSystem::JobSystem(unsigned int threadCount)
+{
+	queuedJobs = 0;
+	stealCount = 0;
+	quitting = false;
+
+	if (threadCount == 0)
+		threadCount = std::thread::hardware_concurrency();
+	if (threadCount == 0)
+		threadCount = 1;
+
+	for (unsigned int i = 0; i < threadCount; i++)
+		queues.push_back(std::unique_ptr<WorkerQueue>(new WorkerQueue()));
+
+	// The creating thread is worker 0
+	currentSystem = this;
+	currentQueue = 0;
+
+	for (unsigned int i = 1; i < threadCount; i++)
+		threads.push_back(std::thread(&JobSystem::WorkerLoop, this, i));
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		quitting = true;
+	}
+	wake.notify_all();
+
+	for (std::thread& thread : threads)
+		thread.join();
+
+	if (currentSystem == this)
+		currentSystem = nullptr;
+}
+
+// --------------------------------------------------------
+// Queue for the calling thread.  Threads that don't belong to
+// this system get queues.size() - they can queue and steal,
+// but have no deque of their own.
+// --------------------------------------------------------
+unsigned int JobSystem::GetQueueIndex()
+{
+	if (currentSystem == this) return currentQueue;
+	return (unsigned int)queues.size();
+}
+
+void JobSystem::Run(JobFunction job, JobCounter* counter)
+{
+	if (counter) counter->Value++;
+
+	unsigned int index = GetQueueIndex();
+	if (index >= queues.size()) index = 0;
+
+	{
+		std::lock_guard<std::mutex> lock(queues[index]->Mutex);
+		Job entry = { job, counter };
+		queues[index]->Jobs.push_back(entry);
+	}
+	queuedJobs++;
+
+	// Taking the lock means a worker can't miss this between
+	// checking for work and going to sleep
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+	}
+	wake.notify_one();
+}
+
+bool JobSystem::PopJob(unsigned int index, Job& job)
+{
+	if (index >= queues.size()) return false;
+
+	WorkerQueue& queue = *queues[index];
+	std::lock_guard<std::mutex> lock(queue.Mutex);
+	if (queue.Jobs.empty()) return false;
+
+	job = queue.Jobs.back();
+	queue.Jobs.pop_back();
+	return true;
+}
+
+// --------------------------------------------------------
+// Takes the oldest job from the first other deque that has
+// one, starting just past the thief so they spread out
+// --------------------------------------------------------
+bool JobSystem::StealJob(unsigned int thief, Job& job)
+{
+	unsigned int count = (unsigned int)queues.size();
+	for (unsigned int i = 1; i <= count; i++)
+	{
+		unsigned int victim = (thief + i) % count;
+		if (victim == thief) continue;
+
+		WorkerQueue& queue = *queues[victim];
+		std::lock_guard<std::mutex> lock(queue.Mutex);
+		if (queue.Jobs.empty()) continue;
+
+		job = queue.Jobs.front();
+		queue.Jobs.pop_front();
+		stealCount++;
+		return true;
+	}
+	return false;
+}
+
+bool JobSystem::RunOneJob(unsigned int index)
+{
+	Job job;
+	if (!PopJob(index, job) && !StealJob(index, job))
+		return false;
+
+	queuedJobs--;
+	job.Function();
+	if (job.Counter) job.Counter->Value--;
+	return true;
+}
+
+void JobSystem::Wait(JobCounter* counter)
+{
+	unsigned int index = GetQueueIndex();
+	while (!counter->IsDone())
+	{
+		// Help out instead of blocking.  If there's nothing to
+		// take, the remaining jobs are already running elsewhere.
+		if (!RunOneJob(index))
+			std::this_thread::yield();
+	}
+}
+
+bool JobSystem::TryRunJob()
+{
+	return RunOneJob(GetQueueIndex());
+}
+
+void JobSystem::ParallelFor(unsigned int count, unsigned int grainSize, RangeFunction body)
+{
+	if (count == 0) return;
+	if (grainSize == 0) grainSize = 1;
+
+	// Roughly a few chunks per thread so stealing can even out the load
+	unsigned int chunks = (count + grainSize - 1) / grainSize;
+	unsigned int maxChunks = GetThreadCount() * 4;
+	if (chunks > maxChunks) chunks = maxChunks;
+
+	if (chunks <= 1)
+	{
+		body(0, count);
+		return;
+	}
+
+	JobCounter counter;
+	for (unsigned int c = 1; c < chunks; c++)
+	{
+		unsigned int begin = (unsigned int)((unsigned long long)count * c / chunks);
+		unsigned int end = (unsigned int)((unsigned long long)count * (c + 1) / chunks);
+		Run([&body, begin, end]() { body(begin, end); }, &counter);
+	}
+
+	// First chunk runs right here
+	body(0, (unsigned int)((unsigned long long)count / chunks));
+	Wait(&counter);
+}
+
+void JobSystem::WorkerLoop(unsigned int index)
+{
+	currentSystem = this;
+	currentQueue = index;
+
+	for (;;)
+	{
+		if (RunOneJob(index)) continue;
+
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		wake.wait(lock, [this]() { return quitting || queuedJobs.load() > 0; });
+		if (quitting) return;
+	}
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// --------------------------------------------------------
+// Counts outstanding jobs.  Pass one to JobSystem::Run and
+// then JobSystem::Wait on it - it hits zero once every job
+// that was given it has finished.
+// --------------------------------------------------------
+struct JobCounter
+{
+	std::atomic<int> Value;
+
+	JobCounter() : Value(0) {}
+	bool IsDone() const { return Value.load() == 0; }
+};
+
+// --------------------------------------------------------
+// Work-stealing job scheduler.
+//
+// Every thread has its own deque of jobs.  A thread pushes and
+// pops its own jobs at the back (most recent first, while the
+// data is still warm), and when it runs dry it steals from the
+// front of someone else's deque.  The thread that creates the
+// JobSystem counts as worker 0 and runs jobs whenever it Waits.
+// --------------------------------------------------------
+class JobSystem
+{
+public:
+	typedef std::function<void()> JobFunction;
+	typedef std::function<void(unsigned int begin, unsigned int end)> RangeFunction;
+
+	// 0 threads means "one per core" (including the calling thread)
+	JobSystem(unsigned int threadCount = 0);
+	~JobSystem();
+
+	// Queues a job.  The counter (if any) goes up now and back
+	// down when the job finishes.
+	void Run(JobFunction job, JobCounter* counter = nullptr);
+
+	// Runs queued jobs until the counter reaches zero
+	void Wait(JobCounter* counter);
+
+	// Runs one queued job on the calling thread, if there is one
+	bool TryRunJob();
+
+	// Splits [0, count) into chunks of at least grainSize items and
+	// runs them across every thread.  Returns once all are done.
+	void ParallelFor(unsigned int count, unsigned int grainSize, RangeFunction body);
+
+	// Worker threads plus the owning thread
+	unsigned int GetThreadCount() { return (unsigned int)queues.size(); }
+
+	// How many jobs were taken from another thread's deque
+	unsigned long long GetStealCount() { return stealCount.load(); }
+
+private:
+	struct Job
+	{
+		JobFunction Function;
+		JobCounter* Counter;
+	};
+
+	struct WorkerQueue
+	{
+		std::mutex Mutex;
+		std::deque<Job> Jobs;
+	};
+
+	std::vector<std::unique_ptr<WorkerQueue>> queues;
+	std::vector<std::thread> threads;
+
+	// Idle workers sleep until something is queued
+	std::atomic<int> queuedJobs;
+	std::atomic<unsigned long long> stealCount;
+	std::mutex sleepMutex;
+	std::condition_variable wake;
+	bool quitting;
+
+	unsigned int GetQueueIndex();
+	bool PopJob(unsigned int index, Job& job);
+	bool StealJob(unsigned int thief, Job& job);
+	bool RunOneJob(unsigned int index);
+	void WorkerLoop(unsigned int index);
+};
@@ -0,0 +1,37 @@
+#pragma once
+#include <cstddef>
+
+// --------------------------------------------------------
+// Read-only view of a whole file through the OS's memory
+// mapping, so big assets can be parsed in place without
+// copying them through a stream first.
+// --------------------------------------------------------
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	// Returns false if the file can't be opened or mapped.
+	// Empty files open fine, with a null data pointer.
+	bool Open(const char* path);
+	void Close();
+
+	const char* GetData() const { return data; }
+	size_t GetSize() const { return size; }
+
+private:
+	const char* data;
+	size_t size;
+
+#ifdef _WIN32
+	void* file;
+	void* mapping;
+#else
+	int file;
+#endif
+
+	// Not copyable - owns OS handles
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+};
@@ -8,6 +8,10 @@ Material::Material(SimpleVertexShader* vs, SimplePixelShader* ps, ID3D11ShaderRe
 	_pixelShader = ps;
 	_texture = srv;
 	_sampler = samp;
+
+	// Materials share textures, so each keeps its own reference
+	if (_texture != nullptr)
+		_texture->AddRef();
 }
 
 
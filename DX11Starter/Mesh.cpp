@@ -1,18 +1,28 @@
 #include "Mesh.h"
 #include <DirectXMath.h>
-#include <fstream>
-#include <vector>
+#include <cstdio>
+#include "ObjLoader.h"
+#include "MappedFile.h"
+#include "MeshCache.h"
+#include "MeshWeld.h"
+#include "MeshOptimize.h"
+#include "MeshSimplify.h"
+
+// The loader fills MeshVertex, which is uploaded as Vertex
+static_assert(sizeof(MeshVertex) == sizeof(Vertex), "MeshVertex must match Vertex");
 
 using namespace DirectX;
 
 Mesh::Mesh(Vertex* vertices, unsigned int vertexCount, 
 	unsigned int indices[], unsigned int indexCount,
 	ID3D11Device* device)
+	: Mesh(MeshVertexFormat::Float)
 {
 	Initialize(vertices, vertexCount, indices, indexCount, device);
 }
 
-Mesh::Mesh(unsigned int width, unsigned int depth, ID3D11Device* device) {
+Mesh::Mesh(unsigned int width, unsigned int depth, ID3D11Device* device)
+	: Mesh(MeshVertexFormat::Float) {
 	int totalverts = width * depth;
 	Vertex* vertices = new Vertex[totalverts];
 	memset(vertices, 0, sizeof(Vertex) * totalverts);
@@ -27,7 +37,7 @@ Mesh::Mesh(unsigned int width, unsigned int depth, ID3D11Device* device) {
 		for (int x = 0; x < width; x++) {
 			float halfWidth = ((float)width - 1.0f) / 2.0f;
 			float halfDepth = ((float)depth - 1.0f) / 2.0f;
-			vertices[z * depth + x] = {
+			vertices[z * width + x] = {
 				{(float)x - halfWidth, 0.0f, (float)z - halfDepth},
 				{0.0f, 1.0f, 0.0f},
 				{(float)x / (width - 1), (float)z / (depth - 1)}
@@ -60,215 +70,248 @@ Mesh::Mesh(unsigned int width, unsigned int depth, ID3D11Device* device) {
 	}
 
 	Initialize(vertices, totalverts, indices, totalIndices, device);
+
+	delete[] vertices;
+	delete[] indices;
+}
+
+Mesh::Mesh(char* filename, ID3D11Device* device, JobSystem* jobs, MeshVertexFormat format)
+	: Mesh(format)
+{
+	Load(filename, jobs);
+	CreateBuffers(device);
 }
 
-Mesh::Mesh(char* filename, ID3D11Device* device)
+Mesh::Mesh(MeshVertexFormat format)
 {
-	// File input object
-	std::ifstream obj(filename);
-
-	// Check for successful open
-	if (!obj.is_open())
-		return;
-
-	// Variables used while reading the file
-	std::vector<XMFLOAT3> positions;     // Positions from the file
-	std::vector<XMFLOAT3> normals;       // Normals from the file
-	std::vector<XMFLOAT2> uvs;           // UVs from the file
-	std::vector<Vertex> verts;           // Verts we're assembling
-	std::vector<UINT> indices;           // Indices of these verts
-	unsigned int vertCounter = 0;        // Count of vertices/indices
-	char chars[100];                     // String for line reading
-
-										 // Still have data left?
-	while (obj.good())
+	_vertexBuffer = 0;
+	_indexBuffer = 0;
+	_indexCount = 0;
+	_vertexFormat = format;
+}
+
+// --------------------------------------------------------
+// Reads, processes and encodes a mesh file, leaving the buffer
+// contents for CreateBuffers.  Touches no D3D objects.
+// --------------------------------------------------------
+bool Mesh::Load(const char* filename, JobSystem* jobs)
+{
+	MappedFile source;
+	if (!source.Open(filename))
 	{
-		// Get the line (100 characters should be more than enough)
-		obj.getline(chars, 100);
+		printf("Failed to load mesh %s\n", filename);
+		return false;
+	}
 
-		// Check the type of line
-		if (chars[0] == 'v' && chars[1] == 'n')
-		{
-			// Read the 3 numbers directly into an XMFLOAT3
-			XMFLOAT3 norm;
-			sscanf_s(
-				chars,
-				"vn %f %f %f",
-				&norm.x, &norm.y, &norm.z);
-
-			// Add to the list of normals
-			normals.push_back(norm);
-		}
-		else if (chars[0] == 'v' && chars[1] == 't')
-		{
-			// Read the 2 numbers directly into an XMFLOAT2
-			XMFLOAT2 uv;
-			sscanf_s(
-				chars,
-				"vt %f %f",
-				&uv.x, &uv.y);
-
-			// Add to the list of uv's
-			uvs.push_back(uv);
-		}
-		else if (chars[0] == 'v')
-		{
-			// Read the 3 numbers directly into an XMFLOAT3
-			XMFLOAT3 pos;
-			sscanf_s(
-				chars,
-				"v %f %f %f",
-				&pos.x, &pos.y, &pos.z);
-
-			// Add to the positions
-			positions.push_back(pos);
-		}
-		else if (chars[0] == 'f')
-		{
-			// Read the face indices into an array
-			unsigned int i[12];
-			int facesRead = sscanf_s(
-				chars,
-				"f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d",
-				&i[0], &i[1], &i[2],
-				&i[3], &i[4], &i[5],
-				&i[6], &i[7], &i[8],
-				&i[9], &i[10], &i[11]);
-
-			// - Create the verts by looking up
-			//    corresponding data from vectors
-			// - OBJ File indices are 1-based, so
-			//    they need to be adusted
-			Vertex v1;
-			v1.Position = positions[i[0] - 1];
-			v1.UV = uvs[i[1] - 1];
-			v1.Normal = normals[i[2] - 1];
-
-			Vertex v2;
-			v2.Position = positions[i[3] - 1];
-			v2.UV = uvs[i[4] - 1];
-			v2.Normal = normals[i[5] - 1];
-
-			Vertex v3;
-			v3.Position = positions[i[6] - 1];
-			v3.UV = uvs[i[7] - 1];
-			v3.Normal = normals[i[8] - 1];
-
-			// The model is most likely in a right-handed space,
-			// especially if it came from Maya.  We want to convert
-			// to a left-handed space for DirectX.  This means we 
-			// need to:
-			//  - Invert the Z position
-			//  - Invert the normal's Z
-			//  - Flip the winding order
-			// We also need to flip the UV coordinate since DirectX
-			// defines (0,0) as the top left of the texture, and many
-			// 3D modeling packages use the bottom left as (0,0)
-
-			// Flip the UV's since they're probably "upside down"
-			v1.UV.y = 1.0f - v1.UV.y;
-			v2.UV.y = 1.0f - v2.UV.y;
-			v3.UV.y = 1.0f - v3.UV.y;
-
-			// Flip Z (LH vs. RH)
-			v1.Position.z *= -1.0f;
-			v2.Position.z *= -1.0f;
-			v3.Position.z *= -1.0f;
-
-			// Flip normal Z
-			v1.Normal.z *= -1.0f;
-			v2.Normal.z *= -1.0f;
-			v3.Normal.z *= -1.0f;
-
-			// Add the verts to the vector (flipping the winding order)
-			verts.push_back(v1);
-			verts.push_back(v3);
-			verts.push_back(v2);
-
-			// Add three more indices
-			indices.push_back(vertCounter); vertCounter += 1;
-			indices.push_back(vertCounter); vertCounter += 1;
-			indices.push_back(vertCounter); vertCounter += 1;
-
-			// Was there a 4th face?
-			if (facesRead == 12)
-			{
-				// Make the last vertex
-				Vertex v4;
-				v4.Position = positions[i[9] - 1];
-				v4.UV = uvs[i[10] - 1];
-				v4.Normal = normals[i[11] - 1];
-
-				// Flip the UV, Z pos and normal
-				v4.UV.y = 1.0f - v4.UV.y;
-				v4.Position.z *= -1.0f;
-				v4.Normal.z *= -1.0f;
-
-				// Add a whole triangle (flipping the winding order)
-				verts.push_back(v1);
-				verts.push_back(v4);
-				verts.push_back(v3);
-
-				// Add three more indices
-				indices.push_back(vertCounter); vertCounter += 1;
-				indices.push_back(vertCounter); vertCounter += 1;
-				indices.push_back(vertCounter); vertCounter += 1;
-			}
-		}
+	// Processed on an earlier run - upload straight from the cache
+	// file, which stays mapped until CreateBuffers
+	uint64_t sourceHash = MeshCache::HashSource(source.GetData(), source.GetSize());
+	MeshCache* cache = new MeshCache();
+	if (cache->Load(sourceHash))
+	{
+		delete _cache;
+		_cache = cache;
+		_submeshes = cache->GetSubmeshes();
+		_lods = cache->GetLods();
+		_meshlets = cache->GetMeshlets();
+		_meshletBounds.Build(_meshlets);
+		_bounds = cache->GetBounds();
+		Prepare((const Vertex*)cache->GetVertices(), cache->GetVertexCount(),
+			cache->GetIndices(), cache->GetIndexCount(), true);
+		PrintQuantization(filename);
+		return true;
 	}
+	delete cache;
 
-	// Close the file and create the actual buffers
-	obj.close();
+	// Parsed straight out of the mapped file - see ObjLoader.h
+	MeshData data;
+	if (!ParseObj(source.GetData(), source.GetSize(), data, jobs) || data.Indices.empty())
+	{
+		printf("Failed to load mesh %s\n", filename);
+		return false;
+	}
 
-	Initialize(&verts[0], vertCounter, &indices[0], vertCounter, device);
+	// The loader gives every corner its own vertex - share the identical ones
+	MeshWeldStats weld;
+	WeldVertices(data, &weld);
+	printf("%s: %u -> %u vertices (%.2fx)\n", filename,
+		weld.VerticesBefore, weld.VerticesAfter, weld.GetReduction());
+
+	// File order ignores the vertex cache - reorder for it, overdraw and fetch
+	MeshOptimizeStats optimize;
+	OptimizeMesh(data, &optimize);
+	printf("%s: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", filename,
+		optimize.Before.Acmr, optimize.After.Acmr, optimize.Before.Atvr, optimize.After.Atvr);
+
+	// Clusters that can be culled on their own.  Regroups LOD 0's
+	// triangles, so it has to happen before the LODs copy them.
+	BuildMeshlets(data);
+	printf("%s: %u meshlets\n", filename, (unsigned int)data.Meshlets.size());
+
+	// Simplified copies for drawing at a distance, sharing the vertices
+	GenerateLods(data);
+	for (size_t i = 1; i < data.Lods.size(); i++)
+	{
+		printf("%s: LOD %u, %u triangles, error %g\n", filename, (unsigned int)i,
+			data.Lods[i].IndexCount / 3, data.Lods[i].Error);
+	}
 
+	if (!MeshCache::Save(sourceHash, data))
+		printf("Couldn't write the mesh cache for %s\n", filename);
+
+	_submeshes = data.Submeshes;
+	_lods = data.Lods;
+	_meshlets = data.Meshlets;
+	_meshletBounds.Build(_meshlets);
+	_bounds = ComputeMeshBounds(data.Vertices.data(), data.Vertices.size());
+	Prepare((const Vertex*)data.Vertices.data(), (unsigned int)data.Vertices.size(),
+		data.Indices.data(), (unsigned int)data.Indices.size());
+	PrintQuantization(filename);
+	return true;
+}
 
-	// - At this point, "verts" is a vector of Vertex structs, and can be used
-	//    directly to create a vertex buffer:  &verts[0] is the address of the first vert
-	//
-	// - The vector "indices" is similar. It's a vector of unsigned ints and
-	//    can be used directly for the index buffer: &indices[0] is the address of the first int
-	//
-	// - "vertCounter" is BOTH the number of vertices and the number of indices
-	// - Yes, the indices are a bit redundant here (one per vertex)
+void Mesh::PrintQuantization(const char* filename)
+{
+	if (_vertexFormat != MeshVertexFormat::Quantized || _vertexData.empty()) return;
+	printf("%s: quantized, max error %g units, %.3f degrees, %g UV\n", filename,
+		_quantizationError.Position, _quantizationError.NormalDegrees, _quantizationError.UV);
 }
 
 Mesh::~Mesh()
 {
-	_vertexBuffer->Release();
-	_indexBuffer->Release();
+	if (_vertexBuffer) _vertexBuffer->Release();
+	if (_indexBuffer) _indexBuffer->Release();
+	delete _cache;
+}
+
+void Mesh::Initialize(const Vertex * vertices, unsigned int vertexCount, 
+	const unsigned int indices[], unsigned int indexCount, ID3D11Device * device)
+{
+	Prepare(vertices, vertexCount, indices, indexCount);
+	CreateBuffers(device);
+}
+
+// --------------------------------------------------------
+// Works out the final vertex and index buffer contents.  With
+// borrow, input that's already in its final form isn't copied
+// and has to stay valid until CreateBuffers.
+// --------------------------------------------------------
+void Mesh::Prepare(const Vertex * vertices, unsigned int vertexCount,
+	const unsigned int indices[], unsigned int indexCount, bool borrow)
+{
+	// Geometry built in code is a single submesh
+	if (_submeshes.empty())
+	{
+		MeshSubmesh whole = {};
+		whole.IndexCount = indexCount;
+		_submeshes.push_back(whole);
+		_bounds = ComputeMeshBounds((const MeshVertex*)vertices, vertexCount);
+	}
+	if (_lods.empty())
+	{
+		MeshLod whole = { 0, indexCount, 0.0f };
+		_lods.push_back(whole);
+	}
+
+	// Quantized meshes are encoded here, so the cache and the
+	// loaders only ever deal in float vertices
+	if (_vertexFormat == MeshVertexFormat::Quantized)
+	{
+		const MeshVertex* source = (const MeshVertex*)vertices;
+		_quantization = ComputeVertexQuantization(source, vertexCount);
+		_vertexData.resize(sizeof(QuantizedVertex) * vertexCount);
+		QuantizedVertex* quantized = (QuantizedVertex*)_vertexData.data();
+		QuantizeVertices(source, vertexCount, _quantization, quantized);
+		_quantizationError = MeasureQuantizationError(source, quantized, vertexCount, _quantization);
+		_vertexUpload = _vertexData.data();
+	}
+	else if (borrow)
+	{
+		_vertexUpload = vertices;
+	}
+	else
+	{
+		const unsigned char* bytes = (const unsigned char*)vertices;
+		_vertexData.assign(bytes, bytes + sizeof(Vertex) * vertexCount);
+		_vertexUpload = _vertexData.data();
+	}
+	_vertexUploadSize = GetVertexStride() * vertexCount;
+
+	// 0xFFFF is the strip cut value, so the last usable index is 0xFFFE
+	if (vertexCount <= 0xFFFF)
+	{
+		_indexFormat = DXGI_FORMAT_R16_UINT;
+		_indexData.resize(sizeof(uint16_t) * indexCount);
+		uint16_t* shortIndices = (uint16_t*)_indexData.data();
+		for (unsigned int i = 0; i < indexCount; i++)
+			shortIndices[i] = (uint16_t)indices[i];
+		_indexUpload = _indexData.data();
+	}
+	else
+	{
+		_indexFormat = DXGI_FORMAT_R32_UINT;
+		if (borrow)
+		{
+			_indexUpload = indices;
+		}
+		else
+		{
+			const unsigned char* bytes = (const unsigned char*)indices;
+			_indexData.assign(bytes, bytes + sizeof(unsigned int) * indexCount);
+			_indexUpload = _indexData.data();
+		}
+	}
+	_indexUploadSize = GetIndexSize() * indexCount;
+
+	// Everything past LOD 0 is only drawn through GetLods()
+	_indexCount = _lods[0].IndexCount;
 }
 
-void Mesh::Initialize(Vertex * vertices, unsigned int vertexCount, 
-	unsigned int indices[], unsigned int indexCount, ID3D11Device * device)
+// --------------------------------------------------------
+// Uploads what Load or Prepare left behind.  Does nothing if
+// loading failed, leaving the mesh without buffers.
+// --------------------------------------------------------
+void Mesh::CreateBuffers(ID3D11Device * device)
 {
+	if (_vertexUploadSize == 0 || _indexUploadSize == 0) return;
+
 	D3D11_BUFFER_DESC vbd;
 	vbd.Usage = D3D11_USAGE_IMMUTABLE;
-	vbd.ByteWidth = sizeof(Vertex) * vertexCount;
+	vbd.ByteWidth = (UINT)_vertexUploadSize;
 	vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
 	vbd.CPUAccessFlags = 0;
 	vbd.MiscFlags = 0;
 	vbd.StructureByteStride = 0;
 
 	D3D11_SUBRESOURCE_DATA initialVertexData;
-	initialVertexData.pSysMem = vertices;
+	initialVertexData.pSysMem = _vertexUpload;
 
 	device->CreateBuffer(&vbd, &initialVertexData, &_vertexBuffer);
 
 	D3D11_BUFFER_DESC ibd;
 	ibd.Usage = D3D11_USAGE_IMMUTABLE;
-	ibd.ByteWidth = sizeof(unsigned int) * indexCount;
+	ibd.ByteWidth = (UINT)_indexUploadSize;
 	ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
 	ibd.CPUAccessFlags = 0;
 	ibd.MiscFlags = 0;
 	ibd.StructureByteStride = 0;
 
 	D3D11_SUBRESOURCE_DATA initialIndexData;
-	initialIndexData.pSysMem = indices;
-
-	_indexCount = indexCount;
+	initialIndexData.pSysMem = _indexUpload;
 
 	device->CreateBuffer(&ibd, &initialIndexData, &_indexBuffer);
+
+	_bufferBytes = _vertexUploadSize + _indexUploadSize;
+
+	// The GPU has its own copy now
+	std::vector<unsigned char>().swap(_vertexData);
+	std::vector<unsigned char>().swap(_indexData);
+	_vertexUpload = nullptr;
+	_indexUpload = nullptr;
+	_vertexUploadSize = 0;
+	_indexUploadSize = 0;
+	delete _cache;
+	_cache = nullptr;
 }
 
 ID3D11Buffer* Mesh::GetVertexBuffer() {
@@ -281,4 +324,48 @@ ID3D11Buffer* Mesh::GetIndexBuffer() {
 
 unsigned int Mesh::GetIndexCount() {
 	return _indexCount;
-}
\ No newline at end of file
+}
+
+const std::vector<MeshSubmesh>& Mesh::GetSubmeshes() {
+	return _submeshes;
+}
+
+const std::vector<MeshLod>& Mesh::GetLods() {
+	return _lods;
+}
+
+const MeshBounds& Mesh::GetBounds() {
+	return _bounds;
+}
+
+const std::vector<Meshlet>& Mesh::GetMeshlets() {
+	return _meshlets;
+}
+
+const MeshletBounds& Mesh::GetMeshletBounds() {
+	return _meshletBounds;
+}
+
+DXGI_FORMAT Mesh::GetIndexFormat() {
+	return _indexFormat;
+}
+
+unsigned int Mesh::GetIndexSize() {
+	return _indexFormat == DXGI_FORMAT_R16_UINT ? 2 : 4;
+}
+
+MeshVertexFormat Mesh::GetVertexFormat() {
+	return _vertexFormat;
+}
+
+unsigned int Mesh::GetVertexStride() {
+	return _vertexFormat == MeshVertexFormat::Quantized ? sizeof(QuantizedVertex) : sizeof(Vertex);
+}
+
+const VertexQuantization* Mesh::GetQuantization() {
+	return _vertexFormat == MeshVertexFormat::Quantized ? &_quantization : nullptr;
+}
+
+size_t Mesh::GetMemorySize() {
+	return _bufferBytes;
+}
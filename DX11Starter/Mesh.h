@@ -1,21 +1,99 @@
 #pragma once
 #include <d3d11.h>
+#include <vector>
 #include "Vertex.h"
+#include "MeshData.h"
+#include "VertexQuantize.h"
+#include "Meshlet.h"
+
+class JobSystem;
+class MeshCache;
+
+// --------------------------------------------------------
+// How a mesh's vertices sit in its vertex buffer.  Quantized
+// meshes are half the size, but must be drawn with
+// QuantizedVS / QuantizedDepthVS.
+// --------------------------------------------------------
+enum class MeshVertexFormat
+{
+	Float,		// Vertex, 32 bytes
+	Quantized	// QuantizedVertex, 16 bytes
+};
+
 class Mesh
 {
 public:
 	Mesh(Vertex*, unsigned int, unsigned int[], unsigned int, ID3D11Device*);
-	Mesh(char*, ID3D11Device*);
+	Mesh(char*, ID3D11Device*, JobSystem* jobs = nullptr, MeshVertexFormat format = MeshVertexFormat::Float);
 	Mesh(unsigned int, unsigned int, ID3D11Device*);
 	~Mesh();
-	void Initialize(Vertex*, unsigned int, unsigned int[], unsigned int, ID3D11Device*);
+	void Initialize(const Vertex*, unsigned int, const unsigned int[], unsigned int, ID3D11Device*);
+
+	// The file constructor in two halves, for loading off the
+	// owning thread.  Load does all the CPU work and is safe on a
+	// worker; CreateBuffers uploads the result and frees it.
+	explicit Mesh(MeshVertexFormat format = MeshVertexFormat::Float);
+	bool Load(const char* filename, JobSystem* jobs = nullptr);
+	void CreateBuffers(ID3D11Device* device);
+
 	ID3D11Buffer* GetVertexBuffer();
 	ID3D11Buffer* GetIndexBuffer();
-	unsigned int GetIndexCount();
+	unsigned int GetIndexCount();	// Full detail - LOD 0
+	const std::vector<MeshSubmesh>& GetSubmeshes();
+
+	// LOD 0 first; the rest are index ranges in the same buffers
+	const std::vector<MeshLod>& GetLods();
+	const MeshBounds& GetBounds();
+
+	// Clusters of LOD 0 for CullMeshlets - empty for meshes
+	// built in code
+	const std::vector<Meshlet>& GetMeshlets();
+	const MeshletBounds& GetMeshletBounds();
+
+	// Meshes with fewer than 65,536 vertices get 16-bit indices
+	DXGI_FORMAT GetIndexFormat();
+	unsigned int GetIndexSize();
+
+	MeshVertexFormat GetVertexFormat();
+	unsigned int GetVertexStride();
+
+	// Constants QuantizedVS needs, or null for float vertices
+	const VertexQuantization* GetQuantization();
+
+	// Vertex and index buffer bytes, once CreateBuffers has run
+	size_t GetMemorySize();
 private:
 	ID3D11Buffer* _vertexBuffer;
 	ID3D11Buffer* _indexBuffer;
 	unsigned int _indexCount;
+	std::vector<MeshSubmesh> _submeshes;
+	std::vector<MeshLod> _lods;
+	MeshBounds _bounds;
+	std::vector<Meshlet> _meshlets;
+	MeshletBounds _meshletBounds;
+
+	void PrintQuantization(const char* filename);
+
+	// Buffer contents between Prepare and CreateBuffers.  The
+	// upload pointers are either the vectors' data or, when
+	// Prepare may borrow its input, the input itself.
+	std::vector<unsigned char> _vertexData;
+	std::vector<unsigned char> _indexData;
+	const void* _vertexUpload = nullptr;
+	const void* _indexUpload = nullptr;
+	size_t _vertexUploadSize = 0;
+	size_t _indexUploadSize = 0;
+	size_t _bufferBytes = 0;
+	void Prepare(const Vertex*, unsigned int, const unsigned int[], unsigned int, bool borrow = false);
+
+	// A cache hit keeps its file mapped until CreateBuffers, so
+	// float vertices and 32-bit indices upload straight from it
+	MeshCache* _cache = nullptr;
+
+	MeshVertexFormat _vertexFormat = MeshVertexFormat::Float;
+	DXGI_FORMAT _indexFormat = DXGI_FORMAT_R32_UINT;
+	VertexQuantization _quantization;
+	QuantizationError _quantizationError;
 
 };
 
@@ -0,0 +1,253 @@
+#include "MeshCache.h"
+#include "Hash.h"
+#include "CacheIO.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+// "MSHC" read as a little-endian 32-bit value
+static const uint32_t CacheMagic = 0x4348534D;
+
+// Vertex data starts on this boundary
+static const size_t SectionAlignment = 16;
+
+std::string MeshCache::CacheDirectory = "MeshCache";
+
+static void WriteFloat(std::vector<unsigned char>& out, float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	WriteU32(out, bits);
+}
+
+static float ReadFloat(CacheReader& reader)
+{
+	uint32_t bits = reader.U32();
+	float value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+uint64_t MeshCache::HashSource(const void* data, size_t size)
+{
+	return HashBytes(data, size);
+}
+
+// --------------------------------------------------------
+// Flattens a processed mesh into a byte array
+//
+// mesh       - Vertices, indices, submeshes, LODs and meshlets to write
+// sourceHash - Hash of the file the mesh was built from
+// out        - Receives the serialized bytes
+// --------------------------------------------------------
+void MeshCache::Serialize(const MeshData& mesh, uint64_t sourceHash, std::vector<unsigned char>& out)
+{
+	static_assert(sizeof(MeshVertex) == 32, "Cache files store 32-byte vertices");
+
+	uint32_t vertexBytes = (uint32_t)(mesh.Vertices.size() * sizeof(MeshVertex));
+	uint32_t indexBytes = (uint32_t)(mesh.Indices.size() * sizeof(uint32_t));
+
+	// Header is a fixed size, so the section offsets are known up front
+	const uint32_t headerSize = 4 * 4 + 8 + 6 * 4 + 3 * 4;
+	uint32_t vertexOffset = (uint32_t)((headerSize + SectionAlignment - 1) & ~(SectionAlignment - 1));
+	uint32_t indexOffset = vertexOffset + vertexBytes;
+	uint32_t submeshOffset = indexOffset + indexBytes;
+
+	MeshBounds meshBounds = ComputeMeshBounds(mesh.Vertices.data(), mesh.Vertices.size());
+
+	out.clear();
+	WriteU32(out, CacheMagic);
+	WriteU32(out, FormatVersion);
+	WriteU64(out, sourceHash);
+	WriteU32(out, (uint32_t)mesh.Vertices.size());
+	WriteU32(out, (uint32_t)mesh.Indices.size());
+	for (int i = 0; i < 3; i++) WriteFloat(out, meshBounds.Min[i]);
+	for (int i = 0; i < 3; i++) WriteFloat(out, meshBounds.Max[i]);
+	WriteU32(out, vertexOffset);
+	WriteU32(out, indexOffset);
+	WriteU32(out, submeshOffset);
+
+	// The bulk data goes in as-is - every D3D11 target is little-endian
+	out.resize(vertexOffset, 0);
+	const unsigned char* vertexData = (const unsigned char*)mesh.Vertices.data();
+	const unsigned char* indexData = (const unsigned char*)mesh.Indices.data();
+	out.insert(out.end(), vertexData, vertexData + vertexBytes);
+	out.insert(out.end(), indexData, indexData + indexBytes);
+
+	WriteU32(out, (uint32_t)mesh.Submeshes.size());
+	for (const MeshSubmesh& submesh : mesh.Submeshes)
+	{
+		WriteU32(out, submesh.IndexStart);
+		WriteU32(out, submesh.IndexCount);
+		WriteString(out, submesh.Name);
+		WriteString(out, submesh.Material);
+	}
+
+	WriteU32(out, (uint32_t)mesh.Lods.size());
+	for (const MeshLod& lod : mesh.Lods)
+	{
+		WriteU32(out, lod.IndexStart);
+		WriteU32(out, lod.IndexCount);
+		WriteFloat(out, lod.Error);
+	}
+
+	WriteU32(out, (uint32_t)mesh.Meshlets.size());
+	for (const Meshlet& meshlet : mesh.Meshlets)
+	{
+		WriteU32(out, meshlet.IndexStart);
+		WriteU32(out, meshlet.IndexCount);
+		for (int i = 0; i < 3; i++) WriteFloat(out, meshlet.Center[i]);
+		WriteFloat(out, meshlet.Radius);
+		for (int i = 0; i < 3; i++) WriteFloat(out, meshlet.ConeAxis[i]);
+		WriteFloat(out, meshlet.ConeCutoff);
+	}
+}
+
+std::string MeshCache::GetCachePath(uint64_t sourceHash)
+{
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.mesh", (unsigned long long)sourceHash);
+	return CacheDirectory + "/" + name;
+}
+
+// --------------------------------------------------------
+// Writes the processed mesh for the given source hash,
+// creating the cache folder if it isn't there yet
+// --------------------------------------------------------
+bool MeshCache::Save(uint64_t sourceHash, const MeshData& mesh)
+{
+#ifdef _WIN32
+	_mkdir(CacheDirectory.c_str());
+#else
+	mkdir(CacheDirectory.c_str(), 0755);
+#endif
+
+	std::vector<unsigned char> bytes;
+	Serialize(mesh, sourceHash, bytes);
+
+	std::ofstream out(GetCachePath(sourceHash), std::ios::binary | std::ios::trunc);
+	if (!out.is_open()) return false;
+	out.write((const char*)bytes.data(), bytes.size());
+	return out.good();
+}
+
+MeshCache::MeshCache()
+{
+	Close();
+}
+
+void MeshCache::Close()
+{
+	file.Close();
+	vertices = nullptr;
+	indices = nullptr;
+	vertexCount = 0;
+	indexCount = 0;
+	submeshes.clear();
+	lods.clear();
+	meshlets.clear();
+	memset(&bounds, 0, sizeof(bounds));
+}
+
+bool MeshCache::Load(uint64_t sourceHash)
+{
+	Close();
+	if (!file.Open(GetCachePath(sourceHash).c_str())) return false;
+
+	if (!Parse((const unsigned char*)file.GetData(), file.GetSize(), sourceHash))
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+// --------------------------------------------------------
+// Checks the header and every section against the file size,
+// then points straight at the vertex and index data
+//
+// Returns false if the bytes are truncated, from another
+// format version, or were written for a different source
+// --------------------------------------------------------
+bool MeshCache::Parse(const unsigned char* bytes, size_t size, uint64_t sourceHash)
+{
+	CacheReader reader = { bytes, size, 0, true };
+	if (reader.U32() != CacheMagic) return false;
+	if (reader.U32() != FormatVersion) return false;
+	if (reader.U64() != sourceHash) return false;
+
+	uint32_t fileVertexCount = reader.U32();
+	uint32_t fileIndexCount = reader.U32();
+	MeshBounds fileBounds;
+	for (int i = 0; i < 3; i++) fileBounds.Min[i] = ReadFloat(reader);
+	for (int i = 0; i < 3; i++) fileBounds.Max[i] = ReadFloat(reader);
+	uint32_t vertexOffset = reader.U32();
+	uint32_t indexOffset = reader.U32();
+	uint32_t submeshOffset = reader.U32();
+	if (!reader.ok) return false;
+
+	// Sections must be in order, in the file and aligned
+	if (vertexOffset % SectionAlignment != 0) return false;
+	if (vertexOffset < reader.pos || vertexOffset > size) return false;
+	if ((size - vertexOffset) / sizeof(MeshVertex) < fileVertexCount) return false;
+	if (indexOffset != vertexOffset + fileVertexCount * sizeof(MeshVertex)) return false;
+	if ((size - indexOffset) / sizeof(uint32_t) < fileIndexCount) return false;
+	if (submeshOffset != indexOffset + fileIndexCount * sizeof(uint32_t)) return false;
+
+	const MeshVertex* fileVertices = (const MeshVertex*)(bytes + vertexOffset);
+	const uint32_t* fileIndices = (const uint32_t*)(bytes + indexOffset);
+	for (uint32_t i = 0; i < fileIndexCount; i++)
+		if (fileIndices[i] >= fileVertexCount) return false;
+
+	reader.pos = submeshOffset;
+	std::vector<MeshSubmesh> fileSubmeshes(reader.Count(16));
+	for (MeshSubmesh& submesh : fileSubmeshes)
+	{
+		submesh.IndexStart = reader.U32();
+		submesh.IndexCount = reader.U32();
+		submesh.Name = reader.String();
+		submesh.Material = reader.String();
+		if (submesh.IndexStart > fileIndexCount || fileIndexCount - submesh.IndexStart < submesh.IndexCount)
+			return false;
+	}
+
+	std::vector<MeshLod> fileLods(reader.Count(12));
+	for (MeshLod& lod : fileLods)
+	{
+		lod.IndexStart = reader.U32();
+		lod.IndexCount = reader.U32();
+		lod.Error = ReadFloat(reader);
+		if (lod.IndexStart > fileIndexCount || fileIndexCount - lod.IndexStart < lod.IndexCount)
+			return false;
+	}
+
+	std::vector<Meshlet> fileMeshlets(reader.Count(40));
+	for (Meshlet& meshlet : fileMeshlets)
+	{
+		meshlet.IndexStart = reader.U32();
+		meshlet.IndexCount = reader.U32();
+		for (int i = 0; i < 3; i++) meshlet.Center[i] = ReadFloat(reader);
+		meshlet.Radius = ReadFloat(reader);
+		for (int i = 0; i < 3; i++) meshlet.ConeAxis[i] = ReadFloat(reader);
+		meshlet.ConeCutoff = ReadFloat(reader);
+		if (meshlet.IndexStart > fileIndexCount || fileIndexCount - meshlet.IndexStart < meshlet.IndexCount)
+			return false;
+	}
+
+	// Trailing bytes mean this isn't a file we wrote
+	if (!reader.ok || reader.pos != size) return false;
+
+	vertices = fileVertices;
+	indices = fileIndices;
+	vertexCount = fileVertexCount;
+	indexCount = fileIndexCount;
+	submeshes.swap(fileSubmeshes);
+	lods.swap(fileLods);
+	meshlets.swap(fileMeshlets);
+	bounds = fileBounds;
+	return true;
+}
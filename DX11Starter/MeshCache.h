@@ -0,0 +1,73 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+#include "MeshData.h"
+
+// --------------------------------------------------------
+// Processed meshes saved to disk, so only the first launch
+// parses and optimizes the OBJ.  Files are keyed by a hash of
+// the source file, like ShaderReflectionCache - editing the
+// OBJ just means the old entry is never found again.
+//
+// Layout, little-endian:
+//   header     magic, version, source hash, counts, bounds and
+//              the byte offset of each section
+//   vertices   MeshVertex[vertexCount], 16-byte aligned
+//   indices    uint32_t[indexCount]
+//   submeshes  index start, count, name, material each
+//   LODs       index start, count and error each
+//   meshlets   index start, count, sphere and cone each
+//
+// The vertex and index sections are exactly what the GPU wants.
+// Mesh keeps a hit mapped until CreateBuffers and uploads float
+// vertices and 32-bit indices straight out of the mapping; only
+// quantized vertices and 16-bit indices get converted copies.
+// --------------------------------------------------------
+class MeshCache
+{
+public:
+	// Bump whenever the binary layout or the processing changes
+	static const uint32_t FormatVersion = 3;
+
+	// Folder (relative to the working directory) holding cache files
+	static std::string CacheDirectory;
+
+	static uint64_t HashSource(const void* data, size_t size);
+
+	// Writing - Save returns false on any I/O problem
+	static void Serialize(const MeshData& mesh, uint64_t sourceHash, std::vector<unsigned char>& out);
+	static std::string GetCachePath(uint64_t sourceHash);
+	static bool Save(uint64_t sourceHash, const MeshData& mesh);
+
+	// Reading - maps the file for the given source hash.  Returns
+	// false on a miss, or if the file is stale or damaged.
+	MeshCache();
+	bool Load(uint64_t sourceHash);
+	void Close();
+
+	// Point into the mapping - valid until Close() or destruction
+	const MeshVertex* GetVertices() const { return vertices; }
+	const uint32_t* GetIndices() const { return indices; }
+	unsigned int GetVertexCount() const { return vertexCount; }
+	unsigned int GetIndexCount() const { return indexCount; }
+
+	const std::vector<MeshSubmesh>& GetSubmeshes() const { return submeshes; }
+	const std::vector<MeshLod>& GetLods() const { return lods; }
+	const std::vector<Meshlet>& GetMeshlets() const { return meshlets; }
+	const MeshBounds& GetBounds() const { return bounds; }
+
+private:
+	bool Parse(const unsigned char* bytes, size_t size, uint64_t sourceHash);
+
+	MappedFile file;
+	const MeshVertex* vertices;
+	const uint32_t* indices;
+	unsigned int vertexCount;
+	unsigned int indexCount;
+	std::vector<MeshSubmesh> submeshes;
+	std::vector<MeshLod> lods;
+	std::vector<Meshlet> meshlets;
+	MeshBounds bounds;
+};
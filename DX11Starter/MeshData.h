@@ -0,0 +1,92 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------
+// Same layout as Vertex, without DirectXMath, so mesh loading
+// and processing can run (and be tested) anywhere.  Mesh.cpp
+// checks the two stay the same size.
+// --------------------------------------------------------
+struct MeshVertex
+{
+	float Position[3];
+	float Normal[3];
+	float UV[2];
+};
+
+// --------------------------------------------------------
+// A run of indices that came from one OBJ group / material.
+// Processing only reorders triangles within a submesh, so
+// the ranges stay valid.
+// --------------------------------------------------------
+struct MeshSubmesh
+{
+	std::string Name;		// Last 'g' or 'o' name, if any
+	std::string Material;	// Last 'usemtl', if any
+	uint32_t IndexStart;
+	uint32_t IndexCount;
+};
+
+// --------------------------------------------------------
+// One level of detail - a run of indices into the same vertex
+// buffer.  LOD 0 is the full mesh (the submeshes); each later
+// level is a simplified copy appended after it.
+// --------------------------------------------------------
+struct MeshLod
+{
+	uint32_t IndexStart;
+	uint32_t IndexCount;
+	float Error;	// Roughly how far the surface moved from LOD 0, in model units
+};
+
+// --------------------------------------------------------
+// A small cluster of LOD 0 triangles - a run of indices with
+// a bounding sphere and a cone around its triangles' normals,
+// so whole clusters facing away or off screen can be skipped.
+// The cone's cutoff is the sine of its half angle, or 1 when
+// the normals spread too far for it to cull anything.
+// --------------------------------------------------------
+struct Meshlet
+{
+	uint32_t IndexStart;
+	uint32_t IndexCount;
+	float Center[3];
+	float Radius;
+	float ConeAxis[3];
+	float ConeCutoff;
+};
+
+// Axis aligned box around every vertex
+struct MeshBounds
+{
+	float Min[3];
+	float Max[3];
+};
+
+// --------------------------------------------------------
+// An indexed triangle list on the CPU, ready to become a Mesh
+// --------------------------------------------------------
+struct MeshData
+{
+	std::vector<MeshVertex> Vertices;
+	std::vector<uint32_t> Indices;
+	std::vector<MeshSubmesh> Submeshes;	// Cover LOD 0 of Indices, in order
+	std::vector<MeshLod> Lods;			// Empty until GenerateLods() runs
+	std::vector<Meshlet> Meshlets;		// Empty until BuildMeshlets() runs
+};
+
+inline MeshBounds ComputeMeshBounds(const MeshVertex* vertices, size_t count)
+{
+	MeshBounds bounds = { { 0, 0, 0 }, { 0, 0, 0 } };
+	for (size_t i = 0; i < count; i++)
+	{
+		for (int k = 0; k < 3; k++)
+		{
+			float p = vertices[i].Position[k];
+			if (i == 0 || p < bounds.Min[k]) bounds.Min[k] = p;
+			if (i == 0 || p > bounds.Max[k]) bounds.Max[k] = p;
+		}
+	}
+	return bounds;
+}
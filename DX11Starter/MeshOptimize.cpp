@@ -0,0 +1,429 @@
+#include "MeshOptimize.h"
+#include <algorithm>
+#include <cmath>
+
+static const uint32_t Unused = 0xFFFFFFFFu;
+
+// --------------------------------------------------------
+// FIFO cache simulation.  A vertex is still cached if fewer than
+// cacheSize other vertices were loaded after it.
+// --------------------------------------------------------
+VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, unsigned int cacheSize)
+{
+	VertexCacheStats stats = {};
+	std::vector<uint32_t> loadedAt(vertexCount, 0);
+	std::vector<uint8_t> used(vertexCount, 0);
+	uint32_t misses = 0;
+	size_t unique = 0;
+
+	for (uint32_t index : indices)
+	{
+		if (!used[index])
+		{
+			used[index] = 1;
+			unique++;
+		}
+		else if (misses - loadedAt[index] <= cacheSize)
+		{
+			continue;
+		}
+		loadedAt[index] = misses++;
+	}
+
+	size_t triangles = indices.size() / 3;
+	stats.Transformed = misses;
+	stats.Acmr = triangles ? (float)misses / triangles : 0;
+	stats.Atvr = unique ? (float)misses / unique : 0;
+	return stats;
+}
+
+// --------------------------------------------------------
+// Forsyth's scoring - see "Linear-Speed Vertex Cache Optimisation"
+// --------------------------------------------------------
+static const int ScoreCacheSize = 32;
+static const int MaxValence = 32;
+
+struct ForsythScores
+{
+	float Cache[ScoreCacheSize];
+	float Valence[MaxValence + 1];
+
+	ForsythScores()
+	{
+		const float decayPower = 1.5f;
+		const float lastTriangleScore = 0.75f;
+		const float valenceScale = 2.0f;
+		const float valencePower = 0.5f;
+
+		for (int i = 0; i < ScoreCacheSize; i++)
+		{
+			// The last triangle's vertices get a fixed score so the
+			// next triangle doesn't just reuse the same edge
+			if (i < 3)
+				Cache[i] = lastTriangleScore;
+			else
+				Cache[i] = powf(1.0f - (float)(i - 3) / (ScoreCacheSize - 3), decayPower);
+		}
+
+		// Favor finishing off vertices with few triangles left
+		Valence[0] = 0;
+		for (int i = 1; i <= MaxValence; i++)
+			Valence[i] = valenceScale * powf((float)i, -valencePower);
+	}
+
+	float Score(int cachePosition, unsigned int liveTriangles) const
+	{
+		if (liveTriangles == 0) return -1.0f;
+		float score = cachePosition >= 0 ? Cache[cachePosition] : 0;
+		return score + Valence[std::min(liveTriangles, (unsigned int)MaxValence)];
+	}
+};
+
+void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount)
+{
+	static const ForsythScores scores;
+
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0) return;
+
+	// Triangles using each vertex, packed into one array
+	std::vector<uint32_t> liveTriangles(vertexCount, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+		liveTriangles[indices[i]]++;
+
+	std::vector<uint32_t> adjacencyStart(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; v++)
+		adjacencyStart[v + 1] = adjacencyStart[v] + liveTriangles[v];
+
+	std::vector<uint32_t> adjacency(triangleCount * 3);
+	{
+		std::vector<uint32_t> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+		for (size_t t = 0; t < triangleCount; t++)
+			for (int c = 0; c < 3; c++)
+				adjacency[fill[indices[t * 3 + c]]++] = (uint32_t)t;
+	}
+
+	std::vector<float> vertexScore(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+		vertexScore[v] = scores.Score(-1, liveTriangles[v]);
+
+	std::vector<uint8_t> emitted(triangleCount, 0);
+	std::vector<uint32_t> output(triangleCount * 3);
+
+	uint32_t cache[ScoreCacheSize + 3];
+	uint32_t nextCache[ScoreCacheSize + 3];
+	int cacheCount = 0;
+
+	size_t best = Unused;
+	size_t scanCursor = 0;
+
+	for (size_t out = 0; out < triangleCount; out++)
+	{
+		// Nothing in the cache is worth anything, so start on the
+		// next triangle in input order
+		if (best == Unused)
+		{
+			while (emitted[scanCursor]) scanCursor++;
+			best = scanCursor;
+		}
+
+		const uint32_t* tri = &indices[best * 3];
+		output[out * 3 + 0] = tri[0];
+		output[out * 3 + 1] = tri[1];
+		output[out * 3 + 2] = tri[2];
+		emitted[best] = 1;
+
+		// The triangle's vertices go to the front of the LRU cache
+		int nextCount = 0;
+		for (int c = 0; c < 3; c++)
+		{
+			uint32_t v = tri[c];
+			nextCache[nextCount++] = v;
+
+			// Take the triangle out of the vertex's adjacency
+			uint32_t* list = &adjacency[adjacencyStart[v]];
+			uint32_t live = liveTriangles[v];
+			for (uint32_t i = 0; i < live; i++)
+			{
+				if (list[i] == best)
+				{
+					list[i] = list[live - 1];
+					break;
+				}
+			}
+			liveTriangles[v] = live - 1;
+		}
+		for (int i = 0; i < cacheCount; i++)
+		{
+			uint32_t v = cache[i];
+			if (v != tri[0] && v != tri[1] && v != tri[2])
+				nextCache[nextCount++] = v;
+		}
+
+		// Rescore everything that was or is in the cache.  Vertices
+		// pushed off the end drop to a cache position of -1.
+		for (int i = 0; i < nextCount; i++)
+		{
+			uint32_t v = nextCache[i];
+			vertexScore[v] = scores.Score(i < ScoreCacheSize ? i : -1, liveTriangles[v]);
+		}
+
+		best = Unused;
+		float bestScore = -1.0f;
+		for (int i = 0; i < nextCount; i++)
+		{
+			uint32_t v = nextCache[i];
+			const uint32_t* list = &adjacency[adjacencyStart[v]];
+			for (uint32_t j = 0; j < liveTriangles[v]; j++)
+			{
+				uint32_t t = list[j];
+				const uint32_t* other = &indices[t * 3];
+				float score = vertexScore[other[0]] + vertexScore[other[1]] + vertexScore[other[2]];
+				if (score > bestScore)
+				{
+					bestScore = score;
+					best = t;
+				}
+			}
+		}
+
+		cacheCount = std::min(nextCount, ScoreCacheSize);
+		std::copy(nextCache, nextCache + cacheCount, cache);
+	}
+
+	indices.swap(output);
+}
+
+// --------------------------------------------------------
+// Splits the triangle list into clusters.  A hard boundary is a
+// triangle that misses the cache on all three vertices - starting
+// a cluster there costs nothing.  Inside those, a soft boundary
+// goes wherever the cluster so far is already within the ACMR
+// target, so sorting can't push it much past the threshold.
+// A target of 0 only finds hard boundaries.
+// --------------------------------------------------------
+static void FindClusters(const std::vector<uint32_t>& indices, size_t vertexCount, float targetAcmr, std::vector<uint32_t>& clusters)
+{
+	const uint32_t cacheSize = 16;
+	size_t triangleCount = indices.size() / 3;
+
+	std::vector<uint32_t> loadedAt(vertexCount, 0);
+	uint32_t misses = cacheSize + 1;		// Everything starts out of the cache
+
+	auto isCached = [&](uint32_t v) { return loadedAt[v] != 0 && misses - loadedAt[v] < cacheSize; };
+	auto load = [&](uint32_t v) { misses++; loadedAt[v] = misses; };
+
+	uint32_t clusterMisses = 0;
+	uint32_t clusterTriangles = 0;
+	bool softSplit = false;		// Current cluster started at a soft boundary
+
+	// A cluster left over at the end of a run of soft ones is usually
+	// too short to reach the target, so fold it into the one before
+	auto endCluster = [&]() {
+		if (softSplit && (float)clusterMisses / clusterTriangles > targetAcmr)
+			clusters.pop_back();
+	};
+
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		const uint32_t* tri = &indices[t * 3];
+		int triMisses = 0;
+		for (int c = 0; c < 3; c++)
+		{
+			if (!isCached(tri[c]))
+			{
+				load(tri[c]);
+				triMisses++;
+			}
+		}
+
+		if (t == 0 || (triMisses == 3 && clusterTriangles > 0))
+		{
+			if (t > 0) endCluster();
+			clusters.push_back((uint32_t)t);
+			clusterMisses = 0;
+			clusterTriangles = 0;
+			softSplit = false;
+		}
+
+		clusterMisses += triMisses;
+		clusterTriangles++;
+
+		if (targetAcmr > 0 && t + 1 < triangleCount && (float)clusterMisses / clusterTriangles <= targetAcmr)
+		{
+			clusters.push_back((uint32_t)t + 1);
+			clusterMisses = 0;
+			clusterTriangles = 0;
+			softSplit = true;
+
+			// The next cluster could end up anywhere, so it can't
+			// count on what's in the cache now
+			misses += cacheSize + 1;
+		}
+	}
+
+	if (clusterTriangles > 0) endCluster();
+}
+
+// --------------------------------------------------------
+// Writes the clusters to output, outermost first
+// --------------------------------------------------------
+static void SortClusters(const std::vector<uint32_t>& indices, const std::vector<MeshVertex>& vertices,
+	const std::vector<uint32_t>& clusters, std::vector<uint32_t>& output)
+{
+	size_t triangleCount = indices.size() / 3;
+
+	// Area weighted centroid of the whole mesh
+	float meshCenter[3] = { 0, 0, 0 };
+	float meshArea = 0;
+
+	size_t clusterCount = clusters.size();
+	std::vector<float> clusterCenter(clusterCount * 3, 0.0f);
+	std::vector<float> clusterNormal(clusterCount * 3, 0.0f);
+
+	for (size_t c = 0; c < clusterCount; c++)
+	{
+		size_t start = clusters[c];
+		size_t end = c + 1 < clusterCount ? clusters[c + 1] : triangleCount;
+		float area = 0;
+		float* center = &clusterCenter[c * 3];
+		float* normal = &clusterNormal[c * 3];
+
+		for (size_t t = start; t < end; t++)
+		{
+			const float* p0 = vertices[indices[t * 3 + 0]].Position;
+			const float* p1 = vertices[indices[t * 3 + 1]].Position;
+			const float* p2 = vertices[indices[t * 3 + 2]].Position;
+
+			float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+			float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+			float n[3] = {
+				e1[1] * e2[2] - e1[2] * e2[1],
+				e1[2] * e2[0] - e1[0] * e2[2],
+				e1[0] * e2[1] - e1[1] * e2[0] };
+			float triArea = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+			for (int i = 0; i < 3; i++)
+			{
+				center[i] += (p0[i] + p1[i] + p2[i]) / 3.0f * triArea;
+				normal[i] += n[i];
+			}
+			area += triArea;
+		}
+
+		for (int i = 0; i < 3; i++)
+			meshCenter[i] += center[i];
+		meshArea += area;
+
+		if (area > 0)
+			for (int i = 0; i < 3; i++)
+				center[i] /= area;
+
+		float length = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		if (length > 0)
+			for (int i = 0; i < 3; i++)
+				normal[i] /= length;
+	}
+
+	if (meshArea > 0)
+		for (int i = 0; i < 3; i++)
+			meshCenter[i] /= meshArea;
+
+	// How far the cluster faces away from the middle - the
+	// outermost, outward facing clusters are drawn first
+	std::vector<float> sortKey(clusterCount);
+	for (size_t c = 0; c < clusterCount; c++)
+	{
+		const float* center = &clusterCenter[c * 3];
+		const float* normal = &clusterNormal[c * 3];
+		sortKey[c] =
+			(center[0] - meshCenter[0]) * normal[0] +
+			(center[1] - meshCenter[1]) * normal[1] +
+			(center[2] - meshCenter[2]) * normal[2];
+	}
+
+	std::vector<uint32_t> order(clusterCount);
+	for (size_t c = 0; c < clusterCount; c++)
+		order[c] = (uint32_t)c;
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sortKey[a] > sortKey[b]; });
+
+	output.clear();
+	output.reserve(indices.size());
+	for (uint32_t c : order)
+	{
+		size_t start = clusters[c];
+		size_t end = c + 1 < clusterCount ? clusters[c + 1] : triangleCount;
+		output.insert(output.end(), indices.begin() + start * 3, indices.begin() + end * 3);
+	}
+}
+
+void OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<MeshVertex>& vertices, float threshold)
+{
+	if (indices.size() < 6) return;
+
+	VertexCacheStats current = AnalyzeVertexCache(indices, vertices.size());
+	float targetAcmr = current.Acmr * threshold;
+
+	std::vector<uint32_t> clusters;
+	std::vector<uint32_t> output;
+	FindClusters(indices, vertices.size(), targetAcmr, clusters);
+	SortClusters(indices, vertices, clusters, output);
+
+	// Lots of small disconnected pieces (the car) make the soft
+	// clusters too small to keep their cache reuse once shuffled.
+	// Hard boundaries alone never cost anything, so fall back to those.
+	if (AnalyzeVertexCache(output, vertices.size()).Acmr > targetAcmr)
+	{
+		clusters.clear();
+		FindClusters(indices, vertices.size(), 0, clusters);
+		SortClusters(indices, vertices, clusters, output);
+	}
+
+	indices.swap(output);
+}
+
+void OptimizeVertexFetch(MeshData& mesh)
+{
+	std::vector<uint32_t> remap(mesh.Vertices.size(), Unused);
+	std::vector<MeshVertex> ordered;
+	ordered.reserve(mesh.Vertices.size());
+
+	for (uint32_t& index : mesh.Indices)
+	{
+		if (remap[index] == Unused)
+		{
+			remap[index] = (uint32_t)ordered.size();
+			ordered.push_back(mesh.Vertices[index]);
+		}
+		index = remap[index];
+	}
+
+	mesh.Vertices.swap(ordered);
+}
+
+void OptimizeMesh(MeshData& mesh, MeshOptimizeStats* stats)
+{
+	if (stats) stats->Before = AnalyzeVertexCache(mesh.Indices, mesh.Vertices.size());
+
+	// Triangles only move within their submesh
+	if (mesh.Submeshes.size() <= 1)
+	{
+		OptimizeVertexCache(mesh.Indices, mesh.Vertices.size());
+		OptimizeOverdraw(mesh.Indices, mesh.Vertices);
+	}
+	else
+	{
+		std::vector<uint32_t> range;
+		for (const MeshSubmesh& submesh : mesh.Submeshes)
+		{
+			std::vector<uint32_t>::iterator first = mesh.Indices.begin() + submesh.IndexStart;
+			range.assign(first, first + submesh.IndexCount);
+			OptimizeVertexCache(range, mesh.Vertices.size());
+			OptimizeOverdraw(range, mesh.Vertices);
+			std::copy(range.begin(), range.end(), first);
+		}
+	}
+	OptimizeVertexFetch(mesh);
+
+	if (stats) stats->After = AnalyzeVertexCache(mesh.Indices, mesh.Vertices.size());
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <cstddef>
+#include "MeshData.h"
+
+// --------------------------------------------------------
+// How well an index buffer uses the post-transform vertex
+// cache, measured with a simulated FIFO cache
+//
+// ACMR - Vertices transformed per triangle (0.5 is ideal for
+//        a big regular grid, 3 is no reuse at all)
+// ATVR - Vertices transformed per unique vertex (1 is ideal)
+// --------------------------------------------------------
+struct VertexCacheStats
+{
+	unsigned int Transformed;
+	float Acmr;
+	float Atvr;
+};
+
+VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, unsigned int cacheSize = 16);
+
+// --------------------------------------------------------
+// Reorders triangles for vertex cache reuse with Tom Forsyth's
+// linear-speed algorithm.  Scores vertices by their position in
+// a simulated LRU cache and how many triangles still use them,
+// then always emits the best scoring triangle next.
+// --------------------------------------------------------
+void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount);
+
+// --------------------------------------------------------
+// Reorders triangles to cut overdraw while keeping most of the
+// cache ordering.  The cache-optimized list is split into
+// clusters, then clusters that face away from the middle of the
+// mesh are drawn first - they tend to occlude the rest.
+//
+// threshold - How much worse the ACMR may get, e.g. 1.05 allows
+//             5%.  Higher means smaller clusters and better sorting.
+// --------------------------------------------------------
+void OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<MeshVertex>& vertices, float threshold = 1.05f);
+
+// --------------------------------------------------------
+// Reorders vertices into the order the indices first use them,
+// so vertex fetches walk memory forwards.  Unused vertices are
+// dropped.
+// --------------------------------------------------------
+void OptimizeVertexFetch(MeshData& mesh);
+
+// --------------------------------------------------------
+// All three passes, in order, with before/after statistics.
+// Triangles are reordered within each submesh separately.
+// --------------------------------------------------------
+struct MeshOptimizeStats
+{
+	VertexCacheStats Before;
+	VertexCacheStats After;
+};
+
+void OptimizeMesh(MeshData& mesh, MeshOptimizeStats* stats = nullptr);
@@ -0,0 +1,644 @@
+#include "MeshSimplify.h"
+#include "MeshOptimize.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+static const uint32_t Empty = 0xFFFFFFFFu;
+
+// Planes along open edges count this much more than triangles,
+// so borders hold their shape
+static const double BorderWeight = 10.0;
+
+// --------------------------------------------------------
+// What a position is allowed to do
+//
+// Manifold - Inside a surface; can collapse onto any neighbor
+// Border   - On an open edge; may only slide along it
+// Locked   - Anything more complicated
+// --------------------------------------------------------
+enum VertexKind
+{
+	KindManifold,
+	KindBorder,
+	KindLocked,
+	KindCount
+};
+
+// [from][to]
+static const bool CanCollapse[KindCount][KindCount] =
+{
+	{ true, true, true },
+	{ false, true, true },
+	{ false, false, false },
+};
+
+MeshLodSettings::MeshLodSettings()
+{
+	MaxLods = 4;
+	Reduction = 0.5f;
+	MinReduction = 0.85f;
+	MinTriangles = 128;
+	MaxError = 0.05f;
+	AttributeWeight = 1.0f;
+}
+
+// Bit pattern of a float, with -0 folded into +0
+static inline uint32_t CanonicalBits(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return bits == 0x80000000u ? 0 : bits;
+}
+
+static inline uint32_t HashPosition(const float position[3])
+{
+	uint64_t h = 0x9E3779B97F4A7C15ULL;
+	for (int i = 0; i < 3; i++)
+	{
+		h ^= CanonicalBits(position[i]);
+		h *= 0xFF51AFD7ED558CCDULL;
+		h ^= h >> 32;
+	}
+	return (uint32_t)h;
+}
+
+static inline bool SamePosition(const MeshVertex& a, const MeshVertex& b)
+{
+	for (int i = 0; i < 3; i++)
+		if (CanonicalBits(a.Position[i]) != CanonicalBits(b.Position[i])) return false;
+	return true;
+}
+
+// --------------------------------------------------------
+// Maps every vertex the indices use to the first one with the
+// same position.  If "wedge" is given it links the vertices
+// sharing a position into a loop (wedge[v] is the next one).
+// Unused vertices map to Empty.
+// --------------------------------------------------------
+static void BuildPositionRemap(const std::vector<MeshVertex>& vertices, const uint32_t* indices, size_t indexCount,
+	std::vector<uint32_t>& remap, std::vector<uint32_t>* wedge)
+{
+	size_t vertexCount = vertices.size();
+	size_t tableSize = 1;
+	while (tableSize < vertexCount * 2) tableSize <<= 1;
+	size_t mask = tableSize - 1;
+
+	std::vector<uint32_t> table(tableSize, Empty);
+	remap.assign(vertexCount, Empty);
+	if (wedge) wedge->assign(vertexCount, Empty);
+
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		uint32_t index = indices[i];
+		if (remap[index] != Empty) continue;
+
+		size_t slot = HashPosition(vertices[index].Position) & mask;
+		while (table[slot] != Empty && !SamePosition(vertices[table[slot]], vertices[index]))
+			slot = (slot + 1) & mask;
+
+		if (table[slot] == Empty)
+		{
+			table[slot] = index;
+			remap[index] = index;
+			if (wedge) (*wedge)[index] = index;
+		}
+		else
+		{
+			uint32_t first = table[slot];
+			remap[index] = first;
+			if (wedge)
+			{
+				(*wedge)[index] = (*wedge)[first];
+				(*wedge)[first] = index;
+			}
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Per-vertex lists built from a triangle list - either the
+// vertices each one has a half-edge to, or the triangles
+// it's part of
+// --------------------------------------------------------
+struct VertexLists
+{
+	std::vector<uint32_t> Offsets;
+	std::vector<uint32_t> Items;
+
+	void BuildEdges(const std::vector<uint32_t>& indices, size_t vertexCount)
+	{
+		Count(indices, vertexCount);
+		for (size_t i = 0; i < indices.size(); i++)
+		{
+			size_t next = i % 3 == 2 ? i - 2 : i + 1;
+			Items[Offsets[indices[i]]++] = indices[next];
+		}
+		Rewind(vertexCount);
+	}
+
+	void BuildTriangles(const std::vector<uint32_t>& indices, size_t vertexCount)
+	{
+		Count(indices, vertexCount);
+		for (size_t i = 0; i < indices.size(); i++)
+			Items[Offsets[indices[i]]++] = (uint32_t)(i / 3);
+		Rewind(vertexCount);
+	}
+
+	bool HasEdge(uint32_t from, uint32_t to) const
+	{
+		for (uint32_t i = Offsets[from]; i < Offsets[from + 1]; i++)
+			if (Items[i] == to) return true;
+		return false;
+	}
+
+private:
+	void Count(const std::vector<uint32_t>& indices, size_t vertexCount)
+	{
+		Offsets.assign(vertexCount + 1, 0);
+		for (uint32_t index : indices) Offsets[index + 1]++;
+		for (size_t v = 0; v < vertexCount; v++) Offsets[v + 1] += Offsets[v];
+		Items.resize(indices.size());
+	}
+
+	// Filling advanced each offset to the next vertex's start
+	void Rewind(size_t vertexCount)
+	{
+		for (size_t v = vertexCount; v > 0; v--) Offsets[v] = Offsets[v - 1];
+		Offsets[0] = 0;
+	}
+};
+
+// --------------------------------------------------------
+// Sum of squared distances to a set of weighted planes, kept
+// as the symmetric matrix, vector and constant of Q(p)
+// --------------------------------------------------------
+struct Quadric
+{
+	double A00, A11, A22, A01, A02, A12;
+	double B0, B1, B2;
+	double C;
+	double Weight;
+};
+
+// Plane n.p + d = 0, with n unit length
+static void AddPlane(Quadric& q, const double n[3], double d, double weight)
+{
+	q.A00 += weight * n[0] * n[0];
+	q.A11 += weight * n[1] * n[1];
+	q.A22 += weight * n[2] * n[2];
+	q.A01 += weight * n[0] * n[1];
+	q.A02 += weight * n[0] * n[2];
+	q.A12 += weight * n[1] * n[2];
+	q.B0 += weight * n[0] * d;
+	q.B1 += weight * n[1] * d;
+	q.B2 += weight * n[2] * d;
+	q.C += weight * d * d;
+	q.Weight += weight;
+}
+
+static void AddQuadric(Quadric& q, const Quadric& other)
+{
+	q.A00 += other.A00; q.A11 += other.A11; q.A22 += other.A22;
+	q.A01 += other.A01; q.A02 += other.A02; q.A12 += other.A12;
+	q.B0 += other.B0; q.B1 += other.B1; q.B2 += other.B2;
+	q.C += other.C;
+	q.Weight += other.Weight;
+}
+
+// Weighted mean squared distance from p to the planes
+static double QuadricError(const Quadric& q, const float p[3])
+{
+	double x = p[0], y = p[1], z = p[2];
+	double r = q.A00 * x * x + q.A11 * y * y + q.A22 * z * z
+		+ 2 * (q.A01 * x * y + q.A02 * x * z + q.A12 * y * z)
+		+ 2 * (q.B0 * x + q.B1 * y + q.B2 * z)
+		+ q.C;
+	return q.Weight > 0 ? fabs(r) / q.Weight : 0;
+}
+
+static void Subtract(const float a[3], const float b[3], double out[3])
+{
+	for (int k = 0; k < 3; k++) out[k] = (double)a[k] - b[k];
+}
+
+static void Cross(const double a[3], const double b[3], double out[3])
+{
+	out[0] = a[1] * b[2] - a[2] * b[1];
+	out[1] = a[2] * b[0] - a[0] * b[2];
+	out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+static double Length(const double v[3])
+{
+	return sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+}
+
+static void TriangleNormal(const float* p0, const float* p1, const float* p2, double normal[3])
+{
+	double e1[3], e2[3];
+	Subtract(p1, p0, e1);
+	Subtract(p2, p0, e2);
+	Cross(e1, e2, normal);
+}
+
+// One edge collapse - every vertex at From's position moves to To's
+struct Collapse
+{
+	uint32_t From;		// Positions, as first vertex with each
+	uint32_t To;
+	double Error;		// Squared
+};
+
+// Squared difference in normal and UV
+static double AttributeDistance(const MeshVertex& a, const MeshVertex& b)
+{
+	double distance = 0;
+	for (int k = 0; k < 3; k++)
+	{
+		double d = (double)a.Normal[k] - b.Normal[k];
+		distance += d * d;
+	}
+	for (int k = 0; k < 2; k++)
+	{
+		double d = (double)a.UV[k] - b.UV[k];
+		distance += d * d;
+	}
+	return distance;
+}
+
+// --------------------------------------------------------
+// Which of the vertices at "to" (a position) "vertex" turns
+// into.  One it shares an edge with keeps the attribute seams
+// where they were; failing that, the closest normal and UV,
+// with how far off it is in attributeError.
+// --------------------------------------------------------
+static uint32_t MapWedge(uint32_t vertex, uint32_t to, const std::vector<uint32_t>& wedge,
+	const VertexLists& edges, const std::vector<MeshVertex>& vertices, double& attributeError)
+{
+	uint32_t best = to;
+	double bestDistance = DBL_MAX;
+	uint32_t candidate = to;
+	do
+	{
+		if (edges.HasEdge(vertex, candidate) || edges.HasEdge(candidate, vertex))
+		{
+			attributeError = 0;
+			return candidate;
+		}
+		double distance = AttributeDistance(vertices[vertex], vertices[candidate]);
+		if (distance < bestDistance)
+		{
+			best = candidate;
+			bestDistance = distance;
+		}
+		candidate = wedge[candidate];
+	} while (candidate != to);
+
+	attributeError = bestDistance;
+	return best;
+}
+
+// --------------------------------------------------------
+// True if moving position "from" onto "to" turns any of its
+// triangles over.  Triangles that touch "to" vanish, so they
+// don't count.
+// --------------------------------------------------------
+static bool FlipsTriangles(const VertexLists& triangles, const std::vector<uint32_t>& positions,
+	const std::vector<MeshVertex>& vertices, uint32_t from, uint32_t to)
+{
+	for (uint32_t i = triangles.Offsets[from]; i < triangles.Offsets[from + 1]; i++)
+	{
+		const uint32_t* triangle = &positions[triangles.Items[i] * 3];
+		if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+			continue;
+
+		const float* before[3];
+		const float* after[3];
+		for (int k = 0; k < 3; k++)
+		{
+			before[k] = vertices[triangle[k]].Position;
+			after[k] = triangle[k] == from ? vertices[to].Position : before[k];
+		}
+
+		double n0[3], n1[3];
+		TriangleNormal(before[0], before[1], before[2], n0);
+		TriangleNormal(after[0], after[1], after[2], n1);
+		if (n0[0] * n1[0] + n0[1] * n1[1] + n0[2] * n1[2] <= 0) return true;
+	}
+	return false;
+}
+
+// --------------------------------------------------------
+// Drops repeats of the same triangle (same corners, same
+// winding), keeping the first.  Some of the bundled OBJs list
+// every face twice, which makes every edge look non-manifold.
+// --------------------------------------------------------
+static void RemoveDuplicateTriangles(std::vector<uint32_t>& indices)
+{
+	struct Key
+	{
+		uint32_t Corners[3];
+		uint32_t Triangle;
+	};
+
+	size_t triangleCount = indices.size() / 3;
+	std::vector<Key> keys(triangleCount);
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		// Rotate the smallest index to the front so winding survives
+		const uint32_t* triangle = &indices[t * 3];
+		int first = triangle[1] < triangle[0] ? 1 : 0;
+		if (triangle[2] < triangle[first]) first = 2;
+		for (int k = 0; k < 3; k++) keys[t].Corners[k] = triangle[(first + k) % 3];
+		keys[t].Triangle = (uint32_t)t;
+	}
+
+	std::sort(keys.begin(), keys.end(), [](const Key& a, const Key& b) {
+		for (int k = 0; k < 3; k++)
+			if (a.Corners[k] != b.Corners[k]) return a.Corners[k] < b.Corners[k];
+		return a.Triangle < b.Triangle;
+	});
+
+	std::vector<unsigned char> duplicate(triangleCount, 0);
+	for (size_t i = 1; i < triangleCount; i++)
+		if (memcmp(keys[i].Corners, keys[i - 1].Corners, sizeof(keys[i].Corners)) == 0)
+			duplicate[keys[i].Triangle] = 1;
+
+	size_t write = 0;
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		if (duplicate[t]) continue;
+		for (int k = 0; k < 3; k++) indices[write++] = indices[t * 3 + k];
+	}
+	indices.resize(write);
+}
+
+float SimplifyMesh(const uint32_t* indices, size_t indexCount, const std::vector<MeshVertex>& vertices,
+	size_t target, float maxError, float attributeWeight, std::vector<uint32_t>& out)
+{
+	out.assign(indices, indices + indexCount);
+	RemoveDuplicateTriangles(out);
+	if (out.size() <= target) return 0.0f;
+
+	size_t vertexCount = vertices.size();
+	std::vector<uint32_t> remap;
+	std::vector<uint32_t> wedge;
+	BuildPositionRemap(vertices, out.data(), out.size(), remap, &wedge);
+
+	// Topology is tracked per position, so UV and normal splits
+	// don't look like holes; the vertex-level edges are only
+	// needed to keep those splits in place
+	std::vector<uint32_t> positions(out.size());
+	for (size_t i = 0; i < out.size(); i++) positions[i] = remap[out[i]];
+
+	VertexLists edges;
+	VertexLists positionEdges;
+	VertexLists positionTriangles;
+	edges.BuildEdges(out, vertexCount);
+	positionEdges.BuildEdges(positions, vertexCount);
+
+	// Open edges are half-edges with no partner going the other way
+	std::vector<uint32_t> openOut(vertexCount, 0), openIn(vertexCount, 0);
+	for (size_t i = 0; i < positions.size(); i++)
+	{
+		uint32_t a = positions[i];
+		uint32_t b = positions[i % 3 == 2 ? i - 2 : i + 1];
+		if (positionEdges.HasEdge(b, a)) continue;
+		openOut[a]++;
+		openIn[b]++;
+	}
+
+	std::vector<unsigned char> kind(vertexCount, KindLocked);
+	for (uint32_t v = 0; v < vertexCount; v++)
+	{
+		if (remap[v] != v) continue;
+
+		if (openOut[v] == 0 && openIn[v] == 0) kind[v] = KindManifold;
+		else if (openOut[v] == 1 && openIn[v] == 1) kind[v] = KindBorder;
+	}
+
+	// One quadric per position, with planes for every triangle
+	// plus planes along borders and attribute seams
+	std::vector<Quadric> quadrics(vertexCount);
+	memset(quadrics.data(), 0, quadrics.size() * sizeof(Quadric));
+	for (size_t i = 0; i < out.size(); i += 3)
+	{
+		const float* p[3];
+		for (int k = 0; k < 3; k++) p[k] = vertices[positions[i + k]].Position;
+
+		double normal[3];
+		TriangleNormal(p[0], p[1], p[2], normal);
+		double length = Length(normal);
+		if (length == 0) continue;
+		for (int k = 0; k < 3; k++) normal[k] /= length;
+
+		double d = -(normal[0] * p[0][0] + normal[1] * p[0][1] + normal[2] * p[0][2]);
+		for (int k = 0; k < 3; k++)
+			AddPlane(quadrics[positions[i + k]], normal, d, length * 0.5);
+
+		// A plane through each open edge, square to the triangle
+		for (int k = 0; k < 3; k++)
+		{
+			uint32_t a = positions[i + k];
+			uint32_t b = positions[i + (k + 1) % 3];
+			double weight;
+			if (!positionEdges.HasEdge(b, a)) weight = BorderWeight;
+			else if (!edges.HasEdge(out[i + (k + 1) % 3], out[i + k])) weight = 1.0;
+			else continue;
+
+			double edge[3], edgeNormal[3];
+			Subtract(vertices[b].Position, vertices[a].Position, edge);
+			Cross(edge, normal, edgeNormal);
+			double edgeLength = Length(edgeNormal);
+			if (edgeLength == 0) continue;
+			for (int j = 0; j < 3; j++) edgeNormal[j] /= edgeLength;
+
+			const float* pa = vertices[a].Position;
+			double edgeD = -(edgeNormal[0] * pa[0] + edgeNormal[1] * pa[1] + edgeNormal[2] * pa[2]);
+			weight *= edgeLength * edgeLength;
+			AddPlane(quadrics[a], edgeNormal, edgeD, weight);
+			AddPlane(quadrics[b], edgeNormal, edgeD, weight);
+		}
+	}
+
+	double errorLimit = (double)maxError * maxError;
+	double resultError = 0;
+
+	std::vector<Collapse> collapses;
+	std::vector<uint32_t> collapseRemap(vertexCount);
+	std::vector<unsigned char> touched(vertexCount);
+
+	// --------------------------------------------------------
+	// Each pass picks the cheaper direction of every edge, then
+	// performs the collapses cheapest first, skipping any whose
+	// positions already moved this pass.  Much faster than a
+	// heap, and nearly as good.
+	// --------------------------------------------------------
+	while (out.size() > target)
+	{
+		edges.BuildEdges(out, vertexCount);
+		positionEdges.BuildEdges(positions, vertexCount);
+		positionTriangles.BuildTriangles(positions, vertexCount);
+		collapses.clear();
+
+		for (size_t i = 0; i < positions.size(); i++)
+		{
+			uint32_t p0 = positions[i];
+			uint32_t p1 = positions[i % 3 == 2 ? i - 2 : i + 1];
+			bool open = !positionEdges.HasEdge(p1, p0);
+
+			// Inner edges turn up twice - once from each side
+			if (!open && p0 > p1) continue;
+
+			Collapse best = { Empty, Empty, DBL_MAX };
+			for (int direction = 0; direction < 2; direction++)
+			{
+				uint32_t from = direction ? p1 : p0;
+				uint32_t to = direction ? p0 : p1;
+				if (!CanCollapse[kind[from]][kind[to]]) continue;
+				if (kind[from] == KindBorder && !open) continue;
+
+				double error = QuadricError(quadrics[from], vertices[to].Position);
+
+				// Vertices that have to jump to a different UV or
+				// normal cost more the longer the edge is
+				double attributeError = 0;
+				uint32_t w = from;
+				do
+				{
+					if (edges.Offsets[w] != edges.Offsets[w + 1])
+					{
+						double wedgeError;
+						MapWedge(w, to, wedge, edges, vertices, wedgeError);
+						if (wedgeError > attributeError) attributeError = wedgeError;
+					}
+					w = wedge[w];
+				} while (w != from);
+
+				if (attributeError > 0)
+				{
+					double edge[3];
+					Subtract(vertices[to].Position, vertices[from].Position, edge);
+					error += attributeWeight * attributeError * (edge[0] * edge[0] + edge[1] * edge[1] + edge[2] * edge[2]);
+				}
+
+				if (error < best.Error)
+				{
+					Collapse collapse = { from, to, error };
+					best = collapse;
+				}
+			}
+			if (best.From != Empty) collapses.push_back(best);
+		}
+		if (collapses.empty()) break;
+
+		std::sort(collapses.begin(), collapses.end(),
+			[](const Collapse& a, const Collapse& b) { return a.Error < b.Error; });
+
+		// Most edges lose two triangles.  Collisions block plenty of
+		// the cheap collapses, so allow some headroom past the goal.
+		size_t triangleGoal = (out.size() - target) / 3;
+		size_t edgeGoal = triangleGoal / 2;
+		double passLimit = edgeGoal < collapses.size() ? 1.5 * collapses[edgeGoal].Error : DBL_MAX;
+		if (passLimit > errorLimit) passLimit = errorLimit;
+
+		for (uint32_t v = 0; v < vertexCount; v++) collapseRemap[v] = v;
+		std::fill(touched.begin(), touched.end(), (unsigned char)0);
+
+		size_t collapsedTriangles = 0;
+		size_t performed = 0;
+		for (const Collapse& collapse : collapses)
+		{
+			if (collapse.Error > passLimit || collapsedTriangles >= triangleGoal) break;
+			if (touched[collapse.From] || touched[collapse.To]) continue;
+			if (FlipsTriangles(positionTriangles, positions, vertices, collapse.From, collapse.To)) continue;
+
+			uint32_t w = collapse.From;
+			do
+			{
+				double wedgeError;
+				collapseRemap[w] = MapWedge(w, collapse.To, wedge, edges, vertices, wedgeError);
+				w = wedge[w];
+			} while (w != collapse.From);
+			AddQuadric(quadrics[collapse.To], quadrics[collapse.From]);
+
+			touched[collapse.From] = 1;
+			touched[collapse.To] = 1;
+			collapsedTriangles += kind[collapse.From] == KindBorder ? 1 : 2;
+			if (collapse.Error > resultError) resultError = collapse.Error;
+			performed++;
+		}
+		if (performed == 0) break;
+
+		// Remap and drop the triangles that collapsed
+		size_t write = 0;
+		for (size_t i = 0; i < out.size(); i += 3)
+		{
+			uint32_t a = collapseRemap[out[i]];
+			uint32_t b = collapseRemap[out[i + 1]];
+			uint32_t c = collapseRemap[out[i + 2]];
+			uint32_t pa = remap[a], pb = remap[b], pc = remap[c];
+			if (pa == pb || pb == pc || pa == pc) continue;
+			positions[write] = pa;
+			out[write++] = a;
+			positions[write] = pb;
+			out[write++] = b;
+			positions[write] = pc;
+			out[write++] = c;
+		}
+		out.resize(write);
+		positions.resize(write);
+	}
+
+	return (float)sqrt(resultError);
+}
+
+void GenerateLods(MeshData& mesh, const MeshLodSettings& settings)
+{
+	mesh.Lods.clear();
+	uint32_t baseCount = (uint32_t)mesh.Indices.size();
+	MeshLod base = { 0, baseCount, 0.0f };
+	mesh.Lods.push_back(base);
+	if (baseCount == 0) return;
+
+	size_t vertexCount = mesh.Vertices.size();
+	MeshBounds bounds = ComputeMeshBounds(mesh.Vertices.data(), vertexCount);
+	float diagonal = 0;
+	for (int k = 0; k < 3; k++)
+	{
+		float extent = bounds.Max[k] - bounds.Min[k];
+		diagonal += extent * extent;
+	}
+	float maxError = sqrtf(diagonal) * settings.MaxError;
+
+	std::vector<uint32_t> lodIndices;
+	for (unsigned int level = 1; level < settings.MaxLods; level++)
+	{
+		const MeshLod& previous = mesh.Lods.back();
+		if (previous.IndexCount / 3 < settings.MinTriangles) break;
+
+		float ratio = powf(settings.Reduction, (float)level);
+		MeshLod lod = { (uint32_t)mesh.Indices.size(), 0, 0.0f };
+		size_t target = (size_t)(baseCount * ratio) / 3 * 3;
+		lod.Error = SimplifyMesh(mesh.Indices.data(), baseCount, mesh.Vertices,
+			target, maxError, settings.AttributeWeight, lodIndices);
+		if (lod.Error < previous.Error) lod.Error = previous.Error;
+		OptimizeVertexCache(lodIndices, vertexCount);
+
+		// Stuck against the error limit or locked positions - no point going on
+		if (lodIndices.size() > previous.IndexCount * settings.MinReduction) break;
+
+		lod.IndexCount = (uint32_t)lodIndices.size();
+		mesh.Indices.insert(mesh.Indices.end(), lodIndices.begin(), lodIndices.end());
+		mesh.Lods.push_back(lod);
+	}
+}
+
+unsigned int SelectMeshLod(const std::vector<MeshLod>& lods, float pixelsPerUnit, float maxPixelError)
+{
+	for (size_t i = lods.size(); i-- > 1;)
+		if (lods[i].Error * pixelsPerUnit <= maxPixelError) return (unsigned int)i;
+	return 0;
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "MeshData.h"
+
+// --------------------------------------------------------
+// Simplifies a triangle list with quadric error metrics
+// (Garland & Heckbert).  Every position keeps a quadric - the
+// sum of the planes of the triangles around it - and the edges
+// whose collapse moves the surface least go first.  Positions
+// only ever collapse onto existing ones, so the result indexes
+// into the same vertex array.
+//
+// Topology is worked out per position, so the vertices split
+// by UV or normal seams move together and the surface never
+// tears.  Open borders only slide along themselves.
+//
+// indices         - Triangle list to simplify
+// target          - Stop at or below this many indices
+// maxError        - Stop before any collapse that moves the
+//                   surface further than this (model units)
+// attributeWeight - Cost of a vertex having to take another
+//                   vertex's normal / UV, per unit of squared
+//                   attribute difference and edge length
+// out             - Receives the simplified triangle list
+//
+// Returns the error actually reached, in model units
+// --------------------------------------------------------
+float SimplifyMesh(const uint32_t* indices, size_t indexCount, const std::vector<MeshVertex>& vertices,
+	size_t target, float maxError, float attributeWeight, std::vector<uint32_t>& out);
+
+// --------------------------------------------------------
+// Knobs for GenerateLods
+// --------------------------------------------------------
+struct MeshLodSettings
+{
+	MeshLodSettings();
+
+	unsigned int MaxLods;		// Including LOD 0
+	float Reduction;			// Triangles kept per level, e.g. 0.5
+	float MinReduction;			// Give up on levels that keep more than this
+	unsigned int MinTriangles;	// Don't simplify levels smaller than this
+	float MaxError;				// Fraction of the bounds' diagonal
+	float AttributeWeight;		// See SimplifyMesh
+};
+
+// --------------------------------------------------------
+// Fills mesh.Lods with LOD 0 (the current indices) and a chain
+// of simplified levels appended to mesh.Indices.  Each level is
+// simplified from LOD 0 so its error is measured against the
+// real surface, then ordered for the vertex cache.  The whole
+// mesh is simplified at once so the joins between submeshes
+// can't open up - levels aren't split by submesh.
+//
+// Run after OptimizeMesh - the levels reuse its vertex order.
+// --------------------------------------------------------
+void GenerateLods(MeshData& mesh, const MeshLodSettings& settings = MeshLodSettings());
+
+// --------------------------------------------------------
+// Picks the coarsest level whose error covers no more than
+// maxPixelError pixels, given how many pixels one model unit
+// covers at the mesh's distance.  0 if there are no levels.
+// --------------------------------------------------------
+unsigned int SelectMeshLod(const std::vector<MeshLod>& lods, float pixelsPerUnit, float maxPixelError);
@@ -0,0 +1,94 @@
+#include "MeshWeld.h"
+#include <cstring>
+
+static const uint32_t Empty = 0xFFFFFFFFu;
+
+// Bit pattern of a float, with -0 folded into +0
+static inline uint32_t CanonicalBits(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return bits == 0x80000000u ? 0 : bits;
+}
+
+// --------------------------------------------------------
+// Mixes the vertex's eight 32-bit words.  Cheaper than hashing
+// byte by byte and good enough to keep probe runs short.
+// --------------------------------------------------------
+static inline uint32_t HashVertex(const uint32_t words[8])
+{
+	uint64_t h = 0x9E3779B97F4A7C15ULL;
+	for (int i = 0; i < 8; i++)
+	{
+		h ^= words[i];
+		h *= 0xFF51AFD7ED558CCDULL;
+		h ^= h >> 32;
+	}
+	return (uint32_t)h;
+}
+
+static inline void VertexWords(const MeshVertex& vertex, uint32_t words[8])
+{
+	const float* values = vertex.Position;
+	for (int i = 0; i < 8; i++)
+		words[i] = CanonicalBits(values[i]);
+}
+
+void WeldVertices(MeshData& mesh, MeshWeldStats* stats)
+{
+	static_assert(sizeof(MeshVertex) == sizeof(float) * 8, "WeldVertices expects a tightly packed MeshVertex");
+
+	size_t vertexCount = mesh.Vertices.size();
+	if (stats)
+	{
+		stats->VerticesBefore = (unsigned int)vertexCount;
+		stats->VerticesAfter = (unsigned int)vertexCount;
+	}
+	if (vertexCount == 0) return;
+
+	size_t tableSize = 1;
+	while (tableSize < vertexCount * 2) tableSize <<= 1;
+	size_t mask = tableSize - 1;
+
+	std::vector<uint32_t> table(tableSize, Empty);
+	std::vector<uint32_t> remap(vertexCount, Empty);
+	std::vector<MeshVertex> welded;
+	std::vector<uint32_t> weldedWords;	// Canonical words of each welded vertex
+	welded.reserve(vertexCount);
+	weldedWords.reserve(vertexCount * 8);
+
+	for (uint32_t& index : mesh.Indices)
+	{
+		uint32_t& mapped = remap[index];
+		if (mapped == Empty)
+		{
+			uint32_t words[8];
+			VertexWords(mesh.Vertices[index], words);
+
+			size_t slot = HashVertex(words) & mask;
+			while (true)
+			{
+				uint32_t existing = table[slot];
+				if (existing == Empty)
+				{
+					existing = (uint32_t)welded.size();
+					table[slot] = existing;
+					welded.push_back(mesh.Vertices[index]);
+					weldedWords.insert(weldedWords.end(), words, words + 8);
+					mapped = existing;
+					break;
+				}
+				if (memcmp(&weldedWords[existing * 8], words, sizeof(words)) == 0)
+				{
+					mapped = existing;
+					break;
+				}
+				slot = (slot + 1) & mask;
+			}
+		}
+		index = mapped;
+	}
+
+	mesh.Vertices.swap(welded);
+	if (stats) stats->VerticesAfter = (unsigned int)mesh.Vertices.size();
+}
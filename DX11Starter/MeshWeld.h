@@ -0,0 +1,25 @@
+#pragma once
+#include "MeshData.h"
+
+// --------------------------------------------------------
+// How much welding saved
+// --------------------------------------------------------
+struct MeshWeldStats
+{
+	unsigned int VerticesBefore;
+	unsigned int VerticesAfter;
+
+	// Before / after - 1 means nothing was shared
+	float GetReduction() const { return VerticesAfter ? (float)VerticesBefore / VerticesAfter : 1.0f; }
+};
+
+// --------------------------------------------------------
+// Merges vertices whose position, normal and UV are identical
+// and rewrites the indices to match.  Vertices come out in the
+// order the index buffer first uses them, and any the indices
+// never touch are dropped.  -0 and +0 count as the same.
+//
+// Uses an open addressing hash table sized to twice the vertex
+// count, so it's a single linear pass.
+// --------------------------------------------------------
+void WeldVertices(MeshData& mesh, MeshWeldStats* stats = nullptr);
@@ -0,0 +1,453 @@
+#include "Meshlet.h"
+#include <algorithm>
+#include <cmath>
+#include <xmmintrin.h>
+
+// Normals wider apart than this (cos of the angle from the
+// axis) make a cone that would almost never cull anything
+static const float MinConeDot = 0.1f;
+
+// How much facing the same way counts against distance when
+// picking the next triangle - 0 is distance only
+static const float NormalWeight = 1.0f;
+
+// Meshlets smaller than this keep going past the end of their
+// patch of surface rather than closing early
+static const unsigned int MinMeshletTriangles = MeshletMaxTriangles / 4;
+
+// --------------------------------------------------------
+// Unit normals and centroids for every triangle, four at a
+// time.  Normals follow D3D's default front face - clockwise
+// on screen, so cross(p1 - p0, p2 - p0) points out.
+// --------------------------------------------------------
+struct TriangleInfo
+{
+	std::vector<float> NormalX, NormalY, NormalZ;
+	std::vector<float> CenterX, CenterY, CenterZ;
+};
+
+static void ComputeTriangleInfo(const MeshData& mesh, uint32_t triangleCount, TriangleInfo& info)
+{
+	// Rounded up so the last group of four can store whole
+	size_t padded = (triangleCount + 3) & ~(size_t)3;
+	info.NormalX.assign(padded, 0); info.NormalY.assign(padded, 0); info.NormalZ.assign(padded, 0);
+	info.CenterX.assign(padded, 0); info.CenterY.assign(padded, 0); info.CenterZ.assign(padded, 0);
+
+	const MeshVertex* vertices = mesh.Vertices.data();
+	const uint32_t* indices = mesh.Indices.data();
+	const __m128 third = _mm_set1_ps(1.0f / 3.0f);
+	const __m128 tiny = _mm_set1_ps(1e-20f);
+
+	for (uint32_t t = 0; t < triangleCount; t += 4)
+	{
+		// Gather corners into lanes; missing triangles repeat the last
+		float p[3][3][4];
+		for (int lane = 0; lane < 4; lane++)
+		{
+			uint32_t tri = std::min(t + lane, triangleCount - 1);
+			for (int corner = 0; corner < 3; corner++)
+			{
+				const float* position = vertices[indices[tri * 3 + corner]].Position;
+				for (int k = 0; k < 3; k++)
+					p[corner][k][lane] = position[k];
+			}
+		}
+
+		__m128 x0 = _mm_loadu_ps(p[0][0]), y0 = _mm_loadu_ps(p[0][1]), z0 = _mm_loadu_ps(p[0][2]);
+		__m128 x1 = _mm_loadu_ps(p[1][0]), y1 = _mm_loadu_ps(p[1][1]), z1 = _mm_loadu_ps(p[1][2]);
+		__m128 x2 = _mm_loadu_ps(p[2][0]), y2 = _mm_loadu_ps(p[2][1]), z2 = _mm_loadu_ps(p[2][2]);
+
+		__m128 ax = _mm_sub_ps(x1, x0), ay = _mm_sub_ps(y1, y0), az = _mm_sub_ps(z1, z0);
+		__m128 bx = _mm_sub_ps(x2, x0), by = _mm_sub_ps(y2, y0), bz = _mm_sub_ps(z2, z0);
+		__m128 nx = _mm_sub_ps(_mm_mul_ps(ay, bz), _mm_mul_ps(az, by));
+		__m128 ny = _mm_sub_ps(_mm_mul_ps(az, bx), _mm_mul_ps(ax, bz));
+		__m128 nz = _mm_sub_ps(_mm_mul_ps(ax, by), _mm_mul_ps(ay, bx));
+
+		// Full precision divide - rsqrt's 12 bits would loosen the cones
+		__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)), _mm_mul_ps(nz, nz)));
+		__m128 scale = _mm_div_ps(_mm_set1_ps(1.0f), _mm_max_ps(length, tiny));
+
+		_mm_storeu_ps(&info.NormalX[t], _mm_mul_ps(nx, scale));
+		_mm_storeu_ps(&info.NormalY[t], _mm_mul_ps(ny, scale));
+		_mm_storeu_ps(&info.NormalZ[t], _mm_mul_ps(nz, scale));
+		_mm_storeu_ps(&info.CenterX[t], _mm_mul_ps(_mm_add_ps(_mm_add_ps(x0, x1), x2), third));
+		_mm_storeu_ps(&info.CenterY[t], _mm_mul_ps(_mm_add_ps(_mm_add_ps(y0, y1), y2), third));
+		_mm_storeu_ps(&info.CenterZ[t], _mm_mul_ps(_mm_add_ps(_mm_add_ps(z0, z1), z2), third));
+	}
+}
+
+// --------------------------------------------------------
+// Sphere around the meshlet's vertices and cone around its
+// triangle normals
+// --------------------------------------------------------
+static void ComputeMeshletBounds(const MeshData& mesh, const TriangleInfo& info,
+	const std::vector<uint32_t>& triangles, const std::vector<uint32_t>& meshletVertices, Meshlet& meshlet)
+{
+	// Nothing to bound - a point that can't be culled by its cone.
+	// BuildMeshlets never makes one, but the loads below need a
+	// first group of four.
+	size_t count = meshletVertices.size();
+	if (count == 0)
+	{
+		for (int k = 0; k < 3; k++) meshlet.Center[k] = meshlet.ConeAxis[k] = 0;
+		meshlet.Radius = 0;
+		meshlet.ConeCutoff = 1.0f;
+		return;
+	}
+
+	// Vertices as four-wide columns, padded with copies of the
+	// first.  There's at least one, so the first four are always
+	// written - the do-while lets the compiler see that too.
+	float px[MeshletMaxVertices + 3], py[MeshletMaxVertices + 3], pz[MeshletMaxVertices + 3];
+	size_t padded = (count + 3) & ~(size_t)3;
+	size_t v = 0;
+	do
+	{
+		const float* position = mesh.Vertices[meshletVertices[v < count ? v : 0]].Position;
+		px[v] = position[0];
+		py[v] = position[1];
+		pz[v] = position[2];
+	} while (++v < padded);
+
+	// Box centre is near enough and costs one pass
+	__m128 minX = _mm_loadu_ps(px), maxX = minX;
+	__m128 minY = _mm_loadu_ps(py), maxY = minY;
+	__m128 minZ = _mm_loadu_ps(pz), maxZ = minZ;
+	for (size_t i = 4; i < padded; i += 4)
+	{
+		__m128 x = _mm_loadu_ps(px + i), y = _mm_loadu_ps(py + i), z = _mm_loadu_ps(pz + i);
+		minX = _mm_min_ps(minX, x); maxX = _mm_max_ps(maxX, x);
+		minY = _mm_min_ps(minY, y); maxY = _mm_max_ps(maxY, y);
+		minZ = _mm_min_ps(minZ, z); maxZ = _mm_max_ps(maxZ, z);
+	}
+
+	float lanes[2][4];
+	float center[3];
+	__m128 mins[3] = { minX, minY, minZ };
+	__m128 maxs[3] = { maxX, maxY, maxZ };
+	for (int k = 0; k < 3; k++)
+	{
+		_mm_storeu_ps(lanes[0], mins[k]);
+		_mm_storeu_ps(lanes[1], maxs[k]);
+		float low = std::min(std::min(lanes[0][0], lanes[0][1]), std::min(lanes[0][2], lanes[0][3]));
+		float high = std::max(std::max(lanes[1][0], lanes[1][1]), std::max(lanes[1][2], lanes[1][3]));
+		center[k] = (low + high) * 0.5f;
+	}
+
+	__m128 cx = _mm_set1_ps(center[0]), cy = _mm_set1_ps(center[1]), cz = _mm_set1_ps(center[2]);
+	__m128 farthest = _mm_setzero_ps();
+	for (size_t i = 0; i < padded; i += 4)
+	{
+		__m128 dx = _mm_sub_ps(_mm_loadu_ps(px + i), cx);
+		__m128 dy = _mm_sub_ps(_mm_loadu_ps(py + i), cy);
+		__m128 dz = _mm_sub_ps(_mm_loadu_ps(pz + i), cz);
+		farthest = _mm_max_ps(farthest, _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+	}
+	_mm_storeu_ps(lanes[0], farthest);
+	float radiusSq = std::max(std::max(lanes[0][0], lanes[0][1]), std::max(lanes[0][2], lanes[0][3]));
+
+	for (int k = 0; k < 3; k++) meshlet.Center[k] = center[k];
+	meshlet.Radius = sqrtf(radiusSq);
+
+	// Cone axis is the average facing; its width is the normal
+	// that strays furthest from it
+	float axis[3] = { 0, 0, 0 };
+	for (uint32_t tri : triangles)
+	{
+		axis[0] += info.NormalX[tri];
+		axis[1] += info.NormalY[tri];
+		axis[2] += info.NormalZ[tri];
+	}
+	float length = sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+	float minDot = -1.0f;
+	if (length > 1e-6f)
+	{
+		for (int k = 0; k < 3; k++) axis[k] /= length;
+		minDot = 1.0f;
+		for (uint32_t tri : triangles)
+		{
+			float dot = info.NormalX[tri] * axis[0] + info.NormalY[tri] * axis[1] + info.NormalZ[tri] * axis[2];
+			minDot = std::min(minDot, dot);
+		}
+	}
+
+	if (minDot <= MinConeDot)
+	{
+		// A zero axis can never pass the back-facing test
+		for (int k = 0; k < 3; k++) meshlet.ConeAxis[k] = 0;
+		meshlet.ConeCutoff = 1.0f;
+	}
+	else
+	{
+		for (int k = 0; k < 3; k++) meshlet.ConeAxis[k] = axis[k];
+		meshlet.ConeCutoff = sqrtf(1.0f - minDot * minDot);
+	}
+}
+
+void BuildMeshlets(MeshData& mesh)
+{
+	mesh.Meshlets.clear();
+	if (mesh.Indices.empty()) return;
+
+	// Only LOD 0 - the submeshes - is split up
+	uint32_t lod0Count = 0;
+	for (const MeshSubmesh& submesh : mesh.Submeshes)
+		lod0Count = std::max(lod0Count, submesh.IndexStart + submesh.IndexCount);
+	if (mesh.Submeshes.empty()) lod0Count = (uint32_t)mesh.Indices.size();
+	uint32_t triangleCount = lod0Count / 3;
+
+	TriangleInfo info;
+	ComputeTriangleInfo(mesh, triangleCount, info);
+
+	// Triangles around each vertex, packed one vertex after another
+	size_t vertexCount = mesh.Vertices.size();
+	std::vector<uint32_t> adjacencyStart(vertexCount + 1, 0);
+	for (uint32_t i = 0; i < triangleCount * 3; i++)
+		adjacencyStart[mesh.Indices[i] + 1]++;
+	for (size_t v = 0; v < vertexCount; v++)
+		adjacencyStart[v + 1] += adjacencyStart[v];
+	std::vector<uint32_t> adjacency(triangleCount * 3);
+	{
+		std::vector<uint32_t> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+		for (uint32_t i = 0; i < triangleCount * 3; i++)
+			adjacency[fill[mesh.Indices[i]]++] = i / 3;
+	}
+
+	std::vector<uint8_t> emitted(triangleCount, 0);
+	std::vector<uint32_t> vertexStamp(vertexCount, 0);		// Meshlet the vertex is in, plus one
+	std::vector<uint32_t> candidateStamp(triangleCount, 0);	// Meshlet it's a candidate for, plus one
+	std::vector<uint32_t> candidates, triangles, meshletVertices;
+	std::vector<uint32_t> reordered;
+	reordered.reserve(lod0Count);
+
+	// Code-built meshes have no submesh list but are one anyway
+	std::vector<MeshSubmesh> ranges = mesh.Submeshes;
+	if (ranges.empty())
+	{
+		MeshSubmesh whole = {};
+		whole.IndexCount = lod0Count;
+		ranges.push_back(whole);
+	}
+
+	uint32_t stamp = 0;
+	for (const MeshSubmesh& submesh : ranges)
+	{
+		uint32_t first = submesh.IndexStart / 3;
+		uint32_t last = first + submesh.IndexCount / 3;
+		uint32_t cursor = first;
+
+		for (;;)
+		{
+			// Seed with the next triangle in cache order
+			while (cursor < last && emitted[cursor]) cursor++;
+			if (cursor >= last) break;
+
+			stamp++;
+			triangles.clear();
+			meshletVertices.clear();
+			candidates.clear();
+			float sum[3] = { 0, 0, 0 };
+			float normalSum[3] = { 0, 0, 0 };
+			uint32_t next = cursor;
+
+			for (;;)
+			{
+				// Take the triangle
+				emitted[next] = 1;
+				triangles.push_back(next);
+				sum[0] += info.CenterX[next]; sum[1] += info.CenterY[next]; sum[2] += info.CenterZ[next];
+				normalSum[0] += info.NormalX[next]; normalSum[1] += info.NormalY[next]; normalSum[2] += info.NormalZ[next];
+				for (int corner = 0; corner < 3; corner++)
+				{
+					uint32_t vertex = mesh.Indices[next * 3 + corner];
+					if (vertexStamp[vertex] != stamp)
+					{
+						vertexStamp[vertex] = stamp;
+						meshletVertices.push_back(vertex);
+					}
+
+					// Its neighbours become candidates
+					for (uint32_t a = adjacencyStart[vertex]; a < adjacencyStart[vertex + 1]; a++)
+					{
+						uint32_t neighbour = adjacency[a];
+						if (neighbour < first || neighbour >= last || emitted[neighbour]) continue;
+						if (candidateStamp[neighbour] == stamp) continue;
+						candidateStamp[neighbour] = stamp;
+						candidates.push_back(neighbour);
+					}
+				}
+				if (triangles.size() >= MeshletMaxTriangles) break;
+
+				// Pick the candidate adding the fewest vertices, then the
+				// closest one facing the same way
+				float inverse = 1.0f / triangles.size();
+				float middle[3] = { sum[0] * inverse, sum[1] * inverse, sum[2] * inverse };
+				float normalLength = sqrtf(normalSum[0] * normalSum[0] + normalSum[1] * normalSum[1] + normalSum[2] * normalSum[2]);
+				float facing[3] = { 0, 0, 0 };
+				if (normalLength > 1e-6f)
+				{
+					for (int k = 0; k < 3; k++) facing[k] = normalSum[k] / normalLength;
+				}
+
+				uint32_t best = UINT32_MAX;
+				unsigned int bestExtra = 4;
+				float bestScore = 0;
+				size_t kept = 0;
+				for (size_t c = 0; c < candidates.size(); c++)
+				{
+					uint32_t tri = candidates[c];
+					if (emitted[tri]) continue;
+					candidates[kept++] = tri;
+
+					unsigned int extra = 0;
+					for (int corner = 0; corner < 3; corner++)
+						extra += vertexStamp[mesh.Indices[tri * 3 + corner]] != stamp;
+					if (meshletVertices.size() + extra > MeshletMaxVertices) continue;
+					if (extra > bestExtra) continue;
+
+					float dx = info.CenterX[tri] - middle[0];
+					float dy = info.CenterY[tri] - middle[1];
+					float dz = info.CenterZ[tri] - middle[2];
+					float dot = info.NormalX[tri] * facing[0] + info.NormalY[tri] * facing[1] + info.NormalZ[tri] * facing[2];
+					float score = sqrtf(dx * dx + dy * dy + dz * dz) * (1.0f - NormalWeight * dot);
+					if (extra < bestExtra || score < bestScore)
+					{
+						best = tri;
+						bestExtra = extra;
+						bestScore = score;
+					}
+				}
+				candidates.resize(kept);
+
+				if (best == UINT32_MAX && candidates.empty() && triangles.size() < MinMeshletTriangles)
+				{
+					// Ran out of connected surface while still small - carry
+					// on with the next triangle in cache order if it fits
+					while (cursor < last && emitted[cursor]) cursor++;
+					if (cursor < last)
+					{
+						unsigned int extra = 0;
+						for (int corner = 0; corner < 3; corner++)
+							extra += vertexStamp[mesh.Indices[cursor * 3 + corner]] != stamp;
+						if (meshletVertices.size() + extra <= MeshletMaxVertices)
+							best = cursor;
+					}
+				}
+				if (best == UINT32_MAX) break;
+				next = best;
+			}
+
+			Meshlet meshlet;
+			meshlet.IndexStart = (uint32_t)reordered.size();
+			meshlet.IndexCount = (uint32_t)triangles.size() * 3;
+			ComputeMeshletBounds(mesh, info, triangles, meshletVertices, meshlet);
+			mesh.Meshlets.push_back(meshlet);
+
+			for (uint32_t tri : triangles)
+			{
+				for (int corner = 0; corner < 3; corner++)
+					reordered.push_back(mesh.Indices[tri * 3 + corner]);
+			}
+		}
+	}
+
+	// Submeshes cover LOD 0 in order, and each one's meshlets
+	// went in its own range, so the ranges still line up
+	std::copy(reordered.begin(), reordered.end(), mesh.Indices.begin());
+}
+
+MeshletBounds::MeshletBounds()
+{
+	Count = 0;
+}
+
+void MeshletBounds::Build(const std::vector<Meshlet>& meshlets)
+{
+	Count = meshlets.size();
+	size_t padded = (Count + 3) & ~(size_t)3;
+
+	// Padding is never visible - CullMeshlets ignores lanes past Count
+	CenterX.assign(padded, 0); CenterY.assign(padded, 0); CenterZ.assign(padded, 0);
+	Radius.assign(padded, 0);
+	AxisX.assign(padded, 0); AxisY.assign(padded, 0); AxisZ.assign(padded, 0);
+	Cutoff.assign(padded, 1);
+
+	for (size_t i = 0; i < Count; i++)
+	{
+		const Meshlet& meshlet = meshlets[i];
+		CenterX[i] = meshlet.Center[0];
+		CenterY[i] = meshlet.Center[1];
+		CenterZ[i] = meshlet.Center[2];
+		Radius[i] = meshlet.Radius;
+		AxisX[i] = meshlet.ConeAxis[0];
+		AxisY[i] = meshlet.ConeAxis[1];
+		AxisZ[i] = meshlet.ConeAxis[2];
+		Cutoff[i] = meshlet.ConeCutoff;
+	}
+}
+
+unsigned int CullMeshlets(const std::vector<Meshlet>& meshlets, const MeshletBounds& bounds,
+	const MeshletView& view, unsigned int mergeGap, std::vector<MeshletRange>& out)
+{
+	out.clear();
+	const __m128 cameraX = _mm_set1_ps(view.CameraPosition[0]);
+	const __m128 cameraY = _mm_set1_ps(view.CameraPosition[1]);
+	const __m128 cameraZ = _mm_set1_ps(view.CameraPosition[2]);
+	const __m128 zero = _mm_setzero_ps();
+	uint32_t gapIndices = mergeGap * 3;
+	unsigned int visible = 0;
+
+	for (size_t i = 0; i < bounds.Count; i += 4)
+	{
+		__m128 x = _mm_loadu_ps(&bounds.CenterX[i]);
+		__m128 y = _mm_loadu_ps(&bounds.CenterY[i]);
+		__m128 z = _mm_loadu_ps(&bounds.CenterZ[i]);
+		__m128 radius = _mm_loadu_ps(&bounds.Radius[i]);
+		__m128 negativeRadius = _mm_sub_ps(zero, radius);
+
+		// Inside or touching every plane
+		__m128 inside = _mm_cmpeq_ps(zero, zero);
+		for (int p = 0; p < 6; p++)
+		{
+			const float* plane = view.Planes[p];
+			__m128 distance = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(plane[0])), _mm_mul_ps(y, _mm_set1_ps(plane[1]))),
+				_mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(plane[2])), _mm_set1_ps(plane[3])));
+			inside = _mm_and_ps(inside, _mm_cmpgt_ps(distance, negativeRadius));
+		}
+
+		// Back-facing if the camera is outside the cone widened by
+		// the sphere - true for every point of every triangle
+		__m128 dx = _mm_sub_ps(x, cameraX);
+		__m128 dy = _mm_sub_ps(y, cameraY);
+		__m128 dz = _mm_sub_ps(z, cameraZ);
+		__m128 distance = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+		__m128 along = _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(dx, _mm_loadu_ps(&bounds.AxisX[i])), _mm_mul_ps(dy, _mm_loadu_ps(&bounds.AxisY[i]))),
+			_mm_mul_ps(dz, _mm_loadu_ps(&bounds.AxisZ[i])));
+		__m128 limit = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&bounds.Cutoff[i]), distance), radius);
+		__m128 backFacing = _mm_cmpge_ps(along, limit);
+
+		int mask = _mm_movemask_ps(_mm_andnot_ps(backFacing, inside));
+		for (size_t lane = 0; mask != 0 && lane < 4 && i + lane < bounds.Count; lane++, mask >>= 1)
+		{
+			if (!(mask & 1)) continue;
+			const Meshlet& meshlet = meshlets[i + lane];
+			visible++;
+
+			if (!out.empty())
+			{
+				MeshletRange& previous = out.back();
+				uint32_t end = previous.IndexStart + previous.IndexCount;
+				if (meshlet.IndexStart >= end && meshlet.IndexStart - end <= gapIndices)
+				{
+					previous.IndexCount = meshlet.IndexStart + meshlet.IndexCount - previous.IndexStart;
+					continue;
+				}
+			}
+			MeshletRange range = { meshlet.IndexStart, meshlet.IndexCount };
+			out.push_back(range);
+		}
+	}
+	return visible;
+}
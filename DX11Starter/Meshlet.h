@@ -0,0 +1,65 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "MeshData.h"
+
+// Small enough that a meshlet's bounds stay tight
+static const unsigned int MeshletMaxVertices = 64;
+static const unsigned int MeshletMaxTriangles = 124;
+
+// --------------------------------------------------------
+// Splits LOD 0 of every submesh into meshlets and fills
+// mesh.Meshlets.  Triangles are regrouped so each meshlet is
+// one run of indices; submesh ranges don't change.
+//
+// Meshlets grow greedily through neighbouring triangles,
+// preferring ones that add no new vertices and that face the
+// same way, so the cones stay narrow enough to cull with.
+//
+// Run after OptimizeMesh and before GenerateLods.
+// --------------------------------------------------------
+void BuildMeshlets(MeshData& mesh);
+
+// --------------------------------------------------------
+// Meshlet bounds split into one array per component, padded
+// to a multiple of 4 with entries that are never visible, so
+// CullMeshlets can test four at a time
+// --------------------------------------------------------
+struct MeshletBounds
+{
+	MeshletBounds();
+	void Build(const std::vector<Meshlet>& meshlets);
+
+	size_t Count;	// Real meshlets, before padding
+	std::vector<float> CenterX, CenterY, CenterZ, Radius;
+	std::vector<float> AxisX, AxisY, AxisZ, Cutoff;
+};
+
+// --------------------------------------------------------
+// The camera in the mesh's own space - see Entity::RecordDraw.
+// Planes face inwards and are normalized.
+// --------------------------------------------------------
+struct MeshletView
+{
+	float CameraPosition[3];
+	float Planes[6][4];
+};
+
+struct MeshletRange
+{
+	uint32_t IndexStart;
+	uint32_t IndexCount;
+};
+
+// --------------------------------------------------------
+// Drops meshlets that are outside the frustum or face away
+// from the camera, and returns index ranges covering the rest.
+// Neighbouring survivors merge into one range, as do ones
+// separated by no more than mergeGap culled triangles - a few
+// wasted triangles are cheaper than another draw call.
+//
+// Returns how many meshlets survived
+// --------------------------------------------------------
+unsigned int CullMeshlets(const std::vector<Meshlet>& meshlets, const MeshletBounds& bounds,
+	const MeshletView& view, unsigned int mergeGap, std::vector<MeshletRange>& out);
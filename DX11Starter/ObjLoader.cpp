@@ -0,0 +1,576 @@
+#include "ObjLoader.h"
+#include "JobSystem.h"
+#include "MappedFile.h"
+#include <atomic>
+#include <cmath>
+#include <cstring>
+
+// Chunks smaller than this aren't worth a job of their own
+static const size_t MinChunkSize = 64 * 1024;
+
+// Corners a single face can have
+static const int MaxFaceCorners = 64;
+
+// --------------------------------------------------------
+// One face corner as written in the file, already 0-based.
+// -1 means "not given".
+// --------------------------------------------------------
+struct ObjCorner
+{
+	int Position;
+	int UV;
+	int Normal;
+};
+
+// --------------------------------------------------------
+// A 'g', 'o' or 'usemtl' line, and how many of its chunk's
+// triangles came before it
+// --------------------------------------------------------
+struct ObjGroup
+{
+	unsigned int Triangle;
+	bool Material;
+	std::string Name;
+};
+
+// --------------------------------------------------------
+// A line-aligned slice of the file.  Counts come from the
+// first pass, offsets (where this chunk's output starts) from
+// a prefix sum over the counts.
+// --------------------------------------------------------
+struct ObjChunk
+{
+	const char* Begin;
+	const char* End;
+
+	unsigned int Positions;
+	unsigned int Normals;
+	unsigned int UVs;
+	unsigned int Triangles;
+
+	unsigned int PositionOffset;
+	unsigned int NormalOffset;
+	unsigned int UVOffset;
+	unsigned int TriangleOffset;
+
+	std::vector<ObjGroup> Groups;
+};
+
+// --------------------------------------------------------
+// Everything the parse pass writes into
+// --------------------------------------------------------
+struct ObjArrays
+{
+	std::vector<float> Positions;	// 3 per position
+	std::vector<float> Normals;		// 3 per normal
+	std::vector<float> UVs;			// 2 per UV
+	std::vector<ObjCorner> Corners;	// 3 per triangle
+};
+
+// Exact powers of ten as doubles
+static const double Pow10[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static inline bool IsDigit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+static inline void SkipSpaces(const char*& text, const char* end)
+{
+	while (text < end && (*text == ' ' || *text == '\t'))
+		text++;
+}
+
+static inline const char* FindLineEnd(const char* text, const char* end)
+{
+	while (text < end && *text != '\n')
+		text++;
+	return text;
+}
+
+// --------------------------------------------------------
+// Up to 19 significant digits go into a 64-bit mantissa; any
+// more only shift the exponent.  Mantissa times an exact power
+// of ten (both exact in a double for the usual OBJ precision)
+// then rounds once to float.
+// --------------------------------------------------------
+bool ParseObjFloat(const char*& text, const char* end, float& value)
+{
+	SkipSpaces(text, end);
+	const char* p = text;
+
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+'))
+	{
+		negative = *p == '-';
+		p++;
+	}
+
+	uint64_t mantissa = 0;
+	int digits = 0;
+	int exponent = 0;
+	bool anyDigits = false;
+
+	while (p < end && IsDigit(*p))
+	{
+		if (digits < 19) { mantissa = mantissa * 10 + (*p - '0'); if (mantissa) digits++; }
+		else exponent++;
+		anyDigits = true;
+		p++;
+	}
+	if (p < end && *p == '.')
+	{
+		p++;
+		while (p < end && IsDigit(*p))
+		{
+			if (digits < 19) { mantissa = mantissa * 10 + (*p - '0'); if (mantissa) digits++; exponent--; }
+			anyDigits = true;
+			p++;
+		}
+	}
+	if (!anyDigits) return false;
+
+	if (p < end && (*p == 'e' || *p == 'E'))
+	{
+		const char* e = p + 1;
+		bool negativeExponent = false;
+		if (e < end && (*e == '-' || *e == '+'))
+		{
+			negativeExponent = *e == '-';
+			e++;
+		}
+		if (e < end && IsDigit(*e))
+		{
+			int written = 0;
+			while (e < end && IsDigit(*e))
+			{
+				if (written < 10000) written = written * 10 + (*e - '0');
+				e++;
+			}
+			exponent += negativeExponent ? -written : written;
+			p = e;
+		}
+	}
+
+	double result = (double)mantissa;
+	if (exponent < 0 && exponent >= -22)
+		result /= Pow10[-exponent];
+	else if (exponent > 0 && exponent <= 22)
+		result *= Pow10[exponent];
+	else if (exponent != 0)
+		result *= pow(10.0, exponent);
+
+	value = (float)(negative ? -result : result);
+	text = p;
+	return true;
+}
+
+static bool ParseInt(const char*& text, const char* end, int& value)
+{
+	const char* p = text;
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+'))
+	{
+		negative = *p == '-';
+		p++;
+	}
+	if (p >= end || !IsDigit(*p)) return false;
+
+	int result = 0;
+	while (p < end && IsDigit(*p))
+	{
+		result = result * 10 + (*p - '0');
+		p++;
+	}
+	value = negative ? -result : result;
+	text = p;
+	return true;
+}
+
+// --------------------------------------------------------
+// What kind of line this is.  text is left just past the
+// keyword.
+// --------------------------------------------------------
+enum class ObjLine { Position, Normal, UV, Face, Group, Material, Other };
+
+static ObjLine ClassifyLine(const char*& text, const char* end)
+{
+	SkipSpaces(text, end);
+	if (end - text < 2) return ObjLine::Other;
+
+	char a = text[0];
+	char b = text[1];
+	if (a == 'v')
+	{
+		if (b == ' ' || b == '\t') { text += 1; return ObjLine::Position; }
+		if (end - text >= 3 && (text[2] == ' ' || text[2] == '\t'))
+		{
+			if (b == 'n') { text += 2; return ObjLine::Normal; }
+			if (b == 't') { text += 2; return ObjLine::UV; }
+		}
+	}
+	else if (a == 'f' && (b == ' ' || b == '\t'))
+	{
+		text += 1;
+		return ObjLine::Face;
+	}
+	else if ((a == 'g' || a == 'o') && (b == ' ' || b == '\t'))
+	{
+		text += 1;
+		return ObjLine::Group;
+	}
+	else if (end - text >= 7 && strncmp(text, "usemtl", 6) == 0 && (text[6] == ' ' || text[6] == '\t'))
+	{
+		text += 6;
+		return ObjLine::Material;
+	}
+	return ObjLine::Other;
+}
+
+// Number of corners on a face line (text is just past the 'f')
+static int CountFaceCorners(const char* text, const char* end)
+{
+	int corners = 0;
+	while (true)
+	{
+		SkipSpaces(text, end);
+		if (text >= end || *text == '\r' || *text == '#') break;
+		corners++;
+		while (text < end && *text != ' ' && *text != '\t' && *text != '\r')
+			text++;
+	}
+	return corners;
+}
+
+// Rest of the line, without surrounding whitespace
+static std::string ReadName(const char* text, const char* end)
+{
+	SkipSpaces(text, end);
+	while (end > text && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r'))
+		end--;
+	return std::string(text, end);
+}
+
+// --------------------------------------------------------
+// First pass - counts, and notes where groups start
+// --------------------------------------------------------
+static void CountChunk(ObjChunk& chunk)
+{
+	chunk.Positions = chunk.Normals = chunk.UVs = chunk.Triangles = 0;
+	chunk.Groups.clear();
+
+	const char* line = chunk.Begin;
+	while (line < chunk.End)
+	{
+		const char* lineEnd = FindLineEnd(line, chunk.End);
+		const char* text = line;
+		ObjLine type = ClassifyLine(text, lineEnd);
+		switch (type)
+		{
+		case ObjLine::Position: chunk.Positions++; break;
+		case ObjLine::Normal: chunk.Normals++; break;
+		case ObjLine::UV: chunk.UVs++; break;
+		case ObjLine::Face:
+		{
+			int corners = CountFaceCorners(text, lineEnd);
+			if (corners >= 3) chunk.Triangles += corners - 2;
+			break;
+		}
+		case ObjLine::Group:
+		case ObjLine::Material:
+		{
+			ObjGroup group;
+			group.Triangle = chunk.Triangles;
+			group.Material = type == ObjLine::Material;
+			group.Name = ReadName(text, lineEnd);
+			chunk.Groups.push_back(group);
+			break;
+		}
+		default: break;
+		}
+		line = lineEnd + 1;
+	}
+}
+
+// Turns a 1-based (or negative, relative) OBJ index into 0-based
+static inline int ResolveIndex(int index, unsigned int definedSoFar)
+{
+	if (index > 0) return index - 1;
+	if (index < 0) return (int)definedSoFar + index;
+	return -1;
+}
+
+// --------------------------------------------------------
+// Second pass - parses into the arrays at this chunk's offsets
+// --------------------------------------------------------
+static bool ParseChunk(const ObjChunk& chunk, ObjArrays& arrays)
+{
+	float* positions = arrays.Positions.data() + chunk.PositionOffset * 3;
+	float* normals = arrays.Normals.data() + chunk.NormalOffset * 3;
+	float* uvs = arrays.UVs.data() + chunk.UVOffset * 2;
+	ObjCorner* corners = arrays.Corners.data() + chunk.TriangleOffset * 3;
+
+	// Defined before the current line, for relative indices
+	unsigned int positionCount = chunk.PositionOffset;
+	unsigned int normalCount = chunk.NormalOffset;
+	unsigned int uvCount = chunk.UVOffset;
+
+	ObjCorner face[MaxFaceCorners];
+
+	const char* line = chunk.Begin;
+	while (line < chunk.End)
+	{
+		const char* lineEnd = FindLineEnd(line, chunk.End);
+		const char* text = line;
+		switch (ClassifyLine(text, lineEnd))
+		{
+		case ObjLine::Position:
+			if (!ParseObjFloat(text, lineEnd, positions[0]) ||
+				!ParseObjFloat(text, lineEnd, positions[1]) ||
+				!ParseObjFloat(text, lineEnd, positions[2]))
+				return false;
+			positions += 3;
+			positionCount++;
+			break;
+
+		case ObjLine::Normal:
+			if (!ParseObjFloat(text, lineEnd, normals[0]) ||
+				!ParseObjFloat(text, lineEnd, normals[1]) ||
+				!ParseObjFloat(text, lineEnd, normals[2]))
+				return false;
+			normals += 3;
+			normalCount++;
+			break;
+
+		case ObjLine::UV:
+			// A third (w) coordinate is allowed and ignored
+			if (!ParseObjFloat(text, lineEnd, uvs[0]) ||
+				!ParseObjFloat(text, lineEnd, uvs[1]))
+				return false;
+			uvs += 2;
+			uvCount++;
+			break;
+
+		case ObjLine::Face:
+		{
+			int count = 0;
+			while (true)
+			{
+				SkipSpaces(text, lineEnd);
+				if (text >= lineEnd || *text == '\r' || *text == '#') break;
+				if (count == MaxFaceCorners) return false;
+
+				ObjCorner& corner = face[count++];
+				int value;
+				if (!ParseInt(text, lineEnd, value)) return false;
+				corner.Position = ResolveIndex(value, positionCount);
+				corner.UV = -1;
+				corner.Normal = -1;
+
+				if (text < lineEnd && *text == '/')
+				{
+					text++;
+					if (ParseInt(text, lineEnd, value))
+						corner.UV = ResolveIndex(value, uvCount);
+					if (text < lineEnd && *text == '/')
+					{
+						text++;
+						if (ParseInt(text, lineEnd, value))
+							corner.Normal = ResolveIndex(value, normalCount);
+					}
+				}
+			}
+
+			// Fan out from the first corner
+			for (int i = 1; i + 1 < count; i++)
+			{
+				corners[0] = face[0];
+				corners[1] = face[i];
+				corners[2] = face[i + 1];
+				corners += 3;
+			}
+			break;
+		}
+		default: break;
+		}
+		line = lineEnd + 1;
+	}
+	return true;
+}
+
+// Runs body(i) for i in [0, count), in parallel if we can
+static void ForEach(JobSystem* jobs, unsigned int count, const std::function<void(unsigned int)>& body)
+{
+	if (!jobs || count <= 1)
+	{
+		for (unsigned int i = 0; i < count; i++) body(i);
+		return;
+	}
+	jobs->ParallelFor(count, 1, [&](unsigned int begin, unsigned int end) {
+		for (unsigned int i = begin; i < end; i++) body(i);
+	});
+}
+
+bool ParseObj(const char* text, size_t size, MeshData& out, JobSystem* jobs)
+{
+	out.Vertices.clear();
+	out.Indices.clear();
+	out.Submeshes.clear();
+
+	// Cut into chunks that end just after a newline
+	size_t chunkTarget = size;
+	if (jobs)
+	{
+		size_t wanted = jobs->GetThreadCount() * 4;
+		chunkTarget = size / wanted;
+		if (chunkTarget < MinChunkSize) chunkTarget = MinChunkSize;
+	}
+
+	std::vector<ObjChunk> chunks;
+	const char* end = text + size;
+	const char* begin = text;
+	while (begin < end)
+	{
+		const char* split = (size_t)(end - begin) > chunkTarget ? begin + chunkTarget : end;
+		split = split < end ? FindLineEnd(split, end) + 1 : end;
+		if (split > end) split = end;
+
+		ObjChunk chunk = {};
+		chunk.Begin = begin;
+		chunk.End = split;
+		chunks.push_back(chunk);
+		begin = split;
+	}
+
+	// Pass 1 - count, then prefix sum into offsets
+	ForEach(jobs, (unsigned int)chunks.size(), [&](unsigned int c) {
+		CountChunk(chunks[c]);
+	});
+
+	unsigned int positions = 0, normals = 0, uvs = 0, triangles = 0;
+	for (ObjChunk& chunk : chunks)
+	{
+		chunk.PositionOffset = positions;
+		chunk.NormalOffset = normals;
+		chunk.UVOffset = uvs;
+		chunk.TriangleOffset = triangles;
+		positions += chunk.Positions;
+		normals += chunk.Normals;
+		uvs += chunk.UVs;
+		triangles += chunk.Triangles;
+	}
+
+	// Every group or material change starts a new submesh.  Changes
+	// with no triangles in between just rename the one coming up.
+	MeshSubmesh submesh = {};
+	for (const ObjChunk& chunk : chunks)
+	{
+		for (const ObjGroup& group : chunk.Groups)
+		{
+			uint32_t start = (chunk.TriangleOffset + group.Triangle) * 3;
+			if (start > submesh.IndexStart)
+			{
+				submesh.IndexCount = start - submesh.IndexStart;
+				out.Submeshes.push_back(submesh);
+				submesh.IndexStart = start;
+			}
+			if (group.Material) submesh.Material = group.Name;
+			else submesh.Name = group.Name;
+		}
+	}
+	submesh.IndexCount = triangles * 3 - submesh.IndexStart;
+	if (submesh.IndexCount > 0 || out.Submeshes.empty())
+		out.Submeshes.push_back(submesh);
+
+	ObjArrays arrays;
+	arrays.Positions.resize(positions * 3);
+	arrays.Normals.resize(normals * 3);
+	arrays.UVs.resize(uvs * 2);
+	arrays.Corners.resize(triangles * 3);
+
+	// Pass 2 - parse in place
+	std::atomic<bool> failed(false);
+	ForEach(jobs, (unsigned int)chunks.size(), [&](unsigned int c) {
+		if (!ParseChunk(chunks[c], arrays))
+			failed = true;
+	});
+	if (failed)
+	{
+		out.Submeshes.clear();
+		return false;
+	}
+
+	// Build the vertices.  Winding is reversed (0, 2, 1) along
+	// with the Z flip, to go from right to left handed.
+	out.Vertices.resize(triangles * 3);
+	out.Indices.resize(triangles * 3);
+	unsigned int trianglesPerJob = 4096;
+	unsigned int jobCount = (triangles + trianglesPerJob - 1) / trianglesPerJob;
+	ForEach(jobs, jobCount, [&](unsigned int job) {
+		unsigned int first = job * trianglesPerJob;
+		unsigned int last = first + trianglesPerJob < triangles ? first + trianglesPerJob : triangles;
+		static const int order[3] = { 0, 2, 1 };
+		for (unsigned int t = first; t < last; t++)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				const ObjCorner& corner = arrays.Corners[t * 3 + order[k]];
+				MeshVertex& v = out.Vertices[t * 3 + k];
+
+				if (corner.Position < 0 || corner.Position >= (int)positions)
+				{
+					failed = true;
+					continue;
+				}
+				const float* p = &arrays.Positions[corner.Position * 3];
+				v.Position[0] = p[0];
+				v.Position[1] = p[1];
+				v.Position[2] = -p[2];
+
+				if (corner.Normal >= 0 && corner.Normal < (int)normals)
+				{
+					const float* n = &arrays.Normals[corner.Normal * 3];
+					v.Normal[0] = n[0];
+					v.Normal[1] = n[1];
+					v.Normal[2] = -n[2];
+				}
+				else
+				{
+					v.Normal[0] = v.Normal[1] = v.Normal[2] = 0;
+				}
+
+				if (corner.UV >= 0 && corner.UV < (int)uvs)
+				{
+					const float* uv = &arrays.UVs[corner.UV * 2];
+					v.UV[0] = uv[0];
+					v.UV[1] = 1.0f - uv[1];
+				}
+				else
+				{
+					v.UV[0] = v.UV[1] = 0;
+				}
+
+				out.Indices[t * 3 + k] = t * 3 + k;
+			}
+		}
+	});
+
+	if (failed)
+	{
+		out.Vertices.clear();
+		out.Indices.clear();
+		out.Submeshes.clear();
+		return false;
+	}
+	return true;
+}
+
+bool LoadObj(const char* path, MeshData& out, JobSystem* jobs)
+{
+	MappedFile file;
+	if (!file.Open(path)) return false;
+	return ParseObj(file.GetData(), file.GetSize(), out, jobs);
+}
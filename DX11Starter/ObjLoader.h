@@ -0,0 +1,35 @@
+#pragma once
+#include <cstddef>
+#include "MeshData.h"
+
+class JobSystem;
+
+// --------------------------------------------------------
+// Wavefront OBJ loading.
+//
+// The file is memory mapped and cut into line-aligned chunks.
+// A first pass counts each chunk's positions, normals, UVs and
+// triangles, so every array is sized exactly once and every
+// chunk knows where its output starts; a second pass parses the
+// chunks straight into place.  With a JobSystem both passes run
+// in parallel.
+//
+// Output is converted for DirectX the same way the old loader
+// did it: Z and normal Z negated, V flipped, winding reversed.
+// Polygons are fanned into triangles.  Faces may use v, v/t,
+// v//n or v/t/n, and negative (relative) indices.
+//
+// 'g', 'o' and 'usemtl' lines split the triangles into submeshes,
+// in file order.  A file with none of them is one submesh.
+// --------------------------------------------------------
+
+// Returns false if the file can't be read or is malformed
+bool LoadObj(const char* path, MeshData& out, JobSystem* jobs = nullptr);
+
+// Same, from text already in memory
+bool ParseObj(const char* text, size_t size, MeshData& out, JobSystem* jobs = nullptr);
+
+// The number parser LoadObj uses.  Reads an optionally signed
+// decimal (with optional fraction and exponent) after any
+// spaces or tabs, and advances text past it.
+bool ParseObjFloat(const char*& text, const char* end, float& value);
@@ -1,14 +1,24 @@
 #pragma once
-#include <DirectXMath.h>
+#include <cstdint>
 
+// --------------------------------------------------------
+// One particle as the vertex shader sees it - 32 bytes.
+//
+// Halves are IEEE half floats, colors are RGBA8 (red in the
+// lowest byte).  TypeAndSpawnTime holds the type in the top
+// bit and the spawn time in milliseconds, modulo 32768, in
+// the rest; the shader works out the age from that, so the
+// vertex never changes after it's written.  Ages wrap after
+// ~32 seconds, which is fine as long as the lifetime is
+// shorter and only live particles are drawn.
+// --------------------------------------------------------
 struct Particle
 {
-	int Type = 1;
-	float Age = 0;
-	DirectX::XMFLOAT3 StartPosition;
-	DirectX::XMFLOAT3 StartVelocity;
-	DirectX::XMFLOAT4 StartColor;
-	DirectX::XMFLOAT4 MidColor;
-	DirectX::XMFLOAT4 EndColor;
-	DirectX::XMFLOAT3 StartMidEndSizes;
-};
\ No newline at end of file
+	uint16_t PositionStartSize[4];	// Half x, y, z, start size
+	uint16_t VelocityMidSize[4];	// Half x, y, z, mid size
+	uint16_t EndSize;				// Half
+	uint16_t TypeAndSpawnTime;		// Type << 15 | spawn ms & 0x7FFF
+	uint32_t Colors[3];				// Start, mid, end
+};
+
+static_assert(sizeof(Particle) == 32, "Particle must match ParticleVS's input layout");
@@ -0,0 +1,60 @@
+#include "ParticleBudget.h"
+#include "ParticleEmitter.h"
+#include <algorithm>
+
+ParticleBudget::ParticleBudget(unsigned int capacity)
+{
+	this->capacity = capacity;
+	used = 0;
+	stolen = 0;
+}
+
+void ParticleBudget::Register(Emitter* emitter)
+{
+	emitters.push_back(emitter);
+}
+
+void ParticleBudget::Unregister(Emitter* emitter)
+{
+	emitters.erase(std::remove(emitters.begin(), emitters.end(), emitter), emitters.end());
+}
+
+// --------------------------------------------------------
+// Grants whatever is free.  If that's not enough and the
+// requester has priority, the lowest priority emitters are
+// asked to give up their oldest particles first.
+// --------------------------------------------------------
+unsigned int ParticleBudget::Acquire(Emitter* requester, unsigned int count)
+{
+	unsigned int free = used < capacity ? capacity - used : 0;
+	unsigned int granted = std::min(count, free);
+	used += granted;
+
+	const EmitterSettings& settings = requester->GetSettings();
+	if (granted == count || settings.Overflow != ParticleOverflow::Priority)
+		return granted;
+
+	std::vector<Emitter*> victims;
+	for (Emitter* emitter : emitters)
+		if (emitter->GetSettings().Priority < settings.Priority)
+			victims.push_back(emitter);
+	std::stable_sort(victims.begin(), victims.end(), [](Emitter* a, Emitter* b) {
+		return a->GetSettings().Priority < b->GetSettings().Priority;
+	});
+
+	for (Emitter* victim : victims)
+	{
+		// Yield() releases what it frees back to us
+		unsigned int taken = victim->Yield(count - granted);
+		used += taken;
+		granted += taken;
+		stolen += taken;
+		if (granted == count) break;
+	}
+	return granted;
+}
+
+void ParticleBudget::Release(unsigned int count)
+{
+	used -= std::min(count, used);
+}
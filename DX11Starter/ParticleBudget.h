@@ -0,0 +1,43 @@
+#pragma once
+#include <vector>
+
+class Emitter;
+
+// --------------------------------------------------------
+// One pool of particle slots shared by every emitter.  Each
+// emitter has its own ring, but the number of particles alive
+// across all of them can't exceed the budget.
+//
+// Emitters acquire slots when they spawn and release them when
+// particles die.  An emitter with the Priority overflow policy
+// can take slots back from lower priority emitters, which give
+// up their oldest particles.
+//
+// Not thread safe - emitters are updated and spawned into from
+// one job at a time.
+// --------------------------------------------------------
+class ParticleBudget
+{
+public:
+	ParticleBudget(unsigned int capacity);
+
+	void Register(Emitter* emitter);
+	void Unregister(Emitter* emitter);
+
+	// Returns how many of the requested slots were granted
+	unsigned int Acquire(Emitter* requester, unsigned int count);
+	void Release(unsigned int count);
+
+	void SetCapacity(unsigned int capacity) { this->capacity = capacity; }
+	unsigned int GetCapacity() const { return capacity; }
+	unsigned int GetUsed() const { return used; }
+
+	// Slots taken from lower priority emitters, ever
+	unsigned int GetStolenCount() const { return stolen; }
+
+private:
+	unsigned int capacity;
+	unsigned int used;
+	unsigned int stolen;
+	std::vector<Emitter*> emitters;
+};
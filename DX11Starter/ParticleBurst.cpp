@@ -0,0 +1,265 @@
+#include "ParticleBurst.h"
+#include <cmath>
+#include <emmintrin.h>
+
+// Random numbers are drawn in chunks this big (a multiple of 4)
+static const unsigned int ChunkSize = 64;
+static const float Pi = 3.14159265359f;
+
+ParticleShape ParticlePoint(float x, float y, float z)
+{
+	ParticleShape shape = {};
+	shape.Type = ParticleShapeType::Point;
+	shape.Center[0] = x; shape.Center[1] = y; shape.Center[2] = z;
+	return shape;
+}
+
+ParticleShape ParticleBox(float x, float y, float z, float halfX, float halfY, float halfZ)
+{
+	ParticleShape shape = ParticlePoint(x, y, z);
+	shape.Type = ParticleShapeType::Box;
+	shape.Extents[0] = halfX; shape.Extents[1] = halfY; shape.Extents[2] = halfZ;
+	return shape;
+}
+
+ParticleShape ParticleSphere(float x, float y, float z, float radius)
+{
+	ParticleShape shape = ParticlePoint(x, y, z);
+	shape.Type = ParticleShapeType::Sphere;
+	shape.Extents[0] = radius;
+	return shape;
+}
+
+ParticleShape ParticleCone(float axisX, float axisY, float axisZ, float halfAngle, float minLength, float maxLength)
+{
+	ParticleShape shape = ParticlePoint(axisX, axisY, axisZ);
+	shape.Type = ParticleShapeType::Cone;
+	shape.ConeAngle = halfAngle;
+	shape.MinLength = minLength;
+	shape.MaxLength = maxLength;
+	return shape;
+}
+
+// --------------------------------------------------------
+// Builds two unit vectors perpendicular to the (normalized)
+// axis, so cone samples can be rotated around it
+// --------------------------------------------------------
+static void BuildBasis(const float axis[3], float tangent[3], float bitangent[3])
+{
+	// Cross with whichever world axis is least parallel
+	float other[3] = { 0, 0, 0 };
+	if (fabsf(axis[0]) < 0.9f) other[0] = 1; else other[1] = 1;
+
+	tangent[0] = axis[1] * other[2] - axis[2] * other[1];
+	tangent[1] = axis[2] * other[0] - axis[0] * other[2];
+	tangent[2] = axis[0] * other[1] - axis[1] * other[0];
+	float length = sqrtf(tangent[0] * tangent[0] + tangent[1] * tangent[1] + tangent[2] * tangent[2]);
+	for (int i = 0; i < 3; i++) tangent[i] /= length;
+
+	bitangent[0] = axis[1] * tangent[2] - axis[2] * tangent[1];
+	bitangent[1] = axis[2] * tangent[0] - axis[0] * tangent[2];
+	bitangent[2] = axis[0] * tangent[1] - axis[1] * tangent[0];
+}
+
+// --------------------------------------------------------
+// sin and cos of 2 pi u for four uniforms u in [0, 1).  Shifted
+// to x in [-pi, pi), folded into [0, pi / 2] and run through the
+// Taylor series to x^11 and x^12 (error under 1e-7 there), then
+// given back the signs of their quadrant.
+// --------------------------------------------------------
+static inline void SinCosTwoPi4(__m128 u, __m128& sinOut, __m128& cosOut)
+{
+	const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32((int)0x80000000u));
+	const __m128 halfPi = _mm_set1_ps(Pi * 0.5f);
+
+	// sin(2 pi u) = -sin(x) and cos(2 pi u) = -cos(x)
+	__m128 x = _mm_mul_ps(_mm_sub_ps(u, _mm_set1_ps(0.5f)), _mm_set1_ps(Pi * 2.0f));
+	__m128 sign = _mm_and_ps(x, signMask);
+	__m128 absolute = _mm_xor_ps(x, sign);
+
+	// sin(pi - x) = sin(x), so everything lands in [0, pi / 2]
+	__m128 folded = _mm_cmpgt_ps(absolute, halfPi);
+	__m128 r = _mm_or_ps(_mm_and_ps(folded, _mm_sub_ps(_mm_set1_ps(Pi), absolute)), _mm_andnot_ps(folded, absolute));
+
+	__m128 r2 = _mm_mul_ps(r, r);
+	__m128 poly = _mm_set1_ps(-1.0f / 39916800.0f);
+	poly = _mm_add_ps(_mm_mul_ps(poly, r2), _mm_set1_ps(1.0f / 362880.0f));
+	poly = _mm_add_ps(_mm_mul_ps(poly, r2), _mm_set1_ps(-1.0f / 5040.0f));
+	poly = _mm_add_ps(_mm_mul_ps(poly, r2), _mm_set1_ps(1.0f / 120.0f));
+	poly = _mm_add_ps(_mm_mul_ps(poly, r2), _mm_set1_ps(-1.0f / 6.0f));
+	poly = _mm_add_ps(_mm_mul_ps(poly, r2), _mm_set1_ps(1.0f));
+	__m128 s = _mm_mul_ps(poly, r);
+
+	poly = _mm_set1_ps(1.0f / 479001600.0f);
+	poly = _mm_add_ps(_mm_mul_ps(poly, r2), _mm_set1_ps(-1.0f / 3628800.0f));
+	poly = _mm_add_ps(_mm_mul_ps(poly, r2), _mm_set1_ps(1.0f / 40320.0f));
+	poly = _mm_add_ps(_mm_mul_ps(poly, r2), _mm_set1_ps(-1.0f / 720.0f));
+	poly = _mm_add_ps(_mm_mul_ps(poly, r2), _mm_set1_ps(1.0f / 24.0f));
+	poly = _mm_add_ps(_mm_mul_ps(poly, r2), _mm_set1_ps(-0.5f));
+	__m128 c = _mm_add_ps(_mm_mul_ps(poly, r2), _mm_set1_ps(1.0f));
+
+	// Flip both signs for the -sin(x), -cos(x) above.  Cos is
+	// positive outside the fold, so negative there once flipped.
+	sinOut = _mm_xor_ps(s, _mm_xor_ps(sign, signMask));
+	cosOut = _mm_xor_ps(c, _mm_andnot_ps(folded, signMask));
+}
+
+// --------------------------------------------------------
+// Cube roots of four values in [0, 1).  The classic "divide the
+// exponent by three" bit trick gets close, and two Newton steps
+// finish it off (relative error around 1e-7).
+// --------------------------------------------------------
+static inline __m128 Cbrt4(__m128 v)
+{
+	// Bits / 3 through float, since SSE2 has no integer divide
+	__m128i bits = _mm_castps_si128(v);
+	__m128 third = _mm_mul_ps(_mm_cvtepi32_ps(bits), _mm_set1_ps(1.0f / 3.0f));
+	__m128 y = _mm_castsi128_ps(_mm_add_epi32(_mm_cvttps_epi32(third), _mm_set1_epi32(709921077)));
+
+	// y = (2y + v / y^2) / 3
+	for (int i = 0; i < 2; i++)
+	{
+		__m128 y2 = _mm_mul_ps(y, y);
+		y = _mm_mul_ps(_mm_add_ps(_mm_add_ps(y, y), _mm_div_ps(v, y2)), _mm_set1_ps(1.0f / 3.0f));
+	}
+	return y;
+}
+
+// Writes four results, or fewer at the end of a chunk
+static inline void Store4(float* px, float* py, float* pz, unsigned int i, unsigned int n, __m128 x, __m128 y, __m128 z)
+{
+	if (n - i >= 4)
+	{
+		_mm_storeu_ps(px + i, x);
+		_mm_storeu_ps(py + i, y);
+		_mm_storeu_ps(pz + i, z);
+		return;
+	}
+
+	float lanes[3][4];
+	_mm_storeu_ps(lanes[0], x);
+	_mm_storeu_ps(lanes[1], y);
+	_mm_storeu_ps(lanes[2], z);
+	for (unsigned int j = 0; i + j < n; j++)
+	{
+		px[i + j] = lanes[0][j];
+		py[i + j] = lanes[1][j];
+		pz[i + j] = lanes[2][j];
+	}
+}
+
+void SampleParticleShape(const ParticleShape& shape, ParticleRandom& random, float* x, float* y, float* z, unsigned int count)
+{
+	const float* c = shape.Center;
+	const float* e = shape.Extents;
+
+	if (shape.Type == ParticleShapeType::Point)
+	{
+		for (unsigned int i = 0; i < count; i++)
+		{
+			x[i] = c[0];
+			y[i] = c[1];
+			z[i] = c[2];
+		}
+		return;
+	}
+
+	// Every shape needs three uniforms per vector
+	float u0[ChunkSize], u1[ChunkSize], u2[ChunkSize];
+
+	float axis[3] = { c[0], c[1], c[2] };
+	float tangent[3] = { 0, 0, 0 };
+	float bitangent[3] = { 0, 0, 0 };
+	if (shape.Type == ParticleShapeType::Cone)
+		BuildBasis(axis, tangent, bitangent);
+	float minCos = cosf(shape.ConeAngle);
+
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 two = _mm_set1_ps(2.0f);
+	const __m128 cx = _mm_set1_ps(c[0]), cy = _mm_set1_ps(c[1]), cz = _mm_set1_ps(c[2]);
+
+	for (unsigned int start = 0; start < count; start += ChunkSize)
+	{
+		// Whole lanes of uniforms - Fill steps all four lanes even
+		// for a partial group, so this draws the same stream
+		unsigned int n = count - start < ChunkSize ? count - start : ChunkSize;
+		unsigned int lanes = (n + 3) & ~3u;
+		random.Fill(u0, lanes);
+		random.Fill(u1, lanes);
+		random.Fill(u2, lanes);
+
+		float* px = x + start;
+		float* py = y + start;
+		float* pz = z + start;
+
+		switch (shape.Type)
+		{
+		case ParticleShapeType::Box:
+		{
+			const __m128 ex = _mm_set1_ps(e[0]), ey = _mm_set1_ps(e[1]), ez = _mm_set1_ps(e[2]);
+			for (unsigned int i = 0; i < n; i += 4)
+			{
+				__m128 vx = _mm_add_ps(cx, _mm_mul_ps(ex, _mm_sub_ps(_mm_mul_ps(_mm_loadu_ps(u0 + i), two), one)));
+				__m128 vy = _mm_add_ps(cy, _mm_mul_ps(ey, _mm_sub_ps(_mm_mul_ps(_mm_loadu_ps(u1 + i), two), one)));
+				__m128 vz = _mm_add_ps(cz, _mm_mul_ps(ez, _mm_sub_ps(_mm_mul_ps(_mm_loadu_ps(u2 + i), two), one)));
+				Store4(px, py, pz, i, n, vx, vy, vz);
+			}
+			break;
+		}
+
+		case ParticleShapeType::Sphere:
+		{
+			// Uniform direction from (cos theta, phi), cube root on
+			// the radius so the ball fills evenly instead of bunching
+			// up in the middle
+			const __m128 radius = _mm_set1_ps(e[0]);
+			for (unsigned int i = 0; i < n; i += 4)
+			{
+				__m128 cosTheta = _mm_sub_ps(_mm_mul_ps(_mm_loadu_ps(u0 + i), two), one);
+				__m128 sinTheta = _mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(one, _mm_mul_ps(cosTheta, cosTheta)), _mm_setzero_ps()));
+				__m128 sinPhi, cosPhi;
+				SinCosTwoPi4(_mm_loadu_ps(u1 + i), sinPhi, cosPhi);
+				__m128 r = _mm_mul_ps(radius, Cbrt4(_mm_loadu_ps(u2 + i)));
+				__m128 rSin = _mm_mul_ps(r, sinTheta);
+
+				__m128 vx = _mm_add_ps(cx, _mm_mul_ps(rSin, cosPhi));
+				__m128 vy = _mm_add_ps(cy, _mm_mul_ps(rSin, sinPhi));
+				__m128 vz = _mm_add_ps(cz, _mm_mul_ps(r, cosTheta));
+				Store4(px, py, pz, i, n, vx, vy, vz);
+			}
+			break;
+		}
+
+		case ParticleShapeType::Cone:
+		{
+			// Cos theta uniform between the cone edge and the axis
+			const __m128 edge = _mm_set1_ps(minCos);
+			const __m128 spread = _mm_set1_ps(1.0f - minCos);
+			const __m128 minLength = _mm_set1_ps(shape.MinLength);
+			const __m128 lengthRange = _mm_set1_ps(shape.MaxLength - shape.MinLength);
+			for (unsigned int i = 0; i < n; i += 4)
+			{
+				__m128 cosTheta = _mm_add_ps(edge, _mm_mul_ps(spread, _mm_loadu_ps(u0 + i)));
+				__m128 sinTheta = _mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(one, _mm_mul_ps(cosTheta, cosTheta)), _mm_setzero_ps()));
+				__m128 sinPhi, cosPhi;
+				SinCosTwoPi4(_mm_loadu_ps(u1 + i), sinPhi, cosPhi);
+				__m128 length = _mm_add_ps(minLength, _mm_mul_ps(lengthRange, _mm_loadu_ps(u2 + i)));
+
+				__m128 a = _mm_mul_ps(length, cosTheta);
+				__m128 side = _mm_mul_ps(length, sinTheta);
+				__m128 t = _mm_mul_ps(side, cosPhi);
+				__m128 b = _mm_mul_ps(side, sinPhi);
+
+				__m128 vx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(axis[0]), a), _mm_mul_ps(_mm_set1_ps(tangent[0]), t)), _mm_mul_ps(_mm_set1_ps(bitangent[0]), b));
+				__m128 vy = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(axis[1]), a), _mm_mul_ps(_mm_set1_ps(tangent[1]), t)), _mm_mul_ps(_mm_set1_ps(bitangent[1]), b));
+				__m128 vz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(axis[2]), a), _mm_mul_ps(_mm_set1_ps(tangent[2]), t)), _mm_mul_ps(_mm_set1_ps(bitangent[2]), b));
+				Store4(px, py, pz, i, n, vx, vy, vz);
+			}
+			break;
+		}
+
+		default:
+			break;
+		}
+	}
+}
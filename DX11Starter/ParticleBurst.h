@@ -0,0 +1,54 @@
+#pragma once
+#include "ParticleRandom.h"
+
+// --------------------------------------------------------
+// Shapes random vectors (positions or velocities) are
+// picked from
+// --------------------------------------------------------
+enum class ParticleShapeType
+{
+	Point,		// Always Center
+	Box,		// Center +/- Extents on each axis
+	Sphere,		// Anywhere inside a ball of radius Extents[0]
+	Cone		// Within ConeAngle of the Center direction, length between MinLength and MaxLength
+};
+
+struct ParticleShape
+{
+	ParticleShapeType Type;
+	float Center[3];	// Cone: the axis (normalized)
+	float Extents[3];
+	float ConeAngle;	// Half angle, radians
+	float MinLength;
+	float MaxLength;
+};
+
+// --------------------------------------------------------
+// Everything needed to spawn a group of particles at once.
+// Colors and sizes follow the usual start/mid/end ramp.
+// --------------------------------------------------------
+struct ParticleBurstDesc
+{
+	unsigned int Count;
+	ParticleShape Position;
+	ParticleShape Velocity;
+	float StartColor[4];
+	float MidColor[4];
+	float EndColor[4];
+	float Sizes[3];		// Start, mid, end
+	int Type;
+};
+
+// Handy shape constructors
+ParticleShape ParticlePoint(float x, float y, float z);
+ParticleShape ParticleBox(float x, float y, float z, float halfX, float halfY, float halfZ);
+ParticleShape ParticleSphere(float x, float y, float z, float radius);
+ParticleShape ParticleCone(float axisX, float axisY, float axisZ, float halfAngle, float minLength, float maxLength);
+
+// --------------------------------------------------------
+// Fills x/y/z[0 .. count) with vectors from the shape.  Random
+// numbers come out of the generator four at a time and each
+// shape is sampled four vectors per SSE step, with polynomial
+// sin/cos and cube root standing in for the CRT ones.
+// --------------------------------------------------------
+void SampleParticleShape(const ParticleShape& shape, ParticleRandom& random, float* x, float* y, float* z, unsigned int count);
@@ -1,5 +1,17 @@
 #include "ParticleEmitter.h"
-#include <stdlib.h>     /* srand, rand */
+
+// Each emitter gets a different (but repeatable) random stream
+static uint64_t nextEmitterSeed = 1;
+
+EmitterSettings::EmitterSettings()
+{
+	Capacity = 10000;
+	Lifetime = 5;
+	Overflow = ParticleOverflow::DropNew;
+	Priority = 0;
+	SortByDepth = false;
+	LodWeight = 1;
+}
 
 Emitter::Emitter(
 	ID3D11Device* device,
@@ -9,9 +21,18 @@ Emitter::Emitter(
 	ID3D11ShaderResourceView* texture,
 	ID3D11SamplerState* sampler,
 	ID3D11BlendState* particleBlendState,
-	ID3D11DepthStencilState* particleDepthState
+	ID3D11DepthStencilState* particleDepthState,
+	ParticleBudget* budget,
+	const EmitterSettings& settings
 ) {
-	maxParticles = 10000;
+	this->settings = settings;
+	maxParticles = settings.Capacity;
+	lifetime = settings.Lifetime;
+	memset(&stats, 0, sizeof(stats));
+	lod.SpawnScale = 1;
+	lod.SizeScale = 1;
+	lod.LifetimeScale = 1;
+	random.Seed(nextEmitterSeed++);
 
 	// emitter properties
 	spawnPos = XMFLOAT3(0, 1, 0);
@@ -30,19 +51,9 @@ Emitter::Emitter(
 	this->particleBlendState = particleBlendState;
 	this->particleDepthState = particleDepthState;
 
-	// fill particles array
-	particles = new Particle[maxParticles]();
-	for (int i = 0; i < maxParticles; i++) {
-		particles[i] = Particle();
-		// set default properties
-		InitializeParticle(i, spawnPos, velocity, colorTint, colorTint, colorTint, XMFLOAT3(1,1,1));
-		//InitializeParticle(i, spawnPos, DirectX::XMFLOAT3((rand() % 10000)*0.0001, i/100.0, (rand()%10000)*0.0001));
-		// start with no particles alive
-		particles[i].Age = lifetime + 1;
-	}
-	for (int i = 0; i < maxParticles; i++) {
-		particles[i].Age = lifetime + 1;
-	}
+	// fill particles array - every particle starts out dead
+	particles = new ParticleStore(maxParticles, lifetime);
+
 	// initialize DYNAMIC buffer for particles
 	vbd.Usage = D3D11_USAGE_DYNAMIC;
 	vbd.ByteWidth = sizeof(Particle) * maxParticles;
@@ -51,14 +62,40 @@ Emitter::Emitter(
 	vbd.MiscFlags = 0;
 	vbd.StructureByteStride = 0;
 
-	D3D11_SUBRESOURCE_DATA initialParticleData;
-	initialParticleData.pSysMem = particles;
+	// Start the buffer off with every particle dead.  After this
+	// only freshly spawned ranges are ever written.
+	std::vector<Particle> initialParticles(maxParticles);
+	WriteVertices(initialParticles.data(), 0, maxParticles);
 
+	D3D11_SUBRESOURCE_DATA initialParticleData = {};
+	initialParticleData.pSysMem = initialParticles.data();
 	device->CreateBuffer(&vbd, &initialParticleData, &particleBuffer);
+
+	// sorted emitters draw through an index buffer rewritten every frame
+	if (settings.SortByDepth) {
+		D3D11_BUFFER_DESC ibd = {};
+		ibd.Usage = D3D11_USAGE_DYNAMIC;
+		ibd.ByteWidth = sizeof(uint32_t) * maxParticles;
+		ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
+		ibd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		device->CreateBuffer(&ibd, 0, &sortedIndexBuffer);
+	}
+
+	this->budget = budget;
+	if (budget) budget->Register(this);
 }
 
 Emitter::~Emitter() {
+	// hand our particles back to the budget
+	if (budget) {
+		budget->Release(numLiving);
+		budget->Unregister(this);
+	}
+
 	// deallocate memory
+	delete particles;
+	particleBuffer->Release();
+	if (sortedIndexBuffer) sortedIndexBuffer->Release();
 }
 
 void Emitter::SpawnNewParticle() {
@@ -77,15 +114,117 @@ void Emitter::SpawnNewParticle(
 	DirectX::XMFLOAT4 endColor,
 	DirectX::XMFLOAT3 scale) 
 {
-	// check if there are any available particles
-	if (particles[nextParticle].Age < lifetime) {
-		std::cout << "max particles exceeded";
-		return;
-	}
+	// thinned out at lower LOD
+	if (lod.SpawnScale < 1 && random.NextFloat() >= lod.SpawnScale) return;
+
+	// check if there's room, making some if the policy allows
+	if (ReserveSlots(1) == 0) return;
+
 	// particle available, initialize it
 	InitializeParticle(nextParticle, _position, _velocity, startColor, midColor, endColor, scale);
 	// this particle is at the back of the queue now, go to the next one
 	nextParticle = (nextParticle + 1) % maxParticles;
+	numLiving++;
+}
+
+// --------------------------------------------------------
+// Claims a run of free slots after nextParticle and fills them
+// all at once.  The run can wrap, in which case it's filled in
+// two pieces.
+// --------------------------------------------------------
+unsigned int Emitter::SpawnBurst(const ParticleBurstDesc& desc) {
+	// LOD thins the burst out and shrinks it
+	ParticleBurstDesc scaled = desc;
+	scaled.Count = (unsigned int)(desc.Count * lod.SpawnScale + 0.5f);
+	for (int i = 0; i < 3; i++)
+		scaled.Sizes[i] *= lod.SizeScale;
+
+	int count = ReserveSlots(scaled.Count);
+	if (count == 0) return 0;
+
+	int firstCount = min(count, maxParticles - nextParticle);
+	particles->InitializeBurst(nextParticle, firstCount, scaled, random);
+	particles->InitializeBurst(0, count - firstCount, scaled, random);
+	MarkDirty(nextParticle, count);
+
+	nextParticle = (nextParticle + count) % maxParticles;
+	numLiving += count;
+	return count;
+}
+
+// --------------------------------------------------------
+// Fewer particles first, then smaller and shorter lived ones.
+// Shortening the lifetime ends the oldest particles early; the
+// next Update() trims them off the live window as usual.
+// --------------------------------------------------------
+void Emitter::SetLodQuality(float quality) {
+	float factor = 1 - settings.LodWeight * (1 - quality);
+	lod.SpawnScale = factor;
+	lod.SizeScale = 0.5f + 0.5f * factor;
+	lod.LifetimeScale = 0.5f + 0.5f * factor;
+
+	float newLifetime = settings.Lifetime * lod.LifetimeScale;
+	if (newLifetime != lifetime) {
+		lifetime = newLifetime;
+		particles->SetLifetime(lifetime);
+	}
+}
+
+// --------------------------------------------------------
+// Everything outside the live window is dead, so the ring's
+// free space is whatever the window doesn't cover.  On top of
+// that the shared budget has to agree.
+// --------------------------------------------------------
+int Emitter::ReserveSlots(int count) {
+	int wanted;
+	if (settings.Overflow == ParticleOverflow::DropOldest) {
+		// make room in our own ring
+		wanted = min(count, maxParticles);
+		int ringFree = maxParticles - numLiving;
+		if (wanted > ringFree)
+			stats.DroppedOldest += KillOldest(wanted - ringFree);
+	}
+	else {
+		wanted = min(count, maxParticles - numLiving);
+	}
+
+	int granted = wanted;
+	if (budget) {
+		granted = budget->Acquire(this, wanted);
+
+		// budget's gone - recycle our own oldest instead
+		if (granted < wanted && settings.Overflow == ParticleOverflow::DropOldest) {
+			int killed = KillOldest(wanted - granted);
+			stats.DroppedOldest += killed;
+			granted += budget->Acquire(this, killed);
+		}
+	}
+
+	stats.Spawned += granted;
+	stats.DroppedNew += count - granted;
+	return granted;
+}
+
+// --------------------------------------------------------
+// Ends particles from the front of the live window.  They
+// drop out of the draw range straight away, so the GPU copy
+// doesn't need touching.
+// --------------------------------------------------------
+int Emitter::KillOldest(int count) {
+	count = min(count, numLiving);
+	for (int i = 0; i < count; i++) {
+		particles->Kill(oldestParticle);
+		oldestParticle = (oldestParticle + 1) % maxParticles;
+	}
+	numLiving -= count;
+	if (budget) budget->Release(count);
+	return count;
+}
+
+unsigned int Emitter::Yield(unsigned int count) {
+	int killed = KillOldest((int)min(count, (unsigned int)numLiving));
+	stats.Yielded += killed;
+	return killed;
 }
 
 DirectX::XMFLOAT3* Emitter::GetSpawnPos() {
@@ -101,34 +240,153 @@ void Emitter::InitializeParticle(
 	DirectX::XMFLOAT4 endColor, 
 	DirectX::XMFLOAT3 scale) 
 {
-	particles[index].Age = 0;
-	particles[index].StartPosition = _position;
-	//particles[index].StartColor = particles[index].MidColor= colorTint;
-	particles[index].StartColor = startColor;
-	particles[index].MidColor = midColor;
-	particles[index].EndColor = endColor;
-	particles[index].StartVelocity = _velocity;
-	particles[index].StartMidEndSizes = scale;
+	ParticleSpawnDesc desc;
+	desc.Position[0] = _position.x;
+	desc.Position[1] = _position.y;
+	desc.Position[2] = _position.z;
+	desc.Velocity[0] = _velocity.x;
+	desc.Velocity[1] = _velocity.y;
+	desc.Velocity[2] = _velocity.z;
+	memcpy(desc.StartColor, &startColor, sizeof(desc.StartColor));
+	memcpy(desc.MidColor, &midColor, sizeof(desc.MidColor));
+	memcpy(desc.EndColor, &endColor, sizeof(desc.EndColor));
+	desc.Sizes[0] = scale.x * lod.SizeScale;
+	desc.Sizes[1] = scale.y * lod.SizeScale;
+	desc.Sizes[2] = scale.z * lod.SizeScale;
+	desc.Type = 1;
+	particles->Initialize(index, desc);
+	MarkDirty(index);
 }
 
 void Emitter::Update(float dt) {
-	// update particle age
-	for (int i = 0; i < maxParticles; i++)
-	{
-		particles[i].Age += dt;
+	// update particle age (and recount the living)
+	time += dt;
+	particles->Age(dt);
+
+	// shrink the live window past anything that just died
+	int died = 0;
+	while (numLiving > 0 && !particles->IsAlive(oldestParticle)) {
+		oldestParticle = (oldestParticle + 1) % maxParticles;
+		numLiving--;
+		died++;
 	}
+	if (budget) budget->Release(died);
 }
 
-void Emitter::Draw(ID3D11DeviceContext* context, Camera* camera, float deltaTime, float totalTime) {
-	// update buffer
-	// All particles copied locally - send whole buffer to GPU
+unsigned int Emitter::GetLiveCount() {
+	return particles->GetLiveCount();
+}
+
+// --------------------------------------------------------
+// Records freshly written slots.  Spawns walk the ring in
+// order, so they almost always just extend the last range.
+// --------------------------------------------------------
+void Emitter::MarkDirty(int index, int count) {
+	// Everything is going up already
+	if (dirtyCount >= maxParticles) return;
+	dirtyCount += count;
+
+	if (!dirtyRanges.empty()) {
+		std::pair<int, int>& last = dirtyRanges.back();
+		if ((last.first + last.second) % maxParticles == index) {
+			last.second += count;
+			return;
+		}
+	}
+	dirtyRanges.push_back(std::make_pair(index, count));
+}
+
+// --------------------------------------------------------
+// Packs particles [first, first + count) into the 32-byte
+// vertex layout the shaders expect
+// --------------------------------------------------------
+void Emitter::WriteVertices(Particle* vertices, int first, int count) {
+	PackParticles(*particles, first, count, time, vertices);
+}
+
+// --------------------------------------------------------
+// Writes only the dirty ranges, with NO_OVERWRITE so the rest
+// of the buffer stays where it is.  Slots being written were
+// dead, so an earlier frame still reading them on the GPU
+// would have skipped them anyway - and if it sees the new
+// particle early, its age comes out negative and the shader
+// skips it too.
+// --------------------------------------------------------
+void Emitter::Upload(ID3D11DeviceContext* context) {
+	bytesUploaded = 0;
+	if (dirtyCount == 0) return;
+
 	D3D11_MAPPED_SUBRESOURCE mapped = {};
-	context->Map(particleBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped);
+	context->Map(particleBuffer, 0, D3D11_MAP_WRITE_NO_OVERWRITE, 0, &mapped);
+	Particle* vertices = (Particle*)mapped.pData;
 
-	memcpy(mapped.pData, particles, sizeof(Particle) * maxParticles);
+	if (dirtyCount >= maxParticles) {
+		WriteVertices(vertices, 0, maxParticles);
+	}
+	else {
+		for (const std::pair<int, int>& range : dirtyRanges) {
+			// Ranges can wrap past the end of the ring
+			int first = range.first;
+			int count = min(range.second, maxParticles - first);
+			WriteVertices(vertices, first, count);
+			WriteVertices(vertices, 0, range.second - count);
+		}
+	}
 
 	context->Unmap(particleBuffer, 0);
 
+	bytesUploaded = sizeof(Particle) * min(dirtyCount, maxParticles);
+	dirtyRanges.clear();
+	dirtyCount = 0;
+}
+
+unsigned int Emitter::GetBytesUploaded() {
+	return bytesUploaded;
+}
+
+// --------------------------------------------------------
+// Number of vertices Draw() sends down the pipeline
+// --------------------------------------------------------
+unsigned int Emitter::GetDrawnCount() {
+	return numLiving;
+}
+
+// --------------------------------------------------------
+// Builds a view depth for every slot in the live window and
+// radix sorts the slot numbers by it, farthest first.  The
+// result replaces the window draw, so wrapping doesn't matter.
+// --------------------------------------------------------
+void Emitter::SortForView(ID3D11DeviceContext* context, Camera* camera, JobSystem* jobs) {
+	sortedCount = 0;
+	if (!sortedIndexBuffer || numLiving == 0) return;
+
+	// View space z comes from the third row of the (transposed) view matrix
+	XMFLOAT4X4 view = camera->GetViewMatrix();
+	float viewRow[4] = { view._31, view._32, view._33, view._34 };
+	float acceleration[3] = { 0, 0, 0 }; // matches Draw()
+
+	sortDepths.resize(numLiving);
+	sortSlots.resize(numLiving);
+	int firstCount = min(numLiving, maxParticles - oldestParticle);
+	ComputeParticleDepths(*particles, oldestParticle, firstCount, acceleration, viewRow, sortDepths.data());
+	ComputeParticleDepths(*particles, 0, numLiving - firstCount, acceleration, viewRow, sortDepths.data() + firstCount);
+	for (int i = 0; i < numLiving; i++)
+		sortSlots[i] = (oldestParticle + i) % maxParticles;
+
+	sorter.Sort(jobs, sortDepths.data(), sortSlots.data(), numLiving);
+
+	D3D11_MAPPED_SUBRESOURCE mapped = {};
+	context->Map(sortedIndexBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped);
+	memcpy(mapped.pData, sorter.GetSortedValues(), sizeof(uint32_t) * numLiving);
+	context->Unmap(sortedIndexBuffer, 0);
+	sortedCount = numLiving;
+}
+
+void Emitter::Draw(ID3D11DeviceContext* context, Camera* camera, float deltaTime, float totalTime) {
+	// nothing alive, nothing to draw
+	if (numLiving == 0) return;
+
+
 	// shaders
 	particleGS->SetMatrix4x4("world", XMFLOAT4X4(1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1)); // Identity
 	particleGS->SetMatrix4x4("view", camera->GetViewMatrix());
@@ -137,6 +395,7 @@ void Emitter::Draw(ID3D11DeviceContext* context, Camera* camera, float deltaTime
 
 	particleVS->SetFloat3("acceleration", DirectX::XMFLOAT3(0,0,0)); // no accelaration
 	particleVS->SetFloat("maxLifetime", lifetime);
+	particleVS->SetInt("currentTimeMs", ParticleTimeToMs(time));
 	particleVS->CopyAllBufferData();
 
 	particlePS->SetSamplerState("trilinear", particleSampler);
@@ -160,7 +419,19 @@ void Emitter::Draw(ID3D11DeviceContext* context, Camera* camera, float deltaTime
 
 	// Draw auto - draws based on current stream out buffer
 	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_POINTLIST);
-	context->Draw(maxParticles,0);
+	if (sortedCount > 0) {
+		// Back to front, as ordered by SortForView()
+		context->IASetIndexBuffer(sortedIndexBuffer, DXGI_FORMAT_R32_UINT, 0);
+		context->DrawIndexed(sortedCount, 0, 0);
+	}
+	else {
+		// Only the live window - one range, or two when it wraps
+		// around the end of the ring
+		int firstCount = min(numLiving, maxParticles - oldestParticle);
+		context->Draw(firstCount, oldestParticle);
+		if (numLiving > firstCount)
+			context->Draw(numLiving - firstCount, 0);
+	}
 
 	// Unset Geometry Shader for next frame and reset states
 	context->GSSetShader(0, 0, 0);
@@ -1,11 +1,58 @@
 #pragma once
 #include <vector>
 #include <DirectXMath.h>
-#include <iostream>
 #include "Particle.h"
+#include "ParticlePacking.h"
+#include "ParticleBurst.h"
+#include "ParticleBudget.h"
+#include "ParticleSort.h"
 #include "Material.h"
 #include "Camera.h"
 
+// --------------------------------------------------------
+// What an emitter does when a spawn doesn't fit - either its
+// own ring is full or the shared budget has run out
+// --------------------------------------------------------
+enum class ParticleOverflow
+{
+	DropNew,	// The new particles are skipped
+	DropOldest,	// The emitter's own oldest particles make room
+	Priority	// Lower priority emitters give up their oldest
+};
+
+struct EmitterSettings
+{
+	EmitterSettings();
+
+	unsigned int Capacity;	// Size of the emitter's ring
+	float Lifetime;
+	ParticleOverflow Overflow;
+	int Priority;			// Higher takes budget from lower
+	bool SortByDepth;		// Draw back to front, for alpha blending
+	float LodWeight;		// How much LOD quality affects this emitter, 0 to 1
+};
+
+// --------------------------------------------------------
+// What the current LOD quality does to an emitter
+// --------------------------------------------------------
+struct EmitterLod
+{
+	float SpawnScale;		// Fraction of requested particles spawned
+	float SizeScale;		// Multiplies spawned particle sizes
+	float LifetimeScale;	// Multiplies the emitter's lifetime
+};
+
+// --------------------------------------------------------
+// Running totals, in particles
+// --------------------------------------------------------
+struct EmitterStats
+{
+	unsigned int Spawned;
+	unsigned int DroppedNew;	// Skipped because they didn't fit
+	unsigned int DroppedOldest;	// Killed early to make room here
+	unsigned int Yielded;		// Killed early for a higher priority emitter
+};
+
 class Emitter {
 public:
 	Emitter(
@@ -16,7 +63,9 @@ public:
 		ID3D11ShaderResourceView* texture,
 		ID3D11SamplerState* sampler,
 		ID3D11BlendState* particleBlendState,
-		ID3D11DepthStencilState* particleDepthState
+		ID3D11DepthStencilState* particleDepthState,
+		ParticleBudget* budget = nullptr,
+		const EmitterSettings& settings = EmitterSettings()
 	);
 	~Emitter();
 	void SpawnNewParticle();
@@ -28,6 +77,9 @@ public:
 		DirectX::XMFLOAT4 midColor,
 		DirectX::XMFLOAT4 endColor,
 		DirectX::XMFLOAT3 scale);
+	// Spawns desc.Count particles in one pass.  Returns how many
+	// actually fit in the ring.
+	unsigned int SpawnBurst(const ParticleBurstDesc& desc);
 	DirectX::XMFLOAT3* GetSpawnPos();
 	void InitializeParticle(
 		int index,
@@ -38,6 +90,30 @@ public:
 		DirectX::XMFLOAT4 endColor,
 		DirectX::XMFLOAT3 scale);
 	void Update(float dt);
+	unsigned int GetLiveCount();
+
+	const EmitterSettings& GetSettings() const { return settings; }
+	const EmitterStats& GetStats() const { return stats; }
+
+	// Scales spawn counts, sizes and lifetime from a quality in
+	// [0, 1], weighted by the emitter's LodWeight
+	void SetLodQuality(float quality);
+	const EmitterLod& GetLod() const { return lod; }
+
+	// Kills up to count of the oldest particles so a higher
+	// priority emitter can have their budget.  Returns how many.
+	unsigned int Yield(unsigned int count);
+
+	// Sends particles spawned since the last upload to the GPU.
+	// Call once per frame, before any pass draws the emitter.
+	void Upload(ID3D11DeviceContext* context);
+	unsigned int GetBytesUploaded();
+	unsigned int GetDrawnCount();
+
+	// For SortByDepth emitters: orders the live particles back to
+	// front for this camera and uploads the index buffer Draw()
+	// uses.  Does nothing for unsorted emitters.
+	void SortForView(ID3D11DeviceContext* context, Camera* camera, JobSystem* jobs);
 
 	void Draw(ID3D11DeviceContext* context, Camera* camera, float deltaTime, float totalTime);
 
@@ -56,16 +132,52 @@ private:
 	// buffer matrix for ParticleGS cbuffer
 	ID3D11Buffer* stuff;
 
+	// Live particles always sit in one window of the ring, from
+	// oldestParticle up to (not including) nextParticle.  Every
+	// particle has the same lifetime and spawns in ring order, so
+	// they die oldest first and the window never has holes.
 	int numLiving = 0;
+	int oldestParticle = 0;
 	int nextParticle = 0;
 	DirectX::XMFLOAT3 spawnPos;
 	DirectX::XMFLOAT3 velocity;
 	int maxParticles;
+	EmitterSettings settings;
+	EmitterStats stats;
+	EmitterLod lod;
+	ParticleBudget* budget;
 	Material* material;
 	// circular buffer of particles
-	Particle* particles;
-	float lifetime = 5;
+	ParticleStore* particles;
+	float lifetime;
 	DirectX::XMFLOAT4 colorTint;
 	D3D11_BUFFER_DESC vbd;
 	ID3D11Buffer* particleBuffer;
+
+	// Emitter clock - particles store their spawn time on the GPU
+	// so their vertices don't change as they age
+	float time = 0;
+
+	// This emitter's own random stream for bursts
+	ParticleRandom random;
+
+	// Ring ranges written since the last upload, as (first, count)
+	std::vector<std::pair<int, int>> dirtyRanges;
+	int dirtyCount = 0;
+	unsigned int bytesUploaded = 0;
+	void MarkDirty(int index, int count = 1);
+
+	// Depth sorting (SortByDepth only)
+	ParticleDepthSorter sorter;
+	std::vector<float> sortDepths;
+	std::vector<uint32_t> sortSlots;
+	ID3D11Buffer* sortedIndexBuffer = nullptr;
+	int sortedCount = 0;
+
+	// Makes room for up to count new particles starting at
+	// nextParticle, applying the overflow policy.  Returns how
+	// many can be written.
+	int ReserveSlots(int count);
+	int KillOldest(int count);
+	void WriteVertices(Particle* vertices, int first, int count);
 };
\ No newline at end of file
@@ -0,0 +1,113 @@
+#include "ParticleLod.h"
+#include <algorithm>
+
+ParticleLodSettings::ParticleLodSettings()
+{
+	TargetFrameTime = 1.0f / 60.0f;
+	DegradeRatio = 1.1f;
+	RecoverRatio = 0.85f;
+	RecoverDelay = 2.0f;
+	Cooldown = 0.25f;
+	StepDown = 0.15f;
+	StepUp = 0.05f;
+	MinQuality = 0.2f;
+	WindowSize = 30;
+}
+
+ParticleLodController::ParticleLodController(const ParticleLodSettings& settings)
+{
+	this->settings = settings;
+	if (this->settings.WindowSize == 0) this->settings.WindowSize = 1;
+
+	quality = 1;
+	clock = 0;
+	lastChange = -settings.Cooldown;
+	underSince = -1;
+
+	frameTimes.resize(this->settings.WindowSize, 0.0f);
+	nextFrame = 0;
+	frameCount = 0;
+	frameTimeSum = 0;
+
+	nextDecision = 0;
+	totalDecisions = 0;
+}
+
+float ParticleLodController::GetAverageFrameTime() const
+{
+	return frameCount > 0 ? frameTimeSum / frameCount : 0.0f;
+}
+
+const ParticleLodDecision& ParticleLodController::GetDecision(unsigned int index) const
+{
+	// Once the ring is full, the oldest entry is the next to be overwritten
+	unsigned int start = decisions.size() < HistorySize ? 0 : nextDecision;
+	return decisions[(start + index) % decisions.size()];
+}
+
+void ParticleLodController::AddFrameTime(float seconds)
+{
+	clock += seconds;
+
+	// Rolling window
+	frameTimeSum -= frameTimes[nextFrame];
+	frameTimes[nextFrame] = seconds;
+	frameTimeSum += seconds;
+	nextFrame = (nextFrame + 1) % settings.WindowSize;
+	if (frameCount < settings.WindowSize) frameCount++;
+
+	// Not enough history to judge yet
+	if (frameCount < settings.WindowSize) return;
+
+	float average = GetAverageFrameTime();
+	bool over = average > settings.TargetFrameTime * settings.DegradeRatio;
+	bool under = average < settings.TargetFrameTime * settings.RecoverRatio;
+
+	if (!under)
+		underSince = -1;
+	else if (underSince < 0)
+		underSince = clock;
+
+	if (clock - lastChange < settings.Cooldown) return;
+
+	if (over && quality > settings.MinQuality)
+	{
+		float next = quality - settings.StepDown;
+		ChangeQuality(next < settings.MinQuality ? settings.MinQuality : next, average);
+	}
+	else if (under && quality < 1 && clock - underSince >= settings.RecoverDelay)
+	{
+		float next = quality + settings.StepUp;
+		ChangeQuality(next > 1 ? 1 : next, average);
+
+		// Each step up has to earn its own delay
+		underSince = clock;
+	}
+}
+
+void ParticleLodController::ChangeQuality(float newQuality, float average)
+{
+	ParticleLodDecision decision;
+	decision.Time = clock;
+	decision.AverageFrameTime = average;
+	decision.OldQuality = quality;
+	decision.NewQuality = newQuality;
+
+	if (decisions.size() < HistorySize)
+		decisions.push_back(decision);
+	else
+		decisions[nextDecision] = decision;
+	nextDecision = (nextDecision + 1) % HistorySize;
+	totalDecisions++;
+
+	quality = newQuality;
+	lastChange = clock;
+
+	// The frames in the window were rendered at the old quality.
+	// Start it over, so the next decision only sees frames from
+	// after this one and a single spike can't cut twice.
+	std::fill(frameTimes.begin(), frameTimes.end(), 0.0f);
+	nextFrame = 0;
+	frameCount = 0;
+	frameTimeSum = 0;
+}
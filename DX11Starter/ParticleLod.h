@@ -0,0 +1,82 @@
+#pragma once
+#include <vector>
+
+// --------------------------------------------------------
+// Knobs for ParticleLodController.  Times are in seconds.
+// --------------------------------------------------------
+struct ParticleLodSettings
+{
+	ParticleLodSettings();
+
+	float TargetFrameTime;	// The frame budget to hold
+	float DegradeRatio;		// Cut quality above Target * this...
+	float RecoverRatio;		// ...raise it again below Target * this
+	float RecoverDelay;		// Must stay under the recover line this long
+	float Cooldown;			// Minimum time between any two changes
+	float StepDown;			// Quality removed per cut
+	float StepUp;			// Quality restored per recovery
+	float MinQuality;
+	unsigned int WindowSize;	// Frames averaged
+};
+
+// --------------------------------------------------------
+// One change of quality, kept for telemetry
+// --------------------------------------------------------
+struct ParticleLodDecision
+{
+	float Time;					// Controller clock when it happened
+	float AverageFrameTime;		// What it was reacting to
+	float OldQuality;
+	float NewQuality;
+};
+
+// --------------------------------------------------------
+// Watches recent frame times and picks a particle quality
+// between MinQuality and 1.  Quality drops quickly when the
+// average frame time goes over budget and comes back slowly,
+// only after frames have stayed comfortably under budget for a
+// while - the gap between the two lines plus the delays stop it
+// flip-flopping around the target.  Each change also empties
+// the frame window, so the next one waits for WindowSize frames
+// at the new quality.
+//
+// What quality means is up to the emitters; see
+// Emitter::SetLodQuality().
+// --------------------------------------------------------
+class ParticleLodController
+{
+public:
+	ParticleLodController(const ParticleLodSettings& settings = ParticleLodSettings());
+
+	// Call once per rendered frame with that frame's duration
+	void AddFrameTime(float seconds);
+
+	float GetQuality() const { return quality; }
+	float GetAverageFrameTime() const;
+	const ParticleLodSettings& GetSettings() const { return settings; }
+
+	// Recent decisions, oldest first (at most HistorySize)
+	unsigned int GetDecisionCount() const { return (unsigned int)decisions.size(); }
+	const ParticleLodDecision& GetDecision(unsigned int index) const;
+	unsigned int GetTotalDecisions() const { return totalDecisions; }
+
+	static const unsigned int HistorySize = 32;
+
+private:
+	ParticleLodSettings settings;
+	float quality;
+	float clock;
+	float lastChange;
+	float underSince;		// When frames went under the recover line, or -1
+
+	std::vector<float> frameTimes;	// Ring of WindowSize entries
+	unsigned int nextFrame;
+	unsigned int frameCount;
+	float frameTimeSum;
+
+	std::vector<ParticleLodDecision> decisions;	// Ring of HistorySize entries
+	unsigned int nextDecision;
+	unsigned int totalDecisions;
+
+	void ChangeQuality(float newQuality, float average);
+};
@@ -7,81 +7,229 @@ ParticleManager& ParticleManager::GetInstance() {
 }
 
 // private constructor
-ParticleManager::ParticleManager() {
-
+ParticleManager::ParticleManager() : budget(10000) {
+	for (int i = 0; i < (int)ParticleEffect::Count; i++)
+		emitters[i] = nullptr;
 }
 
 ParticleManager::~ParticleManager() {
-	delete emitter;
+	ReleaseEmitters();
 }
 
 // emitter for manager to use with effects
-void ParticleManager::AttachEmitter(Emitter* _emitter) {
-	emitter = _emitter;
+void ParticleManager::AttachEmitter(ParticleEffect effect, Emitter* _emitter) {
+	delete emitters[(int)effect];
+	emitters[(int)effect] = _emitter;
+	if (_emitter) _emitter->SetLodQuality(lod.GetQuality());
+}
+
+Emitter* ParticleManager::GetEmitter(ParticleEffect effect) {
+	return emitters[(int)effect];
+}
+
+void ParticleManager::ReleaseEmitters() {
+	for (int i = 0; i < (int)ParticleEffect::Count; i++) {
+		delete emitters[i];
+		emitters[i] = nullptr;
+	}
+}
+
+ParticleBudget* ParticleManager::GetBudget() {
+	return &budget;
+}
+
+void ParticleManager::UpdateEmitters(float dt) {
+	for (Emitter* emitter : emitters)
+		if (emitter) emitter->Update(dt);
+}
+
+void ParticleManager::UploadEmitters(ID3D11DeviceContext* context) {
+	for (Emitter* emitter : emitters)
+		if (emitter) emitter->Upload(context);
+}
+
+void ParticleManager::SortEmitters(ID3D11DeviceContext* context, Camera* camera, JobSystem* jobs) {
+	for (Emitter* emitter : emitters)
+		if (emitter) emitter->SortForView(context, camera, jobs);
+}
+
+void ParticleManager::DrawEmitters(ID3D11DeviceContext* context, Camera* camera, float deltaTime, float totalTime) {
+	for (Emitter* emitter : emitters)
+		if (emitter) emitter->Draw(context, camera, deltaTime, totalTime);
+}
+
+// fills in a burst's color ramp
+void ParticleManager::SetBurstColors(ParticleBurstDesc& burst, XMFLOAT4 start, XMFLOAT4 mid, XMFLOAT4 end) {
+	memcpy(burst.StartColor, &start, sizeof(burst.StartColor));
+	memcpy(burst.MidColor, &mid, sizeof(burst.MidColor));
+	memcpy(burst.EndColor, &end, sizeof(burst.EndColor));
+	burst.Type = 1;
+}
+
+// same size for the whole life of the particle
+void ParticleManager::SetBurstSizes(ParticleBurstDesc& burst, float size) {
+	burst.Sizes[0] = size;
+	burst.Sizes[1] = size;
+	burst.Sizes[2] = size;
+}
+
+void ParticleManager::ObserveFrameTime(float seconds) {
+	float before = lod.GetQuality();
+	lod.AddFrameTime(seconds);
+	if (lod.GetQuality() == before) return;
+
+	for (Emitter* emitter : emitters)
+		if (emitter) emitter->SetLodQuality(lod.GetQuality());
+}
+
+const ParticleLodController& ParticleManager::GetLodController() {
+	return lod;
 }
 
 void ParticleManager::EmitSmallParticle(XMFLOAT3 pos, XMFLOAT3 vel) {
+	Emitter* emitter = emitters[(int)ParticleEffect::NoteHit];
+	if (emitter == nullptr) return;
 	emitter->SpawnNewParticle(pos, vel, XMFLOAT4(1,1,1,1),XMFLOAT4(1,1,1,0.5), XMFLOAT4(1,1,1,0),XMFLOAT3(0.1,0.1,0.1));
 }
 
 void ParticleManager::EmitMedParticle(XMFLOAT3 pos, XMFLOAT3 vel) {
+	Emitter* emitter = emitters[(int)ParticleEffect::NoteHit];
+	if (emitter == nullptr) return;
 	emitter->SpawnNewParticle(pos, vel, XMFLOAT4(1, 1, 1, 1), XMFLOAT4(1, 1, 1, 0.5), XMFLOAT4(1, 1, 1, 0), XMFLOAT3(2, 2, 2));
 }
 
 void ParticleManager::EmitSkyParticle(XMFLOAT3 pos, XMFLOAT3 vel, XMFLOAT4 color) {
+	Emitter* emitter = emitters[(int)ParticleEffect::Sky];
+	if (emitter == nullptr) return;
 	emitter->SpawnNewParticle(pos, vel, XMFLOAT4(color.x,color.y,color.z,0), color, color, XMFLOAT3(20.1, 20.1, 20.1));
 }
 
 void ParticleManager::NoteHitBurst(DirectX::XMFLOAT3 pos) {
+	Emitter* emitter = emitters[(int)ParticleEffect::NoteHit];
 	if (emitter == nullptr) return;
 
-	DirectX::XMFLOAT3 vel = DirectX::XMFLOAT3(0, 0, 0);
+	// small white sparks flying out in every direction
+	ParticleBurstDesc burst = {};
+	burst.Count = 100;
+	burst.Position = ParticlePoint(pos.x, pos.y, pos.z);
+	burst.Velocity = ParticleBox(0, 0, 0, 10, 10, 10);
+	SetBurstColors(burst, XMFLOAT4(1, 1, 1, 1), XMFLOAT4(1, 1, 1, 0.5), XMFLOAT4(1, 1, 1, 0));
+	SetBurstSizes(burst, 0.1f);
+	emitter->SpawnBurst(burst);
+}
+
+void ParticleManager::LoadChart(SMParser* _chart) {
+	chart = _chart;
+	scheduler.Build(*chart);
+}
+
+void ParticleManager::SetSongTime(double seconds, bool playing) {
+	songTime = seconds;
+	songPlaying = playing;
+}
 
-	for (int i = 0; i < 100; i++) {
-		// random velocity
-		vel.x = ((rand() % 100) * 0.02 - 1) * 10.0;
-		vel.y = ((rand() % 100) * 0.02 - 1) * 10.0;
-		vel.z = ((rand() % 100) * 0.02 - 1) * 10.0;
+void ParticleManager::QueueBurst(ParticleEffect effect, const ParticleBurstDesc& burst) {
+	QueuedBurst queued;
+	queued.Effect = effect;
+	queued.Burst = burst;
+	queued.Remaining = burst.Count;
+	queuedBursts.push_back(queued);
+}
 
-		// shoot particle
-		EmitSmallParticle(pos, vel);
+// spends this step's spawn allowance on the oldest queued bursts
+void ParticleManager::SpawnQueuedBursts() {
+	unsigned int allowance = spawnsPerStep;
+	size_t done = 0;
+	for (QueuedBurst& queued : queuedBursts) {
+		if (allowance == 0) break;
+		Emitter* emitter = emitters[(int)queued.Effect];
+		unsigned int count = min(queued.Remaining, allowance);
+		if (emitter) {
+			ParticleBurstDesc chunk = queued.Burst;
+			chunk.Count = count;
+			emitter->SpawnBurst(chunk);
+		}
+		queued.Remaining -= count;
+		allowance -= count;
+		if (queued.Remaining == 0) done++;
 	}
+	// finished bursts are always at the front
+	queuedBursts.erase(queuedBursts.begin(), queuedBursts.begin() + done);
 }
 
 void ParticleManager::Update(float dt) {
 	timer += dt;
-	skyTimer += dt;
-	if (skyTimer > skyInterval) {
-		skyTimer -= skyInterval;
-		SkyColorBurst();
+
+	if (chart && songPlaying) {
+		// effects follow the chart
+		scheduler.Dispatch(songTime, [this](const EffectEvent& event) {
+			OnEffectEvent(event);
+		});
 	}
+	else {
+		skyTimer += dt;
+		if (skyTimer > skyInterval) {
+			skyTimer -= skyInterval;
+			SkyColorBurst();
+		}
+	}
+
+	SpawnQueuedBursts();
 
 	//updateCyclingColor(currentColor);
 }
 
+void ParticleManager::OnEffectEvent(const EffectEvent& event) {
+	switch (event.Type) {
+	case EffectEventType::Downbeat:
+		SkyColorBurst();
+		break;
+	case EffectEventType::TempoChange:
+		// mark the new tempo with an extra burst
+		SkyColorBurst();
+		break;
+	case EffectEventType::StreamStart:
+		inStream = true;
+		break;
+	case EffectEventType::StreamEnd:
+		inStream = false;
+		break;
+	}
+}
+
+// --------------------------------------------------------
+// Drives the color cycle.  While the song plays it follows the
+// beat - at the starting tempo that's one radian per second,
+// same as the wall clock it replaces.
+// --------------------------------------------------------
+float ParticleManager::GetColorPhase() {
+	if (!chart || !songPlaying || chart->BpmChanges.empty()) return timer;
+	return (float)(chart->SecondsToBeat(songTime) * 60.0 / chart->BpmChanges[0].Bpm);
+}
+
 void ParticleManager::SkyColorBurst() {
+	Emitter* emitter = emitters[(int)ParticleEffect::Sky];
 	if (emitter == nullptr) return;
 
-	XMFLOAT4 color = XMFLOAT4(XMScalarCos(timer), XMScalarSin(timer), XMScalarCos(timer),0.3);
+	float phase = GetColorPhase();
+	XMFLOAT4 color = XMFLOAT4(XMScalarCos(phase), XMScalarSin(phase), XMScalarCos(phase),0.3);
 	currentColor = nextColor;
 	nextColor = color;
 
-	XMFLOAT3 vel = XMFLOAT3(0, 0, -50);
-	XMFLOAT3 pos = XMFLOAT3(0, 0, 50);
-	for (int i = 0; i < 200; i++) {
-		// random position
-		pos.x = (rand()%1000 * 0.001)*100 - 50;
-		pos.y = 5;
-		pos.z = (rand() % 1000 * 0.001) * 100 + 50;
-
-		// shoot particle
-		EmitSkyParticle(pos, vel, color);
-	}
+	// big soft particles spread over the sky, all drifting toward the player,
+	// twice as many during streams
+	ParticleBurstDesc burst = {};
+	burst.Count = inStream ? 400 : 200;
+	burst.Position = ParticleBox(0, 5, 100, 50, 0, 50);
+	burst.Velocity = ParticlePoint(0, 0, -50);
+	SetBurstColors(burst, XMFLOAT4(color.x, color.y, color.z, 0), color, color);
+	SetBurstSizes(burst, 20.1f);
+	QueueBurst(ParticleEffect::Sky, burst);
 }
 
 
 XMFLOAT4 ParticleManager::GetCyclingColor() {
-	float t = timer + 4.5;
+	float t = GetColorPhase() + 4.5;
 	return XMFLOAT4(XMScalarCos(t), XMScalarSin(t), XMScalarCos(t), 0.3);;
 }
 
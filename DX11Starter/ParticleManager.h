@@ -1,14 +1,55 @@
 #pragma once
 
 #include "ParticleEmitter.h";
+#include "ParticleLod.h"
+#include "EffectScheduler.h"
 
 using namespace DirectX;
 
+// --------------------------------------------------------
+// Which emitter each effect spawns into
+// --------------------------------------------------------
+enum class ParticleEffect
+{
+	NoteHit,	// Hit bursts and note trails
+	Sky,		// Colored rain over the track
+	Count
+};
+
 class ParticleManager {
 public:
 	static ParticleManager& GetInstance();
 	~ParticleManager();
-	void AttachEmitter(Emitter* _emitter);
+
+	// Hands an emitter over to the manager, which deletes it in
+	// ReleaseEmitters().  Create it with GetBudget() so it shares
+	// the global particle budget.
+	void AttachEmitter(ParticleEffect effect, Emitter* _emitter);
+	Emitter* GetEmitter(ParticleEffect effect);
+	void ReleaseEmitters();
+	ParticleBudget* GetBudget();
+
+	// Every attached emitter, in ParticleEffect order
+	void UpdateEmitters(float dt);
+	void UploadEmitters(ID3D11DeviceContext* context);
+	void SortEmitters(ID3D11DeviceContext* context, Camera* camera, JobSystem* jobs);
+	void DrawEmitters(ID3D11DeviceContext* context, Camera* camera, float deltaTime, float totalTime);
+
+	// Feeds the LOD controller one rendered frame and passes any
+	// change of quality on to the emitters
+	void ObserveFrameTime(float seconds);
+	const ParticleLodController& GetLodController();
+
+	// Times sky effects to the chart's beat grid from now on
+	void LoadChart(SMParser* chart);
+
+	// Where the song is, set before Update() each step.  Until it's
+	// playing, sky bursts fall back to a fixed timer.
+	void SetSongTime(double seconds, bool playing);
+
+	// Spawns the burst over the next few steps instead of all at once
+	void QueueBurst(ParticleEffect effect, const ParticleBurstDesc& burst);
+
 	void EmitSmallParticle(XMFLOAT3 pos, XMFLOAT3 vel);
 	void EmitMedParticle(XMFLOAT3 pos, XMFLOAT3 vel);
 	void EmitSkyParticle(XMFLOAT3 pos, XMFLOAT3 vel, XMFLOAT4 color);
@@ -23,7 +64,31 @@ private:
 	XMFLOAT4 currentColor;
 	XMFLOAT4 cyclingColor;
 	void updateCyclingColor(XMFLOAT4 color);
-	Emitter* emitter;
+	void OnEffectEvent(const EffectEvent& event);
+	void SpawnQueuedBursts();
+	float GetColorPhase();
+	void SetBurstColors(ParticleBurstDesc& burst, XMFLOAT4 start, XMFLOAT4 mid, XMFLOAT4 end);
+	void SetBurstSizes(ParticleBurstDesc& burst, float size);
+	Emitter* emitters[(int)ParticleEffect::Count];
+	ParticleBudget budget;
+	ParticleLodController lod;
+
+	// chart timing
+	SMParser* chart = nullptr;
+	EffectScheduler scheduler;
+	double songTime = 0;
+	bool songPlaying = false;
+	bool inStream = false;
+
+	// bursts still being spawned, a chunk per step
+	struct QueuedBurst {
+		ParticleEffect Effect;
+		ParticleBurstDesc Burst;
+		unsigned int Remaining;
+	};
+	std::vector<QueuedBurst> queuedBursts;
+	unsigned int spawnsPerStep = 64;
+
 	float skyInterval = 1;
 	float skyTimer = 0;
 	float timer = 0;
@@ -0,0 +1,206 @@
+#include "ParticlePacking.h"
+#include <cstring>
+#include <emmintrin.h>
+
+// --------------------------------------------------------
+// Four floats to four halves (one per 32-bit lane, in the low
+// 16 bits) with SSE2 only.  Rounds to nearest, overflows to
+// infinity, keeps NaNs and produces denormals for tiny values.
+// --------------------------------------------------------
+static __m128i FloatToHalf4(__m128 f)
+{
+	const __m128i signMask = _mm_set1_epi32((int)0x80000000u);
+	const __m128i roundMask = _mm_set1_epi32(~0xfff);
+	const __m128i floatInfinity = _mm_set1_epi32(255 << 23);
+	const __m128i magic = _mm_set1_epi32(15 << 23);
+	const __m128i nanBit = _mm_set1_epi32(0x200);
+	const __m128i halfInfinity = _mm_set1_epi32(0x7c00);
+	const __m128i clampValue = _mm_set1_epi32((31 << 23) - 0x1000);
+
+	__m128 sign = _mm_and_ps(_mm_castsi128_ps(signMask), f);
+	__m128 absolute = _mm_xor_ps(f, sign);
+	__m128i absoluteBits = _mm_castps_si128(absolute);
+
+	__m128i isNan = _mm_cmpgt_epi32(absoluteBits, floatInfinity);
+	__m128i isNormal = _mm_cmpgt_epi32(floatInfinity, absoluteBits);
+	__m128i infOrNan = _mm_or_si128(_mm_and_si128(isNan, nanBit), halfInfinity);
+
+	// Rebias the exponent by multiplying, which also handles
+	// denormals and rounding in one go
+	__m128 truncated = _mm_and_ps(absolute, _mm_castsi128_ps(roundMask));
+	__m128 scaled = _mm_mul_ps(truncated, _mm_castsi128_ps(magic));
+	__m128 clamped = _mm_min_ps(scaled, _mm_castsi128_ps(clampValue));
+	__m128i biased = _mm_sub_epi32(_mm_castps_si128(clamped), roundMask);
+	__m128i normal = _mm_and_si128(_mm_srli_epi32(biased, 13), isNormal);
+
+	__m128i joined = _mm_or_si128(normal, _mm_andnot_si128(isNormal, infOrNan));
+	return _mm_or_si128(joined, _mm_srli_epi32(_mm_castps_si128(sign), 16));
+}
+
+// --------------------------------------------------------
+// Packs two vectors of four halves into eight 16-bit values.
+// packs_epi32 saturates, so sign-extend first to keep the
+// bit patterns intact.
+// --------------------------------------------------------
+static __m128i PackHalves(__m128i a, __m128i b)
+{
+	a = _mm_srai_epi32(_mm_slli_epi32(a, 16), 16);
+	b = _mm_srai_epi32(_mm_slli_epi32(b, 16), 16);
+	return _mm_packs_epi32(a, b);
+}
+
+// Four RGBA float colors to four RGBA8 values
+static __m128i PackColors4(const float* c0, const float* c1, const float* c2, const float* c3)
+{
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 scale = _mm_set1_ps(255.0f);
+
+	__m128i i0 = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(c0), zero), one), scale));
+	__m128i i1 = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(c1), zero), one), scale));
+	__m128i i2 = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(c2), zero), one), scale));
+	__m128i i3 = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(c3), zero), one), scale));
+
+	return _mm_packus_epi16(_mm_packs_epi32(i0, i1), _mm_packs_epi32(i2, i3));
+}
+
+static uint16_t TypeAndTime(int type, float spawnTime)
+{
+	return (uint16_t)((type != 0 ? 0x8000 : 0) | (ParticleTimeToMs(spawnTime) & 0x7FFF));
+}
+
+// --------------------------------------------------------
+// Packs four consecutive particles starting at "index".  The
+// caller guarantees the store has four readable slots there.
+// --------------------------------------------------------
+static void PackFour(const ParticleStore& store, unsigned int index, float time, Particle* out)
+{
+	__m128 row0 = _mm_loadu_ps(store.GetPositionX() + index);
+	__m128 row1 = _mm_loadu_ps(store.GetPositionY() + index);
+	__m128 row2 = _mm_loadu_ps(store.GetPositionZ() + index);
+	__m128 row3 = _mm_loadu_ps(store.GetStartSizes() + index);
+	_MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+	__m128i positions01 = PackHalves(FloatToHalf4(row0), FloatToHalf4(row1));
+	__m128i positions23 = PackHalves(FloatToHalf4(row2), FloatToHalf4(row3));
+
+	row0 = _mm_loadu_ps(store.GetVelocityX() + index);
+	row1 = _mm_loadu_ps(store.GetVelocityY() + index);
+	row2 = _mm_loadu_ps(store.GetVelocityZ() + index);
+	row3 = _mm_loadu_ps(store.GetMidSizes() + index);
+	_MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+	__m128i velocities01 = PackHalves(FloatToHalf4(row0), FloatToHalf4(row1));
+	__m128i velocities23 = PackHalves(FloatToHalf4(row2), FloatToHalf4(row3));
+
+	__m128i endSizes = FloatToHalf4(_mm_loadu_ps(store.GetEndSizes() + index));
+
+	const float* start = store.GetStartColors() + index * 4;
+	const float* mid = store.GetMidColors() + index * 4;
+	const float* end = store.GetEndColors() + index * 4;
+	__m128i startColors = PackColors4(start, start + 4, start + 8, start + 12);
+	__m128i midColors = PackColors4(mid, mid + 4, mid + 8, mid + 12);
+	__m128i endColors = PackColors4(end, end + 4, end + 8, end + 12);
+
+	// Spill to plain arrays and assemble whole particles, so the
+	// output (usually a mapped GPU buffer) is written in order
+	uint16_t positions[16];
+	uint16_t velocities[16];
+	uint32_t ends[4];
+	uint32_t colors[3][4];
+	_mm_storeu_si128((__m128i*)positions, positions01);
+	_mm_storeu_si128((__m128i*)(positions + 8), positions23);
+	_mm_storeu_si128((__m128i*)velocities, velocities01);
+	_mm_storeu_si128((__m128i*)(velocities + 8), velocities23);
+	_mm_storeu_si128((__m128i*)ends, endSizes);
+	_mm_storeu_si128((__m128i*)colors[0], startColors);
+	_mm_storeu_si128((__m128i*)colors[1], midColors);
+	_mm_storeu_si128((__m128i*)colors[2], endColors);
+
+	const float* ages = store.GetAges() + index;
+	const int* types = store.GetTypes() + index;
+
+	Particle block[4];
+	for (int p = 0; p < 4; p++)
+	{
+		memcpy(block[p].PositionStartSize, positions + p * 4, sizeof(uint16_t) * 4);
+		memcpy(block[p].VelocityMidSize, velocities + p * 4, sizeof(uint16_t) * 4);
+		block[p].EndSize = (uint16_t)ends[p];
+		block[p].TypeAndSpawnTime = TypeAndTime(types[p], time - ages[p]);
+		block[p].Colors[0] = colors[0][p];
+		block[p].Colors[1] = colors[1][p];
+		block[p].Colors[2] = colors[2][p];
+	}
+	memcpy(out, block, sizeof(block));
+}
+
+static void PackOne(const ParticleStore& store, unsigned int index, float time, Particle* out)
+{
+	Particle particle;
+	particle.PositionStartSize[0] = FloatToHalf(store.GetPositionX()[index]);
+	particle.PositionStartSize[1] = FloatToHalf(store.GetPositionY()[index]);
+	particle.PositionStartSize[2] = FloatToHalf(store.GetPositionZ()[index]);
+	particle.PositionStartSize[3] = FloatToHalf(store.GetStartSizes()[index]);
+	particle.VelocityMidSize[0] = FloatToHalf(store.GetVelocityX()[index]);
+	particle.VelocityMidSize[1] = FloatToHalf(store.GetVelocityY()[index]);
+	particle.VelocityMidSize[2] = FloatToHalf(store.GetVelocityZ()[index]);
+	particle.VelocityMidSize[3] = FloatToHalf(store.GetMidSizes()[index]);
+	particle.EndSize = FloatToHalf(store.GetEndSizes()[index]);
+	particle.TypeAndSpawnTime = TypeAndTime(store.GetTypes()[index], time - store.GetAges()[index]);
+	particle.Colors[0] = PackColor(store.GetStartColors() + index * 4);
+	particle.Colors[1] = PackColor(store.GetMidColors() + index * 4);
+	particle.Colors[2] = PackColor(store.GetEndColors() + index * 4);
+	*out = particle;
+}
+
+void PackParticles(const ParticleStore& store, unsigned int first, unsigned int count, float time, Particle* out)
+{
+	unsigned int end = first + count;
+	unsigned int i = first;
+	for (; i + 4 <= end; i += 4)
+		PackFour(store, i, time, out + i);
+	for (; i < end; i++)
+		PackOne(store, i, time, out + i);
+}
+
+uint16_t FloatToHalf(float value)
+{
+	return (uint16_t)_mm_cvtsi128_si32(FloatToHalf4(_mm_set_ss(value)));
+}
+
+float HalfToFloat(uint16_t half)
+{
+	uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+	uint32_t exponent = (half >> 10) & 0x1F;
+	uint32_t mantissa = half & 0x3FF;
+	uint32_t bits;
+
+	if (exponent == 0)
+	{
+		// Zero or denormal - scale the mantissa as a float
+		float magnitude = mantissa * (1.0f / 16777216.0f);
+		memcpy(&bits, &magnitude, sizeof(bits));
+		bits |= sign;
+	}
+	else if (exponent == 31)
+	{
+		bits = sign | 0x7F800000 | (mantissa << 13);
+	}
+	else
+	{
+		bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+	}
+
+	float result;
+	memcpy(&result, &bits, sizeof(result));
+	return result;
+}
+
+uint32_t PackColor(const float rgba[4])
+{
+	return (uint32_t)_mm_cvtsi128_si32(PackColors4(rgba, rgba, rgba, rgba));
+}
+
+void UnpackColor(uint32_t color, float rgba[4])
+{
+	for (int c = 0; c < 4; c++)
+		rgba[c] = ((color >> (c * 8)) & 0xFF) / 255.0f;
+}
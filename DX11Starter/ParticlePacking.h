@@ -0,0 +1,26 @@
+#pragma once
+#include "Particle.h"
+#include "ParticleStore.h"
+
+// --------------------------------------------------------
+// Conversions between ParticleStore's float arrays and the
+// packed Particle vertex.  The bulk path converts four
+// particles at a time with SSE2.
+// --------------------------------------------------------
+
+// Emitter time -> the millisecond clock TypeAndSpawnTime uses
+inline unsigned int ParticleTimeToMs(float seconds)
+{
+	return seconds > 0 ? (unsigned int)(seconds * 1000.0f) : 0;
+}
+
+// Packs particles [first, first + count) of the store into out[first ..]
+//
+// time - Current emitter time; spawn time is time minus age
+void PackParticles(const ParticleStore& store, unsigned int first, unsigned int count, float time, Particle* out);
+
+// Single value conversions, matching what the shader decodes
+uint16_t FloatToHalf(float value);
+float HalfToFloat(uint16_t half);
+uint32_t PackColor(const float rgba[4]);
+void UnpackColor(uint32_t color, float rgba[4]);
@@ -0,0 +1,89 @@
+#include "ParticleRandom.h"
+#include <emmintrin.h>
+
+// --------------------------------------------------------
+// splitmix64 - spreads a single seed into well-mixed state
+// --------------------------------------------------------
+static uint64_t SplitMix64(uint64_t& x)
+{
+	uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+static inline __m128i RotateLeft11(__m128i x)
+{
+	return _mm_or_si128(_mm_slli_epi32(x, 11), _mm_srli_epi32(x, 21));
+}
+
+ParticleRandom::ParticleRandom(uint64_t seed)
+{
+	Seed(seed);
+}
+
+void ParticleRandom::Seed(uint64_t seed)
+{
+	uint64_t x = seed;
+	for (int i = 0; i < 16; i += 2)
+	{
+		uint64_t value = SplitMix64(x);
+		state[i] = (uint32_t)value;
+		state[i + 1] = (uint32_t)(value >> 32);
+	}
+	bufferedCount = 0;
+}
+
+// --------------------------------------------------------
+// One xoshiro128+ step per lane.  The top 24 bits of each
+// result become a float in [0, 1) - exactly representable,
+// so 1.0 can never come out.
+// --------------------------------------------------------
+void ParticleRandom::Fill(float* out, unsigned int count)
+{
+	__m128i s0 = _mm_loadu_si128((const __m128i*)(state + 0));
+	__m128i s1 = _mm_loadu_si128((const __m128i*)(state + 4));
+	__m128i s2 = _mm_loadu_si128((const __m128i*)(state + 8));
+	__m128i s3 = _mm_loadu_si128((const __m128i*)(state + 12));
+	const __m128 scale = _mm_set1_ps(1.0f / 16777216.0f);
+
+	for (unsigned int i = 0; i < count; i += 4)
+	{
+		__m128i result = _mm_add_epi32(s0, s3);
+		__m128i t = _mm_slli_epi32(s1, 9);
+		s2 = _mm_xor_si128(s2, s0);
+		s3 = _mm_xor_si128(s3, s1);
+		s1 = _mm_xor_si128(s1, s2);
+		s0 = _mm_xor_si128(s0, s3);
+		s2 = _mm_xor_si128(s2, t);
+		s3 = RotateLeft11(s3);
+
+		__m128 values = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(result, 8)), scale);
+		if (count - i >= 4)
+		{
+			_mm_storeu_ps(out + i, values);
+		}
+		else
+		{
+			float lanes[4];
+			_mm_storeu_ps(lanes, values);
+			for (unsigned int j = 0; i + j < count; j++)
+				out[i + j] = lanes[j];
+		}
+	}
+
+	_mm_storeu_si128((__m128i*)(state + 0), s0);
+	_mm_storeu_si128((__m128i*)(state + 4), s1);
+	_mm_storeu_si128((__m128i*)(state + 8), s2);
+	_mm_storeu_si128((__m128i*)(state + 12), s3);
+}
+
+float ParticleRandom::NextFloat()
+{
+	if (bufferedCount == 0)
+	{
+		Fill(buffered, 4);
+		bufferedCount = 4;
+	}
+	return buffered[--bufferedCount];
+}
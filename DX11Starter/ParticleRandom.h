@@ -0,0 +1,30 @@
+#pragma once
+#include <cstdint>
+
+// --------------------------------------------------------
+// Four interleaved xoshiro128+ generators, stepped together
+// with SSE2.  Each emitter owns one, so spawning never goes
+// near the CRT's shared rand() state.
+// --------------------------------------------------------
+class ParticleRandom
+{
+public:
+	ParticleRandom(uint64_t seed = 1);
+
+	// Restarts all four streams from one 64-bit seed
+	void Seed(uint64_t seed);
+
+	// Fills out[0 .. count) with uniform floats in [0, 1)
+	void Fill(float* out, unsigned int count);
+
+	// One uniform float in [0, 1)
+	float NextFloat();
+
+private:
+	// Lane-major: state[word * 4 + lane]
+	uint32_t state[16];
+
+	// Leftovers from the last 4-wide step, for NextFloat()
+	float buffered[4];
+	unsigned int bufferedCount;
+};
@@ -0,0 +1,256 @@
+#include "ParticleSimulator.h"
+#include "ParticlePacking.h"
+#include <cfloat>
+#include <xmmintrin.h>
+
+// Packed vertices are decoded this many at a time
+static const unsigned int ChunkSize = 64;
+
+// --------------------------------------------------------
+// Structure-of-arrays view of the particles being simulated
+// --------------------------------------------------------
+struct SimInput
+{
+	const float* Ages;
+	const float* PositionX;
+	const float* PositionY;
+	const float* PositionZ;
+	const float* VelocityX;
+	const float* VelocityY;
+	const float* VelocityZ;
+	const float* StartColors;
+	const float* MidColors;
+	const float* EndColors;
+	const float* StartSizes;
+	const float* MidSizes;
+	const float* EndSizes;
+	const int* Types;
+};
+
+static void ResetBounds(ParticleBounds* bounds)
+{
+	if (!bounds) return;
+	for (int i = 0; i < 3; i++)
+	{
+		bounds->Min[i] = FLT_MAX;
+		bounds->Max[i] = -FLT_MAX;
+	}
+	bounds->MaxSize = 0;
+	bounds->VisibleCount = 0;
+}
+
+// Quadratic Bezier, in the shader's operation order
+static inline __m128 Bezier4(__m128 p0, __m128 p1, __m128 p2, __m128 t)
+{
+	__m128 oneMinusT = _mm_sub_ps(_mm_set1_ps(1.0f), t);
+	__m128 a = _mm_mul_ps(_mm_mul_ps(oneMinusT, oneMinusT), p0);
+	__m128 b = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(_mm_set1_ps(2.0f), oneMinusT), t), p1);
+	__m128 c = _mm_mul_ps(_mm_mul_ps(t, t), p2);
+	return _mm_add_ps(_mm_add_ps(a, b), c);
+}
+
+static inline float Bezier(float p0, float p1, float p2, float t)
+{
+	float oneMinusT = 1.0f - t;
+	return oneMinusT * oneMinusT * p0 + 2.0f * oneMinusT * t * p1 + t * t * p2;
+}
+
+// Keeps lanes of value where mask is set, fallback elsewhere
+static inline __m128 Select(__m128 mask, __m128 value, __m128 fallback)
+{
+	return _mm_or_ps(_mm_and_ps(mask, value), _mm_andnot_ps(mask, fallback));
+}
+
+// --------------------------------------------------------
+// The actual simulation.  Particles [0, count) of the input go
+// to out[offset ..].  Bounds accumulate rather than reset.
+// --------------------------------------------------------
+static void SimulateRange(const SimInput& in, unsigned int count, float maxLifetime,
+	const float acceleration[3], const ParticleSimOutput& out, unsigned int offset, ParticleBounds* bounds)
+{
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 lifetime = _mm_set1_ps(maxLifetime);
+	const __m128 ax = _mm_set1_ps(acceleration[0]);
+	const __m128 ay = _mm_set1_ps(acceleration[1]);
+	const __m128 az = _mm_set1_ps(acceleration[2]);
+
+	__m128 minX = _mm_set1_ps(FLT_MAX), minY = minX, minZ = minX;
+	__m128 maxX = _mm_set1_ps(-FLT_MAX), maxY = maxX, maxZ = maxX;
+	__m128 maxSize = _mm_setzero_ps();
+	unsigned int visibleCount = 0;
+
+	unsigned int i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		unsigned int o = offset + i;
+		__m128 t = _mm_loadu_ps(in.Ages + i);
+
+		// Visible if the type is set and it isn't past its lifetime
+		__m128 typeSet = _mm_cmpneq_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*)(in.Types + i))), _mm_setzero_ps());
+		__m128 visible = _mm_and_ps(typeSet, _mm_cmple_ps(t, lifetime));
+
+		__m128 h = _mm_mul_ps(_mm_mul_ps(half, t), t);
+		__m128 x = _mm_add_ps(_mm_add_ps(_mm_mul_ps(h, ax), _mm_mul_ps(t, _mm_loadu_ps(in.VelocityX + i))), _mm_loadu_ps(in.PositionX + i));
+		__m128 y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(h, ay), _mm_mul_ps(t, _mm_loadu_ps(in.VelocityY + i))), _mm_loadu_ps(in.PositionY + i));
+		__m128 z = _mm_add_ps(_mm_add_ps(_mm_mul_ps(h, az), _mm_mul_ps(t, _mm_loadu_ps(in.VelocityZ + i))), _mm_loadu_ps(in.PositionZ + i));
+		_mm_storeu_ps(out.PositionX + o, x);
+		_mm_storeu_ps(out.PositionY + o, y);
+		_mm_storeu_ps(out.PositionZ + o, z);
+
+		__m128 percent = _mm_div_ps(t, lifetime);
+		__m128 size = Bezier4(_mm_loadu_ps(in.StartSizes + i), _mm_loadu_ps(in.MidSizes + i), _mm_loadu_ps(in.EndSizes + i), percent);
+		_mm_storeu_ps(out.Sizes + o, size);
+
+		// Colors are already RGBA per particle - one register each,
+		// with that particle's t broadcast
+		float percents[4];
+		_mm_storeu_ps(percents, percent);
+		for (unsigned int j = 0; j < 4; j++)
+		{
+			unsigned int c = (i + j) * 4;
+			__m128 color = Bezier4(_mm_loadu_ps(in.StartColors + c), _mm_loadu_ps(in.MidColors + c), _mm_loadu_ps(in.EndColors + c), _mm_set1_ps(percents[j]));
+			_mm_storeu_ps(out.Colors + (o + j) * 4, color);
+		}
+
+		int mask = _mm_movemask_ps(visible);
+		for (unsigned int j = 0; j < 4; j++)
+			out.Visible[o + j] = (mask >> j) & 1;
+
+		if (bounds && mask)
+		{
+			minX = _mm_min_ps(minX, Select(visible, x, _mm_set1_ps(FLT_MAX)));
+			minY = _mm_min_ps(minY, Select(visible, y, _mm_set1_ps(FLT_MAX)));
+			minZ = _mm_min_ps(minZ, Select(visible, z, _mm_set1_ps(FLT_MAX)));
+			maxX = _mm_max_ps(maxX, Select(visible, x, _mm_set1_ps(-FLT_MAX)));
+			maxY = _mm_max_ps(maxY, Select(visible, y, _mm_set1_ps(-FLT_MAX)));
+			maxZ = _mm_max_ps(maxZ, Select(visible, z, _mm_set1_ps(-FLT_MAX)));
+			maxSize = _mm_max_ps(maxSize, _mm_and_ps(visible, size));
+			visibleCount += (mask & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1) + ((mask >> 3) & 1);
+		}
+	}
+
+	if (bounds)
+	{
+		float lanes[7][4];
+		_mm_storeu_ps(lanes[0], minX);
+		_mm_storeu_ps(lanes[1], minY);
+		_mm_storeu_ps(lanes[2], minZ);
+		_mm_storeu_ps(lanes[3], maxX);
+		_mm_storeu_ps(lanes[4], maxY);
+		_mm_storeu_ps(lanes[5], maxZ);
+		_mm_storeu_ps(lanes[6], maxSize);
+		for (int j = 0; j < 4; j++)
+		{
+			for (int a = 0; a < 3; a++)
+			{
+				if (lanes[a][j] < bounds->Min[a]) bounds->Min[a] = lanes[a][j];
+				if (lanes[a + 3][j] > bounds->Max[a]) bounds->Max[a] = lanes[a + 3][j];
+			}
+			if (lanes[6][j] > bounds->MaxSize) bounds->MaxSize = lanes[6][j];
+		}
+		bounds->VisibleCount += visibleCount;
+	}
+
+	// Leftovers, one at a time with the same math
+	for (; i < count; i++)
+	{
+		unsigned int o = offset + i;
+		float t = in.Ages[i];
+		bool visible = in.Types[i] != 0 && t <= maxLifetime;
+
+		float h = 0.5f * t * t;
+		float p[3] = {
+			h * acceleration[0] + t * in.VelocityX[i] + in.PositionX[i],
+			h * acceleration[1] + t * in.VelocityY[i] + in.PositionY[i],
+			h * acceleration[2] + t * in.VelocityZ[i] + in.PositionZ[i] };
+		out.PositionX[o] = p[0];
+		out.PositionY[o] = p[1];
+		out.PositionZ[o] = p[2];
+
+		float percent = t / maxLifetime;
+		float size = Bezier(in.StartSizes[i], in.MidSizes[i], in.EndSizes[i], percent);
+		out.Sizes[o] = size;
+		for (unsigned int c = 0; c < 4; c++)
+			out.Colors[o * 4 + c] = Bezier(in.StartColors[i * 4 + c], in.MidColors[i * 4 + c], in.EndColors[i * 4 + c], percent);
+
+		out.Visible[o] = visible ? 1 : 0;
+		if (bounds && visible)
+		{
+			for (int a = 0; a < 3; a++)
+			{
+				if (p[a] < bounds->Min[a]) bounds->Min[a] = p[a];
+				if (p[a] > bounds->Max[a]) bounds->Max[a] = p[a];
+			}
+			if (size > bounds->MaxSize) bounds->MaxSize = size;
+			bounds->VisibleCount++;
+		}
+	}
+}
+
+void SimulateParticles(const ParticleStore& store, unsigned int first, unsigned int count,
+	const float acceleration[3], const ParticleSimOutput& out, ParticleBounds* bounds)
+{
+	SimInput in;
+	in.Ages = store.GetAges() + first;
+	in.PositionX = store.GetPositionX() + first;
+	in.PositionY = store.GetPositionY() + first;
+	in.PositionZ = store.GetPositionZ() + first;
+	in.VelocityX = store.GetVelocityX() + first;
+	in.VelocityY = store.GetVelocityY() + first;
+	in.VelocityZ = store.GetVelocityZ() + first;
+	in.StartColors = store.GetStartColors() + first * 4;
+	in.MidColors = store.GetMidColors() + first * 4;
+	in.EndColors = store.GetEndColors() + first * 4;
+	in.StartSizes = store.GetStartSizes() + first;
+	in.MidSizes = store.GetMidSizes() + first;
+	in.EndSizes = store.GetEndSizes() + first;
+	in.Types = store.GetTypes() + first;
+
+	ResetBounds(bounds);
+	SimulateRange(in, count, store.GetLifetime(), acceleration, out, 0, bounds);
+}
+
+// --------------------------------------------------------
+// Decodes a chunk of vertices the way ParticleVS does, then
+// runs it through the same simulation as the store path
+// --------------------------------------------------------
+void SimulatePackedParticles(const Particle* vertices, unsigned int count, unsigned int currentTimeMs,
+	float maxLifetime, const float acceleration[3], const ParticleSimOutput& out, ParticleBounds* bounds)
+{
+	float ages[ChunkSize];
+	float px[ChunkSize], py[ChunkSize], pz[ChunkSize];
+	float vx[ChunkSize], vy[ChunkSize], vz[ChunkSize];
+	float startColors[ChunkSize * 4], midColors[ChunkSize * 4], endColors[ChunkSize * 4];
+	float startSizes[ChunkSize], midSizes[ChunkSize], endSizes[ChunkSize];
+	int types[ChunkSize];
+
+	SimInput in = { ages, px, py, pz, vx, vy, vz, startColors, midColors, endColors, startSizes, midSizes, endSizes, types };
+
+	ResetBounds(bounds);
+	for (unsigned int start = 0; start < count; start += ChunkSize)
+	{
+		unsigned int n = count - start < ChunkSize ? count - start : ChunkSize;
+		for (unsigned int i = 0; i < n; i++)
+		{
+			const Particle& p = vertices[start + i];
+			unsigned int spawnMs = p.TypeAndSpawnTime & 0x7FFF;
+			ages[i] = ((currentTimeMs - spawnMs) & 0x7FFF) / 1000.0f;
+			types[i] = p.TypeAndSpawnTime >> 15;
+
+			px[i] = HalfToFloat(p.PositionStartSize[0]);
+			py[i] = HalfToFloat(p.PositionStartSize[1]);
+			pz[i] = HalfToFloat(p.PositionStartSize[2]);
+			startSizes[i] = HalfToFloat(p.PositionStartSize[3]);
+			vx[i] = HalfToFloat(p.VelocityMidSize[0]);
+			vy[i] = HalfToFloat(p.VelocityMidSize[1]);
+			vz[i] = HalfToFloat(p.VelocityMidSize[2]);
+			midSizes[i] = HalfToFloat(p.VelocityMidSize[3]);
+			endSizes[i] = HalfToFloat(p.EndSize);
+
+			UnpackColor(p.Colors[0], startColors + i * 4);
+			UnpackColor(p.Colors[1], midColors + i * 4);
+			UnpackColor(p.Colors[2], endColors + i * 4);
+		}
+		SimulateRange(in, n, maxLifetime, acceleration, out, start, bounds);
+	}
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+#include "Particle.h"
+#include "ParticleStore.h"
+
+// --------------------------------------------------------
+// CPU version of what ParticleVS does to each particle:
+//
+//   position = 0.5 * a * t^2 + v * t + p0
+//   color/size = quadratic Bezier over start/mid/end at t / lifetime
+//
+// Lets particle behaviour be checked (or culled, or bounded)
+// without a D3D device.  Four particles go through SSE at a
+// time, with the same operation order as the shader.
+// --------------------------------------------------------
+
+// Caller owned arrays, one entry per simulated particle
+// (Colors holds four floats, RGBA, per particle)
+struct ParticleSimOutput
+{
+	float* PositionX;
+	float* PositionY;
+	float* PositionZ;
+	float* Colors;
+	float* Sizes;
+	uint8_t* Visible;	// 0 where the geometry shader would skip it
+};
+
+// Axis aligned box around every visible particle's center
+struct ParticleBounds
+{
+	float Min[3];
+	float Max[3];
+	float MaxSize;		// Largest visible size, for padding the box
+	unsigned int VisibleCount;
+};
+
+// Simulates particles [first, first + count) of the store straight
+// from its float arrays and exact ages.  Output index 0 is particle
+// "first".  bounds can be null.
+void SimulateParticles(const ParticleStore& store, unsigned int first, unsigned int count,
+	const float acceleration[3], const ParticleSimOutput& out, ParticleBounds* bounds);
+
+// Simulates packed vertices exactly as the GPU sees them - half
+// floats, 8-bit colors and millisecond spawn times included.  This
+// is the one to compare against shader captures.
+void SimulatePackedParticles(const Particle* vertices, unsigned int count, unsigned int currentTimeMs,
+	float maxLifetime, const float acceleration[3], const ParticleSimOutput& out, ParticleBounds* bounds);
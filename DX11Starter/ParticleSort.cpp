@@ -0,0 +1,180 @@
+#include "ParticleSort.h"
+#include "JobSystem.h"
+#include <cstring>
+#include <xmmintrin.h>
+
+static const unsigned int RadixBits = 8;
+static const unsigned int RadixSize = 1 << RadixBits;
+static const unsigned int RadixPasses = 32 / RadixBits;
+
+// --------------------------------------------------------
+// Float -> key with the opposite unsigned order.  Flipping the
+// sign bit (or every bit, for negatives) makes the bits sort
+// like the floats; inverting that puts the largest depth first.
+// --------------------------------------------------------
+static inline uint32_t DepthToKey(float depth)
+{
+	uint32_t bits;
+	memcpy(&bits, &depth, sizeof(bits));
+	uint32_t mask = (bits & 0x80000000u) ? 0xFFFFFFFFu : 0x80000000u;
+	return ~(bits ^ mask);
+}
+
+ParticleDepthSorter::ParticleDepthSorter()
+{
+	sortedCount = 0;
+	minBlockSize = 4096;
+}
+
+void ParticleDepthSorter::Sort(JobSystem* jobs, const float* depths, const uint32_t* input, unsigned int count)
+{
+	sortedCount = count;
+	for (int b = 0; b < 2; b++)
+	{
+		if (keys[b].size() < count) keys[b].resize(count);
+		if (values[b].size() < count) values[b].resize(count);
+	}
+	if (count == 0) return;
+
+	// One block per thread, unless that would make them tiny
+	unsigned int threads = jobs ? jobs->GetThreadCount() : 1;
+	unsigned int blockCount = (count + minBlockSize - 1) / minBlockSize;
+	if (blockCount > threads) blockCount = threads;
+	if (blockCount < 1) blockCount = 1;
+	unsigned int blockSize = (count + blockCount - 1) / blockCount;
+	histograms.resize(blockCount * RadixSize);
+
+	// Runs body(block) for every block, in parallel if we can
+	auto forEachBlock = [&](const std::function<void(unsigned int)>& body) {
+		if (!jobs || blockCount == 1)
+		{
+			for (unsigned int b = 0; b < blockCount; b++) body(b);
+			return;
+		}
+		jobs->ParallelFor(blockCount, 1, [&](unsigned int begin, unsigned int end) {
+			for (unsigned int b = begin; b < end; b++) body(b);
+		});
+	};
+
+	// Keys
+	forEachBlock([&](unsigned int block) {
+		unsigned int begin = block * blockSize;
+		unsigned int end = begin + blockSize < count ? begin + blockSize : count;
+		for (unsigned int i = begin; i < end; i++)
+		{
+			keys[0][i] = DepthToKey(depths[i]);
+			values[0][i] = input[i];
+		}
+	});
+
+	int current = 0;
+	for (unsigned int pass = 0; pass < RadixPasses; pass++)
+	{
+		unsigned int shift = pass * RadixBits;
+		const uint32_t* srcKeys = keys[current].data();
+		const uint32_t* srcValues = values[current].data();
+		uint32_t* dstKeys = keys[current ^ 1].data();
+		uint32_t* dstValues = values[current ^ 1].data();
+
+		// Histogram each block
+		forEachBlock([&](unsigned int block) {
+			uint32_t* histogram = &histograms[block * RadixSize];
+			memset(histogram, 0, sizeof(uint32_t) * RadixSize);
+			unsigned int begin = block * blockSize;
+			unsigned int end = begin + blockSize < count ? begin + blockSize : count;
+			for (unsigned int i = begin; i < end; i++)
+				histogram[(srcKeys[i] >> shift) & (RadixSize - 1)]++;
+		});
+
+		// If every key has the same digit this pass would just copy
+		bool trivial = false;
+		for (unsigned int digit = 0; digit < RadixSize; digit++)
+		{
+			uint32_t total = 0;
+			for (unsigned int b = 0; b < blockCount; b++)
+				total += histograms[b * RadixSize + digit];
+			if (total == count) trivial = true;
+			if (total != 0) break;
+		}
+		if (trivial) continue;
+
+		// Turn the counts into each block's starting offset per digit -
+		// digit major, then block, so equal keys keep their order
+		uint32_t offset = 0;
+		for (unsigned int digit = 0; digit < RadixSize; digit++)
+		{
+			for (unsigned int b = 0; b < blockCount; b++)
+			{
+				uint32_t n = histograms[b * RadixSize + digit];
+				histograms[b * RadixSize + digit] = offset;
+				offset += n;
+			}
+		}
+
+		// Scatter
+		forEachBlock([&](unsigned int block) {
+			uint32_t* offsets = &histograms[block * RadixSize];
+			unsigned int begin = block * blockSize;
+			unsigned int end = begin + blockSize < count ? begin + blockSize : count;
+			for (unsigned int i = begin; i < end; i++)
+			{
+				uint32_t key = srcKeys[i];
+				uint32_t destination = offsets[(key >> shift) & (RadixSize - 1)]++;
+				dstKeys[destination] = key;
+				dstValues[destination] = srcValues[i];
+			}
+		});
+
+		current ^= 1;
+	}
+
+	// Results are always read from buffer 0
+	if (current != 0)
+	{
+		keys[0].swap(keys[1]);
+		values[0].swap(values[1]);
+	}
+}
+
+// --------------------------------------------------------
+// Same kinematics as ParticleVS, but only the part that feeds
+// view space z, four particles at a time
+// --------------------------------------------------------
+void ComputeParticleDepths(const ParticleStore& store, unsigned int first, unsigned int count,
+	const float acceleration[3], const float viewRow[4], float* depths)
+{
+	const float* ages = store.GetAges() + first;
+	const float* px = store.GetPositionX() + first;
+	const float* py = store.GetPositionY() + first;
+	const float* pz = store.GetPositionZ() + first;
+	const float* vx = store.GetVelocityX() + first;
+	const float* vy = store.GetVelocityY() + first;
+	const float* vz = store.GetVelocityZ() + first;
+
+	// Project the acceleration and velocity onto the view axis
+	// once, rather than building the full position
+	float accelDepth = 0.5f * (acceleration[0] * viewRow[0] + acceleration[1] * viewRow[1] + acceleration[2] * viewRow[2]);
+
+	const __m128 rx = _mm_set1_ps(viewRow[0]);
+	const __m128 ry = _mm_set1_ps(viewRow[1]);
+	const __m128 rz = _mm_set1_ps(viewRow[2]);
+	const __m128 rw = _mm_set1_ps(viewRow[3]);
+	const __m128 ad = _mm_set1_ps(accelDepth);
+
+	unsigned int i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 t = _mm_loadu_ps(ages + i);
+		__m128 p = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(px + i), rx), _mm_mul_ps(_mm_loadu_ps(py + i), ry)), _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(pz + i), rz), rw));
+		__m128 v = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(vx + i), rx), _mm_mul_ps(_mm_loadu_ps(vy + i), ry)), _mm_mul_ps(_mm_loadu_ps(vz + i), rz));
+		__m128 depth = _mm_add_ps(p, _mm_mul_ps(t, _mm_add_ps(v, _mm_mul_ps(ad, t))));
+		_mm_storeu_ps(depths + i, depth);
+	}
+	for (; i < count; i++)
+	{
+		float t = ages[i];
+		float p = px[i] * viewRow[0] + py[i] * viewRow[1] + (pz[i] * viewRow[2] + viewRow[3]);
+		float v = vx[i] * viewRow[0] + vy[i] * viewRow[1] + vz[i] * viewRow[2];
+		depths[i] = p + t * (v + accelDepth * t);
+	}
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "ParticleStore.h"
+
+class JobSystem;
+
+// --------------------------------------------------------
+// Back-to-front ordering for alpha blended particles.
+//
+// Depths are turned into 32-bit keys whose unsigned order is
+// the reverse of the float order, then sorted together with
+// their values by an LSD radix sort - four passes of 8 bits.
+// Each pass splits the input into blocks; blocks build their
+// histograms and scatter in parallel, and since every block
+// scatters to its own precomputed offsets the sort is stable.
+// --------------------------------------------------------
+class ParticleDepthSorter
+{
+public:
+	ParticleDepthSorter();
+
+	// Sorts values by depth, farthest first.  jobs can be null
+	// to sort on the calling thread.
+	void Sort(JobSystem* jobs, const float* depths, const uint32_t* values, unsigned int count);
+
+	// The values from the last Sort(), farthest first
+	const uint32_t* GetSortedValues() const { return values[0].data(); }
+	unsigned int GetSortedCount() const { return sortedCount; }
+
+	// Blocks smaller than this aren't worth a job of their own
+	void SetMinBlockSize(unsigned int size) { minBlockSize = size; }
+
+private:
+	std::vector<uint32_t> keys[2];
+	std::vector<uint32_t> values[2];
+	std::vector<uint32_t> histograms;	// 256 per block
+	unsigned int sortedCount;
+	unsigned int minBlockSize;
+};
+
+// Writes each particle's view space depth for slots [first, first + count).
+// viewRow is the third row of the (transposed, shader ready) view
+// matrix - the one that produces view space z.
+void ComputeParticleDepths(const ParticleStore& store, unsigned int first, unsigned int count,
+	const float acceleration[3], const float viewRow[4], float* depths);
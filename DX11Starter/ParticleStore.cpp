@@ -0,0 +1,217 @@
+#include "ParticleStore.h"
+#include <cstdlib>
+#include <cstring>
+#include <emmintrin.h>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+// --------------------------------------------------------
+// 16-byte aligned allocation, so SSE loads never split
+// --------------------------------------------------------
+static void* AlignedAlloc(size_t size)
+{
+#ifdef _WIN32
+	return _aligned_malloc(size, 16);
+#else
+	void* memory = nullptr;
+	if (posix_memalign(&memory, 16, size) != 0) return nullptr;
+	return memory;
+#endif
+}
+
+static void AlignedFree(void* memory)
+{
+#ifdef _WIN32
+	_aligned_free(memory);
+#else
+	free(memory);
+#endif
+}
+
+static float* AllocFloats(unsigned int count)
+{
+	float* data = (float*)AlignedAlloc(sizeof(float) * count);
+	memset(data, 0, sizeof(float) * count);
+	return data;
+}
+
+ParticleStore::ParticleStore(unsigned int capacity, float lifetime)
+{
+	// Round up so the SIMD loops always work in whole blocks of 16
+	this->capacity = (capacity + 15) & ~15u;
+	this->lifetime = lifetime;
+	liveCount = 0;
+
+	ages = AllocFloats(this->capacity);
+	positionX = AllocFloats(this->capacity);
+	positionY = AllocFloats(this->capacity);
+	positionZ = AllocFloats(this->capacity);
+	velocityX = AllocFloats(this->capacity);
+	velocityY = AllocFloats(this->capacity);
+	velocityZ = AllocFloats(this->capacity);
+	startColors = AllocFloats(this->capacity * 4);
+	midColors = AllocFloats(this->capacity * 4);
+	endColors = AllocFloats(this->capacity * 4);
+	startSizes = AllocFloats(this->capacity);
+	midSizes = AllocFloats(this->capacity);
+	endSizes = AllocFloats(this->capacity);
+	types = (int*)AlignedAlloc(sizeof(int) * this->capacity);
+
+	// Start with no particles alive
+	for (unsigned int i = 0; i < this->capacity; i++)
+	{
+		ages[i] = lifetime + 1;
+		types[i] = 0;
+	}
+}
+
+ParticleStore::~ParticleStore()
+{
+	AlignedFree(ages);
+	AlignedFree(positionX);
+	AlignedFree(positionY);
+	AlignedFree(positionZ);
+	AlignedFree(velocityX);
+	AlignedFree(velocityY);
+	AlignedFree(velocityZ);
+	AlignedFree(startColors);
+	AlignedFree(midColors);
+	AlignedFree(endColors);
+	AlignedFree(startSizes);
+	AlignedFree(midSizes);
+	AlignedFree(endSizes);
+	AlignedFree(types);
+}
+
+void ParticleStore::Initialize(unsigned int index, const ParticleSpawnDesc& desc)
+{
+	if (!IsAlive(index)) liveCount++;
+
+	ages[index] = 0;
+	positionX[index] = desc.Position[0];
+	positionY[index] = desc.Position[1];
+	positionZ[index] = desc.Position[2];
+	velocityX[index] = desc.Velocity[0];
+	velocityY[index] = desc.Velocity[1];
+	velocityZ[index] = desc.Velocity[2];
+	memcpy(&startColors[index * 4], desc.StartColor, sizeof(float) * 4);
+	memcpy(&midColors[index * 4], desc.MidColor, sizeof(float) * 4);
+	memcpy(&endColors[index * 4], desc.EndColor, sizeof(float) * 4);
+	startSizes[index] = desc.Sizes[0];
+	midSizes[index] = desc.Sizes[1];
+	endSizes[index] = desc.Sizes[2];
+	types[index] = desc.Type;
+}
+
+// --------------------------------------------------------
+// Fills a contiguous run of slots in one pass per attribute.
+// Positions and velocities are sampled straight into the SoA
+// arrays, everything else is a broadcast.
+// --------------------------------------------------------
+void ParticleStore::InitializeBurst(unsigned int first, unsigned int count, const ParticleBurstDesc& desc, ParticleRandom& random)
+{
+	unsigned int end = first + count;
+	for (unsigned int i = first; i < end; i++)
+		if (!IsAlive(i)) liveCount++;
+
+	SampleParticleShape(desc.Position, random, positionX + first, positionY + first, positionZ + first, count);
+	SampleParticleShape(desc.Velocity, random, velocityX + first, velocityY + first, velocityZ + first, count);
+
+	for (unsigned int i = first; i < end; i++)
+	{
+		ages[i] = 0;
+		startSizes[i] = desc.Sizes[0];
+		midSizes[i] = desc.Sizes[1];
+		endSizes[i] = desc.Sizes[2];
+		types[i] = desc.Type;
+	}
+
+	for (unsigned int i = first; i < end; i++)
+	{
+		memcpy(&startColors[i * 4], desc.StartColor, sizeof(float) * 4);
+		memcpy(&midColors[i * 4], desc.MidColor, sizeof(float) * 4);
+		memcpy(&endColors[i * 4], desc.EndColor, sizeof(float) * 4);
+	}
+}
+
+// --------------------------------------------------------
+// A shorter lifetime kills everything already past it, so the
+// live count is redone from scratch either way
+// --------------------------------------------------------
+void ParticleStore::SetLifetime(float lifetime)
+{
+	if (lifetime > this->lifetime)
+	{
+		// Push the dead past the new limit so none come back
+		for (unsigned int i = 0; i < capacity; i++)
+			if (ages[i] >= this->lifetime && ages[i] < lifetime + 1)
+				ages[i] = lifetime + 1;
+	}
+	this->lifetime = lifetime;
+	liveCount = CountLiving();
+}
+
+void ParticleStore::Kill(unsigned int index)
+{
+	if (!IsAlive(index)) return;
+	ages[index] = lifetime + 1;
+	liveCount--;
+}
+
+// --------------------------------------------------------
+// Ages 16 particles per iteration (four SSE registers) and
+// counts how many are still alive afterwards.  Compare masks
+// are all ones (-1) for living lanes, so subtracting them from
+// an integer accumulator counts without leaving SSE2.
+// --------------------------------------------------------
+void ParticleStore::Age(float dt)
+{
+	__m128 delta = _mm_set1_ps(dt);
+	__m128 limit = _mm_set1_ps(lifetime);
+	__m128i living = _mm_setzero_si128();
+
+	for (unsigned int i = 0; i < capacity; i += 16)
+	{
+		__m128 a0 = _mm_add_ps(_mm_load_ps(ages + i), delta);
+		__m128 a1 = _mm_add_ps(_mm_load_ps(ages + i + 4), delta);
+		__m128 a2 = _mm_add_ps(_mm_load_ps(ages + i + 8), delta);
+		__m128 a3 = _mm_add_ps(_mm_load_ps(ages + i + 12), delta);
+
+		_mm_store_ps(ages + i, a0);
+		_mm_store_ps(ages + i + 4, a1);
+		_mm_store_ps(ages + i + 8, a2);
+		_mm_store_ps(ages + i + 12, a3);
+
+		living = _mm_sub_epi32(living, _mm_castps_si128(_mm_cmplt_ps(a0, limit)));
+		living = _mm_sub_epi32(living, _mm_castps_si128(_mm_cmplt_ps(a1, limit)));
+		living = _mm_sub_epi32(living, _mm_castps_si128(_mm_cmplt_ps(a2, limit)));
+		living = _mm_sub_epi32(living, _mm_castps_si128(_mm_cmplt_ps(a3, limit)));
+	}
+
+	// Sum the four lanes
+	int lanes[4];
+	_mm_storeu_si128((__m128i*)lanes, living);
+	liveCount = (unsigned int)(lanes[0] + lanes[1] + lanes[2] + lanes[3]);
+}
+
+// --------------------------------------------------------
+// Same counting trick as Age(), without touching the ages
+// --------------------------------------------------------
+unsigned int ParticleStore::CountLiving() const
+{
+	__m128 limit = _mm_set1_ps(lifetime);
+	__m128i living = _mm_setzero_si128();
+
+	for (unsigned int i = 0; i < capacity; i += 16)
+	{
+		living = _mm_sub_epi32(living, _mm_castps_si128(_mm_cmplt_ps(_mm_load_ps(ages + i), limit)));
+		living = _mm_sub_epi32(living, _mm_castps_si128(_mm_cmplt_ps(_mm_load_ps(ages + i + 4), limit)));
+		living = _mm_sub_epi32(living, _mm_castps_si128(_mm_cmplt_ps(_mm_load_ps(ages + i + 8), limit)));
+		living = _mm_sub_epi32(living, _mm_castps_si128(_mm_cmplt_ps(_mm_load_ps(ages + i + 12), limit)));
+	}
+
+	int lanes[4];
+	_mm_storeu_si128((__m128i*)lanes, living);
+	return (unsigned int)(lanes[0] + lanes[1] + lanes[2] + lanes[3]);
+}
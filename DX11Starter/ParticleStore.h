@@ -0,0 +1,98 @@
+#pragma once
+#include "ParticleBurst.h"
+
+// --------------------------------------------------------
+// Everything needed to start one particle
+// --------------------------------------------------------
+struct ParticleSpawnDesc
+{
+	float Position[3];
+	float Velocity[3];
+	float StartColor[4];
+	float MidColor[4];
+	float EndColor[4];
+	float Sizes[3];		// Start, mid, end
+	int Type;
+};
+
+// --------------------------------------------------------
+// Structure-of-arrays particle storage.  Each attribute lives
+// in its own 16-byte aligned array, so the per-frame aging
+// pass only streams through ages instead of striding over
+// whole particles.  Capacity is rounded up to a multiple of
+// 16 so the SIMD loops never need a scalar tail; the padding
+// slots are permanently dead.
+//
+// A particle is alive while its age is below the lifetime.
+// --------------------------------------------------------
+class ParticleStore
+{
+public:
+	ParticleStore(unsigned int capacity, float lifetime);
+	~ParticleStore();
+
+	// Writes a particle into the given slot and makes it alive
+	void Initialize(unsigned int index, const ParticleSpawnDesc& desc);
+
+	// Starts count particles in slots [first, first + count), picking
+	// positions and velocities from the burst's shapes
+	void InitializeBurst(unsigned int first, unsigned int count, const ParticleBurstDesc& desc, ParticleRandom& random);
+
+	// Changes how long particles live, including ones already alive,
+	// and recounts them.  Dead particles stay dead even if the
+	// lifetime grows.
+	void SetLifetime(float lifetime);
+
+	// Ends a particle early
+	void Kill(unsigned int index);
+
+	// Adds dt to every age and recounts the living
+	void Age(float dt);
+
+	bool IsAlive(unsigned int index) const { return ages[index] < lifetime; }
+	unsigned int GetCapacity() const { return capacity; }
+	unsigned int GetLiveCount() const { return liveCount; }
+	float GetLifetime() const { return lifetime; }
+
+	// Attribute arrays (capacity entries each, colors are RGBA)
+	const float* GetAges() const { return ages; }
+	const float* GetPositionX() const { return positionX; }
+	const float* GetPositionY() const { return positionY; }
+	const float* GetPositionZ() const { return positionZ; }
+	const float* GetVelocityX() const { return velocityX; }
+	const float* GetVelocityY() const { return velocityY; }
+	const float* GetVelocityZ() const { return velocityZ; }
+	const float* GetStartColors() const { return startColors; }
+	const float* GetMidColors() const { return midColors; }
+	const float* GetEndColors() const { return endColors; }
+	const float* GetStartSizes() const { return startSizes; }
+	const float* GetMidSizes() const { return midSizes; }
+	const float* GetEndSizes() const { return endSizes; }
+	const int* GetTypes() const { return types; }
+
+private:
+	unsigned int capacity;
+	unsigned int liveCount;
+	float lifetime;
+
+	float* ages;
+	float* positionX;
+	float* positionY;
+	float* positionZ;
+	float* velocityX;
+	float* velocityY;
+	float* velocityZ;
+	float* startColors;
+	float* midColors;
+	float* endColors;
+	float* startSizes;
+	float* midSizes;
+	float* endSizes;
+	int* types;
+
+	unsigned int CountLiving() const;
+
+	// Not copyable - owns raw aligned arrays
+	ParticleStore(const ParticleStore&);
+	ParticleStore& operator=(const ParticleStore&);
+};
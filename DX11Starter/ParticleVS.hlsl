@@ -1,14 +1,11 @@
 
+// Packed 32-byte particle - see Particle.h
 struct VSInput
 {
-	int type			: TEXCOORD0;
-	float age			: TEXCOORD1;
-	float3 startPos		: POSITION;
-	float3 startVel		: TEXCOORD2;
-	float4 startColor	: COLOR0;
-	float4 midColor		: COLOR1;
-	float4 endColor		: COLOR2;
-	float3 sizes		: TEXCOORD3;
+	uint2 positionStartSize	: POSITION;		// Half x, y, z, start size
+	uint2 velocityMidSize	: TEXCOORD0;	// Half x, y, z, mid size
+	uint endSizeTypeTime	: TEXCOORD1;	// Half end size, type << 15 | spawn ms
+	uint3 colors			: COLOR0;		// RGBA8 start, mid, end
 };
 
 struct VStoGS
@@ -23,6 +20,22 @@ cbuffer externalData : register(b0)
 {
 	float3 acceleration;
 	float maxLifetime;
+	uint currentTimeMs;
+}
+
+// Unpacking helpers
+float2 UnpackHalves(uint value)
+{
+	return float2(f16tof32(value & 0xFFFF), f16tof32(value >> 16));
+}
+
+float4 UnpackColor(uint color)
+{
+	return float4(
+		color & 0xFF,
+		(color >> 8) & 0xFF,
+		(color >> 16) & 0xFF,
+		color >> 24) / 255.0f;
 }
 
 // Helpers for interpolation
@@ -62,20 +75,36 @@ VStoGS main(VSInput input)
 {
 	// Set up output
 	VStoGS output;
-	output.type = input.type;
-	if (input.age > maxLifetime) {
+	output.type = input.endSizeTypeTime >> 31;
+
+	// Vertices only hold the spawn time (in milliseconds, modulo
+	// 32768), so they don't need uploading again as the particle
+	// ages.  A particle spawned after this frame was recorded
+	// wraps around to a huge age and gets skipped.
+	uint spawnMs = (input.endSizeTypeTime >> 16) & 0x7FFF;
+	float age = ((currentTimeMs - spawnMs) & 0x7FFF) / 1000.0f;
+	if (age > maxLifetime) {
 		output.type = 0;
 		return output;
 	}
+
+	float2 posXY = UnpackHalves(input.positionStartSize.x);
+	float2 posZStart = UnpackHalves(input.positionStartSize.y);
+	float2 velXY = UnpackHalves(input.velocityMidSize.x);
+	float2 velZMid = UnpackHalves(input.velocityMidSize.y);
+	float endSize = f16tof32(input.endSizeTypeTime & 0xFFFF);
+
+	float3 startPos = float3(posXY, posZStart.x);
+	float3 startVel = float3(velXY, velZMid.x);
 	
 	// Handle the position
-	float t = input.age;
-	output.position = 0.5f * t * t * acceleration + t * input.startVel + input.startPos;
+	float t = age;
+	output.position = 0.5f * t * t * acceleration + t * startVel + startPos;
 
 	// Interpolate the color and size
 	float agePercent = t / maxLifetime;
-	output.color = BezierCurve(input.startColor, input.midColor, input.endColor, agePercent);
-	output.size = BezierCurve(input.sizes.x, input.sizes.y, input.sizes.z, agePercent);
+	output.color = BezierCurve(UnpackColor(input.colors.x), UnpackColor(input.colors.y), UnpackColor(input.colors.z), agePercent);
+	output.size = BezierCurve(posZStart.y, velZMid.y, endSize, agePercent);
 	
 	return output;
 }
\ No newline at end of file
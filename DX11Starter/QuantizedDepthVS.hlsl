@@ -0,0 +1,44 @@
+
+// Same as DepthVS.hlsl, for meshes stored as 16-byte
+// QuantizedVertex - see QuantizedVS.hlsl
+struct Quantization
+{
+	float3 positionOffset;
+	float padding0;
+	float3 positionScale;
+	float padding1;
+	float2 uvOffset;
+	float2 uvScale;
+};
+
+cbuffer externalData : register(b0)
+{
+	matrix world;
+	matrix view;
+	matrix projection;
+	Quantization quantization;
+};
+
+struct VertexShaderInput
+{
+	float3 position		: POSITION_UNORM;
+	float2 normal		: NORMAL_SNORM;
+	float2 uv			: TEXCOORD_UNORM;
+};
+
+struct VertexToPixel
+{
+	float4 position		: SV_POSITION;
+};
+
+VertexToPixel main(VertexShaderInput input)
+{
+	VertexToPixel output;
+
+	float3 position = quantization.positionOffset + input.position * quantization.positionScale;
+
+	matrix worldViewProj = mul(mul(world, view), projection);
+	output.position = mul(float4(position, 1.0f), worldViewProj);
+
+	return output;
+}
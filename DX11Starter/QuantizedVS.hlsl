@@ -0,0 +1,63 @@
+
+// Same as VertexShader.hlsl, for meshes stored as 16-byte
+// QuantizedVertex - see VertexQuantize.h
+struct Quantization
+{
+	float3 positionOffset;
+	float padding0;
+	float3 positionScale;
+	float padding1;
+	float2 uvOffset;
+	float2 uvScale;
+};
+
+cbuffer externalData : register(b0)
+{
+	matrix world;
+	matrix view;
+	matrix projection;
+	Quantization quantization;
+};
+
+// The _UNORM / _SNORM semantics make SimpleShader pick 16-bit
+// normalized formats, so these arrive already in [0, 1] / [-1, 1]
+struct VertexShaderInput
+{
+	float3 position		: POSITION_UNORM;	// Across the mesh's bounds
+	float2 normal		: NORMAL_SNORM;		// Octahedral
+	float2 uv			: TEXCOORD_UNORM;	// Across the mesh's UV range
+};
+
+struct VertexToPixel
+{
+	float4 position		: SV_POSITION;
+	float3 normal		: NORMAL;
+	float2 uv			: TEXCOORD;
+};
+
+// Matches DecodeOctahedral in VertexQuantize.cpp
+float3 DecodeOctahedral(float2 e)
+{
+	float3 n = float3(e, 1.0f - abs(e.x) - abs(e.y));
+	if (n.z < 0)
+	{
+		float2 signs = float2(n.x >= 0 ? 1.0f : -1.0f, n.y >= 0 ? 1.0f : -1.0f);
+		n.xy = (1.0f - abs(n.yx)) * signs;
+	}
+	return normalize(n);
+}
+
+VertexToPixel main(VertexShaderInput input)
+{
+	VertexToPixel output;
+
+	float3 position = quantization.positionOffset + input.position * quantization.positionScale;
+	float3 normal = DecodeOctahedral(input.normal);
+
+	matrix worldViewProj = mul(mul(world, view), projection);
+	output.position = mul(float4(position, 1.0f), worldViewProj);
+	output.normal = mul(normal, (float3x3)world);
+	output.uv = quantization.uvOffset + input.uv * quantization.uvScale;
+
+	return output;
+}
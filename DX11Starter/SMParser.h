@@ -6,6 +6,12 @@
 
 using namespace std;
 
+// a tempo change, at a beat position in the chart
+struct BpmChange {
+	float Beat;
+	float Bpm;
+};
+
 // parses stepmania (.sm) files 
 class SMParser {
 public:
@@ -19,6 +25,10 @@ public:
 	int MaxNotesPerMeasure = 4;
 	// current measure
 	int measureNum = 0;
+	// every tempo change, in beat order (the first is at beat 0)
+	vector<BpmChange> BpmChanges;
+	// seconds of music before beat 0 (negative when the music starts early)
+	float Offset = 0;
 
 	// returns success
 	bool OpenFile(char* filepath) {
@@ -38,13 +48,24 @@ public:
 				// debug - print out every line in the file
 	//			cout << line << '\n';
 
+				// song offset comes before the bpms
+				if (line.find("#OFFSET:") != string::npos) {
+					Offset = stof(line.substr(line.find(":") + 1));
+				}
+
 				// look for beats per minute
 				if (!bpmsFound) {
 					if (line.find("#BPMS:") != string::npos) {
-						int startIdx = line.find("=") + 1;
-						// get bpms and convert string to int
-						BPMS = stoi(line.substr(startIdx));
+						// the list can run over several lines, up to the ';'
+						string value = line.substr(line.find(":") + 1);
+						while (value.find(";") == string::npos && getline(myfile, line)) {
+							value += line;
+						}
+						ParseBpms(value.substr(0, value.find(";")));
+						// first tempo, as an int, for the rest of the game
+						BPMS = BpmChanges.empty() ? 0 : (int)BpmChanges[0].Bpm;
 						bpmsFound = true;
+						continue;
 					}
 					else {
 						continue;
@@ -109,7 +130,57 @@ public:
 	int GetNote(int measure, int index) {
 		return measures[measure][index];
 	}
+
+	int GetMeasureCount() {
+		return measures.size();
+	}
+
+	// song time of a beat, following every tempo change
+	double BeatToSeconds(double beat) const {
+		double seconds = -Offset;
+		for (size_t i = 0; i < BpmChanges.size(); i++) {
+			double start = BpmChanges[i].Beat;
+			if (beat <= start) break;
+			double end = i + 1 < BpmChanges.size() ? BpmChanges[i + 1].Beat : beat;
+			if (end > beat) end = beat;
+			seconds += (end - start) * 60.0 / BpmChanges[i].Bpm;
+		}
+		return seconds;
+	}
+
+	// beat at a song time - the inverse of BeatToSeconds
+	double SecondsToBeat(double seconds) const {
+		double elapsed = seconds + Offset;
+		for (size_t i = 0; i < BpmChanges.size(); i++) {
+			double segmentBeats = i + 1 < BpmChanges.size() ? BpmChanges[i + 1].Beat - BpmChanges[i].Beat : -1;
+			double segmentSeconds = segmentBeats * 60.0 / BpmChanges[i].Bpm;
+			if (segmentBeats < 0 || elapsed < segmentSeconds) {
+				return BpmChanges[i].Beat + elapsed * BpmChanges[i].Bpm / 60.0;
+			}
+			elapsed -= segmentSeconds;
+		}
+		return 0;
+	}
 private:
+	// "beat=bpm,beat=bpm,..."
+	void ParseBpms(string value) {
+		BpmChanges.clear();
+		size_t start = 0;
+		while (start < value.size()) {
+			size_t end = value.find(",", start);
+			if (end == string::npos) end = value.size();
+			string pair = value.substr(start, end - start);
+			size_t equals = pair.find("=");
+			if (equals != string::npos) {
+				BpmChange change;
+				change.Beat = stof(pair.substr(0, equals));
+				change.Bpm = stof(pair.substr(equals + 1));
+				if (change.Bpm > 0) BpmChanges.push_back(change);
+			}
+			start = end + 1;
+		}
+	}
+
 	// takes the 
 	int NoteFromLine(string input) {
 		int numValuesPerLine = 4;
@@ -0,0 +1,177 @@
+#include "ShaderReflectionCache.h"
+#include "Hash.h"
+#include "CacheIO.h"
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+// "SRFL" read as a little-endian 32-bit value
+static const uint32_t CacheMagic = 0x4C465253;
+
+std::string ShaderReflectionCache::CacheDirectory = "ShaderCache";
+
+uint64_t ShaderReflectionCache::HashShaderCode(const void* code, size_t size)
+{
+	return HashBytes(code, size);
+}
+
+// --------------------------------------------------------
+// Flattens the reflection data into a byte array
+//
+// data     - The tables to write
+// codeHash - Hash of the shader code the tables came from
+// out      - Receives the serialized bytes
+// --------------------------------------------------------
+void ShaderReflectionCache::Serialize(const ShaderReflectionData& data, uint64_t codeHash, std::vector<unsigned char>& out)
+{
+	out.clear();
+	WriteU32(out, CacheMagic);
+	WriteU32(out, FormatVersion);
+	WriteU64(out, codeHash);
+
+	WriteU32(out, (uint32_t)data.ConstantBuffers.size());
+	for (const CachedConstantBuffer& cb : data.ConstantBuffers)
+	{
+		WriteString(out, cb.Name);
+		WriteU32(out, cb.Size);
+		WriteU32(out, cb.BindIndex);
+		WriteU32(out, (uint32_t)cb.Variables.size());
+		for (const CachedShaderVariable& var : cb.Variables)
+		{
+			WriteString(out, var.Name);
+			WriteU32(out, var.ByteOffset);
+			WriteU32(out, var.Size);
+		}
+	}
+
+	WriteU32(out, (uint32_t)data.Textures.size());
+	for (const CachedBoundResource& res : data.Textures)
+	{
+		WriteString(out, res.Name);
+		WriteU32(out, res.BindIndex);
+	}
+
+	WriteU32(out, (uint32_t)data.Samplers.size());
+	for (const CachedBoundResource& res : data.Samplers)
+	{
+		WriteString(out, res.Name);
+		WriteU32(out, res.BindIndex);
+	}
+
+	WriteU32(out, (uint32_t)data.InputParameters.size());
+	for (const CachedInputParameter& param : data.InputParameters)
+	{
+		WriteString(out, param.SemanticName);
+		WriteU32(out, param.SemanticIndex);
+		WriteU32(out, param.Mask);
+		WriteU32(out, param.ComponentType);
+	}
+}
+
+// --------------------------------------------------------
+// Rebuilds reflection data from serialized bytes
+//
+// Returns false if the bytes are truncated, from another
+// format version, or were written for different shader code
+// --------------------------------------------------------
+bool ShaderReflectionCache::Deserialize(const unsigned char* bytes, size_t size, uint64_t codeHash, ShaderReflectionData& out)
+{
+	CacheReader reader = { bytes, size, 0, true };
+	if (reader.U32() != CacheMagic) return false;
+	if (reader.U32() != FormatVersion) return false;
+	if (reader.U64() != codeHash) return false;
+
+	ShaderReflectionData data;
+
+	// Smallest possible entries: empty strings plus their fixed fields
+	data.ConstantBuffers.resize(reader.Count(16));
+	for (CachedConstantBuffer& cb : data.ConstantBuffers)
+	{
+		cb.Name = reader.String();
+		cb.Size = reader.U32();
+		cb.BindIndex = reader.U32();
+		cb.Variables.resize(reader.Count(12));
+		for (CachedShaderVariable& var : cb.Variables)
+		{
+			var.Name = reader.String();
+			var.ByteOffset = reader.U32();
+			var.Size = reader.U32();
+		}
+	}
+
+	data.Textures.resize(reader.Count(8));
+	for (CachedBoundResource& res : data.Textures)
+	{
+		res.Name = reader.String();
+		res.BindIndex = reader.U32();
+	}
+
+	data.Samplers.resize(reader.Count(8));
+	for (CachedBoundResource& res : data.Samplers)
+	{
+		res.Name = reader.String();
+		res.BindIndex = reader.U32();
+	}
+
+	data.InputParameters.resize(reader.Count(16));
+	for (CachedInputParameter& param : data.InputParameters)
+	{
+		param.SemanticName = reader.String();
+		param.SemanticIndex = reader.U32();
+		param.Mask = reader.U32();
+		param.ComponentType = reader.U32();
+	}
+
+	// Trailing bytes mean this isn't a file we wrote
+	if (!reader.ok || reader.pos != size) return false;
+
+	out = data;
+	return true;
+}
+
+std::string ShaderReflectionCache::GetCachePath(uint64_t codeHash)
+{
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.refl", (unsigned long long)codeHash);
+	return CacheDirectory + "/" + name;
+}
+
+// --------------------------------------------------------
+// Loads the cached tables for the given shader code hash
+// --------------------------------------------------------
+bool ShaderReflectionCache::Load(uint64_t codeHash, ShaderReflectionData& out)
+{
+	std::ifstream file(GetCachePath(codeHash), std::ios::binary);
+	if (!file.is_open()) return false;
+
+	std::vector<unsigned char> bytes(
+		(std::istreambuf_iterator<char>(file)),
+		std::istreambuf_iterator<char>());
+
+	return Deserialize(bytes.data(), bytes.size(), codeHash, out);
+}
+
+// --------------------------------------------------------
+// Writes the tables for the given shader code hash, creating
+// the cache folder if it isn't there yet
+// --------------------------------------------------------
+bool ShaderReflectionCache::Save(uint64_t codeHash, const ShaderReflectionData& data)
+{
+#ifdef _WIN32
+	_mkdir(CacheDirectory.c_str());
+#else
+	mkdir(CacheDirectory.c_str(), 0755);
+#endif
+
+	std::vector<unsigned char> bytes;
+	Serialize(data, codeHash, bytes);
+
+	std::ofstream file(GetCachePath(codeHash), std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) return false;
+	file.write((const char*)bytes.data(), bytes.size());
+	return file.good();
+}
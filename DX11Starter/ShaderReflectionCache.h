@@ -0,0 +1,73 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------
+// Plain copies of the information SimpleShader pulls out of
+// shader reflection.  Nothing here depends on DirectX, so the
+// cache format can be read and written on any platform.
+// --------------------------------------------------------
+struct CachedShaderVariable
+{
+	std::string Name;
+	unsigned int ByteOffset;
+	unsigned int Size;
+};
+
+struct CachedConstantBuffer
+{
+	std::string Name;
+	unsigned int Size;
+	unsigned int BindIndex;
+	std::vector<CachedShaderVariable> Variables;
+};
+
+struct CachedBoundResource
+{
+	std::string Name;
+	unsigned int BindIndex;
+};
+
+struct CachedInputParameter
+{
+	std::string SemanticName;
+	unsigned int SemanticIndex;
+	unsigned int Mask;
+	unsigned int ComponentType;	// D3D_REGISTER_COMPONENT_TYPE
+};
+
+struct ShaderReflectionData
+{
+	std::vector<CachedConstantBuffer> ConstantBuffers;
+	std::vector<CachedBoundResource> Textures;
+	std::vector<CachedBoundResource> Samplers;
+	std::vector<CachedInputParameter> InputParameters;
+};
+
+// --------------------------------------------------------
+// Reads and writes ShaderReflectionData as a compact binary
+// blob, keyed by a hash of the compiled shader code.  A
+// shader that has been rebuilt hashes differently, so a
+// stale entry is simply never found.
+// --------------------------------------------------------
+class ShaderReflectionCache
+{
+public:
+	// Bump whenever the binary layout changes
+	static const uint32_t FormatVersion = 1;
+
+	// Folder (relative to the working directory) holding cache files
+	static std::string CacheDirectory;
+
+	static uint64_t HashShaderCode(const void* code, size_t size);
+
+	// In-memory serialization
+	static void Serialize(const ShaderReflectionData& data, uint64_t codeHash, std::vector<unsigned char>& out);
+	static bool Deserialize(const unsigned char* bytes, size_t size, uint64_t codeHash, ShaderReflectionData& out);
+
+	// File helpers - return false on a miss or any I/O problem
+	static std::string GetCachePath(uint64_t codeHash);
+	static bool Load(uint64_t codeHash, ShaderReflectionData& out);
+	static bool Save(uint64_t codeHash, const ShaderReflectionData& data);
+};
@@ -66,15 +66,59 @@ void ISimpleShader::CleanUp()
 // reflection.  This must be a separate step from the constructor since
 // we can't invoke derived class overrides in the base class constructor.
 //
+// Reflection results are cached on disk, keyed by a hash of the
+// compiled code, so later launches skip D3DReflect entirely.
+//
 // shaderFile - A "wide string" specifying the compiled shader to load
 // 
 // Returns true if shader is loaded properly, false otherwise
 // --------------------------------------------------------
 bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
+{
+	return ReadShaderFile(shaderFile) && CreateShaderObjects();
+}
+
+// --------------------------------------------------------
+// First half of LoadShaderFile - reads the compiled code and
+// its reflection tables.  Safe on a worker thread.
+//
+// shaderFile - A "wide string" specifying the compiled shader to load
+//
+// Returns false if the file can't be read
+// --------------------------------------------------------
+bool ISimpleShader::ReadShaderFile(LPCWSTR shaderFile)
 {
 	// Load the shader to a blob and ensure it worked
 	HRESULT hr = D3DReadFileToBlob(shaderFile, &shaderBlob);
 	if (hr != S_OK)
+	{
+		shaderBlob = 0;
+		return false;
+	}
+
+	// Grab the reflection tables, either from the cache or
+	// by reflecting now (and saving them for next time)
+	uint64_t codeHash = ShaderReflectionCache::HashShaderCode(
+		shaderBlob->GetBufferPointer(),
+		shaderBlob->GetBufferSize());
+	if (!ShaderReflectionCache::Load(codeHash, reflectionData))
+	{
+		ReflectShader(shaderBlob);
+		ShaderReflectionCache::Save(codeHash, reflectionData);
+	}
+	return true;
+}
+
+// --------------------------------------------------------
+// Second half of LoadShaderFile - creates the shader, its
+// constant buffers and the variable tables from what
+// ReadShaderFile found.  Owning thread only.
+//
+// Returns false if there's no code or the shader is invalid
+// --------------------------------------------------------
+bool ISimpleShader::CreateShaderObjects()
+{
+	if (!shaderBlob)
 	{
 		return false;
 	}
@@ -87,6 +131,88 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		return false;
 	}
 
+	// Create resource arrays
+	constantBufferCount = (unsigned int)reflectionData.ConstantBuffers.size();
+	constantBuffers = new SimpleConstantBuffer[constantBufferCount];
+	
+	// Handle bound resources (like shaders and samplers)
+	for (const CachedBoundResource& texture : reflectionData.Textures)
+	{
+		// Create the SRV wrapper
+		SimpleSRV* srv = new SimpleSRV();
+		srv->BindIndex = texture.BindIndex;			// Shader bind point
+		srv->Index = shaderResourceViews.size();	// Raw index
+
+		textureTable.insert(std::pair<std::string, SimpleSRV*>(texture.Name, srv));
+		shaderResourceViews.push_back(srv);
+	}
+
+	for (const CachedBoundResource& sampler : reflectionData.Samplers)
+	{
+		// Create the sampler wrapper
+		SimpleSampler* samp = new SimpleSampler();
+		samp->BindIndex = sampler.BindIndex;		// Shader bind point
+		samp->Index = samplerStates.size();			// Raw index
+
+		samplerTable.insert(std::pair<std::string, SimpleSampler*>(sampler.Name, samp));
+		samplerStates.push_back(samp);
+	}
+
+	// Loop through all constant buffers
+	for (unsigned int b = 0; b < constantBufferCount; b++)
+	{
+		const CachedConstantBuffer& bufferDesc = reflectionData.ConstantBuffers[b];
+		
+		// Set up the buffer and put its pointer in the table
+		constantBuffers[b].BindIndex = bufferDesc.BindIndex;
+		constantBuffers[b].Name = bufferDesc.Name;
+		cbTable.insert(std::pair<std::string, SimpleConstantBuffer*>(bufferDesc.Name, &constantBuffers[b]));
+
+		// Create this constant buffer
+		D3D11_BUFFER_DESC newBuffDesc;
+		newBuffDesc.Usage = D3D11_USAGE_DEFAULT;
+		newBuffDesc.ByteWidth = bufferDesc.Size;
+		newBuffDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+		newBuffDesc.CPUAccessFlags = 0;
+		newBuffDesc.MiscFlags = 0;
+		newBuffDesc.StructureByteStride = 0;
+		device->CreateBuffer(&newBuffDesc, 0, &constantBuffers[b].ConstantBuffer);
+
+		// Set up the data buffer for this constant buffer
+		constantBuffers[b].Size = bufferDesc.Size;
+		constantBuffers[b].LocalDataBuffer = new unsigned char[bufferDesc.Size];
+		ZeroMemory(constantBuffers[b].LocalDataBuffer, bufferDesc.Size);
+
+		// Loop through all variables in this buffer
+		for (const CachedShaderVariable& var : bufferDesc.Variables)
+		{
+			// Create the variable struct
+			SimpleShaderVariable varStruct;
+			varStruct.ConstantBufferIndex = b;
+			varStruct.ByteOffset = var.ByteOffset;
+			varStruct.Size = var.Size;
+
+			// Add this variable to the table and the constant buffer
+			varTable.insert(std::pair<std::string, SimpleShaderVariable>(var.Name, varStruct));
+			constantBuffers[b].Variables.push_back(varStruct);
+		}
+	}
+
+	// All set
+	return true;
+}
+
+// --------------------------------------------------------
+// Uses shader reflection to pull out everything LoadShaderFile
+// and the derived classes need: constant buffers and their
+// variables, bound textures and samplers, and the input signature.
+//
+// shaderBlob - The shader's compiled code
+// --------------------------------------------------------
+void ISimpleShader::ReflectShader(ID3DBlob* shaderBlob)
+{
+	reflectionData = ShaderReflectionData();
+
 	// Set up shader reflection to get information about
 	// this shader and its variables,  buffers, etc.
 	ID3D11ShaderReflection* refl;
@@ -100,10 +226,6 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 	D3D11_SHADER_DESC shaderDesc;
 	refl->GetDesc(&shaderDesc);
 
-	// Create resource arrays
-	constantBufferCount = shaderDesc.ConstantBuffers;
-	constantBuffers = new SimpleConstantBuffer[constantBufferCount];
-	
 	// Handle bound resources (like shaders and samplers)
 	unsigned int resourceCount = shaderDesc.BoundResources;
 	for (unsigned int r = 0; r < resourceCount; r++)
@@ -112,37 +234,25 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		D3D11_SHADER_INPUT_BIND_DESC resourceDesc;
 		refl->GetResourceBindingDesc(r, &resourceDesc);
 
+		CachedBoundResource resource;
+		resource.Name = resourceDesc.Name;
+		resource.BindIndex = resourceDesc.BindPoint;
+
 		// Check the type
 		switch (resourceDesc.Type)
 		{
 		case D3D_SIT_TEXTURE: // A texture resource
-		{
-			// Create the SRV wrapper
-			SimpleSRV* srv = new SimpleSRV();
-			srv->BindIndex = resourceDesc.BindPoint;	// Shader bind point
-			srv->Index = shaderResourceViews.size();	// Raw index
-
-			textureTable.insert(std::pair<std::string, SimpleSRV*>(resourceDesc.Name, srv));
-			shaderResourceViews.push_back(srv);
-		}
+			reflectionData.Textures.push_back(resource);
 			break;
 
 		case D3D_SIT_SAMPLER: // A sampler resource
-		{
-			// Create the sampler wrapper
-			SimpleSampler* samp = new SimpleSampler();
-			samp->BindIndex = resourceDesc.BindPoint;	// Shader bind point
-			samp->Index = samplerStates.size();			// Raw index
-
-			samplerTable.insert(std::pair<std::string, SimpleSampler*>(resourceDesc.Name, samp));
-			samplerStates.push_back(samp);
-		}
+			reflectionData.Samplers.push_back(resource);
 			break;
 		}
 	}
 
 	// Loop through all constant buffers
-	for (unsigned int b = 0; b < constantBufferCount; b++)
+	for (unsigned int b = 0; b < shaderDesc.ConstantBuffers; b++)
 	{
 		// Get this buffer
 		ID3D11ShaderReflectionConstantBuffer* cb =
@@ -156,26 +266,11 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		// we know exactly how it's bound in the shader
 		D3D11_SHADER_INPUT_BIND_DESC bindDesc;
 		refl->GetResourceBindingDescByName(bufferDesc.Name, &bindDesc);
-		
-		// Set up the buffer and put its pointer in the table
-		constantBuffers[b].BindIndex = bindDesc.BindPoint;
-		constantBuffers[b].Name = bufferDesc.Name;
-		cbTable.insert(std::pair<std::string, SimpleConstantBuffer*>(bufferDesc.Name, &constantBuffers[b]));
 
-		// Create this constant buffer
-		D3D11_BUFFER_DESC newBuffDesc;
-		newBuffDesc.Usage = D3D11_USAGE_DEFAULT;
-		newBuffDesc.ByteWidth = bufferDesc.Size;
-		newBuffDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-		newBuffDesc.CPUAccessFlags = 0;
-		newBuffDesc.MiscFlags = 0;
-		newBuffDesc.StructureByteStride = 0;
-		device->CreateBuffer(&newBuffDesc, 0, &constantBuffers[b].ConstantBuffer);
-
-		// Set up the data buffer for this constant buffer
-		constantBuffers[b].Size = bufferDesc.Size;
-		constantBuffers[b].LocalDataBuffer = new unsigned char[bufferDesc.Size];
-		ZeroMemory(constantBuffers[b].LocalDataBuffer, bufferDesc.Size);
+		CachedConstantBuffer buffer;
+		buffer.Name = bufferDesc.Name;
+		buffer.Size = bufferDesc.Size;
+		buffer.BindIndex = bindDesc.BindPoint;
 
 		// Loop through all variables in this buffer
 		for (unsigned int v = 0; v < bufferDesc.Variables; v++)
@@ -188,24 +283,32 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 			D3D11_SHADER_VARIABLE_DESC varDesc;
 			var->GetDesc(&varDesc);
 
-			// Create the variable struct
-			SimpleShaderVariable varStruct;
-			varStruct.ConstantBufferIndex = b;
-			varStruct.ByteOffset = varDesc.StartOffset;
-			varStruct.Size = varDesc.Size;
-			
-			// Get a string version
-			std::string varName(varDesc.Name);
-
-			// Add this variable to the table and the constant buffer
-			varTable.insert(std::pair<std::string, SimpleShaderVariable>(varName, varStruct));
-			constantBuffers[b].Variables.push_back(varStruct);
+			CachedShaderVariable variable;
+			variable.Name = varDesc.Name;
+			variable.ByteOffset = varDesc.StartOffset;
+			variable.Size = varDesc.Size;
+			buffer.Variables.push_back(variable);
 		}
+
+		reflectionData.ConstantBuffers.push_back(buffer);
+	}
+
+	// Input signature (only vertex shaders use this, to build an input layout)
+	for (unsigned int i = 0; i < shaderDesc.InputParameters; i++)
+	{
+		D3D11_SIGNATURE_PARAMETER_DESC paramDesc;
+		refl->GetInputParameterDesc(i, &paramDesc);
+
+		CachedInputParameter param;
+		param.SemanticName = paramDesc.SemanticName;
+		param.SemanticIndex = paramDesc.SemanticIndex;
+		param.Mask = paramDesc.Mask;
+		param.ComponentType = paramDesc.ComponentType;
+		reflectionData.InputParameters.push_back(param);
 	}
 
 	// All set
 	refl->Release();
-	return true;
 }
 
 // --------------------------------------------------------
@@ -654,40 +757,33 @@ bool SimpleVertexShader::CreateShader(ID3DBlob* shaderBlob)
 		return true;
 
 	// Vertex shader was created successfully, so we now use the
-	// shader code to re-reflect and create an input layout that 
-	// matches what the vertex shader expects.  Code adapted from:
+	// reflected input signature (from LoadShaderFile) to create an
+	// input layout that matches what the vertex shader expects.  Code adapted from:
 	// https://takinginitiative.wordpress.com/2011/12/11/directx-1011-basic-shader-reflection-automatic-input-layout-creation/
 
-	// Reflect shader info
-	ID3D11ShaderReflection* refl;
-	D3DReflect(
-		shaderBlob->GetBufferPointer(),
-		shaderBlob->GetBufferSize(),
-		IID_ID3D11ShaderReflection,
-		(void**)&refl);
-	
-	// Get shader info
-	D3D11_SHADER_DESC shaderDesc;
-	refl->GetDesc(&shaderDesc);
-
 	// Read input layout description from shader info
 	std::vector<D3D11_INPUT_ELEMENT_DESC> inputLayoutDesc;
-	for (unsigned int i = 0; i< shaderDesc.InputParameters; i++)
+	for (unsigned int i = 0; i < reflectionData.InputParameters.size(); i++)
 	{
-		D3D11_SIGNATURE_PARAMETER_DESC paramDesc;
-		refl->GetInputParameterDesc(i, &paramDesc);
+		const CachedInputParameter& paramDesc = reflectionData.InputParameters[i];
 
 		// Check the semantic name for "_PER_INSTANCE"
 		std::string perInstanceStr = "_PER_INSTANCE";
-		std::string sem = paramDesc.SemanticName;
+		const std::string& sem = paramDesc.SemanticName;
 		long lenDiff = sem.size() - perInstanceStr.size();
 		bool isPerInstance = 
 			lenDiff >= 0 &&
 			sem.compare(lenDiff, perInstanceStr.size(), perInstanceStr) == 0;
 
+		// "_UNORM" / "_SNORM" semantics read 16-bit normalized values
+		// (quantized vertices) instead of 32-bit floats.  No digits -
+		// HLSL would take those as the semantic index.
+		bool isUnorm16 = sem.size() > 6 && sem.compare(sem.size() - 6, 6, "_UNORM") == 0;
+		bool isSnorm16 = sem.size() > 6 && sem.compare(sem.size() - 6, 6, "_SNORM") == 0;
+
 		// Fill out input element desc
 		D3D11_INPUT_ELEMENT_DESC elementDesc;
-		elementDesc.SemanticName = paramDesc.SemanticName;
+		elementDesc.SemanticName = paramDesc.SemanticName.c_str();
 		elementDesc.SemanticIndex = paramDesc.SemanticIndex;
 		elementDesc.InputSlot = 0;
 		elementDesc.AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
@@ -730,6 +826,15 @@ bool SimpleVertexShader::CreateShader(ID3DBlob* shaderBlob)
 			else if (paramDesc.ComponentType == D3D_REGISTER_COMPONENT_FLOAT32) elementDesc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
 		}
 
+		// There's no three component 16-bit format, so a float3
+		// reads the first three of four
+		if (isUnorm16 || isSnorm16)
+		{
+			if (paramDesc.Mask == 1) elementDesc.Format = isUnorm16 ? DXGI_FORMAT_R16_UNORM : DXGI_FORMAT_R16_SNORM;
+			else if (paramDesc.Mask <= 3) elementDesc.Format = isUnorm16 ? DXGI_FORMAT_R16G16_UNORM : DXGI_FORMAT_R16G16_SNORM;
+			else elementDesc.Format = isUnorm16 ? DXGI_FORMAT_R16G16B16A16_UNORM : DXGI_FORMAT_R16G16B16A16_SNORM;
+		}
+
 		// Save element desc
 		inputLayoutDesc.push_back(elementDesc);
 	}
@@ -742,8 +847,7 @@ bool SimpleVertexShader::CreateShader(ID3DBlob* shaderBlob)
 		shaderBlob->GetBufferSize(),
 		&inputLayout);
 
-	// All done, clean up
-	refl->Release();
+	// All done
 	return true;
 }
 
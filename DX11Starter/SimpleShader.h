@@ -10,6 +10,8 @@
 #include <vector>
 #include <string>
 
+#include "ShaderReflectionCache.h"
+
 // --------------------------------------------------------
 // Used by simple shaders to store information about
 // specific variables in constant buffers
@@ -67,6 +69,12 @@ public:
 	// overrides in the base class constructor)
 	bool LoadShaderFile(LPCWSTR shaderFile);
 
+	// LoadShaderFile in two halves, so the file read and reflection
+	// can happen on a worker.  ReadShaderFile touches no D3D objects;
+	// CreateShaderObjects must run on the thread that owns the device.
+	bool ReadShaderFile(LPCWSTR shaderFile);
+	bool CreateShaderObjects();
+
 	// Simple helpers
 	bool IsShaderValid() { return shaderValid; }
 
@@ -121,6 +129,10 @@ protected:
 	ID3D11Device* device;
 	ID3D11DeviceContext* deviceContext;
 
+	// Reflection tables for the loaded shader, either read from
+	// the reflection cache or extracted with D3DReflect
+	ShaderReflectionData reflectionData;
+
 	// Resource counts
 	unsigned int constantBufferCount;
 	
@@ -139,6 +151,9 @@ protected:
 
 	virtual void CleanUp();
 
+	// Fills reflectionData from the shader code itself
+	void ReflectShader(ID3DBlob* shaderBlob);
+
 	// Helpers for finding data by name
 	SimpleShaderVariable* FindVariable(std::string name, int size);
 	SimpleConstantBuffer* FindConstantBuffer(std::string name);
@@ -0,0 +1,121 @@
+#include "Terrain.h"
+#include <cstring>
+#include "Vertex.h"
+
+using namespace DirectX;
+
+Terrain::Terrain(ID3D11Device* device, JobSystem* jobs, const TerrainSettings& settings)
+	: streamer(jobs, settings)
+{
+	distance = 0.0;
+
+	D3D11_BUFFER_DESC vbd;
+	vbd.Usage = D3D11_USAGE_DYNAMIC;
+	vbd.ByteWidth = GetTerrainVertexCount(settings, 0) * sizeof(Vertex);
+	vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	vbd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	vbd.MiscFlags = 0;
+	vbd.StructureByteStride = 0;
+	for (unsigned int i = 0; i < streamer.GetSlotCount(); i++)
+	{
+		ID3D11Buffer* buffer = nullptr;
+		device->CreateBuffer(&vbd, nullptr, &buffer);
+		vertexBuffers.push_back(buffer);
+	}
+
+	// Chunks are small, so 16-bit indices always do
+	std::vector<uint32_t> indices;
+	std::vector<uint16_t> shortIndices;
+	for (unsigned int lod = 0; lod < settings.LodCount; lod++)
+	{
+		BuildTerrainIndices(settings, lod, indices);
+		shortIndices.assign(indices.begin(), indices.end());
+
+		D3D11_BUFFER_DESC ibd;
+		ibd.Usage = D3D11_USAGE_IMMUTABLE;
+		ibd.ByteWidth = (UINT)(shortIndices.size() * sizeof(uint16_t));
+		ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
+		ibd.CPUAccessFlags = 0;
+		ibd.MiscFlags = 0;
+		ibd.StructureByteStride = 0;
+
+		D3D11_SUBRESOURCE_DATA initialIndexData;
+		initialIndexData.pSysMem = shortIndices.data();
+
+		ID3D11Buffer* buffer = nullptr;
+		device->CreateBuffer(&ibd, &initialIndexData, &buffer);
+		indexBuffers.push_back(buffer);
+		indexCounts.push_back((unsigned int)shortIndices.size());
+	}
+}
+
+Terrain::~Terrain()
+{
+	for (ID3D11Buffer* buffer : vertexBuffers)
+		if (buffer) buffer->Release();
+	for (ID3D11Buffer* buffer : indexBuffers)
+		if (buffer) buffer->Release();
+}
+
+void Terrain::Update(ID3D11DeviceContext* context, double distance, float cameraZ, bool wait)
+{
+	this->distance = distance;
+	streamer.Update(distance + cameraZ);
+	if (wait) streamer.Flush();
+
+	for (unsigned int i = 0; i < streamer.GetSlotCount(); i++)
+	{
+		TerrainChunk& chunk = streamer.GetChunk(i);
+		if (!chunk.Ready || !chunk.Changed || !vertexBuffers[i]) continue;
+
+		// Discard renames the buffer, so a frame still drawing the
+		// chunk's old LOD out of it isn't waited on
+		D3D11_MAPPED_SUBRESOURCE mapped;
+		if (FAILED(context->Map(vertexBuffers[i], 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+			continue;
+		memcpy(mapped.pData, chunk.Vertices.data(), chunk.Vertices.size() * sizeof(Vertex));
+		context->Unmap(vertexBuffers[i], 0);
+		chunk.Changed = false;
+	}
+}
+
+void Terrain::Draw(ID3D11DeviceContext* context, Material* material, XMFLOAT4X4 view,
+	XMFLOAT4X4 projection, float* frequencies, unsigned int length,
+	DirectionalLight light, DirectionalLight light2)
+{
+	SimpleVertexShader* vs = material->GetVertexShader();
+	SimplePixelShader* ps = material->GetPixelShader();
+	vs->SetMatrix4x4("view", view);
+	vs->SetMatrix4x4("projection", projection);
+	vs->SetData("amplitudes", frequencies, sizeof(float) * length);
+	vs->CopyAllBufferData();
+	ps->SetData("light", &light, sizeof(DirectionalLight));
+	ps->SetData("light2", &light2, sizeof(DirectionalLight));
+	ps->SetShaderResourceView("diffuseTexture", material->GetTexture());
+	ps->SetSamplerState("basicSampler", material->GetSamplerState());
+	ps->CopyAllBufferData();
+	vs->SetShader();
+	ps->SetShader();
+
+	const UINT stride = sizeof(Vertex);
+	const UINT offset = 0;
+	double chunkLength = streamer.GetSettings().ChunkLength;
+	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+	for (unsigned int i = 0; i < streamer.GetSlotCount(); i++)
+	{
+		TerrainChunk& chunk = streamer.GetChunk(i);
+		if (!chunk.Ready || chunk.Changed || !vertexBuffers[i]) continue;
+
+		// Offset in double first - both sides can be huge on a long track
+		float z = (float)(chunk.Index * chunkLength - distance);
+		XMFLOAT4X4 world;
+		XMStoreFloat4x4(&world, XMMatrixTranspose(XMMatrixTranslation(0.0f, 0.0f, z)));
+		vs->SetMatrix4x4("world", world);
+		vs->CopyBufferData("externalData");
+
+		context->IASetVertexBuffers(0, 1, &vertexBuffers[i], &stride, &offset);
+		context->IASetIndexBuffer(indexBuffers[chunk.Lod], DXGI_FORMAT_R16_UINT, 0);
+		context->DrawIndexed(indexCounts[chunk.Lod], 0, 0);
+	}
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <d3d11.h>
+#include <DirectXMath.h>
+#include <vector>
+#include "Lights.h"
+#include "Material.h"
+#include "TerrainStreamer.h"
+
+// --------------------------------------------------------
+// The ground either side of the track, streamed in chunks.
+// The world doesn't really move - chunks slide back past the
+// camera as the track distance grows, the same way the music
+// nodes come down the rails.
+//
+// Every slot has a fixed dynamic vertex buffer big enough for
+// LOD 0, and each LOD one shared index buffer, so streaming
+// never creates GPU resources.
+// --------------------------------------------------------
+class Terrain
+{
+public:
+	Terrain(ID3D11Device* device, JobSystem* jobs, const TerrainSettings& settings = TerrainSettings());
+	~Terrain();
+
+	// Streams around the camera and uploads chunks that finished
+	// building.  Call once per frame, before drawing.
+	//
+	// distance - How far along the track the world has moved
+	// cameraZ  - The camera's z in world space
+	// wait     - Finish every build first, e.g. for the first frame
+	void Update(ID3D11DeviceContext* context, double distance, float cameraZ, bool wait = false);
+
+	// Draws every uploaded chunk with TerrainVS and the given
+	// material, for the depth prepass or the scene
+	void Draw(ID3D11DeviceContext* context, Material* material, DirectX::XMFLOAT4X4 view,
+		DirectX::XMFLOAT4X4 projection, float* frequencies, unsigned int length,
+		DirectionalLight light, DirectionalLight light2);
+
+	TerrainStreamer& GetStreamer() { return streamer; }
+
+private:
+	TerrainStreamer streamer;
+	std::vector<ID3D11Buffer*> vertexBuffers;	// One per streamer slot
+	std::vector<ID3D11Buffer*> indexBuffers;	// One per LOD
+	std::vector<unsigned int> indexCounts;
+	double distance;
+};
@@ -0,0 +1,204 @@
+#include "TerrainChunk.h"
+#include <algorithm>
+#include <cmath>
+
+TerrainSettings::TerrainSettings()
+{
+	// As wide as the two old side grids together
+	ChunkLength = 25.0f;
+	HalfWidth = 35.0f;
+	TrackHalfWidth = 6.0f;
+	GroundHeight = -2.0f;
+	HillHeight = 8.0f;
+	HillSize = 20.0f;
+	Seed = 1;
+
+	CellsAcross = 32;
+	CellsAlong = 16;
+	LodCount = 3;
+	LodDistance = 50.0f;
+	SkirtDepth = 2.0f;
+
+	// Same texel density as the old side grids
+	TextureWidth = 35.0f;
+	TextureLength = 175.0f;
+
+	ViewAhead = 250.0f;
+	ViewBehind = 25.0f;
+}
+
+// --------------------------------------------------------
+// Value noise - a random height at every lattice point,
+// smoothly blended in between
+// --------------------------------------------------------
+static float LatticeValue(int64_t x, int64_t z, uint32_t seed)
+{
+	uint64_t h = (uint64_t)x * 0x9E3779B97F4A7C15ULL ^ (uint64_t)z * 0xC2B2AE3D27D4EB4FULL ^ seed;
+	h ^= h >> 33;
+	h *= 0xFF51AFD7ED558CCDULL;
+	h ^= h >> 33;
+	h *= 0xC4CEB9FE1A85EC53ULL;
+	h ^= h >> 33;
+	return (h >> 40) / (float)(1 << 24);
+}
+
+static float ValueNoise(double x, double z, uint32_t seed)
+{
+	double cellX = floor(x);
+	double cellZ = floor(z);
+	float fx = (float)(x - cellX);
+	float fz = (float)(z - cellZ);
+	int64_t ix = (int64_t)cellX;
+	int64_t iz = (int64_t)cellZ;
+
+	// Smoothstep, so the slope is continuous across cells
+	float sx = fx * fx * (3.0f - 2.0f * fx);
+	float sz = fz * fz * (3.0f - 2.0f * fz);
+
+	float a = LatticeValue(ix, iz, seed);
+	float b = LatticeValue(ix + 1, iz, seed);
+	float c = LatticeValue(ix, iz + 1, seed);
+	float d = LatticeValue(ix + 1, iz + 1, seed);
+	return (a + (b - a) * sx) + ((c + (d - c) * sx) - (a + (b - a) * sx)) * sz;
+}
+
+float GetTerrainHeight(const TerrainSettings& settings, float x, double z)
+{
+	// Flat by the track, rising towards the edges
+	float edge = (fabsf(x) - settings.TrackHalfWidth) / (settings.HalfWidth - settings.TrackHalfWidth);
+	edge = std::min(std::max(edge, 0.0f), 1.0f);
+	float ramp = edge * edge * (3.0f - 2.0f * edge);
+	if (ramp <= 0.0f) return settings.GroundHeight;
+
+	// Three octaves, each half the size and height of the last
+	double scale = 1.0 / settings.HillSize;
+	float amplitude = 0.5f;
+	float hills = 0.0f;
+	for (int octave = 0; octave < 3; octave++)
+	{
+		hills += ValueNoise(x * scale, z * scale, settings.Seed + octave) * amplitude;
+		scale *= 2.0;
+		amplitude *= 0.5f;
+	}
+	return settings.GroundHeight + hills / 0.875f * settings.HillHeight * ramp;
+}
+
+unsigned int SelectTerrainLod(const TerrainSettings& settings, float distance)
+{
+	unsigned int lod = 0;
+	float limit = settings.LodDistance;
+	while (distance >= limit && lod + 1 < settings.LodCount)
+	{
+		lod++;
+		limit *= 2.0f;
+	}
+	return lod;
+}
+
+static void GetGridSize(const TerrainSettings& settings, unsigned int lod, unsigned int& across, unsigned int& along)
+{
+	across = std::max(settings.CellsAcross >> lod, 1u);
+	along = std::max(settings.CellsAlong >> lod, 1u);
+}
+
+unsigned int GetTerrainVertexCount(const TerrainSettings& settings, unsigned int lod)
+{
+	unsigned int across, along;
+	GetGridSize(settings, lod, across, along);
+
+	// The grid, then a skirt row under each of the two edges
+	return (across + 1) * (along + 1) + 2 * (across + 1);
+}
+
+void BuildTerrainIndices(const TerrainSettings& settings, unsigned int lod, std::vector<uint32_t>& out)
+{
+	unsigned int across, along;
+	GetGridSize(settings, lod, across, along);
+	unsigned int row = across + 1;
+
+	out.clear();
+	out.reserve(across * along * 6 + across * 12);
+
+	// Clockwise seen from above, like everything else D3D draws
+	for (unsigned int z = 0; z < along; z++)
+	{
+		for (unsigned int x = 0; x < across; x++)
+		{
+			uint32_t a = z * row + x;
+			uint32_t b = a + 1;
+			uint32_t c = a + row;
+			uint32_t d = c + 1;
+			uint32_t quad[6] = { a, c, b, b, c, d };
+			out.insert(out.end(), quad, quad + 6);
+		}
+	}
+
+	// Skirts face out of the chunk - the front one back down
+	// the track, the back one up it
+	uint32_t frontSkirt = row * (along + 1);
+	uint32_t backEdge = row * along;
+	uint32_t backSkirt = frontSkirt + row;
+	for (unsigned int x = 0; x < across; x++)
+	{
+		uint32_t front[6] = { x, x + 1, frontSkirt + x, x + 1, frontSkirt + x + 1, frontSkirt + x };
+		uint32_t back[6] = { backEdge + x, backSkirt + x, backEdge + x + 1,
+			backEdge + x + 1, backSkirt + x, backSkirt + x + 1 };
+		out.insert(out.end(), front, front + 6);
+		out.insert(out.end(), back, back + 6);
+	}
+}
+
+void BuildTerrainChunk(const TerrainSettings& settings, int64_t chunk, unsigned int lod, std::vector<MeshVertex>& out)
+{
+	unsigned int across, along;
+	GetGridSize(settings, lod, across, along);
+	unsigned int row = across + 1;
+
+	double start = (double)chunk * settings.ChunkLength;
+	float cellWidth = settings.HalfWidth * 2.0f / across;
+	float cellLength = settings.ChunkLength / along;
+
+	// Normals are sampled at LOD 0's spacing whatever the LOD, so
+	// they match across seams and don't pop between levels
+	float step = settings.ChunkLength / settings.CellsAlong;
+
+	// UVs restart every texture repeat, so they stay small
+	float textureStart = (float)fmod(start, (double)settings.TextureLength);
+	if (textureStart < 0.0f) textureStart += settings.TextureLength;
+
+	out.resize(GetTerrainVertexCount(settings, lod));
+	for (unsigned int z = 0; z <= along; z++)
+	{
+		float localZ = z * cellLength;
+		double trackZ = start + localZ;
+		for (unsigned int x = 0; x <= across; x++)
+		{
+			float worldX = -settings.HalfWidth + x * cellWidth;
+			float height = GetTerrainHeight(settings, worldX, trackZ);
+
+			float slopeX = GetTerrainHeight(settings, worldX + step, trackZ) - GetTerrainHeight(settings, worldX - step, trackZ);
+			float slopeZ = GetTerrainHeight(settings, worldX, trackZ + step) - GetTerrainHeight(settings, worldX, trackZ - step);
+			float normal[3] = { -slopeX, 2.0f * step, -slopeZ };
+			float length = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+
+			MeshVertex& vertex = out[z * row + x];
+			vertex.Position[0] = worldX;
+			vertex.Position[1] = height;
+			vertex.Position[2] = localZ;
+			for (int k = 0; k < 3; k++) vertex.Normal[k] = normal[k] / length;
+			vertex.UV[0] = (worldX + settings.HalfWidth) / settings.TextureWidth;
+			vertex.UV[1] = (textureStart + localZ) / settings.TextureLength;
+		}
+	}
+
+	// Skirts copy their edge, dropped - lit the same so they blend in
+	uint32_t frontSkirt = row * (along + 1);
+	uint32_t backEdge = row * along;
+	for (unsigned int x = 0; x <= across; x++)
+	{
+		out[frontSkirt + x] = out[x];
+		out[frontSkirt + x].Position[1] -= settings.SkirtDepth;
+		out[frontSkirt + row + x] = out[backEdge + x];
+		out[frontSkirt + row + x].Position[1] -= settings.SkirtDepth;
+	}
+}
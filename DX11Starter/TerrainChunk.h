@@ -0,0 +1,65 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "MeshData.h"
+
+// --------------------------------------------------------
+// Shape of the ground either side of the track, and how it's
+// cut into chunks.  The track runs along +z through x = 0;
+// chunk n covers z from n * ChunkLength to (n + 1) * ChunkLength
+// in track space.
+// --------------------------------------------------------
+struct TerrainSettings
+{
+	TerrainSettings();
+
+	float ChunkLength;
+	float HalfWidth;		// Chunks cover x from -HalfWidth to +HalfWidth
+	float TrackHalfWidth;	// Ground this close to the track stays flat
+	float GroundHeight;		// y of the flat ground
+	float HillHeight;		// Tallest hills, out at the edges
+	float HillSize;			// Roughly how far apart hills are
+	uint32_t Seed;
+
+	// LOD 0 quads across and along a chunk.  Each further level
+	// halves both, and switches in twice as far away as the last.
+	unsigned int CellsAcross;
+	unsigned int CellsAlong;
+	unsigned int LodCount;
+	float LodDistance;		// Where LOD 1 takes over
+	float SkirtDepth;		// How far the skirts hiding LOD seams hang down
+
+	// Ground covered by one repeat of UV space
+	float TextureWidth;
+	float TextureLength;
+
+	// Track kept covered around the viewer - see TerrainStreamer
+	float ViewAhead;
+	float ViewBehind;
+};
+
+// Height of the ground at x across and z along the track
+float GetTerrainHeight(const TerrainSettings& settings, float x, double z);
+
+// LOD for a chunk whose nearest edge is this far away
+unsigned int SelectTerrainLod(const TerrainSettings& settings, float distance);
+
+unsigned int GetTerrainVertexCount(const TerrainSettings& settings, unsigned int lod);
+
+// --------------------------------------------------------
+// Triangle list for one LOD.  Every chunk at that LOD shares
+// it - only the vertices differ.  Skirts hang down from the
+// chunk's front and back edges to cover the cracks between
+// neighbours at different LODs.
+// --------------------------------------------------------
+void BuildTerrainIndices(const TerrainSettings& settings, unsigned int lod, std::vector<uint32_t>& out);
+
+// --------------------------------------------------------
+// Vertices for one chunk at one LOD.  z is relative to the
+// chunk's start, so it stays precise however far along the
+// track it is.  Safe to call from any thread.
+//
+// out keeps its capacity, so rebuilding into the same vector
+// never allocates once it has held LOD 0.
+// --------------------------------------------------------
+void BuildTerrainChunk(const TerrainSettings& settings, int64_t chunk, unsigned int lod, std::vector<MeshVertex>& out);
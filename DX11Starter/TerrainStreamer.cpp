@@ -0,0 +1,172 @@
+#include "TerrainStreamer.h"
+#include <algorithm>
+#include <cmath>
+
+// Slots that aren't holding a chunk
+static const int64_t NoChunk = INT64_MIN;
+
+TerrainStreamer::TerrainStreamer(JobSystem* jobs, const TerrainSettings& settings)
+{
+	this->jobs = jobs;
+	this->settings = settings;
+	buildCount = 0;
+
+	// However the range lines up with the chunk edges, it never
+	// touches more chunks than this
+	float span = settings.ViewAhead + settings.ViewBehind;
+	unsigned int count = (unsigned int)floorf(span / settings.ChunkLength) + 2;
+
+	size_t vertexCount = GetTerrainVertexCount(settings, 0);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		std::unique_ptr<Slot> slot(new Slot());
+		slot->Chunk.Index = NoChunk;
+		slot->Chunk.Lod = 0;
+		slot->Chunk.Ready = false;
+		slot->Chunk.Changed = false;
+		slot->Chunk.Vertices.reserve(vertexCount);
+		slot->Building.reserve(vertexCount);
+		slot->BuildIndex = NoChunk;
+		slot->BuildLod = 0;
+		slot->Busy = false;
+		slots.push_back(std::move(slot));
+	}
+	wanted.reserve(count);
+}
+
+TerrainStreamer::~TerrainStreamer()
+{
+	// Builds still running write into the slots
+	for (auto& slot : slots)
+		jobs->Wait(&slot->Counter);
+}
+
+float TerrainStreamer::GetChunkDistance(int64_t index, double viewerZ)
+{
+	double start = (double)index * settings.ChunkLength;
+	double end = start + settings.ChunkLength;
+	if (viewerZ < start) return (float)(start - viewerZ);
+	if (viewerZ > end) return (float)(viewerZ - end);
+	return 0.0f;
+}
+
+TerrainStreamer::Slot* TerrainStreamer::FindSlot(int64_t index)
+{
+	for (auto& slot : slots)
+	{
+		if (slot->Chunk.Index == index) return slot.get();
+	}
+	return nullptr;
+}
+
+TerrainStreamer::Slot* TerrainStreamer::FindFreeSlot()
+{
+	for (auto& slot : slots)
+	{
+		if (slot->Chunk.Index == NoChunk && !slot->Busy) return slot.get();
+	}
+	return nullptr;
+}
+
+void TerrainStreamer::Queue(Slot& slot, int64_t index, unsigned int lod)
+{
+	slot.Busy = true;
+	slot.BuildIndex = index;
+	slot.BuildLod = lod;
+
+	// The job only touches the slot's spare array, which nothing
+	// else reads until Collect sees the counter reach zero
+	Slot* target = &slot;
+	const TerrainSettings* shape = &settings;
+	jobs->Run([target, shape]() {
+		BuildTerrainChunk(*shape, target->BuildIndex, target->BuildLod, target->Building);
+	}, &slot.Counter);
+}
+
+void TerrainStreamer::Collect()
+{
+	for (auto& slot : slots)
+	{
+		if (!slot->Busy || !slot->Counter.IsDone()) continue;
+		slot->Busy = false;
+
+		// Recycled while it was building - nothing to show for it
+		if (slot->Chunk.Index != slot->BuildIndex) continue;
+
+		// Swapping keeps both arrays' capacity in the slot
+		slot->Chunk.Vertices.swap(slot->Building);
+		slot->Chunk.Lod = slot->BuildLod;
+		slot->Chunk.Ready = true;
+		slot->Chunk.Changed = true;
+		buildCount++;
+	}
+}
+
+void TerrainStreamer::Update(double viewerZ)
+{
+	Collect();
+
+	int64_t first = (int64_t)floor((viewerZ - settings.ViewBehind) / settings.ChunkLength);
+	int64_t last = (int64_t)floor((viewerZ + settings.ViewAhead) / settings.ChunkLength);
+
+	// Whatever fell out of range gives up its slot.  One still
+	// building stays busy until its job finishes.
+	for (auto& slot : slots)
+	{
+		if (slot->Chunk.Index == NoChunk) continue;
+		if (slot->Chunk.Index < first || slot->Chunk.Index > last)
+		{
+			slot->Chunk.Index = NoChunk;
+			slot->Chunk.Ready = false;
+			slot->Chunk.Changed = false;
+		}
+	}
+
+	// Nearest first, so the ground under the viewer comes in
+	// before the horizon does
+	wanted.clear();
+	for (int64_t index = first; index <= last; index++)
+		wanted.push_back(index);
+	std::sort(wanted.begin(), wanted.end(), [this, viewerZ](int64_t a, int64_t b) {
+		return GetChunkDistance(a, viewerZ) < GetChunkDistance(b, viewerZ);
+	});
+
+	for (int64_t index : wanted)
+	{
+		unsigned int lod = SelectTerrainLod(settings, GetChunkDistance(index, viewerZ));
+		Slot* slot = FindSlot(index);
+		if (!slot)
+		{
+			// A slot whose old chunk is still building frees up
+			// next time round
+			slot = FindFreeSlot();
+			if (!slot) continue;
+			slot->Chunk.Index = index;
+			slot->Chunk.Ready = false;
+			Queue(*slot, index, lod);
+		}
+		else if (!slot->Busy && slot->Chunk.Lod != lod)
+		{
+			Queue(*slot, index, lod);
+		}
+	}
+
+	// Without worker threads nobody else would run the builds
+	if (jobs->GetThreadCount() == 1)
+		Flush();
+}
+
+void TerrainStreamer::Flush()
+{
+	for (auto& slot : slots)
+		jobs->Wait(&slot->Counter);
+	Collect();
+}
+
+size_t TerrainStreamer::GetMemorySize()
+{
+	size_t bytes = 0;
+	for (auto& slot : slots)
+		bytes += (slot->Chunk.Vertices.capacity() + slot->Building.capacity()) * sizeof(MeshVertex);
+	return bytes;
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "JobSystem.h"
+#include "TerrainChunk.h"
+
+// --------------------------------------------------------
+// One chunk as the renderer sees it
+// --------------------------------------------------------
+struct TerrainChunk
+{
+	int64_t Index;						// Chunk along the track, if Ready
+	unsigned int Lod;
+	bool Ready;							// Vertices hold a built chunk
+	bool Changed;						// Built since the renderer last cleared this
+	std::vector<MeshVertex> Vertices;	// See BuildTerrainChunk
+};
+
+// --------------------------------------------------------
+// Keeps the track around the viewer covered with terrain.
+// Chunks coming into range are built on the job system, the
+// nearest first; chunks that fall behind hand their slot to
+// the next one ahead.  The slots and their vertex arrays are
+// all allocated up front, so memory stays the same however
+// long the track runs.
+//
+// A chunk whose LOD should change is rebuilt into its slot's
+// spare array and keeps drawing the old one until it's done.
+//
+// Nothing here touches the GPU - see Terrain for that.  Only
+// the thread that owns the streamer may call it.
+// --------------------------------------------------------
+class TerrainStreamer
+{
+public:
+	TerrainStreamer(JobSystem* jobs, const TerrainSettings& settings = TerrainSettings());
+	~TerrainStreamer();
+
+	// Takes finished builds, recycles chunks out of range and
+	// queues whatever is missing.  Never waits.
+	//
+	// viewerZ - How far along the track the viewer is
+	void Update(double viewerZ);
+
+	// Waits for every queued build and takes the results - e.g.
+	// so the first frame isn't missing its ground
+	void Flush();
+
+	unsigned int GetSlotCount() { return (unsigned int)slots.size(); }
+	TerrainChunk& GetChunk(unsigned int slot) { return slots[slot]->Chunk; }
+	const TerrainSettings& GetSettings() { return settings; }
+
+	// Chunks built so far, and bytes held by the vertex arrays
+	unsigned int GetBuildCount() { return buildCount; }
+	size_t GetMemorySize();
+
+private:
+	struct Slot
+	{
+		TerrainChunk Chunk;
+		std::vector<MeshVertex> Building;	// The job's output, swapped in when done
+		int64_t BuildIndex;
+		unsigned int BuildLod;
+		bool Busy;
+		JobCounter Counter;
+	};
+
+	JobSystem* jobs;
+	TerrainSettings settings;
+	std::vector<std::unique_ptr<Slot>> slots;
+	std::vector<int64_t> wanted;
+	unsigned int buildCount;
+
+	void Collect();
+	void Queue(Slot& slot, int64_t index, unsigned int lod);
+	Slot* FindSlot(int64_t index);
+	Slot* FindFreeSlot();
+	float GetChunkDistance(int64_t index, double viewerZ);
+};
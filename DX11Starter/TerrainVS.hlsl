@@ -17,6 +17,11 @@ cbuffer frequencyData : register(b1)
 	float1 amplitudes[64];
 }
 
+// Where the old 8x8 side grids put their rows and columns
+static const float pulseStart = 47.5;
+static const float bandEdge = 34.9;
+static const float bandWidth = 5.0;
+
 // Struct representing a single vertex worth of data
 // - This should match the vertex definition in our C++ code
 // - By "match", I mean the size, order and number of members
@@ -32,7 +37,6 @@ struct VertexShaderInput
 	float3 position		: POSITION;     // XYZ position
 	float3 normal		: NORMAL;
 	float2 uv			: TEXCOORD;
-	uint    id			: SV_VertexID;
 };
 
 // Struct representing the data we're sending down the pipeline
@@ -66,10 +70,14 @@ VertexToPixel main(VertexShaderInput input)
 
 	matrix newWorld = world;
 
-	uint newid = input.id % 8;
+	// Ground out past pulseStart bounces to the music in eight
+	// strips either side, one frequency per strip - band 0 at the
+	// outer edges, band 7 by the track
+	float3 worldPosition = mul(float4(input.position, 1.0f), world).xyz;
+	uint band = (uint)clamp(round((bandEdge - abs(input.position.x)) / bandWidth), 0, 7);
 
-	if (abs(input.position.z) > 1.9)
-		newWorld[3][1] += 10 * saturate(amplitudes[newid] * 100);
+	if (abs(worldPosition.z) > pulseStart)
+		newWorld[3][1] += 10 * saturate(amplitudes[band] * 100);
 
 	// The vertex's position (input.position) must be converted to world space,
 	// then camera space (relative to our 3D camera), then to proper homogenous 
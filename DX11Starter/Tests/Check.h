@@ -0,0 +1,25 @@
+#pragma once
+#include <cstdio>
+
+// --------------------------------------------------------
+// Bare-bones checks for the headless tests.  A failed check
+// prints where it was and carries on, and the test's main()
+// returns CheckResult() so make stops on any failure.
+// --------------------------------------------------------
+static int checkFailures = 0;
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) \
+		{ \
+			printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+			checkFailures++; \
+		} \
+	} while (0)
+
+static int CheckResult(const char* name)
+{
+	if (checkFailures == 0) printf("%s: passed\n", name);
+	else printf("%s: %d check(s) failed\n", name, checkFailures);
+	return checkFailures == 0 ? 0 : 1;
+}
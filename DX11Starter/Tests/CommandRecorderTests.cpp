@@ -0,0 +1,196 @@
+#include "CommandRecorder.h"
+#include "Check.h"
+#include <vector>
+
+// Stand-ins for materials and buffers - only their addresses matter
+static int materials[4];
+static int vertexBuffers[3];
+static int indexBuffers[3];
+
+static uint32_t Next(uint32_t& state)
+{
+	state = state * 1664525u + 1013904223u;
+	return state >> 8;
+}
+
+// --------------------------------------------------------
+// A draw list shaped like the game's: runs of items sharing a
+// material and mesh, sorted the way the renderer sorts them but
+// with plenty of switches
+// --------------------------------------------------------
+static std::vector<DrawPacket> RandomPackets(uint32_t& state, unsigned int count)
+{
+	std::vector<DrawPacket> packets(count);
+	int material = 0, mesh = 0;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		if (Next(state) % 4 == 0) material = Next(state) % 4;
+		if (Next(state) % 3 == 0) mesh = Next(state) % 3;
+
+		DrawPacket& packet = packets[i];
+		packet = DrawPacket();
+		packet.Material = &materials[material];
+		packet.VertexBuffer = &vertexBuffers[mesh];
+		packet.IndexBuffer = &indexBuffers[mesh];
+		packet.Quantization = nullptr;
+		packet.StartIndex = Next(state) % 1000;
+		packet.IndexCount = 3 + Next(state) % 300;
+		packet.IndexSize = mesh == 2 ? 4 : 2;
+		packet.VertexStride = Next(state) % 5 == 0 ? 16 : 32;
+		for (int k = 0; k < 16; k++)
+			packet.World[k] = (float)(Next(state) % 100);
+	}
+	return packets;
+}
+
+// Items map to packets one to one, except every seventh item
+// draws nothing - the recorder mustn't care
+static void RecordItems(const std::vector<DrawPacket>& packets, unsigned int begin, unsigned int end, CommandList& list)
+{
+	for (unsigned int i = begin; i < end; i++)
+	{
+		if (i % 7 == 6) continue;
+		list.Record(packets[i]);
+	}
+}
+
+// What replay should send: the same draws, with a bind only
+// where the state changes
+static void ReplayByHand(const std::vector<DrawPacket>& packets, NullCommandBackend& backend)
+{
+	const DrawPacket* previous = nullptr;
+	for (unsigned int i = 0; i < packets.size(); i++)
+	{
+		if (i % 7 == 6) continue;
+		const DrawPacket& packet = packets[i];
+		if (!previous || packet.Material != previous->Material)
+			backend.BindMaterial(packet.Material);
+		if (!previous ||
+			packet.VertexBuffer != previous->VertexBuffer ||
+			packet.IndexBuffer != previous->IndexBuffer ||
+			packet.VertexStride != previous->VertexStride ||
+			packet.IndexSize != previous->IndexSize)
+			backend.BindGeometry(packet.VertexBuffer, packet.IndexBuffer, packet.VertexStride, packet.IndexSize);
+		backend.Draw(packet);
+		previous = &packet;
+	}
+}
+
+static bool SameCalls(const NullCommandBackend& a, const NullCommandBackend& b)
+{
+	return a.GetChecksum() == b.GetChecksum() &&
+		a.GetMaterialBinds() == b.GetMaterialBinds() &&
+		a.GetGeometryBinds() == b.GetGeometryBinds() &&
+		a.GetDrawCount() == b.GetDrawCount();
+}
+
+// --------------------------------------------------------
+// Recording across the job system replays exactly what a
+// serial recording does, for thousands of random lists
+// --------------------------------------------------------
+static void TestParallelMatchesSerial()
+{
+	JobSystem jobs(4);
+	CommandRecorder serial, parallel;
+	NullCommandBackend serialBackend, parallelBackend, expected;
+	uint32_t state = 31;
+	int mismatches = 0, wrongBinds = 0;
+	unsigned int multiList = 0;
+
+	for (int run = 0; run < 3000; run++)
+	{
+		unsigned int count = Next(state) % 600;
+		unsigned int minItems = 1 + Next(state) % 64;
+		std::vector<DrawPacket> packets = RandomPackets(state, count);
+		auto record = [&packets](unsigned int begin, unsigned int end, CommandList& list) {
+			RecordItems(packets, begin, end, list);
+		};
+
+		serial.Record(nullptr, count, minItems, record);
+		parallel.Record(&jobs, count, minItems, record);
+		if (parallel.GetListCount() > 1) multiList++;
+
+		serialBackend.Reset();
+		parallelBackend.Reset();
+		expected.Reset();
+		serial.Replay(serialBackend);
+		parallel.Replay(parallelBackend);
+		ReplayByHand(packets, expected);
+
+		if (!SameCalls(serialBackend, parallelBackend)) mismatches++;
+		if (!SameCalls(serialBackend, expected)) wrongBinds++;
+		CHECK(serial.GetPacketCount() == parallel.GetPacketCount());
+	}
+	CHECK(mismatches == 0);
+	CHECK(wrongBinds == 0);
+
+	// Most runs really were split up
+	CHECK(multiList > 2000);
+}
+
+// --------------------------------------------------------
+// Draws that share state bind it once
+// --------------------------------------------------------
+static void TestRedundantBindsSkipped()
+{
+	uint32_t state = 5;
+	std::vector<DrawPacket> packets = RandomPackets(state, 50);
+	for (DrawPacket& packet : packets)
+	{
+		packet.Material = &materials[0];
+		packet.VertexBuffer = &vertexBuffers[0];
+		packet.IndexBuffer = &indexBuffers[0];
+		packet.VertexStride = 32;
+		packet.IndexSize = 2;
+	}
+
+	// Switching only the stride or index size still rebinds geometry
+	packets[20].VertexStride = 16;
+	packets[30].IndexSize = 4;
+	packets[40].Material = &materials[1];
+
+	JobSystem jobs(4);
+	CommandRecorder recorder;
+	recorder.Record(&jobs, 50, 1, [&packets](unsigned int begin, unsigned int end, CommandList& list) {
+		for (unsigned int i = begin; i < end; i++) list.Record(packets[i]);
+	});
+
+	NullCommandBackend backend;
+	recorder.Replay(backend);
+	CHECK(recorder.GetListCount() == 4);
+	CHECK(backend.GetDrawCount() == 50);
+	CHECK(backend.GetMaterialBinds() == 3);	// 0, 1 at 40, 0 again at 41
+	CHECK(backend.GetGeometryBinds() == 5);	// first, 20, 21, 30, 31
+}
+
+// --------------------------------------------------------
+// Nothing recorded, nothing sent; and the checksum notices a
+// reordering that the counts alone wouldn't
+// --------------------------------------------------------
+static void TestEmptyAndOrder()
+{
+	CommandRecorder recorder;
+	recorder.Record(nullptr, 0, 16, [](unsigned int, unsigned int, CommandList&) {});
+	NullCommandBackend empty, untouched;
+	recorder.Replay(empty);
+	CHECK(empty.GetDrawCount() == 0 && empty.GetMaterialBinds() == 0);
+	CHECK(empty.GetChecksum() == untouched.GetChecksum());
+
+	uint32_t state = 9;
+	std::vector<DrawPacket> packets = RandomPackets(state, 2);
+	NullCommandBackend forward, backward;
+	forward.Draw(packets[0]);
+	forward.Draw(packets[1]);
+	backward.Draw(packets[1]);
+	backward.Draw(packets[0]);
+	CHECK(forward.GetDrawCount() == backward.GetDrawCount());
+	CHECK(forward.GetChecksum() != backward.GetChecksum());
+}
+
+int main()
+{
+	TestParallelMatchesSerial();
+	TestRedundantBindsSkipped();
+	TestEmptyAndOrder();
+	return CheckResult("CommandRecorderTests");
+}
@@ -0,0 +1,342 @@
+#include "FrameGraph.h"
+#include "Check.h"
+#include <algorithm>
+
+static const FrameGraphTextureDesc ColorDesc = { 1280, 720, 28, false };
+static const FrameGraphTextureDesc DepthDesc = { 1280, 720, 41, true };
+static const FrameGraphTextureDesc HalfDesc = { 640, 360, 28, false };
+
+// Where a pass ended up in the compiled order, -1 if culled
+static int PositionOf(FrameGraph& graph, int pass)
+{
+	const std::vector<int>& order = graph.GetPassOrder();
+	std::vector<int>::const_iterator it = std::find(order.begin(), order.end(), pass);
+	return it == order.end() ? -1 : (int)(it - order.begin());
+}
+
+static bool HasBarrier(FrameGraph& graph, int pass, int resource, FrameGraphState before, FrameGraphState after)
+{
+	for (const FrameGraphBarrier& barrier : graph.GetBarriers(pass))
+	{
+		if (barrier.Resource == resource && barrier.Before == before && barrier.After == after)
+			return true;
+	}
+	return false;
+}
+
+// --------------------------------------------------------
+// A reader sees the writer declared before it, not a later one
+// --------------------------------------------------------
+static void TestWriteAfterRead()
+{
+	FrameGraph graph;
+	int output = graph.ImportTexture("Output");
+	graph.MarkOutput(output);
+	int x = graph.CreateTexture("X", ColorDesc);
+	int y = graph.CreateTexture("Y", ColorDesc);
+
+	int w0 = graph.AddPass("W0", nullptr);
+	graph.Write(w0, x);
+	int a = graph.AddPass("A", nullptr);
+	graph.Read(a, x);
+	graph.Write(a, y);
+	int b = graph.AddPass("B", nullptr);
+	graph.Write(b, x);
+	int c = graph.AddPass("C", nullptr);
+	graph.Read(c, x);
+	graph.Read(c, y);
+	graph.Write(c, output);
+
+	CHECK(graph.Compile());
+	CHECK(PositionOf(graph, w0) < PositionOf(graph, a));
+	CHECK(PositionOf(graph, a) < PositionOf(graph, b));
+	CHECK(PositionOf(graph, b) < PositionOf(graph, c));
+}
+
+// --------------------------------------------------------
+// Independent passes keep their declaration order, and a read
+// declared before any write doesn't see a later writer
+// --------------------------------------------------------
+static void TestOrdering()
+{
+	FrameGraph graph;
+	int output = graph.ImportTexture("Output");
+	graph.MarkOutput(output);
+	int x = graph.CreateTexture("X", ColorDesc);
+	int y = graph.CreateTexture("Y", ColorDesc);
+	int z = graph.CreateTexture("Z", ColorDesc);
+
+	// Declared out of order - the composite comes first
+	int composite = graph.AddPass("Composite", nullptr);
+	graph.Read(composite, x);
+	graph.Read(composite, y);
+	graph.Write(composite, z);
+	int makeX = graph.AddPass("MakeX", nullptr);
+	graph.Write(makeX, x);
+	int makeY = graph.AddPass("MakeY", nullptr);
+	graph.Write(makeY, y);
+	int present = graph.AddPass("Present", nullptr);
+	graph.Read(present, z);
+	graph.Write(present, output);
+
+	// The composite reads X and Y before anyone wrote them, so the
+	// writers' results are never read and they go
+	CHECK(graph.Compile());
+	CHECK(graph.IsPassCulled(makeX));
+	CHECK(graph.IsPassCulled(makeY));
+	CHECK(PositionOf(graph, composite) < PositionOf(graph, present));
+
+	// Same graph declared the sensible way round comes out as declared
+	FrameGraph ordered;
+	output = ordered.ImportTexture("Output");
+	ordered.MarkOutput(output);
+	x = ordered.CreateTexture("X", ColorDesc);
+	y = ordered.CreateTexture("Y", ColorDesc);
+	z = ordered.CreateTexture("Z", ColorDesc);
+	makeX = ordered.AddPass("MakeX", nullptr);
+	ordered.Write(makeX, x);
+	makeY = ordered.AddPass("MakeY", nullptr);
+	ordered.Write(makeY, y);
+	composite = ordered.AddPass("Composite", nullptr);
+	ordered.Read(composite, x);
+	ordered.Read(composite, y);
+	ordered.Write(composite, z);
+	present = ordered.AddPass("Present", nullptr);
+	ordered.Read(present, z);
+	ordered.Write(present, output);
+
+	CHECK(ordered.Compile());
+	std::vector<int> expected = { makeX, makeY, composite, present };
+	CHECK(ordered.GetPassOrder() == expected);
+}
+
+// --------------------------------------------------------
+// A pass that reads and writes the same resource sees the
+// version before its own write, after everyone else reading it
+// --------------------------------------------------------
+static void TestReadModifyWrite()
+{
+	FrameGraph graph;
+	int output = graph.ImportTexture("Output");
+	graph.MarkOutput(output);
+	int x = graph.CreateTexture("X", ColorDesc);
+	int copy = graph.CreateTexture("Copy", ColorDesc);
+
+	int w0 = graph.AddPass("W0", nullptr);
+	graph.Write(w0, x);
+	int modify = graph.AddPass("Modify", nullptr);
+	graph.Read(modify, x);
+	graph.Write(modify, x);
+	int copier = graph.AddPass("Copier", nullptr);
+	graph.Read(copier, x);
+	graph.Write(copier, copy);
+	int present = graph.AddPass("Present", nullptr);
+	graph.Read(present, x);
+	graph.Read(present, copy);
+	graph.Write(present, output);
+
+	CHECK(graph.Compile());
+	std::vector<int> expected = { w0, modify, copier, present };
+	CHECK(graph.GetPassOrder() == expected);
+}
+
+// --------------------------------------------------------
+// Passes whose writes never reach an output are dropped, along
+// with anything that only fed them
+// --------------------------------------------------------
+static void TestCulling()
+{
+	FrameGraph graph;
+	int output = graph.ImportTexture("Output");
+	graph.MarkOutput(output);
+	int scene = graph.CreateTexture("Scene", ColorDesc);
+	int debug = graph.CreateTexture("Debug", ColorDesc);
+	int debugInput = graph.CreateTexture("DebugInput", ColorDesc);
+
+	int scenePass = graph.AddPass("Scene", nullptr);
+	graph.Write(scenePass, scene);
+	int feeder = graph.AddPass("Feeder", nullptr);
+	graph.Write(feeder, debugInput);
+	int debugPass = graph.AddPass("Debug", nullptr);
+	graph.Read(debugPass, scene);
+	graph.Read(debugPass, debugInput);
+	graph.Write(debugPass, debug);
+	int present = graph.AddPass("Present", nullptr);
+	graph.Read(present, scene);
+	graph.Write(present, output);
+
+	CHECK(graph.Compile());
+	CHECK(!graph.IsPassCulled(scenePass));
+	CHECK(!graph.IsPassCulled(present));
+	CHECK(graph.IsPassCulled(debugPass));
+	CHECK(graph.IsPassCulled(feeder));
+	CHECK(graph.GetPassOrder().size() == 2);
+
+	// Culled passes' textures don't get memory
+	CHECK(graph.GetPhysicalTexture(debug) == -1);
+	CHECK(graph.GetPhysicalTexture(debugInput) == -1);
+	CHECK(graph.GetTransientTextureCount() == 1);
+
+	// And they never run
+	int runs = 0;
+	FrameGraph counted;
+	output = counted.ImportTexture("Output");
+	counted.MarkOutput(output);
+	debug = counted.CreateTexture("Debug", ColorDesc);
+	int live = counted.AddPass("Live", [&runs]() { runs += 1; });
+	counted.Write(live, output);
+	int dead = counted.AddPass("Dead", [&runs]() { runs += 100; });
+	counted.Write(dead, debug);
+	CHECK(counted.Compile());
+	counted.Execute(nullptr);
+	CHECK(runs == 1);
+
+	// Earlier writers of a needed resource stay alive, since a
+	// write draws on top of what's there
+	FrameGraph layered;
+	output = layered.ImportTexture("Output");
+	layered.MarkOutput(output);
+	int first = layered.AddPass("First", nullptr);
+	layered.Write(first, output);
+	int second = layered.AddPass("Second", nullptr);
+	layered.Write(second, output);
+	CHECK(layered.Compile());
+	CHECK(!layered.IsPassCulled(first));
+	CHECK(!layered.IsPassCulled(second));
+}
+
+// --------------------------------------------------------
+// Textures whose lifetimes don't overlap share a slot, but only
+// with an identical description
+// --------------------------------------------------------
+static void TestAliasing()
+{
+	FrameGraph graph;
+	int output = graph.ImportTexture("Output");
+	graph.MarkOutput(output);
+	int a = graph.CreateTexture("A", ColorDesc);
+	int b = graph.CreateTexture("B", ColorDesc);
+	int c = graph.CreateTexture("C", ColorDesc);
+	int half = graph.CreateTexture("Half", HalfDesc);
+	int depth = graph.CreateTexture("Depth", DepthDesc);
+
+	int p0 = graph.AddPass("P0", nullptr);
+	graph.Write(p0, a);
+	graph.Write(p0, depth, FrameGraphState::DepthWrite);
+	int p1 = graph.AddPass("P1", nullptr);
+	graph.Read(p1, a);
+	graph.Write(p1, b);
+	int p2 = graph.AddPass("P2", nullptr);
+	graph.Read(p2, b);
+	graph.Write(p2, half);
+	int p3 = graph.AddPass("P3", nullptr);
+	graph.Read(p3, half);
+	graph.Write(p3, c);
+	int p4 = graph.AddPass("P4", nullptr);
+	graph.Read(p4, c);
+	graph.Read(p4, depth);
+	graph.Write(p4, output);
+
+	CHECK(graph.Compile());
+	CHECK(graph.GetPassOrder().size() == 5);
+	CHECK(graph.GetTransientTextureCount() == 5);
+
+	// A is done after P1, so C (first used in P3) takes its slot;
+	// B overlaps A in P1 and needs its own
+	CHECK(graph.GetPhysicalTexture(c) == graph.GetPhysicalTexture(a));
+	CHECK(graph.GetPhysicalTexture(b) != graph.GetPhysicalTexture(a));
+
+	// Different descriptions never share, and the depth buffer is
+	// live the whole frame
+	int halfSlot = graph.GetPhysicalTexture(half);
+	int depthSlot = graph.GetPhysicalTexture(depth);
+	CHECK(halfSlot != graph.GetPhysicalTexture(a));
+	CHECK(halfSlot != graph.GetPhysicalTexture(b));
+	CHECK(depthSlot != halfSlot);
+	CHECK(graph.GetPhysicalDesc(halfSlot) == HalfDesc);
+	CHECK(graph.GetPhysicalDesc(depthSlot) == DepthDesc);
+	CHECK(graph.GetPhysicalTextureCount() == 4);
+
+	// Imported textures are never aliased
+	CHECK(graph.GetPhysicalTexture(output) == -1);
+}
+
+// --------------------------------------------------------
+// Every state change is recorded on the pass that needs it, and
+// an aliased slot starts over as Undefined for its new owner
+// --------------------------------------------------------
+static void TestBarriers()
+{
+	FrameGraph graph;
+	int output = graph.ImportTexture("Output");
+	graph.MarkOutput(output);
+	int a = graph.CreateTexture("A", ColorDesc);
+	int b = graph.CreateTexture("B", ColorDesc);
+	int c = graph.CreateTexture("C", ColorDesc);
+	int depth = graph.CreateTexture("Depth", DepthDesc);
+
+	int p0 = graph.AddPass("P0", nullptr);
+	graph.Write(p0, a);
+	graph.Write(p0, depth, FrameGraphState::DepthWrite);
+	int p1 = graph.AddPass("P1", nullptr);
+	graph.Read(p1, a);
+	graph.Write(p1, b);
+	int p2 = graph.AddPass("P2", nullptr);
+	graph.Read(p2, b);
+	graph.Read(p2, depth);
+	graph.Write(p2, c);
+	int p3 = graph.AddPass("P3", nullptr);
+	graph.Read(p3, c);
+	graph.Write(p3, output);
+
+	CHECK(graph.Compile());
+	CHECK(graph.GetPhysicalTexture(c) == graph.GetPhysicalTexture(a));
+
+	CHECK(HasBarrier(graph, p0, a, FrameGraphState::Undefined, FrameGraphState::RenderTarget));
+	CHECK(HasBarrier(graph, p0, depth, FrameGraphState::Undefined, FrameGraphState::DepthWrite));
+	CHECK(HasBarrier(graph, p1, a, FrameGraphState::RenderTarget, FrameGraphState::ShaderRead));
+	CHECK(HasBarrier(graph, p1, b, FrameGraphState::Undefined, FrameGraphState::RenderTarget));
+	CHECK(HasBarrier(graph, p2, b, FrameGraphState::RenderTarget, FrameGraphState::ShaderRead));
+	CHECK(HasBarrier(graph, p2, depth, FrameGraphState::DepthWrite, FrameGraphState::ShaderRead));
+	CHECK(HasBarrier(graph, p3, c, FrameGraphState::RenderTarget, FrameGraphState::ShaderRead));
+	CHECK(HasBarrier(graph, p3, output, FrameGraphState::Undefined, FrameGraphState::RenderTarget));
+
+	// C took over A's slot while it was a shader input - its
+	// contents don't carry over, so it starts Undefined
+	CHECK(HasBarrier(graph, p2, c, FrameGraphState::Undefined, FrameGraphState::RenderTarget));
+	CHECK(graph.GetBarriers(p0).size() == 2);
+	CHECK(graph.GetBarriers(p1).size() == 2);
+	CHECK(graph.GetBarriers(p2).size() == 3);
+	CHECK(graph.GetBarriers(p3).size() == 2);
+
+	// Execute hands them over in order, before each pass
+	std::vector<int> events;
+	FrameGraph traced;
+	output = traced.ImportTexture("Output");
+	traced.MarkOutput(output);
+	a = traced.CreateTexture("A", ColorDesc);
+	int writer = traced.AddPass("Writer", [&events]() { events.push_back(-1); });
+	traced.Write(writer, a);
+	int reader = traced.AddPass("Reader", [&events]() { events.push_back(-2); });
+	traced.Read(reader, a);
+	traced.Write(reader, output);
+	CHECK(traced.Compile());
+	traced.Execute([&events](const FrameGraphBarrier& barrier) { events.push_back((int)barrier.After); });
+
+	std::vector<int> expected = {
+		(int)FrameGraphState::RenderTarget, -1,
+		(int)FrameGraphState::ShaderRead, (int)FrameGraphState::RenderTarget, -2
+	};
+	CHECK(events == expected);
+}
+
+int main()
+{
+	TestWriteAfterRead();
+	TestOrdering();
+	TestReadModifyWrite();
+	TestCulling();
+	TestAliasing();
+	TestBarriers();
+	return CheckResult("FrameGraphTests");
+}
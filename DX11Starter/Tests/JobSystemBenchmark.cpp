@@ -0,0 +1,121 @@
+#include "JobSystem.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+// --------------------------------------------------------
+// How well the job system scales from one core to all of them.
+//
+// Two workloads, each run with 1, 2, 4 ... threads and then
+// every hardware thread:
+//  - ParallelFor over a fixed, compute-bound array, which is
+//    what the per-frame update mostly looks like
+//  - lots of tiny jobs spawned from jobs, which measures the
+//    deques and stealing rather than the work
+//
+// Pass a thread count to go past the hardware threads.
+// --------------------------------------------------------
+
+static const unsigned int ItemCount = 1 << 20;
+static const unsigned int GrainSize = 4096;
+static const int Repeats = 5;
+
+static const unsigned int TinyJobCount = 20000;
+static bool lostJobs = false;
+
+typedef std::chrono::steady_clock Clock;
+
+static double Milliseconds(Clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Enough arithmetic per item that memory bandwidth doesn't decide it
+static float Work(float x)
+{
+	for (int i = 0; i < 32; i++)
+		x = sqrtf(x * x + 1.0f) * 0.999f;
+	return x;
+}
+
+static double TimeParallelFor(JobSystem& jobs, std::vector<float>& data)
+{
+	double best = 1e30;
+	for (int r = 0; r < Repeats; r++)
+	{
+		Clock::time_point start = Clock::now();
+		jobs.ParallelFor(ItemCount, GrainSize, [&data](unsigned int begin, unsigned int end) {
+			for (unsigned int i = begin; i < end; i++)
+				data[i] = Work(data[i]);
+		});
+		best = std::min(best, Milliseconds(start));
+	}
+	return best;
+}
+
+static double TimeTinyJobs(JobSystem& jobs)
+{
+	double best = 1e30;
+	for (int r = 0; r < Repeats; r++)
+	{
+		std::atomic<unsigned int> done(0);
+		JobCounter counter;
+		Clock::time_point start = Clock::now();
+
+		// Children land on whichever thread ran their parent, so the
+		// other threads only get them by stealing
+		for (unsigned int parent = 0; parent < TinyJobCount / 100; parent++)
+		{
+			jobs.Run([&jobs, &done]() {
+				JobCounter children;
+				for (int child = 0; child < 99; child++)
+					jobs.Run([&done]() { done++; }, &children);
+				jobs.Wait(&children);
+				done++;
+			}, &counter);
+		}
+		jobs.Wait(&counter);
+
+		best = std::min(best, Milliseconds(start));
+		if (done.load() != TinyJobCount)
+		{
+			lostJobs = true;
+			printf("  lost jobs: %u of %u ran\n", done.load(), TinyJobCount);
+		}
+	}
+	return best;
+}
+
+int main(int argc, char* argv[])
+{
+	unsigned int cores = std::max(std::thread::hardware_concurrency(), 1u);
+	unsigned int maxThreads = argc > 1 ? (unsigned int)std::max(atoi(argv[1]), 1) : cores;
+
+	std::vector<unsigned int> threadCounts;
+	for (unsigned int t = 1; t < maxThreads; t *= 2)
+		threadCounts.push_back(t);
+	threadCounts.push_back(maxThreads);
+
+	std::vector<float> data(ItemCount, 1.0f);
+
+	printf("JobSystemBenchmark: %u hardware threads, best of %d\n", cores, Repeats);
+	printf("%8s %16s %9s %11s %16s %10s\n",
+		"threads", "ParallelFor ms", "speedup", "efficiency", "20k tiny jobs ms", "steals");
+
+	double baseline = 0.0;
+	for (unsigned int threads : threadCounts)
+	{
+		JobSystem jobs(threads);
+		double forTime = TimeParallelFor(jobs, data);
+		double tinyTime = TimeTinyJobs(jobs);
+		if (threads == 1) baseline = forTime;
+
+		double speedup = baseline / forTime;
+		printf("%8u %16.2f %8.2fx %10.0f%% %16.2f %10llu\n",
+			threads, forTime, speedup, 100.0 * speedup / threads, tinyTime, jobs.GetStealCount());
+	}
+	return lostJobs ? 1 : 0;
+}
@@ -0,0 +1,263 @@
+#include "MeshCache.h"
+#include "Check.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+static const uint64_t SourceHash = 0xFEEDFACE12345678ull;
+
+// Where the fixed header keeps each field
+static const size_t VersionAt = 4;
+static const size_t VertexOffsetAt = 48;
+static const size_t IndexOffsetAt = 52;
+static const size_t SubmeshOffsetAt = 56;
+
+static uint32_t Next(uint32_t& state)
+{
+	state = state * 1664525u + 1013904223u;
+	return state >> 8;
+}
+
+static float RandomCoordinate(uint32_t& state)
+{
+	return ((int)(Next(state) % 2001) - 1000) / 100.0f;
+}
+
+// --------------------------------------------------------
+// A small mesh with every section filled in: two submeshes,
+// a simplified LOD after them and a few meshlets
+// --------------------------------------------------------
+static MeshData MakeMesh()
+{
+	MeshData mesh;
+	uint32_t state = 77;
+	mesh.Vertices.resize(40);
+	for (MeshVertex& v : mesh.Vertices)
+	{
+		for (int k = 0; k < 3; k++) v.Position[k] = RandomCoordinate(state);
+		for (int k = 0; k < 3; k++) v.Normal[k] = RandomCoordinate(state);
+		for (int k = 0; k < 2; k++) v.UV[k] = RandomCoordinate(state);
+	}
+
+	for (int i = 0; i < 90; i++)
+		mesh.Indices.push_back(Next(state) % 40);
+
+	MeshSubmesh body;
+	body.Name = "Body";
+	body.Material = "Paint";
+	body.IndexStart = 0;
+	body.IndexCount = 45;
+	MeshSubmesh glass;
+	glass.Name = "";
+	glass.Material = "Glass";
+	glass.IndexStart = 45;
+	glass.IndexCount = 27;
+	mesh.Submeshes.push_back(body);
+	mesh.Submeshes.push_back(glass);
+
+	mesh.Lods.push_back({ 0, 72, 0.0f });
+	mesh.Lods.push_back({ 72, 18, 0.125f });
+
+	for (uint32_t start = 0; start < 72; start += 24)
+	{
+		Meshlet meshlet = { start, 24, { 1.0f, -2.0f, 0.5f }, 3.25f, { 0.0f, 1.0f, 0.0f }, 0.5f };
+		mesh.Meshlets.push_back(meshlet);
+	}
+	return mesh;
+}
+
+static uint32_t ReadU32(const std::vector<unsigned char>& bytes, size_t at)
+{
+	uint32_t value;
+	memcpy(&value, &bytes[at], sizeof(value));
+	return value;
+}
+
+static void PatchU32(std::vector<unsigned char>& bytes, size_t at, uint32_t value)
+{
+	memcpy(&bytes[at], &value, sizeof(value));
+}
+
+// Where the LOD and meshlet tables start, past the variable
+// length submesh records
+static size_t LodTableAt(const std::vector<unsigned char>& bytes, const MeshData& mesh)
+{
+	size_t at = ReadU32(bytes, SubmeshOffsetAt) + 4;
+	for (const MeshSubmesh& submesh : mesh.Submeshes)
+		at += 8 + 4 + submesh.Name.size() + 4 + submesh.Material.size();
+	return at;
+}
+
+static size_t MeshletTableAt(const std::vector<unsigned char>& bytes, const MeshData& mesh)
+{
+	return LodTableAt(bytes, mesh) + 4 + mesh.Lods.size() * 12;
+}
+
+static void WriteFile(uint64_t sourceHash, const std::vector<unsigned char>& bytes, size_t size)
+{
+	std::ofstream file(MeshCache::GetCachePath(sourceHash), std::ios::binary | std::ios::trunc);
+	file.write((const char*)bytes.data(), size);
+}
+
+// A refused file leaves the cache empty
+static bool Rejected(const std::vector<unsigned char>& bytes, size_t size, uint64_t sourceHash = SourceHash)
+{
+	WriteFile(sourceHash, bytes, size);
+	MeshCache cache;
+	bool loaded = cache.Load(sourceHash);
+	return !loaded && cache.GetVertices() == nullptr && cache.GetIndices() == nullptr &&
+		cache.GetVertexCount() == 0 && cache.GetSubmeshes().empty() && cache.GetMeshlets().empty();
+}
+
+// --------------------------------------------------------
+// Save then Load gives back the same mesh, with the vertex
+// data mapped on a 16-byte boundary
+// --------------------------------------------------------
+static void TestRoundTrip()
+{
+	MeshData mesh = MakeMesh();
+	CHECK(MeshCache::Save(SourceHash, mesh));
+
+	MeshCache cache;
+	CHECK(cache.Load(SourceHash));
+	CHECK(cache.GetVertexCount() == mesh.Vertices.size());
+	CHECK(cache.GetIndexCount() == mesh.Indices.size());
+	CHECK(((uintptr_t)cache.GetVertices() & 15) == 0);
+	CHECK(memcmp(cache.GetVertices(), mesh.Vertices.data(), mesh.Vertices.size() * sizeof(MeshVertex)) == 0);
+	CHECK(memcmp(cache.GetIndices(), mesh.Indices.data(), mesh.Indices.size() * sizeof(uint32_t)) == 0);
+
+	const std::vector<MeshSubmesh>& submeshes = cache.GetSubmeshes();
+	CHECK(submeshes.size() == 2);
+	for (size_t i = 0; i < submeshes.size() && i < 2; i++)
+	{
+		CHECK(submeshes[i].Name == mesh.Submeshes[i].Name);
+		CHECK(submeshes[i].Material == mesh.Submeshes[i].Material);
+		CHECK(submeshes[i].IndexStart == mesh.Submeshes[i].IndexStart);
+		CHECK(submeshes[i].IndexCount == mesh.Submeshes[i].IndexCount);
+	}
+
+	const std::vector<MeshLod>& lods = cache.GetLods();
+	CHECK(lods.size() == 2);
+	for (size_t i = 0; i < lods.size() && i < 2; i++)
+	{
+		CHECK(lods[i].IndexStart == mesh.Lods[i].IndexStart);
+		CHECK(lods[i].IndexCount == mesh.Lods[i].IndexCount);
+		CHECK(lods[i].Error == mesh.Lods[i].Error);
+	}
+
+	CHECK(cache.GetMeshlets().size() == mesh.Meshlets.size() &&
+		memcmp(cache.GetMeshlets().data(), mesh.Meshlets.data(), mesh.Meshlets.size() * sizeof(Meshlet)) == 0);
+
+	MeshBounds bounds = ComputeMeshBounds(mesh.Vertices.data(), mesh.Vertices.size());
+	CHECK(memcmp(&cache.GetBounds(), &bounds, sizeof(bounds)) == 0);
+
+	// Nothing is saved under any other source
+	CHECK(!cache.Load(SourceHash + 1));
+	CHECK(cache.GetVertices() == nullptr);
+
+	// An empty mesh is a valid entry too
+	CHECK(MeshCache::Save(0, MeshData()));
+	CHECK(cache.Load(0) && cache.GetVertexCount() == 0 && cache.GetSubmeshes().empty());
+	remove(MeshCache::GetCachePath(0).c_str());
+}
+
+// --------------------------------------------------------
+// Stale or damaged files are misses: another source, another
+// format version, misplaced sections, indices or ranges that
+// point past the data, and every truncation
+// --------------------------------------------------------
+static void TestRejects()
+{
+	MeshData mesh = MakeMesh();
+	std::vector<unsigned char> bytes;
+	MeshCache::Serialize(mesh, SourceHash, bytes);
+	CHECK(!Rejected(bytes, bytes.size()));
+
+	// Written for one source, found under another's name
+	CHECK(Rejected(bytes, bytes.size(), SourceHash ^ 1));
+
+	std::vector<unsigned char> version = bytes;
+	PatchU32(version, VersionAt, MeshCache::FormatVersion + 1);
+	CHECK(Rejected(version, version.size()));
+
+	// Four bytes of padding before the vertices, with every offset
+	// after them moved to match - only the alignment is wrong
+	uint32_t vertexOffset = ReadU32(bytes, VertexOffsetAt);
+	std::vector<unsigned char> misaligned = bytes;
+	misaligned.insert(misaligned.begin() + vertexOffset, 4, 0);
+	PatchU32(misaligned, VertexOffsetAt, vertexOffset + 4);
+	PatchU32(misaligned, IndexOffsetAt, ReadU32(bytes, IndexOffsetAt) + 4);
+	PatchU32(misaligned, SubmeshOffsetAt, ReadU32(bytes, SubmeshOffsetAt) + 4);
+	CHECK(Rejected(misaligned, misaligned.size()));
+
+	// Index sections that don't follow the vertices
+	std::vector<unsigned char> gap = bytes;
+	PatchU32(gap, IndexOffsetAt, ReadU32(bytes, IndexOffsetAt) + 4);
+	CHECK(Rejected(gap, gap.size()));
+
+	// Last index points one past the vertices
+	uint32_t indexOffset = ReadU32(bytes, IndexOffsetAt);
+	std::vector<unsigned char> badIndex = bytes;
+	PatchU32(badIndex, indexOffset + (uint32_t)(mesh.Indices.size() - 1) * 4, (uint32_t)mesh.Vertices.size());
+	CHECK(Rejected(badIndex, badIndex.size()));
+
+	// Each kind of range: starting past the end, and running past it
+	uint32_t indexCount = (uint32_t)mesh.Indices.size();
+	size_t ranges[3] = {
+		ReadU32(bytes, SubmeshOffsetAt) + 4,
+		LodTableAt(bytes, mesh) + 4,
+		MeshletTableAt(bytes, mesh) + 4
+	};
+	for (size_t at : ranges)
+	{
+		std::vector<unsigned char> pastEnd = bytes;
+		PatchU32(pastEnd, at, indexCount + 1);
+		PatchU32(pastEnd, at + 4, 0);
+		CHECK(Rejected(pastEnd, pastEnd.size()));
+
+		std::vector<unsigned char> runsOver = bytes;
+		PatchU32(runsOver, at, 3);
+		PatchU32(runsOver, at + 4, indexCount - 2);
+		CHECK(Rejected(runsOver, runsOver.size()));
+
+		// Wrapping back around to small numbers doesn't sneak through
+		std::vector<unsigned char> wraps = bytes;
+		PatchU32(wraps, at, 3);
+		PatchU32(wraps, at + 4, 0xFFFFFFFFu);
+		CHECK(Rejected(wraps, wraps.size()));
+
+		// A range ending exactly at the last index is fine
+		std::vector<unsigned char> exact = bytes;
+		PatchU32(exact, at, 3);
+		PatchU32(exact, at + 4, indexCount - 3);
+		CHECK(!Rejected(exact, exact.size()));
+	}
+
+	int accepted = 0;
+	for (size_t size = 0; size < bytes.size(); size++)
+	{
+		if (!Rejected(bytes, size)) accepted++;
+	}
+	CHECK(accepted == 0);
+
+	std::vector<unsigned char> trailing = bytes;
+	trailing.push_back(0);
+	CHECK(Rejected(trailing, trailing.size()));
+
+	remove(MeshCache::GetCachePath(SourceHash).c_str());
+	remove(MeshCache::GetCachePath(SourceHash ^ 1).c_str());
+}
+
+int main()
+{
+	std::string oldDirectory = MeshCache::CacheDirectory;
+	MeshCache::CacheDirectory = "bin/MeshCacheTest";
+
+	TestRoundTrip();
+	TestRejects();
+
+	remove(MeshCache::GetCachePath(SourceHash).c_str());
+	remove(MeshCache::CacheDirectory.c_str());
+	MeshCache::CacheDirectory = oldDirectory;
+	return CheckResult("MeshCacheTests");
+}
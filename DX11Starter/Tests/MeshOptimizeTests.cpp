@@ -0,0 +1,231 @@
+#include "MeshOptimize.h"
+#include "MeshWeld.h"
+#include "ObjLoader.h"
+#include "Check.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+static uint32_t Next(uint32_t& state)
+{
+	state = state * 1664525u + 1013904223u;
+	return state >> 8;
+}
+
+// --------------------------------------------------------
+// Each submesh's triangles, named by their vertices' original
+// numbers (kept in UV[0], which no pass touches) rather than by
+// index, so the vertex fetch reordering doesn't change them.
+// Rotated to start at the smallest, which keeps the winding,
+// then sorted.
+// --------------------------------------------------------
+typedef std::vector<std::array<float, 3>> TriangleSet;
+
+static std::vector<TriangleSet> CollectTriangles(const MeshData& mesh)
+{
+	std::vector<TriangleSet> sets;
+	for (const MeshSubmesh& submesh : mesh.Submeshes)
+	{
+		TriangleSet set;
+		for (uint32_t i = submesh.IndexStart; i < submesh.IndexStart + submesh.IndexCount; i += 3)
+		{
+			std::array<float, 3> triangle;
+			for (int c = 0; c < 3; c++) triangle[c] = mesh.Vertices[mesh.Indices[i + c]].UV[0];
+			std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+			set.push_back(triangle);
+		}
+		std::sort(set.begin(), set.end());
+		sets.push_back(set);
+	}
+	return sets;
+}
+
+static void NumberVertices(MeshData& mesh)
+{
+	for (size_t v = 0; v < mesh.Vertices.size(); v++)
+		mesh.Vertices[v].UV[0] = (float)v;
+}
+
+static void Shuffle(std::vector<uint32_t>& indices, uint32_t start, uint32_t count, uint32_t& state)
+{
+	for (uint32_t t = count / 3; t > 1; t--)
+	{
+		uint32_t other = Next(state) % t;
+		for (int c = 0; c < 3; c++)
+			std::swap(indices[start + (t - 1) * 3 + c], indices[start + other * 3 + c]);
+	}
+}
+
+// --------------------------------------------------------
+// A bumpy grid appended to the mesh as a new submesh, two
+// triangles per cell, in scanline order
+// --------------------------------------------------------
+static void AddGrid(MeshData& mesh, unsigned int width, unsigned int height, float z)
+{
+	uint32_t base = (uint32_t)mesh.Vertices.size();
+	for (unsigned int y = 0; y <= height; y++)
+	{
+		for (unsigned int x = 0; x <= width; x++)
+		{
+			MeshVertex v = {};
+			v.Position[0] = (float)x;
+			v.Position[1] = (float)y;
+			v.Position[2] = z + 0.3f * sinf(x * 0.7f) * cosf(y * 0.4f);
+			v.Normal[2] = 1.0f;
+			mesh.Vertices.push_back(v);
+		}
+	}
+
+	MeshSubmesh submesh;
+	submesh.IndexStart = (uint32_t)mesh.Indices.size();
+	for (unsigned int y = 0; y < height; y++)
+	{
+		for (unsigned int x = 0; x < width; x++)
+		{
+			uint32_t i = base + y * (width + 1) + x;
+			uint32_t quad[6] = { i, i + width + 1, i + 1, i + 1, i + width + 1, i + width + 2 };
+			mesh.Indices.insert(mesh.Indices.end(), quad, quad + 6);
+		}
+	}
+	submesh.IndexCount = (uint32_t)mesh.Indices.size() - submesh.IndexStart;
+	mesh.Submeshes.push_back(submesh);
+}
+
+// The vertex cache pass on its own, submesh by submesh
+static float CacheOnlyAcmr(const MeshData& original)
+{
+	std::vector<uint32_t> indices = original.Indices, range;
+	for (const MeshSubmesh& submesh : original.Submeshes)
+	{
+		range.assign(indices.begin() + submesh.IndexStart, indices.begin() + submesh.IndexStart + submesh.IndexCount);
+		OptimizeVertexCache(range, original.Vertices.size());
+		std::copy(range.begin(), range.end(), indices.begin() + submesh.IndexStart);
+	}
+	return AnalyzeVertexCache(indices, original.Vertices.size()).Acmr;
+}
+
+// --------------------------------------------------------
+// Optimizes a copy and checks it against the original: every
+// submesh keeps exactly its triangles, winding included; the
+// ACMR reported and measured doesn't go up, and the overdraw
+// pass keeps it within its 5% of the cache order; and every
+// vertex left is used, in first-use order.  Returns the new ACMR.
+// --------------------------------------------------------
+static float CheckOptimize(const MeshData& original, const char* name)
+{
+	MeshData mesh = original;
+	MeshOptimizeStats stats;
+	OptimizeMesh(mesh, &stats);
+
+	VertexCacheStats before = AnalyzeVertexCache(original.Indices, original.Vertices.size());
+	VertexCacheStats after = AnalyzeVertexCache(mesh.Indices, mesh.Vertices.size());
+	bool sameTriangles = CollectTriangles(mesh) == CollectTriangles(original);
+	bool sameStats = stats.Before.Transformed == before.Transformed && stats.After.Transformed == after.Transformed;
+
+	bool firstUse = true;
+	uint32_t nextNew = 0;
+	for (uint32_t index : mesh.Indices)
+	{
+		if (index == nextNew) nextNew++;
+		else if (index > nextNew) firstUse = false;
+	}
+	firstUse = firstUse && nextNew == mesh.Vertices.size();
+
+	float cacheOnly = CacheOnlyAcmr(original);
+	bool overdrawKept = after.Acmr <= cacheOnly * 1.05f + 1e-4f;
+
+	if (!sameTriangles || !sameStats || !firstUse || after.Acmr > before.Acmr || !overdrawKept)
+	{
+		printf("  %s: ACMR %.3f -> %.3f (cache pass alone %.3f), triangles %s, first use %s\n", name,
+			before.Acmr, after.Acmr, cacheOnly, sameTriangles ? "kept" : "changed", firstUse ? "yes" : "no");
+	}
+	CHECK(sameTriangles);
+	CHECK(sameStats);
+	CHECK(firstUse);
+	CHECK(after.Acmr <= before.Acmr);
+	CHECK(overdrawKept);
+	CHECK(mesh.Submeshes.size() == original.Submeshes.size());
+	return after.Acmr;
+}
+
+// --------------------------------------------------------
+// Grids in scanline and shuffled order, several submeshes at
+// once, and triangle soup with degenerate triangles mixed in
+// --------------------------------------------------------
+static void TestSynthetic()
+{
+	uint32_t state = 43;
+
+	MeshData grid;
+	AddGrid(grid, 60, 40, 0.0f);
+	NumberVertices(grid);
+	CheckOptimize(grid, "scanline grid");
+
+	MeshData shuffled = grid;
+	Shuffle(shuffled.Indices, 0, (uint32_t)shuffled.Indices.size(), state);
+	// A regular grid should get close to its ideal of 0.5
+	CHECK(CheckOptimize(shuffled, "shuffled grid") < 0.8f);
+
+	// Optimizing twice doesn't make it worse
+	MeshData twice = shuffled;
+	OptimizeMesh(twice);
+	CheckOptimize(twice, "optimized grid");
+
+	MeshData parts;
+	AddGrid(parts, 20, 20, 0.0f);
+	AddGrid(parts, 1, 1, 5.0f);
+	AddGrid(parts, 45, 7, -3.0f);
+	AddGrid(parts, 3, 30, 2.0f);
+	NumberVertices(parts);
+	for (const MeshSubmesh& submesh : parts.Submeshes)
+		Shuffle(parts.Indices, submesh.IndexStart, submesh.IndexCount, state);
+	CHECK(CheckOptimize(parts, "submeshes") < 0.8f);
+
+	MeshData soup;
+	soup.Vertices.resize(400);
+	for (MeshVertex& v : soup.Vertices)
+	{
+		for (int k = 0; k < 3; k++) v.Position[k] = (float)(Next(state) % 1000) / 100.0f;
+		v.Normal[1] = 1.0f;
+	}
+	NumberVertices(soup);
+	for (int t = 0; t < 3000; t++)
+	{
+		uint32_t a = Next(state) % 400, b = Next(state) % 400, c = t % 50 == 0 ? a : Next(state) % 400;
+		soup.Indices.insert(soup.Indices.end(), { a, b, c });
+	}
+	MeshSubmesh all;
+	all.IndexStart = 0;
+	all.IndexCount = (uint32_t)soup.Indices.size();
+	soup.Submeshes.push_back(all);
+	CheckOptimize(soup, "soup");
+}
+
+// --------------------------------------------------------
+// The game's own models, loaded the way Mesh::Load does.  The
+// car's many small pieces are what the overdraw pass's fallback
+// to hard cluster boundaries is for.
+// --------------------------------------------------------
+static void TestModels()
+{
+	const char* names[4] = { "sphere.obj", "torus.obj", "helix.obj", "Porsche_911_GT2.obj" };
+	for (const char* name : names)
+	{
+		std::string path = std::string("../Assets/Models/") + name;
+		MeshData mesh;
+		CHECK(LoadObj(path.c_str(), mesh));
+		WeldVertices(mesh);
+		NumberVertices(mesh);
+		CheckOptimize(mesh, name);
+	}
+}
+
+int main()
+{
+	TestSynthetic();
+	TestModels();
+	return CheckResult("MeshOptimizeTests");
+}
@@ -0,0 +1,193 @@
+#include "MeshWeld.h"
+#include "Check.h"
+#include <array>
+#include <cstring>
+#include <map>
+#include <vector>
+
+typedef std::array<uint32_t, 8> VertexKey;
+
+// The vertex's bits with -0 read as +0, as welding compares them
+static VertexKey KeyOf(const MeshVertex& vertex)
+{
+	const float values[8] = {
+		vertex.Position[0], vertex.Position[1], vertex.Position[2],
+		vertex.Normal[0], vertex.Normal[1], vertex.Normal[2],
+		vertex.UV[0], vertex.UV[1] };
+	VertexKey key;
+	for (int i = 0; i < 8; i++)
+	{
+		memcpy(&key[i], &values[i], sizeof(uint32_t));
+		if (key[i] == 0x80000000u) key[i] = 0;
+	}
+	return key;
+}
+
+static uint32_t Next(uint32_t& state)
+{
+	state = state * 1664525u + 1013904223u;
+	return state >> 8;
+}
+
+// --------------------------------------------------------
+// A mesh drawn from a small pool of distinct vertices, copied
+// many times over with random signs on its zeros, plus copies
+// no index ever points at
+// --------------------------------------------------------
+static MeshData RandomMesh(uint32_t& state, unsigned int poolSize, unsigned int vertexCount, unsigned int indexCount)
+{
+	std::vector<MeshVertex> pool(poolSize);
+	for (MeshVertex& v : pool)
+	{
+		for (int k = 0; k < 3; k++) v.Position[k] = (float)(Next(state) % 5);
+		for (int k = 0; k < 3; k++) v.Normal[k] = (float)(Next(state) % 3) - 1.0f;
+		for (int k = 0; k < 2; k++) v.UV[k] = (Next(state) % 4) * 0.25f;
+	}
+
+	MeshData mesh;
+	for (unsigned int i = 0; i < vertexCount; i++)
+	{
+		MeshVertex v = pool[Next(state) % poolSize];
+		float* fields[8] = { &v.Position[0], &v.Position[1], &v.Position[2],
+			&v.Normal[0], &v.Normal[1], &v.Normal[2], &v.UV[0], &v.UV[1] };
+		for (float* field : fields)
+		{
+			if (*field == 0.0f && Next(state) % 2) *field = -0.0f;
+		}
+		mesh.Vertices.push_back(v);
+	}
+
+	// The last quarter of the vertices is never used
+	for (unsigned int i = 0; i < indexCount; i++)
+		mesh.Indices.push_back(Next(state) % (vertexCount - vertexCount / 4));
+	return mesh;
+}
+
+// --------------------------------------------------------
+// What welding should give, the slow way: one vertex per
+// distinct key, numbered in the order the indices first use them
+// --------------------------------------------------------
+static void WeldByHand(const MeshData& source, std::vector<VertexKey>& keys, std::vector<uint32_t>& indices)
+{
+	std::map<VertexKey, uint32_t> seen;
+	keys.clear();
+	indices.clear();
+	for (uint32_t index : source.Indices)
+	{
+		VertexKey key = KeyOf(source.Vertices[index]);
+		auto found = seen.find(key);
+		if (found == seen.end())
+		{
+			found = seen.insert(std::make_pair(key, (uint32_t)keys.size())).first;
+			keys.push_back(key);
+		}
+		indices.push_back(found->second);
+	}
+}
+
+// --------------------------------------------------------
+// Random meshes weld to exactly the slow version's result: the
+// same vertices in first-use order, every index pointing at a
+// vertex equal to the one it used to, unused copies dropped
+// --------------------------------------------------------
+static void TestMatchesReference()
+{
+	uint32_t state = 42;
+	int wrongVertices = 0, wrongIndices = 0, wrongStats = 0, unchanged = 0;
+	for (int run = 0; run < 300; run++)
+	{
+		unsigned int pool = 1 + Next(state) % 200;
+		unsigned int vertexCount = 4 + Next(state) % 3000;
+		unsigned int indexCount = Next(state) % 4000;
+		MeshData mesh = RandomMesh(state, pool, vertexCount, indexCount);
+		MeshData original = mesh;
+
+		std::vector<VertexKey> keys;
+		std::vector<uint32_t> indices;
+		WeldByHand(original, keys, indices);
+
+		MeshWeldStats stats;
+		WeldVertices(mesh, &stats);
+
+		if (mesh.Vertices.size() != keys.size()) wrongVertices++;
+		for (size_t i = 0; i < mesh.Vertices.size() && i < keys.size(); i++)
+		{
+			if (KeyOf(mesh.Vertices[i]) != keys[i])
+			{
+				wrongVertices++;
+				break;
+			}
+		}
+		if (mesh.Indices != indices) wrongIndices++;
+		for (size_t i = 0; i < mesh.Indices.size() && i < original.Indices.size(); i++)
+		{
+			if (mesh.Indices[i] >= mesh.Vertices.size() ||
+				KeyOf(mesh.Vertices[mesh.Indices[i]]) != KeyOf(original.Vertices[original.Indices[i]]))
+			{
+				wrongIndices++;
+				break;
+			}
+		}
+
+		if (stats.VerticesBefore != vertexCount || stats.VerticesAfter != mesh.Vertices.size())
+			wrongStats++;
+		if (stats.VerticesAfter == stats.VerticesBefore) unchanged++;
+	}
+	CHECK(wrongVertices == 0);
+	CHECK(wrongIndices == 0);
+	CHECK(wrongStats == 0);
+	CHECK(unchanged == 0);
+}
+
+// --------------------------------------------------------
+// The small cases spelled out
+// --------------------------------------------------------
+static void TestByHand()
+{
+	// Two copies of a vertex that differ only in the sign of zero,
+	// one that differs in a single UV bit, and one nothing uses
+	MeshVertex a = { { 0.0f, 1.0f, 2.0f }, { 0.0f, 0.0f, 1.0f }, { 0.5f, 0.0f } };
+	MeshVertex negativeZero = { { -0.0f, 1.0f, 2.0f }, { 0.0f, -0.0f, 1.0f }, { 0.5f, -0.0f } };
+	MeshVertex nearlyA = a;
+	uint32_t bits;
+	memcpy(&bits, &nearlyA.UV[0], sizeof(bits));
+	bits++;
+	memcpy(&nearlyA.UV[0], &bits, sizeof(bits));
+	MeshVertex unused = { { 9.0f, 9.0f, 9.0f }, { 1.0f, 0.0f, 0.0f }, { 1.0f, 1.0f } };
+
+	MeshData mesh;
+	mesh.Vertices = { unused, nearlyA, negativeZero, a };
+	mesh.Indices = { 3, 2, 1, 1, 2, 3 };
+	MeshSubmesh submesh;
+	submesh.IndexStart = 0;
+	submesh.IndexCount = 6;
+	mesh.Submeshes.push_back(submesh);
+
+	MeshWeldStats stats;
+	WeldVertices(mesh, &stats);
+	CHECK(mesh.Vertices.size() == 2);
+	CHECK(mesh.Indices == std::vector<uint32_t>({ 0, 0, 1, 1, 0, 0 }));
+	CHECK(stats.VerticesBefore == 4 && stats.VerticesAfter == 2);
+	CHECK(stats.GetReduction() == 2.0f);
+	CHECK(mesh.Vertices.size() == 2 && memcmp(&mesh.Vertices[0], &a, sizeof(a)) == 0);
+	CHECK(mesh.Vertices.size() == 2 && memcmp(&mesh.Vertices[1], &nearlyA, sizeof(a)) == 0);
+	CHECK(mesh.Submeshes.size() == 1 && mesh.Submeshes[0].IndexCount == 6);
+
+	// No indices, no vertices
+	MeshData empty;
+	empty.Vertices = { a, unused };
+	WeldVertices(empty, &stats);
+	CHECK(empty.Vertices.empty() && stats.VerticesBefore == 2 && stats.VerticesAfter == 0);
+	CHECK(stats.GetReduction() == 1.0f);
+
+	MeshData nothing;
+	WeldVertices(nothing, &stats);
+	CHECK(nothing.Vertices.empty() && stats.VerticesBefore == 0 && stats.VerticesAfter == 0);
+}
+
+int main()
+{
+	TestMatchesReference();
+	TestByHand();
+	return CheckResult("MeshWeldTests");
+}
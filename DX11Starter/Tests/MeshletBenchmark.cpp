@@ -0,0 +1,317 @@
+#include "ObjLoader.h"
+#include "MeshWeld.h"
+#include "MeshOptimize.h"
+#include "Meshlet.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <dirent.h>
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------
+// BuildMeshlets and CullMeshlets on every .obj in Assets/Models
+// (or the directory given on the command line), loaded the way
+// Mesh::Load does: welded and optimized first.
+//
+// The build is checked for keeping every submesh's triangles,
+// staying within the meshlet limits and bounding its vertices.
+// Culling runs from random cameras around the mesh, and fails
+// the run if it ever drops a triangle that faces the camera and
+// touches the frustum.
+// --------------------------------------------------------
+
+static const int BuildRepeats = 5;
+static const int ViewCount = 200;
+static const int CullRepeats = 50;
+static const unsigned int MergeGap = 8;
+
+typedef std::chrono::steady_clock Clock;
+
+static double Milliseconds(Clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static void Cross(const float* a, const float* b, float* out)
+{
+	out[0] = a[1] * b[2] - a[2] * b[1];
+	out[1] = a[2] * b[0] - a[0] * b[2];
+	out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+static void Normalize(float* v)
+{
+	float length = sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+	for (int k = 0; k < 3; k++) v[k] /= length;
+}
+
+// Small LCG so every run sees the same cameras
+static float RandomSigned(uint32_t& state)
+{
+	state = state * 1664525u + 1013904223u;
+	return (state >> 8) / 8388608.0f - 1.0f;
+}
+
+// Each submesh's triangles, rotated to start at their smallest
+// index and sorted, so reordering doesn't change the result
+typedef std::vector<std::array<uint32_t, 3>> TriangleSet;
+
+static std::vector<TriangleSet> CollectTriangles(const MeshData& mesh)
+{
+	std::vector<TriangleSet> sets;
+	for (const MeshSubmesh& submesh : mesh.Submeshes)
+	{
+		TriangleSet set;
+		for (uint32_t i = submesh.IndexStart; i < submesh.IndexStart + submesh.IndexCount; i += 3)
+		{
+			std::array<uint32_t, 3> triangle = { { mesh.Indices[i], mesh.Indices[i + 1], mesh.Indices[i + 2] } };
+			std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+			set.push_back(triangle);
+		}
+		std::sort(set.begin(), set.end());
+		sets.push_back(set);
+	}
+	return sets;
+}
+
+// Limits, contiguous ranges and spheres that hold their vertices
+static bool CheckMeshlets(const MeshData& mesh)
+{
+	uint32_t expected = 0;
+	for (const Meshlet& meshlet : mesh.Meshlets)
+	{
+		if (meshlet.IndexStart != expected || meshlet.IndexCount / 3 > MeshletMaxTriangles)
+			return false;
+		expected += meshlet.IndexCount;
+
+		std::vector<uint32_t> vertices(mesh.Indices.begin() + meshlet.IndexStart,
+			mesh.Indices.begin() + meshlet.IndexStart + meshlet.IndexCount);
+		std::sort(vertices.begin(), vertices.end());
+		vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+		if (vertices.size() > MeshletMaxVertices) return false;
+
+		for (uint32_t v : vertices)
+		{
+			float distanceSq = 0;
+			for (int k = 0; k < 3; k++)
+			{
+				float d = mesh.Vertices[v].Position[k] - meshlet.Center[k];
+				distanceSq += d * d;
+			}
+			if (sqrtf(distanceSq) > meshlet.Radius * (1 + 1e-5f) + 1e-6f) return false;
+		}
+	}
+	const MeshSubmesh& last = mesh.Submeshes.back();
+	return expected == last.IndexStart + last.IndexCount;
+}
+
+// --------------------------------------------------------
+// A 60 degree frustum somewhere around the mesh, aimed roughly
+// at its centre so some meshlets fall off the edges
+// --------------------------------------------------------
+static MeshletView RandomView(const float center[3], float size, uint32_t& state)
+{
+	float direction[3];
+	float length;
+	do
+	{
+		for (int k = 0; k < 3; k++) direction[k] = RandomSigned(state);
+		length = sqrtf(direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2]);
+	} while (length < 0.1f || length > 1.0f);
+
+	MeshletView view;
+	float distance = size * (0.6f + 1.5f * (RandomSigned(state) + 1.0f));
+	float forward[3];
+	for (int k = 0; k < 3; k++)
+	{
+		view.CameraPosition[k] = center[k] + direction[k] / length * distance;
+		forward[k] = -direction[k] / length;
+	}
+	forward[0] += 0.4f * RandomSigned(state);
+	forward[1] += 0.4f * RandomSigned(state);
+	Normalize(forward);
+
+	float worldUp[3] = { 0, 1, 0 };
+	float right[3], up[3];
+	Cross(worldUp, forward, right);
+	Normalize(right);
+	Cross(forward, right, up);
+
+	// Sides lean in by the half angle; near and far face each other
+	const float slope = tanf(0.5f);
+	const float planes[6][3] = {
+		{ slope, 1, 0 }, { slope, -1, 0 }, { slope, 0, 1 }, { slope, 0, -1 }, { 1, 0, 0 }, { -1, 0, 0 }
+	};
+	for (int p = 0; p < 6; p++)
+	{
+		float* plane = view.Planes[p];
+		for (int k = 0; k < 3; k++)
+			plane[k] = planes[p][0] * forward[k] + planes[p][1] * right[k] + planes[p][2] * up[k];
+		Normalize(plane);
+		plane[3] = -(plane[0] * view.CameraPosition[0] + plane[1] * view.CameraPosition[1] + plane[2] * view.CameraPosition[2]);
+	}
+	view.Planes[4][3] -= 0.01f;
+	view.Planes[5][3] += 1000.0f;
+	return view;
+}
+
+// Triangles that face the camera and touch the frustum but
+// aren't in any returned range
+static unsigned int CountWronglyCulled(const MeshData& mesh, const MeshletView& view, const std::vector<MeshletRange>& ranges)
+{
+	std::vector<uint8_t> drawn(mesh.Indices.size() / 3, 0);
+	for (const MeshletRange& range : ranges)
+	{
+		for (uint32_t i = range.IndexStart; i < range.IndexStart + range.IndexCount; i += 3)
+			drawn[i / 3] = 1;
+	}
+
+	unsigned int wrong = 0;
+	for (const Meshlet& meshlet : mesh.Meshlets)
+	{
+		for (uint32_t i = meshlet.IndexStart; i < meshlet.IndexStart + meshlet.IndexCount; i += 3)
+		{
+			if (drawn[i / 3]) continue;
+
+			const float* p[3];
+			for (int c = 0; c < 3; c++) p[c] = mesh.Vertices[mesh.Indices[i + c]].Position;
+			float a[3], b[3], normal[3];
+			for (int k = 0; k < 3; k++)
+			{
+				a[k] = p[1][k] - p[0][k];
+				b[k] = p[2][k] - p[0][k];
+			}
+			Cross(a, b, normal);
+			float facing = 0;
+			for (int k = 0; k < 3; k++) facing += normal[k] * (view.CameraPosition[k] - p[0][k]);
+			if (facing <= 0) continue;
+
+			bool inside = true;
+			for (int plane = 0; plane < 6 && inside; plane++)
+			{
+				bool anyCorner = false;
+				for (int c = 0; c < 3; c++)
+				{
+					const float* n = view.Planes[plane];
+					if (n[0] * p[c][0] + n[1] * p[c][1] + n[2] * p[c][2] + n[3] > -1e-4f) anyCorner = true;
+				}
+				inside = anyCorner;
+			}
+			if (inside) wrong++;
+		}
+	}
+	return wrong;
+}
+
+static std::vector<std::string> FindObjFiles(const std::string& directory)
+{
+	std::vector<std::string> files;
+	DIR* dir = opendir(directory.c_str());
+	if (!dir) return files;
+	while (dirent* entry = readdir(dir))
+	{
+		std::string name = entry->d_name;
+		if (name.size() > 4 && name.compare(name.size() - 4, 4, ".obj") == 0)
+			files.push_back(name);
+	}
+	closedir(dir);
+	std::sort(files.begin(), files.end());
+	return files;
+}
+
+int main(int argc, char* argv[])
+{
+	std::string directory = argc > 1 ? argv[1] : "../Assets/Models";
+	std::vector<std::string> files = FindObjFiles(directory);
+	if (files.empty())
+	{
+		printf("MeshletBenchmark: no .obj files in %s\n", directory.c_str());
+		return 1;
+	}
+
+	printf("MeshletBenchmark: %s, build best of %d, cull from %d views\n", directory.c_str(), BuildRepeats, ViewCount);
+	printf("%-22s %9s %9s %8s %9s %9s %9s %9s %8s\n",
+		"file", "triangles", "meshlets", "avg tris", "build ms", "cull us", "meshlets", "triangles", "draws");
+
+	bool failed = false;
+	uint32_t state = 1;
+	for (const std::string& name : files)
+	{
+		std::string path = directory + "/" + name;
+		MeshData source;
+		if (!LoadObj(path.c_str(), source))
+		{
+			failed = true;
+			printf("  %s: LoadObj failed\n", name.c_str());
+			continue;
+		}
+		WeldVertices(source);
+		OptimizeMesh(source);
+		std::vector<TriangleSet> before = CollectTriangles(source);
+
+		MeshData mesh;
+		double buildTime = 1e30;
+		for (int r = 0; r < BuildRepeats; r++)
+		{
+			mesh = source;
+			Clock::time_point start = Clock::now();
+			BuildMeshlets(mesh);
+			buildTime = std::min(buildTime, Milliseconds(start));
+		}
+
+		if (CollectTriangles(mesh) != before || !CheckMeshlets(mesh))
+		{
+			failed = true;
+			printf("  %s: meshlets don't match the mesh\n", name.c_str());
+			continue;
+		}
+
+		MeshletBounds bounds;
+		bounds.Build(mesh.Meshlets);
+		MeshBounds box = ComputeMeshBounds(mesh.Vertices.data(), mesh.Vertices.size());
+		float center[3];
+		float size = 0;
+		for (int k = 0; k < 3; k++)
+		{
+			center[k] = (box.Min[k] + box.Max[k]) * 0.5f;
+			size = std::max(size, box.Max[k] - box.Min[k]);
+		}
+
+		double cullTime = 0;
+		double visibleMeshlets = 0, drawnTriangles = 0, draws = 0;
+		unsigned int wrong = 0;
+		std::vector<MeshletRange> ranges;
+		for (int v = 0; v < ViewCount; v++)
+		{
+			MeshletView view = RandomView(center, size, state);
+			unsigned int visible = 0;
+			Clock::time_point start = Clock::now();
+			for (int r = 0; r < CullRepeats; r++)
+				visible = CullMeshlets(mesh.Meshlets, bounds, view, MergeGap, ranges);
+			cullTime += Milliseconds(start) / CullRepeats;
+
+			visibleMeshlets += visible;
+			draws += ranges.size();
+			for (const MeshletRange& range : ranges)
+				drawnTriangles += range.IndexCount / 3;
+			wrong += CountWronglyCulled(mesh, view, ranges);
+		}
+
+		size_t triangles = mesh.Indices.size() / 3;
+		printf("%-22s %9zu %9zu %8.1f %9.2f %9.2f %8.1f%% %8.1f%% %8.1f\n",
+			name.c_str(), triangles, mesh.Meshlets.size(), (double)triangles / mesh.Meshlets.size(),
+			buildTime, cullTime / ViewCount * 1000.0,
+			100.0 * visibleMeshlets / ViewCount / mesh.Meshlets.size(),
+			100.0 * drawnTriangles / ViewCount / triangles, draws / ViewCount);
+
+		if (wrong > 0)
+		{
+			failed = true;
+			printf("  %s: %u visible triangles culled\n", name.c_str(), wrong);
+		}
+	}
+	return failed ? 1 : 0;
+}
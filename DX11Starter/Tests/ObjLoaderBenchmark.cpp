@@ -0,0 +1,216 @@
+#include "ObjLoader.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------
+// LoadObj on every .obj in Assets/Models (or the directory
+// given on the command line), three ways:
+//  - the old loader's getline + sscanf loop, as a baseline
+//  - LoadObj on the calling thread
+//  - LoadObj across a JobSystem with every hardware thread
+//
+// The run fails if any file doesn't load, if the parallel
+// load differs from the serial one, or if LoadObj differs from
+// the baseline on a file the baseline understands.
+// --------------------------------------------------------
+
+static const int Repeats = 5;
+
+typedef std::chrono::steady_clock Clock;
+
+static double Milliseconds(Clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// --------------------------------------------------------
+// What Mesh's constructor did before LoadObj, minus the 100
+// character line limit: v/t/n triangles and quads only, Z and
+// V flipped, winding reversed, no index buffer.  Returns false
+// on anything else.
+// --------------------------------------------------------
+static bool BaselineLoad(const char* path, std::vector<MeshVertex>& vertices)
+{
+	std::ifstream obj(path);
+	if (!obj.is_open()) return false;
+
+	std::vector<float> positions, normals, uvs;
+	std::string line;
+	while (std::getline(obj, line))
+	{
+		const char* chars = line.c_str();
+		float a, b, c;
+		if (chars[0] == 'v' && chars[1] == 'n')
+		{
+			if (sscanf(chars, "vn %f %f %f", &a, &b, &c) != 3) return false;
+			normals.insert(normals.end(), { a, b, c });
+		}
+		else if (chars[0] == 'v' && chars[1] == 't')
+		{
+			if (sscanf(chars, "vt %f %f", &a, &b) != 2) return false;
+			uvs.insert(uvs.end(), { a, b });
+		}
+		else if (chars[0] == 'v' && chars[1] == ' ')
+		{
+			if (sscanf(chars, "v %f %f %f", &a, &b, &c) != 3) return false;
+			positions.insert(positions.end(), { a, b, c });
+		}
+		else if (chars[0] == 'f')
+		{
+			unsigned int i[12];
+			int read = sscanf(chars, "f %u/%u/%u %u/%u/%u %u/%u/%u %u/%u/%u",
+				&i[0], &i[1], &i[2], &i[3], &i[4], &i[5], &i[6], &i[7], &i[8], &i[9], &i[10], &i[11]);
+			if (read != 9 && read != 12) return false;
+			for (int k = 0; k < read; k += 3)
+			{
+				if (i[k] == 0 || i[k] * 3 > positions.size() ||
+					i[k + 1] == 0 || i[k + 1] * 2 > uvs.size() ||
+					i[k + 2] == 0 || i[k + 2] * 3 > normals.size())
+					return false;
+			}
+
+			MeshVertex corners[4];
+			for (int k = 0; k < read / 3; k++)
+			{
+				const unsigned int* index = i + k * 3;
+				MeshVertex& v = corners[k];
+				memcpy(v.Position, &positions[(index[0] - 1) * 3], sizeof(v.Position));
+				memcpy(v.Normal, &normals[(index[2] - 1) * 3], sizeof(v.Normal));
+				v.UV[0] = uvs[(index[1] - 1) * 2];
+				v.UV[1] = 1.0f - uvs[(index[1] - 1) * 2 + 1];
+				v.Position[2] *= -1.0f;
+				v.Normal[2] *= -1.0f;
+			}
+			vertices.push_back(corners[0]);
+			vertices.push_back(corners[2]);
+			vertices.push_back(corners[1]);
+			if (read == 12)
+			{
+				vertices.push_back(corners[0]);
+				vertices.push_back(corners[3]);
+				vertices.push_back(corners[2]);
+			}
+		}
+	}
+	return true;
+}
+
+static bool SameMesh(const MeshData& a, const MeshData& b)
+{
+	if (a.Vertices.size() != b.Vertices.size() || a.Indices != b.Indices ||
+		a.Submeshes.size() != b.Submeshes.size())
+		return false;
+	for (size_t s = 0; s < a.Submeshes.size(); s++)
+	{
+		if (a.Submeshes[s].IndexStart != b.Submeshes[s].IndexStart ||
+			a.Submeshes[s].IndexCount != b.Submeshes[s].IndexCount)
+			return false;
+	}
+	return memcmp(a.Vertices.data(), b.Vertices.data(), a.Vertices.size() * sizeof(MeshVertex)) == 0;
+}
+
+// LoadObj's output expanded back out to one vertex per corner
+static bool SameAsBaseline(const MeshData& mesh, const std::vector<MeshVertex>& baseline)
+{
+	if (mesh.Indices.size() != baseline.size()) return false;
+	for (size_t i = 0; i < baseline.size(); i++)
+	{
+		if (memcmp(&mesh.Vertices[mesh.Indices[i]], &baseline[i], sizeof(MeshVertex)) != 0)
+			return false;
+	}
+	return true;
+}
+
+static std::vector<std::string> FindObjFiles(const std::string& directory)
+{
+	std::vector<std::string> files;
+	DIR* dir = opendir(directory.c_str());
+	if (!dir) return files;
+	while (dirent* entry = readdir(dir))
+	{
+		std::string name = entry->d_name;
+		if (name.size() > 4 && name.compare(name.size() - 4, 4, ".obj") == 0)
+			files.push_back(name);
+	}
+	closedir(dir);
+	std::sort(files.begin(), files.end());
+	return files;
+}
+
+int main(int argc, char* argv[])
+{
+	std::string directory = argc > 1 ? argv[1] : "../Assets/Models";
+	std::vector<std::string> files = FindObjFiles(directory);
+	if (files.empty())
+	{
+		printf("ObjLoaderBenchmark: no .obj files in %s\n", directory.c_str());
+		return 1;
+	}
+
+	JobSystem jobs;
+	printf("ObjLoaderBenchmark: %s, %u threads, best of %d\n", directory.c_str(), jobs.GetThreadCount(), Repeats);
+	printf("%-22s %8s %9s %9s %12s %12s %12s %8s\n",
+		"file", "KB", "vertices", "indices", "baseline ms", "serial ms", "parallel ms", "MB/s");
+
+	bool failed = false;
+	for (const std::string& name : files)
+	{
+		std::string path = directory + "/" + name;
+		double baselineTime = 1e30, serialTime = 1e30, parallelTime = 1e30;
+		std::vector<MeshVertex> baseline;
+		MeshData serial, parallel;
+		bool baselineLoaded = false, serialLoaded = true, parallelLoaded = true;
+
+		for (int r = 0; r < Repeats; r++)
+		{
+			baseline.clear();
+			Clock::time_point start = Clock::now();
+			baselineLoaded = BaselineLoad(path.c_str(), baseline);
+			baselineTime = std::min(baselineTime, Milliseconds(start));
+
+			serial = MeshData();
+			start = Clock::now();
+			serialLoaded &= LoadObj(path.c_str(), serial);
+			serialTime = std::min(serialTime, Milliseconds(start));
+
+			parallel = MeshData();
+			start = Clock::now();
+			parallelLoaded &= LoadObj(path.c_str(), parallel, &jobs);
+			parallelTime = std::min(parallelTime, Milliseconds(start));
+		}
+
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+		double kilobytes = (double)file.tellg() / 1024.0;
+		printf("%-22s %8.0f %9zu %9zu %12.2f %12.2f %12.2f %8.0f\n",
+			name.c_str(), kilobytes, serial.Vertices.size(), serial.Indices.size(),
+			baselineTime, serialTime, parallelTime, kilobytes / 1024.0 / (parallelTime / 1000.0));
+
+		if (!serialLoaded || !parallelLoaded)
+		{
+			failed = true;
+			printf("  %s: LoadObj failed\n", name.c_str());
+		}
+		else if (!SameMesh(serial, parallel))
+		{
+			failed = true;
+			printf("  %s: parallel load differs from serial\n", name.c_str());
+		}
+		else if (baselineLoaded && !SameAsBaseline(serial, baseline))
+		{
+			failed = true;
+			printf("  %s: differs from the baseline loader\n", name.c_str());
+		}
+		else if (!baselineLoaded)
+		{
+			printf("  %s: baseline can't read it, not compared\n", name.c_str());
+		}
+	}
+	return failed ? 1 : 0;
+}
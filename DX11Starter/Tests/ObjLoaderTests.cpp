@@ -0,0 +1,135 @@
+#include "ObjLoader.h"
+#include "Check.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static uint32_t FloatBits(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+
+static bool Parse(const char* text, float& value, const char** stop = nullptr)
+{
+	const char* p = text;
+	bool parsed = ParseObjFloat(p, text + strlen(text), value);
+	if (stop) *stop = p;
+	return parsed;
+}
+
+// Spread over every normal exponent, both signs
+static float RandomFloat(uint32_t& state)
+{
+	uint32_t bits;
+	do
+	{
+		state = state * 1664525u + 1013904223u;
+		bits = state;
+	} while (((bits >> 23) & 0xFF) == 0 || ((bits >> 23) & 0xFF) == 0xFF);
+	float value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+// --------------------------------------------------------
+// Any float printed with 9 significant digits (enough to pick
+// it out) parses back to exactly the same bits
+// --------------------------------------------------------
+static void TestRoundTrip()
+{
+	const char* formats[3] = { "%.9g", "%.8e", "%+.9G" };
+	uint32_t state = 2024;
+	int failures = 0;
+	for (int i = 0; i < 300000; i++)
+	{
+		float value = RandomFloat(state);
+		char text[64];
+		snprintf(text, sizeof(text), formats[i % 3], value);
+
+		float parsed = 0.0f;
+		if (!Parse(text, parsed) || FloatBits(parsed) != FloatBits(value))
+		{
+			if (failures++ < 5) printf("  %s -> %.9g\n", text, parsed);
+		}
+	}
+	CHECK(failures == 0);
+}
+
+// --------------------------------------------------------
+// Fixed point with six decimals, what most exporters write,
+// gives exactly what strtof does
+// --------------------------------------------------------
+static void TestFixedPoint()
+{
+	uint32_t state = 7;
+	int failures = 0;
+	for (int i = 0; i < 300000; i++)
+	{
+		state = state * 1664525u + 1013904223u;
+		double value = ((double)state / 4294967296.0 - 0.5) * 2000.0;
+		char text[64];
+		snprintf(text, sizeof(text), "%.6f", value);
+
+		float parsed = 0.0f;
+		if (!Parse(text, parsed) || FloatBits(parsed) != FloatBits(strtof(text, nullptr)))
+		{
+			if (failures++ < 5) printf("  %s -> %.9g\n", text, parsed);
+		}
+	}
+	CHECK(failures == 0);
+}
+
+// --------------------------------------------------------
+// The odd spellings OBJ files use, and what gets consumed
+// --------------------------------------------------------
+static void TestForms()
+{
+	float value = 0.0f;
+	const char* stop = nullptr;
+
+	CHECK(Parse("1.5", value) && value == 1.5f);
+	CHECK(Parse("+2", value) && value == 2.0f);
+	CHECK(Parse("-0.25e2", value) && value == -25.0f);
+	CHECK(Parse(".5", value) && value == 0.5f);
+	CHECK(Parse("5.", value) && value == 5.0f);
+	CHECK(Parse("1E-3", value) && value == 0.001f);
+	CHECK(Parse("3e+2", value) && value == 300.0f);
+	CHECK(Parse("-0", value) && FloatBits(value) == 0x80000000u);
+	CHECK(Parse("0.000000", value) && FloatBits(value) == 0);
+	CHECK(Parse("1e-50", value) && value == 0.0f);
+	CHECK(Parse("1e50", value) && std::isinf(value));
+	CHECK(Parse("0.1000000000000000000000000001", value) && value == 0.1f);
+	CHECK(Parse("123456789012345678901234567890", value) && value == 1.23456789e29f);
+
+	// Leading spaces and tabs are skipped, the rest of the line isn't
+	CHECK(Parse(" \t 7 8", value, &stop) && value == 7.0f && strcmp(stop, " 8") == 0);
+	CHECK(Parse("4/5/6", value, &stop) && value == 4.0f && strcmp(stop, "/5/6") == 0);
+
+	// An 'e' with no exponent after it isn't part of the number
+	CHECK(Parse("2e", value, &stop) && value == 2.0f && strcmp(stop, "e") == 0);
+	CHECK(Parse("2e-x", value, &stop) && value == 2.0f && strcmp(stop, "e-x") == 0);
+
+	// No digits fails and leaves the text where it was
+	const char* bad[4] = { "", "-", ".", "x1" };
+	for (const char* text : bad)
+	{
+		CHECK(!Parse(text, value, &stop));
+		CHECK(stop == text);
+	}
+
+	// The end pointer is respected, the text needn't be terminated
+	const char* digits = "12345";
+	const char* p = digits;
+	CHECK(ParseObjFloat(p, digits + 2, value) && value == 12.0f && p == digits + 2);
+}
+
+int main()
+{
+	TestRoundTrip();
+	TestFixedPoint();
+	TestForms();
+	return CheckResult("ObjLoaderTests");
+}
@@ -0,0 +1,158 @@
+#include "ParticleBurst.h"
+#include "Check.h"
+#include <cmath>
+#include <vector>
+
+// --------------------------------------------------------
+// The per-shape formulas with the CRT's sin, cos and cbrt, fed
+// the same random stream SampleParticleShape draws
+// --------------------------------------------------------
+static void ReferenceSample(const ParticleShape& shape, ParticleRandom& random, float* x, float* y, float* z, unsigned int count)
+{
+	const float* c = shape.Center;
+	const float* e = shape.Extents;
+	const float twoPi = 6.28318530718f;
+
+	float axis[3] = { c[0], c[1], c[2] };
+	float tangent[3] = { 0, 0, 0 };
+	float bitangent[3] = { 0, 0, 0 };
+	if (shape.Type == ParticleShapeType::Cone)
+	{
+		float other[3] = { 0, 0, 0 };
+		if (fabsf(axis[0]) < 0.9f) other[0] = 1; else other[1] = 1;
+		tangent[0] = axis[1] * other[2] - axis[2] * other[1];
+		tangent[1] = axis[2] * other[0] - axis[0] * other[2];
+		tangent[2] = axis[0] * other[1] - axis[1] * other[0];
+		float length = sqrtf(tangent[0] * tangent[0] + tangent[1] * tangent[1] + tangent[2] * tangent[2]);
+		for (int i = 0; i < 3; i++) tangent[i] /= length;
+		bitangent[0] = axis[1] * tangent[2] - axis[2] * tangent[1];
+		bitangent[1] = axis[2] * tangent[0] - axis[0] * tangent[2];
+		bitangent[2] = axis[0] * tangent[1] - axis[1] * tangent[0];
+	}
+	float minCos = cosf(shape.ConeAngle);
+
+	float u0[64], u1[64], u2[64];
+	for (unsigned int start = 0; start < count; start += 64)
+	{
+		unsigned int n = count - start < 64 ? count - start : 64;
+		random.Fill(u0, n);
+		random.Fill(u1, n);
+		random.Fill(u2, n);
+
+		for (unsigned int i = 0; i < n; i++)
+		{
+			float* px = x + start + i;
+			float* py = y + start + i;
+			float* pz = z + start + i;
+			if (shape.Type == ParticleShapeType::Box)
+			{
+				*px = c[0] + e[0] * (u0[i] * 2.0f - 1.0f);
+				*py = c[1] + e[1] * (u1[i] * 2.0f - 1.0f);
+				*pz = c[2] + e[2] * (u2[i] * 2.0f - 1.0f);
+			}
+			else if (shape.Type == ParticleShapeType::Sphere)
+			{
+				float cosTheta = u0[i] * 2.0f - 1.0f;
+				float sinTheta = sqrtf(1.0f - cosTheta * cosTheta);
+				float phi = u1[i] * twoPi;
+				float r = e[0] * cbrtf(u2[i]);
+				*px = c[0] + r * sinTheta * cosf(phi);
+				*py = c[1] + r * sinTheta * sinf(phi);
+				*pz = c[2] + r * cosTheta;
+			}
+			else
+			{
+				float cosTheta = minCos + (1.0f - minCos) * u0[i];
+				float sinTheta = sqrtf(1.0f - cosTheta * cosTheta);
+				float phi = u1[i] * twoPi;
+				float length = shape.MinLength + (shape.MaxLength - shape.MinLength) * u2[i];
+				float a = length * cosTheta;
+				float t = length * sinTheta * cosf(phi);
+				float b = length * sinTheta * sinf(phi);
+				*px = axis[0] * a + tangent[0] * t + bitangent[0] * b;
+				*py = axis[1] * a + tangent[1] * t + bitangent[1] * b;
+				*pz = axis[2] * a + tangent[2] * t + bitangent[2] * b;
+			}
+		}
+	}
+}
+
+// Largest difference from the reference, relative to the shape's size
+static float CompareWithReference(const ParticleShape& shape, unsigned int count, float scale)
+{
+	std::vector<float> x(count), y(count), z(count);
+	std::vector<float> rx(count), ry(count), rz(count);
+	ParticleRandom random(77);
+	ParticleRandom reference(77);
+	SampleParticleShape(shape, random, x.data(), y.data(), z.data(), count);
+	ReferenceSample(shape, reference, rx.data(), ry.data(), rz.data(), count);
+
+	float worst = 0.0f;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		worst = std::fmax(worst, fabsf(x[i] - rx[i]));
+		worst = std::fmax(worst, fabsf(y[i] - ry[i]));
+		worst = std::fmax(worst, fabsf(z[i] - rz[i]));
+	}
+
+	// Both used up the same random numbers
+	CHECK(random.NextFloat() == reference.NextFloat());
+	return worst / scale;
+}
+
+// --------------------------------------------------------
+// The SSE loops agree with the scalar formulas, at every count
+// including ones that end part way through a group of four
+// --------------------------------------------------------
+static void TestMatchesReference()
+{
+	const unsigned int counts[6] = { 1, 3, 4, 63, 65, 1001 };
+	for (unsigned int count : counts)
+	{
+		CHECK(CompareWithReference(ParticleBox(1, 2, 3, 4, 5, 6), count, 6.0f) < 1e-6f);
+		CHECK(CompareWithReference(ParticleSphere(-5, 0, 10, 3.0f), count, 3.0f) < 2e-6f);
+		CHECK(CompareWithReference(ParticleCone(0, 1, 0, 0.6f, 2.0f, 8.0f), count, 8.0f) < 2e-6f);
+		CHECK(CompareWithReference(ParticleCone(1, 0, 0, 3.0f, 0.0f, 1.0f), count, 1.0f) < 2e-6f);
+	}
+}
+
+// --------------------------------------------------------
+// Samples stay inside their shapes
+// --------------------------------------------------------
+static void TestBounds()
+{
+	const unsigned int count = 10000;
+	std::vector<float> x(count), y(count), z(count);
+	ParticleRandom random(5);
+
+	SampleParticleShape(ParticleSphere(1, 2, 3, 2.0f), random, x.data(), y.data(), z.data(), count);
+	float farthest = 0.0f;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		float dx = x[i] - 1, dy = y[i] - 2, dz = z[i] - 3;
+		farthest = std::fmax(farthest, sqrtf(dx * dx + dy * dy + dz * dz));
+	}
+	CHECK(farthest <= 2.0f * (1 + 1e-5f));
+	CHECK(farthest > 1.9f);
+
+	SampleParticleShape(ParticleCone(0, 0, 1, 0.5f, 1.0f, 4.0f), random, x.data(), y.data(), z.data(), count);
+	float minCos = cosf(0.5f);
+	int outside = 0;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		float length = sqrtf(x[i] * x[i] + y[i] * y[i] + z[i] * z[i]);
+		if (length < 1.0f - 1e-5f || length > 4.0f + 1e-5f) outside++;
+		if (z[i] / length < minCos - 1e-5f) outside++;
+	}
+	CHECK(outside == 0);
+
+	SampleParticleShape(ParticlePoint(7, 8, 9), random, x.data(), y.data(), z.data(), 5);
+	CHECK(x[4] == 7 && y[4] == 8 && z[4] == 9);
+}
+
+int main()
+{
+	TestMatchesReference();
+	TestBounds();
+	return CheckResult("ParticleBurstTests");
+}
@@ -0,0 +1,73 @@
+#include "ParticleLod.h"
+#include "Check.h"
+
+static const float Normal = 1.0f / 60.0f;
+
+static void AddFrames(ParticleLodController& lod, unsigned int count, float seconds)
+{
+	for (unsigned int i = 0; i < count; i++)
+		lod.AddFrameTime(seconds);
+}
+
+// --------------------------------------------------------
+// One long frame is one cut - it doesn't stay in the window to
+// cut again every cooldown
+// --------------------------------------------------------
+static void TestSingleSpike()
+{
+	ParticleLodController lod;
+	AddFrames(lod, 60, Normal);
+	lod.AddFrameTime(0.5f);
+	AddFrames(lod, 120, Normal);
+
+	CHECK(lod.GetTotalDecisions() == 1);
+	CHECK(lod.GetQuality() > 0.84f && lod.GetQuality() < 0.86f);
+}
+
+// --------------------------------------------------------
+// Under sustained load, every cut is judged on a full window of
+// frames rendered after the one before
+// --------------------------------------------------------
+static void TestSustainedLoad()
+{
+	ParticleLodSettings settings;
+	ParticleLodController lod(settings);
+	AddFrames(lod, 600, 0.025f);
+
+	CHECK(lod.GetQuality() == settings.MinQuality);
+	CHECK(lod.GetDecisionCount() > 1);
+	for (unsigned int i = 1; i < lod.GetDecisionCount(); i++)
+	{
+		float gap = lod.GetDecision(i).Time - lod.GetDecision(i - 1).Time;
+		CHECK(gap >= settings.WindowSize * 0.025f - 1e-4f);
+	}
+}
+
+// --------------------------------------------------------
+// Quality comes back a step at a time once frames are cheap
+// again, and holds while they're near the target
+// --------------------------------------------------------
+static void TestRecovery()
+{
+	ParticleLodSettings settings;
+	ParticleLodController lod(settings);
+	AddFrames(lod, 600, 0.025f);
+	unsigned int cuts = lod.GetTotalDecisions();
+
+	AddFrames(lod, 300, Normal);
+	CHECK(lod.GetTotalDecisions() == cuts);
+
+	AddFrames(lod, 10000, 0.01f);
+	CHECK(lod.GetQuality() == 1.0f);
+	const ParticleLodDecision& last = lod.GetDecision(lod.GetDecisionCount() - 1);
+	CHECK(last.NewQuality > last.OldQuality);
+	CHECK(last.NewQuality - last.OldQuality <= settings.StepUp + 1e-5f);
+}
+
+int main()
+{
+	TestSingleSpike();
+	TestSustainedLoad();
+	TestRecovery();
+	return CheckResult("ParticleLodTests");
+}
@@ -0,0 +1,244 @@
+#include "ParticlePacking.h"
+#include "ParticleSimulator.h"
+#include "Check.h"
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+static uint32_t FloatBits(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+
+// --------------------------------------------------------
+// Every finite half survives half -> float -> half, including
+// denormals and both zeros
+// --------------------------------------------------------
+static void TestHalfRoundTrip()
+{
+	int failures = 0;
+	for (uint32_t sign = 0; sign <= 0x8000; sign += 0x8000)
+	{
+		for (uint32_t bits = 0; bits < 0x7C00; bits++)
+		{
+			uint16_t half = (uint16_t)(sign | bits);
+			if (FloatToHalf(HalfToFloat(half)) != half) failures++;
+		}
+	}
+	CHECK(failures == 0);
+
+	// Denormals decode to exact multiples of 2^-24
+	CHECK(HalfToFloat(0x0001) == ldexpf(1.0f, -24));
+	CHECK(HalfToFloat(0x03FF) == ldexpf(1023.0f, -24));
+	CHECK(HalfToFloat(0x8001) == -ldexpf(1.0f, -24));
+	CHECK(HalfToFloat(0x0400) == ldexpf(1.0f, -14));
+}
+
+// --------------------------------------------------------
+// Float -> half rounds to nearest: never more than half a half
+// ulp off, across the whole range including denormals
+// --------------------------------------------------------
+static void TestHalfRounding()
+{
+	uint32_t state = 12345;
+	float worst = 0.0f;
+	int failures = 0;
+	for (int i = 0; i < 1000000; i++)
+	{
+		// Spread over exponents -30 .. 15 so denormals get plenty
+		state = state * 1664525u + 1013904223u;
+		float mantissa = 1.0f + (state >> 8) / 16777216.0f;
+		state = state * 1664525u + 1013904223u;
+		int exponent = (int)(state >> 26) % 46 - 30;
+		float value = ldexpf(mantissa, exponent);
+		if (state & 1) value = -value;
+		if (fabsf(value) > 65504.0f) continue;
+
+		// Half ulp of the half this lands in
+		int halfExponent = exponent < -14 ? -14 : exponent;
+		float tolerance = ldexpf(1.0f, halfExponent - 11);
+
+		float error = fabsf(HalfToFloat(FloatToHalf(value)) - value);
+		if (error > tolerance) failures++;
+		if (error / tolerance > worst) worst = error / tolerance;
+	}
+	CHECK(failures == 0);
+	CHECK(worst <= 1.0f);
+
+	// Too small for a denormal rounds to zero, keeping the sign
+	CHECK(FloatToHalf(1e-8f) == 0x0000);
+	CHECK(FloatToHalf(-1e-8f) == 0x8000);
+	CHECK(FloatToHalf(ldexpf(1.0f, -24)) == 0x0001);
+}
+
+// --------------------------------------------------------
+// Overflow, infinities, NaN and negative zero
+// --------------------------------------------------------
+static void TestHalfSpecials()
+{
+	float infinity = std::numeric_limits<float>::infinity();
+
+	CHECK(FloatToHalf(65504.0f) == 0x7BFF);
+	CHECK(FloatToHalf(-65504.0f) == 0xFBFF);
+	CHECK(FloatToHalf(65520.0f) == 0x7C00);
+	CHECK(FloatToHalf(1e6f) == 0x7C00);
+	CHECK(FloatToHalf(-1e6f) == 0xFC00);
+	CHECK(FloatToHalf(infinity) == 0x7C00);
+	CHECK(FloatToHalf(-infinity) == 0xFC00);
+	CHECK(HalfToFloat(0x7C00) == infinity);
+	CHECK(HalfToFloat(0xFC00) == -infinity);
+
+	uint16_t nan = FloatToHalf(std::numeric_limits<float>::quiet_NaN());
+	CHECK((nan & 0x7C00) == 0x7C00 && (nan & 0x03FF) != 0);
+	CHECK(std::isnan(HalfToFloat(nan)));
+
+	CHECK(FloatToHalf(0.0f) == 0x0000);
+	CHECK(FloatToHalf(-0.0f) == 0x8000);
+	CHECK(FloatBits(HalfToFloat(0x8000)) == 0x80000000u);
+	CHECK(FloatBits(HalfToFloat(0x0000)) == 0);
+}
+
+// --------------------------------------------------------
+// RGBA8 colors: red in the low byte, clamped to [0, 1] and
+// rounded to the nearest step
+// --------------------------------------------------------
+static void TestColors()
+{
+	const float red[4] = { 1.0f, 0.0f, 0.0f, 1.0f };
+	const float mixed[4] = { 0.0f, 0.25f, 0.5f, 0.75f };
+	const float outOfRange[4] = { -0.5f, 1.5f, -100.0f, 100.0f };
+	CHECK(PackColor(red) == 0xFF0000FFu);
+	CHECK(PackColor(mixed) == (0u | (64u << 8) | (128u << 16) | (191u << 24)));
+	CHECK(PackColor(outOfRange) == 0xFF00FF00u);
+
+	// Every 8-bit value survives, and anything in between is at
+	// most half a step off
+	float worst = 0.0f;
+	for (int step = 0; step <= 1020; step++)
+	{
+		float value = step / 1020.0f;
+		float rgba[4] = { value, 1.0f - value, value * 0.5f, 1.0f };
+		float decoded[4];
+		UnpackColor(PackColor(rgba), decoded);
+		for (int c = 0; c < 4; c++)
+			worst = std::fmax(worst, fabsf(decoded[c] - rgba[c]));
+	}
+	CHECK(worst <= 0.5f / 255.0f + 1e-6f);
+}
+
+static void Spawn(ParticleStore& store, unsigned int index, float seed)
+{
+	ParticleSpawnDesc desc;
+	for (int k = 0; k < 3; k++)
+	{
+		desc.Position[k] = seed * 0.7f - k * 30.0f;
+		desc.Velocity[k] = -seed * 0.3f + k;
+		desc.Sizes[k] = 0.1f * (k + 1) + seed * 0.01f;
+	}
+	for (int k = 0; k < 4; k++)
+	{
+		desc.StartColor[k] = k * 0.3f;
+		desc.MidColor[k] = seed / 103.0f;
+		desc.EndColor[k] = 1.5f - k;
+	}
+	desc.Type = (int)seed % 2;
+	store.Initialize(index, desc);
+}
+
+// --------------------------------------------------------
+// The SSE path (four at a time) and the scalar tail produce
+// identical vertices
+// --------------------------------------------------------
+static void TestBulkMatchesSingle()
+{
+	ParticleStore store(103, 5.0f);
+	for (unsigned int i = 0; i < 103; i++)
+		Spawn(store, i, (float)i);
+	store.Age(0.25f);
+
+	std::vector<Particle> bulk(store.GetCapacity());
+	std::vector<Particle> single(store.GetCapacity());
+	PackParticles(store, 1, 102, 10.0f, bulk.data());
+	for (unsigned int i = 1; i < 103; i++)
+		PackParticles(store, i, 1, 10.0f, single.data());
+
+	int mismatches = 0;
+	for (unsigned int i = 1; i < 103; i++)
+		if (memcmp(&bulk[i], &single[i], sizeof(Particle)) != 0) mismatches++;
+	CHECK(mismatches == 0);
+
+	// And what comes out decodes back to the store's values
+	float worst = 0.0f;
+	for (unsigned int i = 1; i < 103; i++)
+	{
+		const Particle& p = bulk[i];
+		float x = HalfToFloat(p.PositionStartSize[0]);
+		float vz = HalfToFloat(p.VelocityMidSize[2]);
+		float end = HalfToFloat(p.EndSize);
+		worst = std::fmax(worst, fabsf(x - store.GetPositionX()[i]) / std::fmax(1.0f, fabsf(store.GetPositionX()[i])));
+		worst = std::fmax(worst, fabsf(vz - store.GetVelocityZ()[i]) / std::fmax(1.0f, fabsf(store.GetVelocityZ()[i])));
+		worst = std::fmax(worst, fabsf(end - store.GetEndSizes()[i]) / std::fmax(1.0f, store.GetEndSizes()[i]));
+		CHECK((p.TypeAndSpawnTime >> 15) == (unsigned int)store.GetTypes()[i]);
+		CHECK((p.TypeAndSpawnTime & 0x7FFF) == 9750);
+	}
+	CHECK(worst <= 1.0f / 2048.0f);
+}
+
+// --------------------------------------------------------
+// Spawn times are stored modulo 32768 ms.  Across the wrap, the
+// packed decode in ParticleSimulator has to land on the same
+// ages as the float store.
+// --------------------------------------------------------
+static void TestSpawnTimeWrap()
+{
+	const float times[5] = { 32.5f, 32.768f, 33.0f, 65.6f, 98.4f };
+	const float noAcceleration[3] = { 0.0f, 0.0f, 0.0f };
+
+	// Moving at one unit per second along x from the origin, so x
+	// after simulation is the age.  Spawned in turn so they end up
+	// 1.9, 0.5, 0.1 and 0 seconds old.
+	ParticleStore store(4, 5.0f);
+	ParticleSpawnDesc desc = {};
+	desc.Velocity[0] = 1.0f;
+	desc.Type = 1;
+	const float steps[4] = { 1.4f, 0.4f, 0.1f, 0.0f };
+	for (unsigned int i = 0; i < 4; i++)
+	{
+		store.Initialize(i, desc);
+		store.Age(steps[i]);
+	}
+
+	Particle packed[4];
+	float px[4], py[4], pz[4], colors[16], sizes[4];
+	uint8_t visible[4];
+	ParticleSimOutput out = { px, py, pz, colors, sizes, visible };
+
+	float worst = 0.0f;
+	for (float time : times)
+	{
+		PackParticles(store, 0, 4, time, packed);
+		SimulatePackedParticles(packed, 4, ParticleTimeToMs(time), 5.0f, noAcceleration, out, nullptr);
+		for (unsigned int i = 0; i < 4; i++)
+		{
+			CHECK(visible[i] == 1);
+			worst = std::fmax(worst, fabsf(px[i] - store.GetAges()[i]));
+		}
+	}
+
+	// Milliseconds truncate at both ends, so up to two off
+	CHECK(worst <= 0.0025f);
+}
+
+int main()
+{
+	TestHalfRoundTrip();
+	TestHalfRounding();
+	TestHalfSpecials();
+	TestColors();
+	TestBulkMatchesSingle();
+	TestSpawnTimeWrap();
+	return CheckResult("ParticlePackingTests");
+}
@@ -0,0 +1,259 @@
+#include "ParticleSimulator.h"
+#include "Check.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+static const unsigned int Capacity = 103;	// 4 * 25 + 3
+static const float Lifetime = 1.5f;
+static const float Acceleration[3] = { 0.5f, -9.8f, 2.0f };
+
+// --------------------------------------------------------
+// Output arrays sized for the whole store
+// --------------------------------------------------------
+struct SimBuffers
+{
+	std::vector<float> X, Y, Z, Colors, Sizes;
+	std::vector<uint8_t> Visible;
+
+	SimBuffers() : X(Capacity), Y(Capacity), Z(Capacity), Colors(Capacity * 4), Sizes(Capacity), Visible(Capacity, 0xCD) {}
+
+	// Output index 0 lands on particle "first"
+	ParticleSimOutput At(unsigned int first)
+	{
+		ParticleSimOutput out = { &X[first], &Y[first], &Z[first], &Colors[first * 4], &Sizes[first], &Visible[first] };
+		return out;
+	}
+};
+
+// --------------------------------------------------------
+// Particles spawned out of order, so ages are scrambled across
+// the SSE groups and the scalar tail.  Every fifth has type 0,
+// and the oldest have outlived the lifetime.
+// --------------------------------------------------------
+static void Fill(ParticleStore& store)
+{
+	for (unsigned int n = 0; n < Capacity; n++)
+	{
+		unsigned int i = (n * 37) % Capacity;
+		float seed = (float)i;
+
+		ParticleSpawnDesc desc;
+		for (int k = 0; k < 3; k++)
+		{
+			desc.Position[k] = seed * 0.7f - k * 30.0f;
+			desc.Velocity[k] = -seed * 0.3f + k * 2.0f;
+			desc.Sizes[k] = 0.1f * (k + 1) + seed * 0.01f;
+		}
+		for (int k = 0; k < 4; k++)
+		{
+			desc.StartColor[k] = k * 0.3f;
+			desc.MidColor[k] = seed / 103.0f;
+			desc.EndColor[k] = 1.5f - k;
+		}
+		desc.Type = i % 5 == 0 ? 0 : 1 + i % 3;
+		store.Initialize(i, desc);
+		store.Age(0.021f);
+	}
+}
+
+static double Bezier(double p0, double p1, double p2, double t)
+{
+	return (1 - t) * (1 - t) * p0 + 2 * (1 - t) * t * p1 + t * t * p2;
+}
+
+static bool Close(float value, double expected)
+{
+	return fabs(value - expected) <= 1e-5 * std::max(1.0, fabs(expected));
+}
+
+// --------------------------------------------------------
+// The formula written out plainly, in doubles:
+//   p = p0 + v t + a t^2 / 2, Bezier color and size at t / lifetime,
+//   visible unless type 0 or older than the lifetime.
+// Counts the particles where the simulator disagrees.
+// --------------------------------------------------------
+static int CompareWithReference(const ParticleStore& store, unsigned int first, unsigned int count,
+	const SimBuffers& sim, const ParticleBounds& bounds)
+{
+	int wrong = 0;
+	double min[3] = { DBL_MAX, DBL_MAX, DBL_MAX }, max[3] = { -DBL_MAX, -DBL_MAX, -DBL_MAX };
+	double maxSize = 0;
+	unsigned int visibleCount = 0;
+
+	for (unsigned int i = first; i < first + count; i++)
+	{
+		double t = store.GetAges()[i];
+		double p[3] = {
+			store.GetPositionX()[i] + store.GetVelocityX()[i] * t + 0.5 * Acceleration[0] * t * t,
+			store.GetPositionY()[i] + store.GetVelocityY()[i] * t + 0.5 * Acceleration[1] * t * t,
+			store.GetPositionZ()[i] + store.GetVelocityZ()[i] * t + 0.5 * Acceleration[2] * t * t };
+		double percent = t / Lifetime;
+		double size = Bezier(store.GetStartSizes()[i], store.GetMidSizes()[i], store.GetEndSizes()[i], percent);
+		bool visible = store.GetTypes()[i] != 0 && t <= Lifetime;
+
+		bool same = Close(sim.X[i], p[0]) && Close(sim.Y[i], p[1]) && Close(sim.Z[i], p[2]) &&
+			Close(sim.Sizes[i], size) && sim.Visible[i] == (visible ? 1 : 0);
+		for (int c = 0; c < 4; c++)
+		{
+			double color = Bezier(store.GetStartColors()[i * 4 + c], store.GetMidColors()[i * 4 + c],
+				store.GetEndColors()[i * 4 + c], percent);
+			if (!Close(sim.Colors[i * 4 + c], color)) same = false;
+		}
+		if (!same) wrong++;
+
+		if (visible)
+		{
+			for (int a = 0; a < 3; a++)
+			{
+				min[a] = std::min(min[a], p[a]);
+				max[a] = std::max(max[a], p[a]);
+			}
+			maxSize = std::max(maxSize, size);
+			visibleCount++;
+		}
+	}
+
+	bool sameBounds = bounds.VisibleCount == visibleCount && Close(bounds.MaxSize, maxSize);
+	for (int a = 0; a < 3; a++)
+	{
+		if (!Close(bounds.Min[a], min[a]) || !Close(bounds.Max[a], max[a]))
+			sameBounds = false;
+	}
+	if (!sameBounds) wrong++;
+	return wrong;
+}
+
+// --------------------------------------------------------
+// Whole-store and offset ranges of 4k + 3 particles match the
+// reference, with the tail holding both visible and hidden ones
+// --------------------------------------------------------
+static void TestMatchesReference()
+{
+	ParticleStore store(Capacity, Lifetime);
+	Fill(store);
+
+	// The setup covers what it's meant to: some too old, some type
+	// 0, and the scalar tail of both ranges has visible particles
+	// next to hidden ones
+	int tooOld = 0, typeZero = 0;
+	for (unsigned int i = 0; i < Capacity; i++)
+	{
+		if (store.GetAges()[i] > Lifetime) tooOld++;
+		if (store.GetTypes()[i] == 0) typeZero++;
+	}
+	CHECK(tooOld > 10 && tooOld < 50);
+	CHECK(typeZero > 10);
+
+	const unsigned int ranges[2][2] = { { 0, Capacity }, { 2, Capacity - 4 } };
+	for (const unsigned int* range : ranges)
+	{
+		unsigned int first = range[0], count = range[1];
+		CHECK(count % 4 == 3);
+
+		SimBuffers sim;
+		ParticleBounds bounds;
+		SimulateParticles(store, first, count, Acceleration, sim.At(first), &bounds);
+		CHECK(CompareWithReference(store, first, count, sim, bounds) == 0);
+
+		int tailVisible = 0;
+		for (unsigned int i = first + count - 3; i < first + count; i++)
+			tailVisible += sim.Visible[i];
+		CHECK(tailVisible > 0 && tailVisible < 3);
+
+		// Nothing written outside the range
+		if (first > 0) CHECK(sim.Visible[first - 1] == 0xCD);
+		if (first + count < Capacity) CHECK(sim.Visible[first + count] == 0xCD);
+	}
+}
+
+// --------------------------------------------------------
+// The SSE groups and the scalar tail are the same math: one
+// particle at a time (all tail) gives identical bits, and the
+// bounds built from either agree
+// --------------------------------------------------------
+static void TestBulkMatchesSingle()
+{
+	ParticleStore store(Capacity, Lifetime);
+	Fill(store);
+
+	SimBuffers bulk, single;
+	ParticleBounds bulkBounds, singleBounds;
+	SimulateParticles(store, 0, Capacity, Acceleration, bulk.At(0), &bulkBounds);
+
+	float min[3] = { FLT_MAX, FLT_MAX, FLT_MAX }, max[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	float maxSize = 0;
+	unsigned int visibleCount = 0;
+	for (unsigned int i = 0; i < Capacity; i++)
+	{
+		SimulateParticles(store, i, 1, Acceleration, single.At(i), &singleBounds);
+		if (!single.Visible[i]) continue;
+		for (int a = 0; a < 3; a++)
+		{
+			min[a] = std::min(min[a], singleBounds.Min[a]);
+			max[a] = std::max(max[a], singleBounds.Max[a]);
+		}
+		maxSize = std::max(maxSize, singleBounds.MaxSize);
+		visibleCount += singleBounds.VisibleCount;
+	}
+
+	CHECK(memcmp(bulk.X.data(), single.X.data(), Capacity * sizeof(float)) == 0);
+	CHECK(memcmp(bulk.Y.data(), single.Y.data(), Capacity * sizeof(float)) == 0);
+	CHECK(memcmp(bulk.Z.data(), single.Z.data(), Capacity * sizeof(float)) == 0);
+	CHECK(memcmp(bulk.Colors.data(), single.Colors.data(), Capacity * 4 * sizeof(float)) == 0);
+	CHECK(memcmp(bulk.Sizes.data(), single.Sizes.data(), Capacity * sizeof(float)) == 0);
+	CHECK(bulk.Visible == single.Visible);
+
+	CHECK(memcmp(bulkBounds.Min, min, sizeof(min)) == 0);
+	CHECK(memcmp(bulkBounds.Max, max, sizeof(max)) == 0);
+	CHECK(bulkBounds.MaxSize == maxSize);
+	CHECK(bulkBounds.VisibleCount == visibleCount);
+}
+
+// --------------------------------------------------------
+// Visibility at the edges: an age of exactly the lifetime is
+// still drawn, as in the shader; type 0 never is; and bounds
+// over nothing visible stay empty
+// --------------------------------------------------------
+static void TestVisibilityEdges()
+{
+	ParticleStore store(8, Lifetime);
+	ParticleSpawnDesc desc = {};
+	desc.Velocity[1] = 1.0f;
+	desc.Sizes[0] = desc.Sizes[1] = desc.Sizes[2] = 2.0f;
+	for (unsigned int i = 0; i < 8; i++)
+	{
+		desc.Type = i % 2;
+		store.Initialize(i, desc);
+	}
+	store.Age(Lifetime);
+	CHECK(store.GetAges()[0] == Lifetime);
+
+	float x[8], y[8], z[8], colors[32], sizes[8];
+	uint8_t visible[8];
+	ParticleSimOutput out = { x, y, z, colors, sizes, visible };
+	ParticleBounds bounds;
+	SimulateParticles(store, 0, 7, Acceleration, out, &bounds);
+	for (unsigned int i = 0; i < 7; i++)
+		CHECK(visible[i] == i % 2);
+	CHECK(bounds.VisibleCount == 3);
+	CHECK(bounds.MaxSize == 2.0f);
+
+	// A moment later they're all gone
+	store.Age(0.001f);
+	SimulateParticles(store, 0, 7, Acceleration, out, &bounds);
+	for (unsigned int i = 0; i < 7; i++)
+		CHECK(visible[i] == 0);
+	CHECK(bounds.VisibleCount == 0 && bounds.MaxSize == 0.0f);
+	CHECK(bounds.Min[0] == FLT_MAX && bounds.Max[0] == -FLT_MAX);
+}
+
+int main()
+{
+	TestMatchesReference();
+	TestBulkMatchesSingle();
+	TestVisibilityEdges();
+	return CheckResult("ParticleSimulatorTests");
+}
@@ -0,0 +1,132 @@
+#include "ParticleSort.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+// --------------------------------------------------------
+// What Emitter::SortForView costs for 100k particles: the view
+// depths (on the calling thread), then the radix sort with 1, 2,
+// 4 ... threads and then every hardware thread.  The budget is
+// 1 ms for the sort on 8 cores.
+//
+// Every sort is checked against std::stable_sort on the same
+// depths; a mismatch fails the run.  Pass a thread count to go
+// past the hardware threads.
+// --------------------------------------------------------
+
+static const unsigned int ParticleCount = 100000;
+static const int Repeats = 20;
+static const double BudgetMs = 1.0;
+
+typedef std::chrono::steady_clock Clock;
+
+static double Milliseconds(Clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// A full ring of sky particles spread over a box, of mixed ages
+static void FillStore(ParticleStore& store)
+{
+	ParticleRandom random(9);
+	ParticleBurstDesc burst = {};
+	burst.Count = ParticleCount;
+	burst.Position = ParticleBox(0, 5, 100, 50, 10, 50);
+	burst.Velocity = ParticleBox(0, 0, -50, 2, 2, 5);
+	burst.Sizes[0] = burst.Sizes[1] = burst.Sizes[2] = 20.1f;
+	burst.Type = 1;
+
+	const unsigned int groups = 10;
+	for (unsigned int g = 0; g < groups; g++)
+	{
+		burst.Count = ParticleCount / groups;
+		store.InitializeBurst(g * burst.Count, burst.Count, burst, random);
+		store.Age(0.3f);
+	}
+}
+
+static bool MatchesStableSort(const std::vector<float>& depths, const ParticleDepthSorter& sorter)
+{
+	std::vector<uint32_t> expected(depths.size());
+	for (unsigned int i = 0; i < expected.size(); i++)
+		expected[i] = i;
+	std::stable_sort(expected.begin(), expected.end(),
+		[&depths](uint32_t a, uint32_t b) { return depths[a] > depths[b]; });
+
+	return sorter.GetSortedCount() == expected.size() &&
+		std::equal(expected.begin(), expected.end(), sorter.GetSortedValues());
+}
+
+int main(int argc, char* argv[])
+{
+	unsigned int cores = std::max(std::thread::hardware_concurrency(), 1u);
+	unsigned int maxThreads = argc > 1 ? (unsigned int)std::max(atoi(argv[1]), 1) : cores;
+
+	std::vector<unsigned int> threadCounts;
+	for (unsigned int t = 1; t < maxThreads; t *= 2)
+		threadCounts.push_back(t);
+	threadCounts.push_back(maxThreads);
+
+	ParticleStore store(ParticleCount, 5.0f);
+	FillStore(store);
+
+	// Looking down +z from just behind the spawn box
+	const float acceleration[3] = { 0, 0, 0 };
+	const float viewRow[4] = { 0.05f, -0.1f, 0.99f, 40.0f };
+	std::vector<float> depths(ParticleCount);
+	std::vector<uint32_t> slots(ParticleCount);
+	for (unsigned int i = 0; i < ParticleCount; i++)
+		slots[i] = i;
+
+	double depthTime = 1e30;
+	for (int r = 0; r < Repeats; r++)
+	{
+		Clock::time_point start = Clock::now();
+		ComputeParticleDepths(store, 0, ParticleCount, acceleration, viewRow, depths.data());
+		depthTime = std::min(depthTime, Milliseconds(start));
+	}
+
+	double stableTime = 1e30;
+	for (int r = 0; r < Repeats / 4; r++)
+	{
+		std::vector<uint32_t> copy(slots);
+		Clock::time_point start = Clock::now();
+		std::stable_sort(copy.begin(), copy.end(),
+			[&depths](uint32_t a, uint32_t b) { return depths[a] > depths[b]; });
+		stableTime = std::min(stableTime, Milliseconds(start));
+	}
+
+	printf("ParticleSortBenchmark: %u particles, %u hardware threads, best of %d\n", ParticleCount, cores, Repeats);
+	printf("  depths: %.3f ms on the calling thread\n", depthTime);
+	printf("  std::stable_sort: %.3f ms\n", stableTime);
+	printf("%8s %10s %9s %10s\n", "threads", "sort ms", "speedup", "budget");
+
+	bool mismatch = false;
+	double baseline = 0.0;
+	for (unsigned int threads : threadCounts)
+	{
+		JobSystem jobs(threads);
+		ParticleDepthSorter sorter;
+		double sortTime = 1e30;
+		for (int r = 0; r < Repeats; r++)
+		{
+			Clock::time_point start = Clock::now();
+			sorter.Sort(threads > 1 ? &jobs : nullptr, depths.data(), slots.data(), ParticleCount);
+			sortTime = std::min(sortTime, Milliseconds(start));
+		}
+		if (threads == 1) baseline = sortTime;
+
+		if (!MatchesStableSort(depths, sorter))
+		{
+			mismatch = true;
+			printf("  %u threads: order differs from std::stable_sort\n", threads);
+		}
+
+		printf("%8u %10.3f %8.2fx %10s\n", threads, sortTime, baseline / sortTime,
+			sortTime <= BudgetMs ? "under" : "over");
+	}
+	return mismatch ? 1 : 0;
+}
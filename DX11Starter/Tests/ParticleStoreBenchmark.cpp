@@ -0,0 +1,93 @@
+#include "ParticleStore.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+// --------------------------------------------------------
+// ParticleStore::Age at 10k, 100k and 1M particles, against
+// the array-of-structs walk it replaced.  The old Particle was
+// 100 bytes, so aging one meant striding over all of it.
+// --------------------------------------------------------
+
+struct OldParticle
+{
+	int Type;
+	float Age;
+	float StartPosition[3];
+	float StartVelocity[3];
+	float StartColor[4];
+	float MidColor[4];
+	float EndColor[4];
+	float StartMidEndSizes[3];
+};
+
+// Tiny steps, so a third of the slots stay dead and the rest
+// stay alive however many frames run
+static const float Lifetime = 5.0f;
+static const float Step = 1e-6f;
+
+typedef std::chrono::steady_clock Clock;
+
+static double Microseconds(Clock::time_point start)
+{
+	return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+}
+
+int main()
+{
+	const unsigned int counts[3] = { 10000, 100000, 1000000 };
+	bool countsMatch = true;
+
+	printf("ParticleStoreBenchmark: microseconds per Age() call, best of 5 runs\n");
+	printf("%10s %12s %12s %9s %10s\n", "particles", "AoS us", "SoA us", "speedup", "live");
+
+	for (unsigned int count : counts)
+	{
+		// About the same total work at every size
+		int frames = (int)(20000000 / count);
+
+		ParticleSpawnDesc desc = {};
+		ParticleStore store(count, Lifetime);
+		std::vector<OldParticle> old(count);
+		for (unsigned int i = 0; i < count; i++)
+		{
+			old[i].Age = Lifetime + 1;
+			if (i % 3 == 0) continue;
+			store.Initialize(i, desc);
+			old[i].Age = 0;
+		}
+
+		double oldBest = 1e30;
+		double newBest = 1e30;
+		for (int run = 0; run < 5; run++)
+		{
+			Clock::time_point start = Clock::now();
+			for (int frame = 0; frame < frames; frame++)
+			{
+				for (unsigned int i = 0; i < count; i++)
+					old[i].Age += Step;
+			}
+			oldBest = std::min(oldBest, Microseconds(start) / frames);
+
+			start = Clock::now();
+			for (int frame = 0; frame < frames; frame++)
+				store.Age(Step);
+			newBest = std::min(newBest, Microseconds(start) / frames);
+		}
+
+		// The store's count against a plain scalar recount
+		unsigned int expected = 0;
+		for (unsigned int i = 0; i < count; i++)
+			if (store.IsAlive(i)) expected++;
+		if (expected != store.GetLiveCount())
+		{
+			printf("  live count %u, should be %u\n", store.GetLiveCount(), expected);
+			countsMatch = false;
+		}
+
+		printf("%10u %12.1f %12.1f %8.1fx %10u\n",
+			count, oldBest, newBest, oldBest / newBest, store.GetLiveCount());
+	}
+	return countsMatch ? 0 : 1;
+}
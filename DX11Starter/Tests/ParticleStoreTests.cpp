@@ -0,0 +1,72 @@
+#include "ParticleStore.h"
+#include "Check.h"
+
+static unsigned int CountAlive(const ParticleStore& store)
+{
+	unsigned int alive = 0;
+	for (unsigned int i = 0; i < store.GetCapacity(); i++)
+		if (store.IsAlive(i)) alive++;
+	return alive;
+}
+
+// --------------------------------------------------------
+// The live count follows spawning, aging and killing
+// --------------------------------------------------------
+static void TestLiveCount()
+{
+	ParticleSpawnDesc desc = {};
+	ParticleStore store(1000, 2.0f);
+	CHECK(store.GetCapacity() == 1008);
+	CHECK(store.GetLiveCount() == 0);
+
+	for (unsigned int i = 0; i < 300; i++)
+		store.Initialize(i, desc);
+	store.Initialize(10, desc);
+	CHECK(store.GetLiveCount() == 300);
+
+	store.Kill(5);
+	store.Kill(5);
+	CHECK(store.GetLiveCount() == 299);
+
+	store.Age(1.0f);
+	CHECK(store.GetLiveCount() == 299);
+	for (unsigned int i = 300; i < 400; i++)
+		store.Initialize(i, desc);
+	store.Age(1.5f);
+	CHECK(store.GetLiveCount() == 100);
+	CHECK(CountAlive(store) == 100);
+}
+
+// --------------------------------------------------------
+// Shrinking the lifetime kills the old straight away, and
+// growing it back doesn't bring them back
+// --------------------------------------------------------
+static void TestSetLifetime()
+{
+	ParticleSpawnDesc desc = {};
+	ParticleStore store(64, 4.0f);
+	for (unsigned int i = 0; i < 10; i++)
+		store.Initialize(i, desc);
+	store.Age(2.5f);
+	for (unsigned int i = 10; i < 16; i++)
+		store.Initialize(i, desc);
+	CHECK(store.GetLiveCount() == 16);
+
+	store.SetLifetime(2.0f);
+	CHECK(store.GetLiveCount() == 6);
+	CHECK(CountAlive(store) == 6);
+
+	store.SetLifetime(8.0f);
+	CHECK(store.GetLiveCount() == 6);
+	CHECK(CountAlive(store) == 6);
+
+	store.Age(1.0f);
+	CHECK(store.GetLiveCount() == 6);
+}
+
+int main()
+{
+	TestLiveCount();
+	TestSetLifetime();
+	return CheckResult("ParticleStoreTests");
+}
@@ -0,0 +1,193 @@
+#include "ShaderReflectionCache.h"
+#include "Check.h"
+#include <cstdio>
+#include <fstream>
+
+// --------------------------------------------------------
+// Something shaped like the game's vertex and pixel shaders:
+// a couple of cbuffers, textures, samplers and an input layout
+// --------------------------------------------------------
+static ShaderReflectionData MakeData()
+{
+	ShaderReflectionData data;
+
+	CachedConstantBuffer perObject = { "perObject", 208, 0, {} };
+	perObject.Variables.push_back({ "world", 0, 64 });
+	perObject.Variables.push_back({ "view", 64, 64 });
+	perObject.Variables.push_back({ "projection", 128, 64 });
+	perObject.Variables.push_back({ "quantScale", 192, 12 });
+	data.ConstantBuffers.push_back(perObject);
+
+	CachedConstantBuffer lights = { "lightData", 96, 1, {} };
+	lights.Variables.push_back({ "dirLight", 0, 48 });
+	lights.Variables.push_back({ "", 48, 4 });
+	data.ConstantBuffers.push_back(lights);
+
+	data.ConstantBuffers.push_back({ "empty", 16, 2, {} });
+
+	data.Textures.push_back({ "diffuseTexture", 0 });
+	data.Textures.push_back({ "skyTexture", 3 });
+	data.Samplers.push_back({ "basicSampler", 0 });
+
+	data.InputParameters.push_back({ "POSITION", 0, 0x7, 3 });
+	data.InputParameters.push_back({ "NORMAL", 0, 0x7, 3 });
+	data.InputParameters.push_back({ "TEXCOORD", 0, 0x3, 3 });
+	data.InputParameters.push_back({ "TEXCOORD", 1, 0xF, 1 });
+	return data;
+}
+
+static bool Same(const ShaderReflectionData& a, const ShaderReflectionData& b)
+{
+	if (a.ConstantBuffers.size() != b.ConstantBuffers.size() ||
+		a.Textures.size() != b.Textures.size() ||
+		a.Samplers.size() != b.Samplers.size() ||
+		a.InputParameters.size() != b.InputParameters.size())
+		return false;
+
+	for (size_t i = 0; i < a.ConstantBuffers.size(); i++)
+	{
+		const CachedConstantBuffer& x = a.ConstantBuffers[i];
+		const CachedConstantBuffer& y = b.ConstantBuffers[i];
+		if (x.Name != y.Name || x.Size != y.Size || x.BindIndex != y.BindIndex ||
+			x.Variables.size() != y.Variables.size())
+			return false;
+		for (size_t v = 0; v < x.Variables.size(); v++)
+		{
+			if (x.Variables[v].Name != y.Variables[v].Name ||
+				x.Variables[v].ByteOffset != y.Variables[v].ByteOffset ||
+				x.Variables[v].Size != y.Variables[v].Size)
+				return false;
+		}
+	}
+	for (size_t i = 0; i < a.Textures.size(); i++)
+	{
+		if (a.Textures[i].Name != b.Textures[i].Name || a.Textures[i].BindIndex != b.Textures[i].BindIndex)
+			return false;
+	}
+	for (size_t i = 0; i < a.Samplers.size(); i++)
+	{
+		if (a.Samplers[i].Name != b.Samplers[i].Name || a.Samplers[i].BindIndex != b.Samplers[i].BindIndex)
+			return false;
+	}
+	for (size_t i = 0; i < a.InputParameters.size(); i++)
+	{
+		const CachedInputParameter& x = a.InputParameters[i];
+		const CachedInputParameter& y = b.InputParameters[i];
+		if (x.SemanticName != y.SemanticName || x.SemanticIndex != y.SemanticIndex ||
+			x.Mask != y.Mask || x.ComponentType != y.ComponentType)
+			return false;
+	}
+	return true;
+}
+
+// A failed read must leave the caller's tables alone
+static bool Rejected(const std::vector<unsigned char>& bytes, size_t size, uint64_t codeHash)
+{
+	ShaderReflectionData out;
+	out.Textures.push_back({ "untouched", 9 });
+	return !ShaderReflectionCache::Deserialize(bytes.data(), size, codeHash, out) &&
+		out.Textures.size() == 1 && out.Textures[0].Name == "untouched" && out.ConstantBuffers.empty();
+}
+
+static const uint64_t CodeHash = 0x0123456789ABCDEFull;
+
+// --------------------------------------------------------
+// Everything written comes back the same, and an empty set of
+// tables is a valid entry too
+// --------------------------------------------------------
+static void TestRoundTrip()
+{
+	ShaderReflectionData data = MakeData();
+	std::vector<unsigned char> bytes;
+	ShaderReflectionCache::Serialize(data, CodeHash, bytes);
+
+	ShaderReflectionData read;
+	CHECK(ShaderReflectionCache::Deserialize(bytes.data(), bytes.size(), CodeHash, read));
+	CHECK(Same(data, read));
+
+	// Reading into tables that already hold something replaces them
+	ShaderReflectionData again = MakeData();
+	CHECK(ShaderReflectionCache::Deserialize(bytes.data(), bytes.size(), CodeHash, again));
+	CHECK(Same(data, again));
+
+	ShaderReflectionData empty, readEmpty = MakeData();
+	ShaderReflectionCache::Serialize(empty, 0, bytes);
+	CHECK(ShaderReflectionCache::Deserialize(bytes.data(), bytes.size(), 0, readEmpty));
+	CHECK(Same(empty, readEmpty));
+}
+
+// --------------------------------------------------------
+// Another shader's hash, another format version, every
+// truncation and any trailing bytes are all misses
+// --------------------------------------------------------
+static void TestRejects()
+{
+	ShaderReflectionData data = MakeData();
+	std::vector<unsigned char> bytes;
+	ShaderReflectionCache::Serialize(data, CodeHash, bytes);
+
+	CHECK(Rejected(bytes, bytes.size(), CodeHash + 1));
+	CHECK(Rejected(bytes, bytes.size(), CodeHash ^ (1ull << 63)));
+
+	// Version follows the 4-byte magic
+	std::vector<unsigned char> version = bytes;
+	version[4]++;
+	CHECK(Rejected(version, version.size(), CodeHash));
+	std::vector<unsigned char> magic = bytes;
+	magic[0]++;
+	CHECK(Rejected(magic, magic.size(), CodeHash));
+
+	int accepted = 0;
+	for (size_t size = 0; size < bytes.size(); size++)
+	{
+		if (!Rejected(bytes, size, CodeHash)) accepted++;
+	}
+	CHECK(accepted == 0);
+
+	std::vector<unsigned char> trailing = bytes;
+	trailing.push_back(0);
+	CHECK(Rejected(trailing, trailing.size(), CodeHash));
+	trailing.insert(trailing.end(), bytes.begin(), bytes.end());
+	CHECK(Rejected(trailing, trailing.size(), CodeHash));
+
+	// A count far bigger than the file can hold is refused
+	// before anything is allocated for it (cbuffer count at 16)
+	std::vector<unsigned char> huge = bytes;
+	huge[16] = huge[17] = huge[18] = huge[19] = 0xFF;
+	CHECK(Rejected(huge, huge.size(), CodeHash));
+}
+
+// --------------------------------------------------------
+// Save and Load through a scratch cache folder
+// --------------------------------------------------------
+static void TestFiles()
+{
+	std::string oldDirectory = ShaderReflectionCache::CacheDirectory;
+	ShaderReflectionCache::CacheDirectory = "bin/ShaderCacheTest";
+
+	ShaderReflectionData data = MakeData(), read;
+	CHECK(ShaderReflectionCache::Save(CodeHash, data));
+	CHECK(ShaderReflectionCache::Load(CodeHash, read));
+	CHECK(Same(data, read));
+	CHECK(!ShaderReflectionCache::Load(CodeHash + 1, read));
+
+	// A file cut short on disk is a miss
+	std::string path = ShaderReflectionCache::GetCachePath(CodeHash);
+	{
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		file.write("SRFL", 4);
+	}
+	CHECK(!ShaderReflectionCache::Load(CodeHash, read));
+
+	remove(path.c_str());
+	remove(ShaderReflectionCache::CacheDirectory.c_str());
+	ShaderReflectionCache::CacheDirectory = oldDirectory;
+}
+
+int main()
+{
+	TestRoundTrip();
+	TestRejects();
+	TestFiles();
+	return CheckResult("ShaderReflectionCacheTests");
+}
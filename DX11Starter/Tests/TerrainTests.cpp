@@ -0,0 +1,227 @@
+#include "TerrainStreamer.h"
+#include "Check.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+static void Cross(const float* a, const float* b, float* out)
+{
+	out[0] = a[1] * b[2] - a[2] * b[1];
+	out[1] = a[2] * b[0] - a[0] * b[2];
+	out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+// --------------------------------------------------------
+// The back edge of chunk n and the front edge of chunk n + 1
+// land on the same heights and normals wherever their grids
+// share a point, whatever LOD each one is at
+// --------------------------------------------------------
+static void TestSeams()
+{
+	TerrainSettings settings;
+	std::vector<MeshVertex> near, far;
+	const int64_t chunks[4] = { -3, 0, 7, 4000000 };
+	int mismatches = 0;
+
+	for (int64_t chunk : chunks)
+	{
+		for (unsigned int nearLod = 0; nearLod < settings.LodCount; nearLod++)
+		{
+			for (unsigned int farLod = 0; farLod < settings.LodCount; farLod++)
+			{
+				BuildTerrainChunk(settings, chunk, nearLod, near);
+				BuildTerrainChunk(settings, chunk + 1, farLod, far);
+
+				unsigned int nearAcross = settings.CellsAcross >> nearLod;
+				unsigned int farAcross = settings.CellsAcross >> farLod;
+				unsigned int nearAlong = settings.CellsAlong >> nearLod;
+				unsigned int shared = std::min(nearAcross, farAcross);
+				for (unsigned int s = 0; s <= shared; s++)
+				{
+					const MeshVertex& a = near[nearAlong * (nearAcross + 1) + s * (nearAcross / shared)];
+					const MeshVertex& b = far[s * (farAcross / shared)];
+					bool same = a.Position[0] == b.Position[0] && a.Position[1] == b.Position[1] &&
+						a.Position[2] == settings.ChunkLength && b.Position[2] == 0.0f &&
+						memcmp(a.Normal, b.Normal, sizeof(a.Normal)) == 0;
+					if (!same) mismatches++;
+				}
+			}
+		}
+	}
+	CHECK(mismatches == 0);
+}
+
+// --------------------------------------------------------
+// Every triangle is clockwise from the side it should be seen
+// from: the surface from above, the front skirt from behind
+// the chunk and the back skirt from ahead of it
+// --------------------------------------------------------
+static void TestWinding()
+{
+	TerrainSettings settings;
+	std::vector<MeshVertex> vertices;
+	std::vector<uint32_t> indices;
+
+	for (unsigned int lod = 0; lod < settings.LodCount; lod++)
+	{
+		BuildTerrainIndices(settings, lod, indices);
+		BuildTerrainChunk(settings, 11, lod, vertices);
+		CHECK(vertices.size() == GetTerrainVertexCount(settings, lod));
+
+		unsigned int across = settings.CellsAcross >> lod;
+		unsigned int along = settings.CellsAlong >> lod;
+		unsigned int surfaceTriangles = across * along * 2;
+		CHECK(indices.size() == (surfaceTriangles + across * 4) * 3);
+
+		int surfaceWrong = 0, frontWrong = 0, backWrong = 0, outOfRange = 0;
+		int front = 0, back = 0;
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			if (indices[i] >= vertices.size() || indices[i + 1] >= vertices.size() || indices[i + 2] >= vertices.size())
+			{
+				outOfRange++;
+				continue;
+			}
+			const float* p0 = vertices[indices[i]].Position;
+			const float* p1 = vertices[indices[i + 1]].Position;
+			const float* p2 = vertices[indices[i + 2]].Position;
+			float a[3], b[3], facing[3];
+			for (int k = 0; k < 3; k++)
+			{
+				a[k] = p1[k] - p0[k];
+				b[k] = p2[k] - p0[k];
+			}
+			Cross(a, b, facing);
+
+			if (i / 3 < surfaceTriangles)
+			{
+				if (facing[1] <= 0) surfaceWrong++;
+			}
+			else if (p0[2] == 0.0f)
+			{
+				front++;
+				if (facing[2] >= 0 || fabsf(facing[1]) > 1e-4f) frontWrong++;
+			}
+			else
+			{
+				back++;
+				if (facing[2] <= 0 || fabsf(facing[1]) > 1e-4f) backWrong++;
+			}
+		}
+		CHECK(outOfRange == 0);
+		CHECK(surfaceWrong == 0);
+		CHECK(front == (int)across * 2 && frontWrong == 0);
+		CHECK(back == (int)across * 2 && backWrong == 0);
+	}
+}
+
+// Everything about the streamer's slots that should always hold
+struct StreamerCheck
+{
+	int uncovered = 0;
+	int stale = 0;
+	int duplicates = 0;
+	int outOfRange = 0;
+	int memoryChanged = 0;
+};
+
+static void CheckStreamer(TerrainStreamer& streamer, double viewerZ, size_t memory, StreamerCheck& check)
+{
+	const TerrainSettings& settings = streamer.GetSettings();
+	int64_t first = (int64_t)floor((viewerZ - settings.ViewBehind) / settings.ChunkLength);
+	int64_t last = (int64_t)floor((viewerZ + settings.ViewAhead) / settings.ChunkLength);
+
+	std::vector<MeshVertex> expected;
+	for (int64_t index = first; index <= last; index++)
+	{
+		int found = 0;
+		for (unsigned int s = 0; s < streamer.GetSlotCount(); s++)
+		{
+			TerrainChunk& chunk = streamer.GetChunk(s);
+			if (chunk.Ready && chunk.Index == index) found++;
+		}
+		if (found == 0) check.uncovered++;
+		if (found > 1) check.duplicates++;
+	}
+
+	// A ready slot holds exactly the chunk it says it does, in
+	// range - never what it held before it was recycled
+	for (unsigned int s = 0; s < streamer.GetSlotCount(); s++)
+	{
+		TerrainChunk& chunk = streamer.GetChunk(s);
+		if (!chunk.Ready) continue;
+		if (chunk.Index < first || chunk.Index > last)
+		{
+			check.outOfRange++;
+			continue;
+		}
+		BuildTerrainChunk(settings, chunk.Index, chunk.Lod, expected);
+		if (chunk.Vertices.size() != expected.size() ||
+			memcmp(chunk.Vertices.data(), expected.data(), expected.size() * sizeof(MeshVertex)) != 0)
+			check.stale++;
+	}
+
+	if (streamer.GetMemorySize() != memory) check.memoryChanged++;
+}
+
+// --------------------------------------------------------
+// A long run down the track, with builds finishing whenever
+// they like in between checks.  Every so often the viewer jumps
+// somewhere new and straight back, so slots get recycled while
+// their builds are still running.
+// --------------------------------------------------------
+static void RunStreamer(unsigned int threads)
+{
+	JobSystem jobs(threads);
+	TerrainStreamer streamer(&jobs);
+	size_t memory = streamer.GetMemorySize();
+	StreamerCheck check;
+
+	double viewerZ = 0.0;
+	for (int frame = 0; frame < 6000; frame++)
+	{
+		viewerZ += 0.9;
+		if (frame % 500 == 250)
+		{
+			streamer.Update(viewerZ + 100000.0);
+			streamer.Update(viewerZ);
+		}
+		streamer.Update(viewerZ);
+
+		if (frame % 25 == 0)
+		{
+			// Anything that couldn't get a slot last time gets one now
+			streamer.Flush();
+			streamer.Update(viewerZ);
+			streamer.Flush();
+			CheckStreamer(streamer, viewerZ, memory, check);
+		}
+		else if (streamer.GetMemorySize() != memory)
+		{
+			check.memoryChanged++;
+		}
+	}
+	streamer.Flush();
+
+	CHECK(check.uncovered == 0);
+	CHECK(check.duplicates == 0);
+	CHECK(check.outOfRange == 0);
+	CHECK(check.stale == 0);
+	CHECK(check.memoryChanged == 0);
+	CHECK(streamer.GetBuildCount() > 200);
+}
+
+static void TestStreamer()
+{
+	RunStreamer(1);
+	RunStreamer(4);
+}
+
+int main()
+{
+	TestSeams();
+	TestWinding();
+	TestStreamer();
+	return CheckResult("TerrainTests");
+}
@@ -0,0 +1,257 @@
+#include "VertexQuantize.h"
+#include "Check.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <vector>
+
+// Worst case for 16-bit octahedral normals with the best of the
+// four roundings picked - the grid's half diagonal, with margin
+static const double MaxNormalDegrees = 0.003;
+
+static float RandomSigned(uint32_t& state)
+{
+	state = state * 1664525u + 1013904223u;
+	return (state >> 8) / 8388608.0f - 1.0f;
+}
+
+static void RandomUnit(uint32_t& state, float n[3])
+{
+	float length;
+	do
+	{
+		for (int k = 0; k < 3; k++) n[k] = RandomSigned(state);
+		length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+	} while (length < 0.1f || length > 1.0f);
+	for (int k = 0; k < 3; k++) n[k] /= length;
+}
+
+// Angle between the two, in doubles so tiny angles are exact
+static double AngleDegrees(const float a[3], const float b[3])
+{
+	double cross[3] = {
+		(double)a[1] * b[2] - (double)a[2] * b[1],
+		(double)a[2] * b[0] - (double)a[0] * b[2],
+		(double)a[0] * b[1] - (double)a[1] * b[0] };
+	double dot = (double)a[0] * b[0] + (double)a[1] * b[1] + (double)a[2] * b[2];
+	return atan2(sqrt(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]), dot) * 57.29577951308232;
+}
+
+static double RoundTripDegrees(const float n[3])
+{
+	int16_t encoded[2];
+	float decoded[3];
+	EncodeOctahedral(n, encoded);
+	DecodeOctahedral(encoded, decoded);
+	return AngleDegrees(n, decoded);
+}
+
+// --------------------------------------------------------
+// Random unit normals, the poles, the equator (the fold line)
+// and the creases where the lower hemisphere folds over all
+// come back within the worst case, and never use -32768
+// --------------------------------------------------------
+static void TestNormals()
+{
+	uint32_t state = 45;
+	double worst = 0;
+	int outOfRange = 0;
+	for (int i = 0; i < 300000; i++)
+	{
+		float n[3];
+		RandomUnit(state, n);
+		worst = std::max(worst, RoundTripDegrees(n));
+
+		int16_t encoded[2];
+		EncodeOctahedral(n, encoded);
+		if (encoded[0] == -32768 || encoded[1] == -32768) outOfRange++;
+	}
+	CHECK(outOfRange == 0);
+	CHECK(worst <= MaxNormalDegrees);
+
+	// Both poles decode exactly
+	const float up[3] = { 0, 0, 1 }, down[3] = { 0, 0, -1 };
+	CHECK(RoundTripDegrees(up) == 0.0);
+	CHECK(RoundTripDegrees(down) == 0.0);
+
+	// Around the equator, just either side of it, and down the
+	// x = 0 and y = 0 creases of the folded lower half
+	double edgeWorst = 0;
+	for (int i = 0; i <= 720; i++)
+	{
+		float angle = i * 3.14159265f / 360.0f;
+		float c = cosf(angle), s = sinf(angle);
+		const float tilts[5] = { 0.0f, -0.0f, 1e-7f, -1e-7f, -1e-3f };
+		for (float tilt : tilts)
+		{
+			float equator[3] = { c, s, tilt };
+			edgeWorst = std::max(edgeWorst, RoundTripDegrees(equator));
+		}
+
+		float creaseX[3] = { 0.0f, c, -fabsf(s) };
+		float creaseY[3] = { c, -0.0f, -fabsf(s) };
+		float nearCrease[3] = { 1e-6f, c, -fabsf(s) };
+		edgeWorst = std::max(edgeWorst, RoundTripDegrees(creaseX));
+		edgeWorst = std::max(edgeWorst, RoundTripDegrees(creaseY));
+		edgeWorst = std::max(edgeWorst, RoundTripDegrees(nearCrease));
+	}
+	CHECK(edgeWorst <= MaxNormalDegrees);
+
+	// Length doesn't matter, only direction
+	float n[3], scaled[3];
+	RandomUnit(state, n);
+	for (int k = 0; k < 3; k++) scaled[k] = n[k] * 37.0f;
+	int16_t a[2], b[2];
+	EncodeOctahedral(n, a);
+	EncodeOctahedral(scaled, b);
+	CHECK(a[0] == b[0] && a[1] == b[1]);
+}
+
+// --------------------------------------------------------
+// A zero normal (missing from the file) encodes to the center,
+// decodes as +z, and is left out of the measured error
+// --------------------------------------------------------
+static void TestZeroNormals()
+{
+	const float zero[3] = { 0, 0, 0 };
+	int16_t encoded[2] = { 1, 1 };
+	EncodeOctahedral(zero, encoded);
+	CHECK(encoded[0] == 0 && encoded[1] == 0);
+	float decoded[3];
+	DecodeOctahedral(encoded, decoded);
+	CHECK(decoded[0] == 0.0f && decoded[1] == 0.0f && decoded[2] == 1.0f);
+
+	std::vector<MeshVertex> vertices(4);
+	for (unsigned int i = 0; i < vertices.size(); i++)
+	{
+		MeshVertex& v = vertices[i];
+		for (int k = 0; k < 3; k++) v.Position[k] = (float)(i * (k + 1));
+		v.UV[0] = v.UV[1] = i * 0.25f;
+		v.Normal[0] = v.Normal[1] = v.Normal[2] = 0.0f;
+	}
+	vertices[1].Normal[0] = -1.0f;
+
+	VertexQuantization quantization = ComputeVertexQuantization(vertices.data(), vertices.size());
+	std::vector<QuantizedVertex> quantized(vertices.size());
+	QuantizeVertices(vertices.data(), vertices.size(), quantization, quantized.data());
+	QuantizationError error = MeasureQuantizationError(vertices.data(), quantized.data(), vertices.size(), quantization);
+	CHECK(error.NormalDegrees <= MaxNormalDegrees);
+}
+
+// --------------------------------------------------------
+// Flat meshes, a single vertex and constant UVs have zero
+// extent on some axis - those axes come back exactly
+// --------------------------------------------------------
+static void TestDegenerateBounds()
+{
+	uint32_t state = 3;
+	std::vector<MeshVertex> vertices(50);
+	for (MeshVertex& v : vertices)
+	{
+		v.Position[0] = RandomSigned(state) * 10.0f;
+		v.Position[1] = 2.5f;
+		v.Position[2] = -7.25f;
+		RandomUnit(state, v.Normal);
+		v.UV[0] = RandomSigned(state);
+		v.UV[1] = 0.375f;
+	}
+
+	VertexQuantization quantization = ComputeVertexQuantization(vertices.data(), vertices.size());
+	CHECK(quantization.PositionScale[1] == 0.0f && quantization.PositionScale[2] == 0.0f);
+	CHECK(quantization.UVScale[1] == 0.0f);
+
+	std::vector<QuantizedVertex> quantized(vertices.size());
+	QuantizeVertices(vertices.data(), vertices.size(), quantization, quantized.data());
+	int inexact = 0;
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		MeshVertex decoded;
+		DequantizeVertex(quantized[i], quantization, decoded);
+		if (decoded.Position[1] != 2.5f || decoded.Position[2] != -7.25f || decoded.UV[1] != 0.375f) inexact++;
+		if (quantized[i].Position[3] != 0) inexact++;
+	}
+	CHECK(inexact == 0);
+
+	MeshVertex single = vertices[7];
+	quantization = ComputeVertexQuantization(&single, 1);
+	QuantizedVertex q;
+	QuantizeVertices(&single, 1, quantization, &q);
+	QuantizationError error = MeasureQuantizationError(&single, &q, 1, quantization);
+	CHECK(error.Position == 0.0f && error.UV == 0.0f);
+	CHECK(error.NormalDegrees <= MaxNormalDegrees);
+}
+
+// Half of one unorm16 step, plus float rounding in the decode
+static double Tolerance(float offset, float scale)
+{
+	double largest = std::max(fabs(offset), fabs(offset + scale));
+	return 0.5 * scale / 65535.0 + 2.0 * FLT_EPSILON * largest;
+}
+
+// --------------------------------------------------------
+// A random mesh: every position and UV rounds to the nearest
+// step (scale / 65535), and MeasureQuantizationError reports
+// the same worst cases as measuring by hand
+// --------------------------------------------------------
+static void TestMeshError()
+{
+	uint32_t state = 1234;
+	std::vector<MeshVertex> vertices(20000);
+	for (MeshVertex& v : vertices)
+	{
+		v.Position[0] = RandomSigned(state) * 1.0f;
+		v.Position[1] = RandomSigned(state) * 0.6f + 0.6f;
+		v.Position[2] = RandomSigned(state) * 2.25f - 100.0f;
+		RandomUnit(state, v.Normal);
+		v.UV[0] = RandomSigned(state) * 0.5f + 0.5f;
+		v.UV[1] = RandomSigned(state) * 2.0f;
+	}
+
+	VertexQuantization quantization = ComputeVertexQuantization(vertices.data(), vertices.size());
+	std::vector<QuantizedVertex> quantized(vertices.size());
+	QuantizeVertices(vertices.data(), vertices.size(), quantization, quantized.data());
+
+	double worstPosition = 0, worstUV = 0, worstNormal = 0;
+	int positionOver = 0, uvOver = 0;
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		MeshVertex decoded;
+		DequantizeVertex(quantized[i], quantization, decoded);
+		const MeshVertex& v = vertices[i];
+
+		double distance = 0;
+		for (int k = 0; k < 3; k++)
+		{
+			double d = (double)decoded.Position[k] - v.Position[k];
+			if (fabs(d) > Tolerance(quantization.PositionOffset[k], quantization.PositionScale[k])) positionOver++;
+			distance += d * d;
+		}
+		worstPosition = std::max(worstPosition, sqrt(distance));
+
+		for (int k = 0; k < 2; k++)
+		{
+			double d = fabs((double)decoded.UV[k] - v.UV[k]);
+			if (d > Tolerance(quantization.UVOffset[k], quantization.UVScale[k])) uvOver++;
+			worstUV = std::max(worstUV, d);
+		}
+		worstNormal = std::max(worstNormal, AngleDegrees(v.Normal, decoded.Normal));
+	}
+	CHECK(positionOver == 0);
+	CHECK(uvOver == 0);
+	CHECK(worstNormal <= MaxNormalDegrees);
+
+	QuantizationError error = MeasureQuantizationError(vertices.data(), quantized.data(), vertices.size(), quantization);
+	CHECK(fabs(error.Position - worstPosition) <= 1e-3 * worstPosition);
+	CHECK(fabs(error.UV - worstUV) <= 1e-3 * worstUV);
+	CHECK(fabs(error.NormalDegrees - worstNormal) <= 0.1 * worstNormal);
+	CHECK(error.NormalDegrees <= MaxNormalDegrees);
+}
+
+int main()
+{
+	TestNormals();
+	TestZeroNormals();
+	TestDegenerateBounds();
+	TestMeshError();
+	return CheckResult("VertexQuantizeTests");
+}
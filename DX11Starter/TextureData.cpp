@@ -0,0 +1,230 @@
+#include "TextureData.h"
+#include <fstream>
+#include <cwctype>
+#include <wincodec.h>
+#include "DDSTextureLoader.h"
+
+TextureData::TextureData()
+{
+	Width = 0;
+	Height = 0;
+	IsDDS = false;
+}
+
+static bool HasExtension(const std::wstring& path, const wchar_t* extension)
+{
+	size_t dot = path.find_last_of(L'.');
+	if (dot == std::wstring::npos) return false;
+
+	std::wstring actual = path.substr(dot + 1);
+	for (wchar_t& c : actual)
+		c = (wchar_t)towlower(c);
+	return actual == extension;
+}
+
+static bool ReadWholeFile(const std::wstring& path, std::vector<unsigned char>& out)
+{
+	std::ifstream file(path.c_str(), std::ios::binary | std::ios::ate);
+	if (!file) return false;
+
+	std::streamoff size = file.tellg();
+	if (size <= 0) return false;
+
+	out.resize((size_t)size);
+	file.seekg(0);
+	file.read((char*)out.data(), size);
+	return file.good();
+}
+
+// --------------------------------------------------------
+// Decodes an image file in memory with WIC, converting
+// whatever it holds to 32bpp RGBA
+// --------------------------------------------------------
+static bool DecodeImage(const std::vector<unsigned char>& file, TextureData& out)
+{
+	// Workers aren't COM threads yet.  The owning thread is
+	// already apartment threaded, which refuses this but still
+	// has WIC available.
+	HRESULT comResult = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+	IWICImagingFactory* factory = nullptr;
+	IWICStream* stream = nullptr;
+	IWICBitmapDecoder* decoder = nullptr;
+	IWICBitmapFrameDecode* frame = nullptr;
+	IWICFormatConverter* converter = nullptr;
+	bool decoded = false;
+
+	HRESULT hr = CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&factory));
+	if (SUCCEEDED(hr)) hr = factory->CreateStream(&stream);
+	if (SUCCEEDED(hr)) hr = stream->InitializeFromMemory((BYTE*)file.data(), (DWORD)file.size());
+	if (SUCCEEDED(hr)) hr = factory->CreateDecoderFromStream(stream, nullptr, WICDecodeMetadataCacheOnDemand, &decoder);
+	if (SUCCEEDED(hr)) hr = decoder->GetFrame(0, &frame);
+	if (SUCCEEDED(hr)) hr = factory->CreateFormatConverter(&converter);
+	if (SUCCEEDED(hr))
+	{
+		hr = converter->Initialize(frame, GUID_WICPixelFormat32bppRGBA,
+			WICBitmapDitherTypeNone, nullptr, 0.0, WICBitmapPaletteTypeCustom);
+	}
+	if (SUCCEEDED(hr)) hr = converter->GetSize(&out.Width, &out.Height);
+	if (SUCCEEDED(hr) && out.Width > 0 && out.Height > 0)
+	{
+		UINT stride = out.Width * 4;
+		out.Pixels.resize((size_t)stride * out.Height);
+		hr = converter->CopyPixels(nullptr, stride, (UINT)out.Pixels.size(), out.Pixels.data());
+		decoded = SUCCEEDED(hr);
+	}
+
+	if (converter) converter->Release();
+	if (frame) frame->Release();
+	if (decoder) decoder->Release();
+	if (stream) stream->Release();
+	if (factory) factory->Release();
+
+	if (SUCCEEDED(comResult))
+		CoUninitialize();
+	return decoded;
+}
+
+bool LoadTextureData(const std::wstring& path, TextureData& out)
+{
+	out = TextureData();
+	if (HasExtension(path, L"dds"))
+	{
+		out.IsDDS = true;
+		return ReadWholeFile(path, out.FileData);
+	}
+
+	std::vector<unsigned char> file;
+	return ReadWholeFile(path, file) && DecodeImage(file, out);
+}
+
+bool CreateTextureFromData(ID3D11Device* device, ID3D11DeviceContext* context,
+	const TextureData& data, ID3D11ShaderResourceView** srv)
+{
+	*srv = nullptr;
+	if (data.IsDDS)
+	{
+		if (data.FileData.empty()) return false;
+		HRESULT hr = DirectX::CreateDDSTextureFromMemory(device,
+			data.FileData.data(), data.FileData.size(), nullptr, srv);
+		return SUCCEEDED(hr);
+	}
+	if (data.Pixels.empty()) return false;
+
+	// A full mip chain, generated from the top level below
+	D3D11_TEXTURE2D_DESC desc = {};
+	desc.Width = data.Width;
+	desc.Height = data.Height;
+	desc.MipLevels = 0;
+	desc.ArraySize = 1;
+	desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET;
+	desc.MiscFlags = D3D11_RESOURCE_MISC_GENERATE_MIPS;
+
+	ID3D11Texture2D* texture = nullptr;
+	if (FAILED(device->CreateTexture2D(&desc, nullptr, &texture)))
+		return false;
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Format = desc.Format;
+	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+	srvDesc.Texture2D.MipLevels = (UINT)-1;
+	HRESULT hr = device->CreateShaderResourceView(texture, &srvDesc, srv);
+	if (SUCCEEDED(hr))
+	{
+		context->UpdateSubresource(texture, 0, nullptr, data.Pixels.data(), data.Width * 4, 0);
+		context->GenerateMips(*srv);
+	}
+
+	// The view keeps the texture alive
+	texture->Release();
+	return SUCCEEDED(hr);
+}
+
+// --------------------------------------------------------
+// Bits per texel for the formats our loaders produce, or per
+// texel of a 4x4 block for the compressed ones
+// --------------------------------------------------------
+static size_t BitsPerPixel(DXGI_FORMAT format)
+{
+	switch (format)
+	{
+	case DXGI_FORMAT_R32G32B32A32_FLOAT:
+	case DXGI_FORMAT_R32G32B32A32_UINT:
+		return 128;
+	case DXGI_FORMAT_R16G16B16A16_FLOAT:
+	case DXGI_FORMAT_R16G16B16A16_UNORM:
+	case DXGI_FORMAT_R32G32_FLOAT:
+		return 64;
+	case DXGI_FORMAT_R8G8_UNORM:
+	case DXGI_FORMAT_R16_FLOAT:
+	case DXGI_FORMAT_R16_UNORM:
+	case DXGI_FORMAT_B5G6R5_UNORM:
+		return 16;
+	case DXGI_FORMAT_R8_UNORM:
+	case DXGI_FORMAT_A8_UNORM:
+	case DXGI_FORMAT_BC2_UNORM:
+	case DXGI_FORMAT_BC2_UNORM_SRGB:
+	case DXGI_FORMAT_BC3_UNORM:
+	case DXGI_FORMAT_BC3_UNORM_SRGB:
+	case DXGI_FORMAT_BC5_UNORM:
+	case DXGI_FORMAT_BC5_SNORM:
+	case DXGI_FORMAT_BC6H_UF16:
+	case DXGI_FORMAT_BC6H_SF16:
+	case DXGI_FORMAT_BC7_UNORM:
+	case DXGI_FORMAT_BC7_UNORM_SRGB:
+		return 8;
+	case DXGI_FORMAT_BC1_UNORM:
+	case DXGI_FORMAT_BC1_UNORM_SRGB:
+	case DXGI_FORMAT_BC4_UNORM:
+	case DXGI_FORMAT_BC4_SNORM:
+		return 4;
+	default:
+		// RGBA8, BGRA8, R10G10B10A2, R32 and friends
+		return 32;
+	}
+}
+
+static bool IsBlockCompressed(DXGI_FORMAT format)
+{
+	return (format >= DXGI_FORMAT_BC1_TYPELESS && format <= DXGI_FORMAT_BC5_SNORM)
+		|| (format >= DXGI_FORMAT_BC6H_TYPELESS && format <= DXGI_FORMAT_BC7_UNORM_SRGB);
+}
+
+size_t GetTextureMemorySize(ID3D11ShaderResourceView* srv)
+{
+	if (!srv) return 0;
+
+	ID3D11Resource* resource = nullptr;
+	srv->GetResource(&resource);
+	ID3D11Texture2D* texture = nullptr;
+	HRESULT hr = resource->QueryInterface(__uuidof(ID3D11Texture2D), (void**)&texture);
+	resource->Release();
+	if (FAILED(hr)) return 0;
+
+	D3D11_TEXTURE2D_DESC desc;
+	texture->GetDesc(&desc);
+	texture->Release();
+
+	size_t bits = BitsPerPixel(desc.Format);
+	bool blocks = IsBlockCompressed(desc.Format);
+	size_t bytes = 0;
+	for (UINT mip = 0; mip < desc.MipLevels; mip++)
+	{
+		size_t width = desc.Width >> mip;
+		size_t height = desc.Height >> mip;
+		if (width == 0) width = 1;
+		if (height == 0) height = 1;
+
+		// Compressed mips are stored as whole 4x4 blocks
+		if (blocks)
+		{
+			width = (width + 3) & ~(size_t)3;
+			height = (height + 3) & ~(size_t)3;
+		}
+		bytes += width * height * bits / 8;
+	}
+	return bytes * desc.ArraySize;
+}
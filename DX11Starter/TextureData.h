@@ -0,0 +1,37 @@
+#pragma once
+#include <d3d11.h>
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------
+// A texture read off disk but not yet on the GPU, so the slow
+// part can happen away from the device context.
+//
+// WIC images (jpg, png, bmp...) are decoded to tightly packed
+// R8G8B8A8 here, the same format WICTextureLoader picks for
+// them.  DDS files are already in a GPU format and are kept
+// as they are.
+// --------------------------------------------------------
+struct TextureData
+{
+	TextureData();
+
+	unsigned int Width;
+	unsigned int Height;
+	std::vector<unsigned char> Pixels;
+
+	bool IsDDS;
+	std::vector<unsigned char> FileData;
+};
+
+// Reads and decodes a texture.  Safe on any thread.
+bool LoadTextureData(const std::wstring& path, TextureData& out);
+
+// Creates the texture and its view - needs the immediate
+// context to generate mips, so only on the owning thread
+bool CreateTextureFromData(ID3D11Device* device, ID3D11DeviceContext* context,
+	const TextureData& data, ID3D11ShaderResourceView** srv);
+
+// Bytes a texture takes on the GPU, mips and array slices
+// included - 0 for a null view
+size_t GetTextureMemorySize(ID3D11ShaderResourceView* srv);
@@ -0,0 +1,221 @@
+#include "VertexQuantize.h"
+#include <cmath>
+
+static_assert(sizeof(QuantizedVertex) == 16, "QuantizedVertex must stay 16 bytes");
+static_assert(sizeof(VertexQuantization) == 48, "VertexQuantization must match the shader's constants");
+
+// Same conversions the input assembler does
+static inline uint16_t ToUnorm16(float value)
+{
+	if (!(value > 0.0f)) return 0;
+	if (value >= 1.0f) return 65535;
+	return (uint16_t)(value * 65535.0f + 0.5f);
+}
+
+static inline float FromUnorm16(uint16_t value)
+{
+	return value / 65535.0f;
+}
+
+static inline float FromSnorm16(int16_t value)
+{
+	float f = value / 32767.0f;
+	return f < -1.0f ? -1.0f : f;
+}
+
+static inline float SignNotZero(float value)
+{
+	return value >= 0.0f ? 1.0f : -1.0f;
+}
+
+VertexQuantization ComputeVertexQuantization(const MeshVertex* vertices, size_t count)
+{
+	VertexQuantization quantization = {};
+	MeshBounds bounds = ComputeMeshBounds(vertices, count);
+
+	float uvMin[2] = { 0, 0 };
+	float uvMax[2] = { 0, 0 };
+	for (size_t i = 0; i < count; i++)
+	{
+		for (int k = 0; k < 2; k++)
+		{
+			float uv = vertices[i].UV[k];
+			if (i == 0 || uv < uvMin[k]) uvMin[k] = uv;
+			if (i == 0 || uv > uvMax[k]) uvMax[k] = uv;
+		}
+	}
+
+	for (int k = 0; k < 3; k++)
+	{
+		quantization.PositionOffset[k] = bounds.Min[k];
+		quantization.PositionScale[k] = bounds.Max[k] - bounds.Min[k];
+	}
+	for (int k = 0; k < 2; k++)
+	{
+		quantization.UVOffset[k] = uvMin[k];
+		quantization.UVScale[k] = uvMax[k] - uvMin[k];
+	}
+	return quantization;
+}
+
+// Fold the lower hemisphere over onto the upper one
+static void OctahedralProject(const float n[3], float& u, float& v)
+{
+	float length = fabsf(n[0]) + fabsf(n[1]) + fabsf(n[2]);
+	if (length == 0.0f) { u = v = 0.0f; return; }
+
+	u = n[0] / length;
+	v = n[1] / length;
+	if (n[2] < 0.0f)
+	{
+		float foldU = (1.0f - fabsf(v)) * SignNotZero(u);
+		float foldV = (1.0f - fabsf(u)) * SignNotZero(v);
+		u = foldU;
+		v = foldV;
+	}
+}
+
+void DecodeOctahedral(const int16_t encoded[2], float normal[3])
+{
+	float u = FromSnorm16(encoded[0]);
+	float v = FromSnorm16(encoded[1]);
+	float z = 1.0f - fabsf(u) - fabsf(v);
+	if (z < 0.0f)
+	{
+		float foldU = (1.0f - fabsf(v)) * SignNotZero(u);
+		float foldV = (1.0f - fabsf(u)) * SignNotZero(v);
+		u = foldU;
+		v = foldV;
+	}
+
+	float length = sqrtf(u * u + v * v + z * z);
+	normal[0] = u / length;
+	normal[1] = v / length;
+	normal[2] = z / length;
+}
+
+void EncodeOctahedral(const float normal[3], int16_t out[2])
+{
+	float u, v;
+	OctahedralProject(normal, u, v);
+
+	float length = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+	float n[3] = { 0, 0, 1 };
+	if (length > 0.0f)
+		for (int k = 0; k < 3; k++) n[k] = normal[k] / length;
+
+	float baseU = floorf(u * 32767.0f);
+	float baseV = floorf(v * 32767.0f);
+	float bestDistance = 5.0f;
+	out[0] = out[1] = 0;
+
+	// Candidates are compared by distance rather than by dot product:
+	// their dots all round to within a float ulp of 1
+	for (int i = 0; i < 4; i++)
+	{
+		float cu = baseU + (i & 1);
+		float cv = baseV + (i >> 1);
+		if (cu < -32767.0f || cu > 32767.0f || cv < -32767.0f || cv > 32767.0f) continue;
+
+		int16_t candidate[2] = { (int16_t)cu, (int16_t)cv };
+		float decoded[3];
+		DecodeOctahedral(candidate, decoded);
+		float distance = 0;
+		for (int k = 0; k < 3; k++)
+			distance += (decoded[k] - n[k]) * (decoded[k] - n[k]);
+		if (distance < bestDistance)
+		{
+			bestDistance = distance;
+			out[0] = candidate[0];
+			out[1] = candidate[1];
+		}
+	}
+}
+
+void QuantizeVertices(const MeshVertex* vertices, size_t count, const VertexQuantization& quantization, QuantizedVertex* out)
+{
+	float positionInverse[3];
+	float uvInverse[2];
+	for (int k = 0; k < 3; k++)
+		positionInverse[k] = quantization.PositionScale[k] > 0 ? 1.0f / quantization.PositionScale[k] : 0.0f;
+	for (int k = 0; k < 2; k++)
+		uvInverse[k] = quantization.UVScale[k] > 0 ? 1.0f / quantization.UVScale[k] : 0.0f;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		const MeshVertex& vertex = vertices[i];
+		QuantizedVertex& q = out[i];
+
+		for (int k = 0; k < 3; k++)
+			q.Position[k] = ToUnorm16((vertex.Position[k] - quantization.PositionOffset[k]) * positionInverse[k]);
+		q.Position[3] = 0;
+
+		EncodeOctahedral(vertex.Normal, q.Normal);
+
+		for (int k = 0; k < 2; k++)
+			q.UV[k] = ToUnorm16((vertex.UV[k] - quantization.UVOffset[k]) * uvInverse[k]);
+	}
+}
+
+void DequantizeVertex(const QuantizedVertex& vertex, const VertexQuantization& quantization, MeshVertex& out)
+{
+	for (int k = 0; k < 3; k++)
+		out.Position[k] = quantization.PositionOffset[k] + FromUnorm16(vertex.Position[k]) * quantization.PositionScale[k];
+
+	DecodeOctahedral(vertex.Normal, out.Normal);
+
+	for (int k = 0; k < 2; k++)
+		out.UV[k] = quantization.UVOffset[k] + FromUnorm16(vertex.UV[k]) * quantization.UVScale[k];
+}
+
+// --------------------------------------------------------
+// Decodes every vertex again and compares with the original.
+// Zero-length normals (missing from the file) are skipped.
+// --------------------------------------------------------
+QuantizationError MeasureQuantizationError(const MeshVertex* original, const QuantizedVertex* quantized,
+	size_t count, const VertexQuantization& quantization)
+{
+	QuantizationError error = {};
+	float maxNormalRadians = 0.0f;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		MeshVertex decoded;
+		DequantizeVertex(quantized[i], quantization, decoded);
+		const MeshVertex& vertex = original[i];
+
+		float distance = 0;
+		for (int k = 0; k < 3; k++)
+		{
+			float d = decoded.Position[k] - vertex.Position[k];
+			distance += d * d;
+		}
+		distance = sqrtf(distance);
+		if (distance > error.Position) error.Position = distance;
+
+		for (int k = 0; k < 2; k++)
+		{
+			float d = fabsf(decoded.UV[k] - vertex.UV[k]);
+			if (d > error.UV) error.UV = d;
+		}
+
+		// atan2 of the cross and dot products stays accurate for tiny
+		// angles, where acos of a float dot bottoms out near 0.03 degrees
+		const float* n = vertex.Normal;
+		const float* d = decoded.Normal;
+		if (n[0] != 0.0f || n[1] != 0.0f || n[2] != 0.0f)
+		{
+			float cross[3] = {
+				n[1] * d[2] - n[2] * d[1],
+				n[2] * d[0] - n[0] * d[2],
+				n[0] * d[1] - n[1] * d[0] };
+			float sine = sqrtf(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]);
+			float cosine = n[0] * d[0] + n[1] * d[1] + n[2] * d[2];
+			float radians = atan2f(sine, cosine);
+			if (radians > maxNormalRadians) maxNormalRadians = radians;
+		}
+	}
+
+	error.NormalDegrees = maxNormalRadians * 57.2957795f;
+	return error;
+}
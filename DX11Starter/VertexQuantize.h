@@ -0,0 +1,64 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "MeshData.h"
+
+// --------------------------------------------------------
+// 16-byte compressed vertex, half the size of Vertex
+//
+// Position - unorm16 across the mesh's bounds; the 4th is padding
+//            since there's no three-component 16-bit format
+// Normal   - Octahedral encoded, snorm16
+// UV       - unorm16 across the mesh's UV range
+//
+// Read through R16G16B16A16_UNORM / R16G16_SNORM / R16G16_UNORM
+// by QuantizedVS.hlsl - see the "_UNORM" and "_SNORM"
+// semantics in SimpleShader.
+// --------------------------------------------------------
+struct QuantizedVertex
+{
+	uint16_t Position[4];
+	int16_t Normal[2];
+	uint16_t UV[2];
+};
+
+// --------------------------------------------------------
+// Turns the normalized values back into the mesh's own:
+// value = offset + normalized * scale.  Laid out like the
+// shader's constant buffer struct, padding included.
+// --------------------------------------------------------
+struct VertexQuantization
+{
+	float PositionOffset[3];
+	float Padding0;
+	float PositionScale[3];
+	float Padding1;
+	float UVOffset[2];
+	float UVScale[2];
+};
+
+// Worst case differences from the original vertices
+struct QuantizationError
+{
+	float Position;			// In model units
+	float NormalDegrees;
+	float UV;
+};
+
+// Offsets and scales that cover every vertex
+VertexQuantization ComputeVertexQuantization(const MeshVertex* vertices, size_t count);
+
+// Encode / decode kernels
+void QuantizeVertices(const MeshVertex* vertices, size_t count, const VertexQuantization& quantization, QuantizedVertex* out);
+void DequantizeVertex(const QuantizedVertex& vertex, const VertexQuantization& quantization, MeshVertex& out);
+
+// --------------------------------------------------------
+// Octahedral normals.  The encoder tries rounding each
+// component both ways and keeps whichever decodes closest,
+// which roughly halves the worst case error.
+// --------------------------------------------------------
+void EncodeOctahedral(const float normal[3], int16_t out[2]);
+void DecodeOctahedral(const int16_t encoded[2], float normal[3]);
+
+QuantizationError MeasureQuantizationError(const MeshVertex* original, const QuantizedVertex* quantized,
+	size_t count, const VertexQuantization& quantization);